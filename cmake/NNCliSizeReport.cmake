@@ -0,0 +1,27 @@
+set(NN_CLI_SIZE_REPORT_SCRIPT
+    ${CMAKE_CURRENT_LIST_DIR}/../tools/nn_cli_size_report.py
+    CACHE INTERNAL "Reporter of the size of each symbol"
+)
+
+# Adds the target `${target}_size_report`, which shows the .text, .rodata,
+# .data and .bss used by each symbol of nn_cli in `map_file`. The target has
+# to be linked with `-Wl,-Map=${map_file}`. nn_cli is built with a section per
+# symbol so that the map file has the size of each of them.
+function(nn_cli_add_size_report target map_file)
+    # Found again for the projects which add nn_cli as a subdirectory
+    find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+    target_compile_options(nn_cli
+        PRIVATE
+        -ffunction-sections
+        -fdata-sections
+    )
+
+    add_custom_target(${target}_size_report
+        COMMAND ${Python3_EXECUTABLE} ${NN_CLI_SIZE_REPORT_SCRIPT}
+            --filter libnn_cli ${map_file}
+        DEPENDS ${target} ${NN_CLI_SIZE_REPORT_SCRIPT}
+        COMMENT "Size of nn_cli in ${target}"
+        VERBATIM
+    )
+endfunction()
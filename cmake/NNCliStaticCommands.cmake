@@ -0,0 +1,35 @@
+find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+set(NN_CLI_GEN_COMMANDS_SCRIPT
+    ${CMAKE_CURRENT_LIST_DIR}/../tools/nn_cli_gen_commands.py
+    CACHE INTERNAL "Generator of the static command table"
+)
+
+# Generates the table of the commands registered with NNCLI_COMMAND() in the
+# sources of `target` and adds it to the target. Duplicate command names fail
+# the build. The target has to be linked with nn_cli.
+function(nn_cli_add_static_commands target)
+    # Found again for the projects which add nn_cli as a subdirectory
+    find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+    get_target_property(sources ${target} SOURCES)
+    get_target_property(source_dir ${target} SOURCE_DIR)
+    set(abs_sources "")
+    foreach(source IN LISTS sources)
+        get_filename_component(abs_source ${source} ABSOLUTE
+            BASE_DIR ${source_dir}
+        )
+        list(APPEND abs_sources ${abs_source})
+    endforeach()
+
+    set(output ${CMAKE_CURRENT_BINARY_DIR}/${target}_static_commands.c)
+    add_custom_command(
+        OUTPUT ${output}
+        COMMAND ${Python3_EXECUTABLE} ${NN_CLI_GEN_COMMANDS_SCRIPT}
+            --output ${output} ${abs_sources}
+        DEPENDS ${abs_sources} ${NN_CLI_GEN_COMMANDS_SCRIPT}
+        COMMENT "Generating the static command table of ${target}"
+        VERBATIM
+    )
+    target_sources(${target} PRIVATE ${output})
+endfunction()
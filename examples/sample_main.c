@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "nn_cli.h"
 
@@ -56,6 +58,84 @@ done:
     return res;
 }
 
+// Registered at build time. See nn_cli_add_static_commands() in
+// CMakeLists.txt.
+NNCLI_COMMAND(sample_status,
+              .m_func = Sample_ShowStatusCmd,
+              .m_name = "sample-status",
+              .m_options = NULL,
+              .m_help_msg = "Show current sample status: <on/off>");
+
+static NNCli_Err_t Sample_SleepCmd(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        printf("[NN] %s:%d Error input!\n", __FILE__, __LINE__);
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    // Ctrl-C or the timeout stops this.
+    int remaining_ms = atoi(argv[1]) * 1000;
+    for (; remaining_ms > 0 && !NNCli_IsCancelled(); remaining_ms -= 100)
+    {
+        usleep(100 * 1000);
+    }
+
+    printf("Slept %s\n", (remaining_ms > 0) ? "partially" : "fully");
+    return NN_CLI__SUCCESS;
+}
+
+NNCLI_COMMAND(sample_sleep,
+              .m_func = Sample_SleepCmd,
+              .m_name = "sample-sleep",
+              .m_options = "seconds",
+              .m_help_msg = "Sleep up to 5 seconds",
+              .m_timeout_ms = 5000);
+
+typedef struct
+{
+    time_t m_end;
+    unsigned long m_count;
+} SampleCountState_t;
+
+// Counts in the background while the prompt keeps working.
+static NNCli_Err_t Sample_CountCmd(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        printf("[NN] %s:%d Error input!\n", __FILE__, __LINE__);
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    SampleCountState_t *state = NNCli_GetResumeState(sizeof(*state));
+    if (state == NULL)
+    {
+        return NN_CLI__GENERAL_ERROR;
+    }
+    if (state->m_end == 0)
+    {
+        state->m_end = time(NULL) + atoi(argv[1]);
+    }
+
+    while (!NNCli_ShouldYield())
+    {
+        state->m_count++;
+    }
+    if (!NNCli_IsCancelled() && time(NULL) < state->m_end)
+    {
+        return NN_CLI__IN_PROGRESS;
+    }
+
+    printf("Counted to %lu\n", state->m_count);
+    return NN_CLI__SUCCESS;
+}
+
+NNCLI_COMMAND(sample_count,
+              .m_func = Sample_CountCmd,
+              .m_name = "sample-count",
+              .m_options = "seconds",
+              .m_help_msg = "Count in the background");
+
 static NNCli_Err_t Sample_CtrlCmd(int argc, char **argv)
 {
     int res = NN_CLI__SUCCESS;
@@ -97,6 +177,25 @@ done:
     return res;
 }
 
+static void Sample_CompleteCtrlArgs(int argc, char **argv,
+                                    NNCli_ArgCandidates_t *a_candidates)
+{
+    if (argc == 2)
+    {
+        NNCli_AddArgCandidate(a_candidates, "on");
+        NNCli_AddArgCandidate(a_candidates, "off");
+    }
+}
+
+static const char *s_replay_filename = NULL;
+static bool s_replay_realtime = false;
+static bool s_zero_heap = false;
+
+// The blocks for --zero-heap. Run `pools` to see how many are used.
+static NN_CLI__POOL_BUF(s_small_blocks, 64, 256);
+static NN_CLI__POOL_BUF(s_medium_blocks, 1024, 32);
+static NN_CLI__POOL_BUF(s_large_blocks, 16384, 4);
+
 static NNCli_Option_t parse_args_and_get_option(int argc, char **argv)
 {
     NNCli_Option_t ret_option = {0};
@@ -108,10 +207,15 @@ static NNCli_Option_t parse_args_and_get_option(int argc, char **argv)
         {"async", no_argument, NULL, 'a'},
         {"key-codes", no_argument, NULL, 'k'},
         {"multi-line", no_argument, NULL, 'm'},
+        {"record", required_argument, NULL, 'r'},
+        {"replay", required_argument, NULL, 'p'},
+        {"realtime", no_argument, NULL, 't'},
+        {"rpc", no_argument, NULL, 'j'},
+        {"zero-heap", no_argument, NULL, 'z'},
         {0, 0, 0, 0},
     };
 
-    while ((opt = getopt_long(argc, argv, "hakm", long_options,
+    while ((opt = getopt_long(argc, argv, "hakmr:p:tjz", long_options,
                               &option_index)) != -1)
     {
         switch (opt)
@@ -127,6 +231,20 @@ static NNCli_Option_t parse_args_and_get_option(int argc, char **argv)
                 printf(
                     "  -m, --multi-line    The string will automatically wrap "
                     "when it reaches the edge of the screen.\n");
+                printf(
+                    "  -r, --record FILE    Records the typed keys to FILE.\n");
+                printf(
+                    "  -p, --replay FILE    Replays FILE without a terminal and "
+                    "reports the timing.\n");
+                printf(
+                    "  -t, --realtime    Replays at the recorded speed "
+                    "instead of as fast as possible.\n");
+                printf(
+                    "  -j, --rpc    Runs JSON requests from stdin instead of "
+                    "the prompt.\n");
+                printf(
+                    "  -z, --zero-heap    Allocates from static pools instead "
+                    "of the heap.\n");
                 exit(0);
 
             case 'a':
@@ -145,6 +263,26 @@ static NNCli_Option_t parse_args_and_get_option(int argc, char **argv)
                 ret_option.m_enable_multi_line = true;
                 break;
 
+            case 'r':
+                ret_option.m_record_filename = optarg;
+                break;
+
+            case 'p':
+                s_replay_filename = optarg;
+                break;
+
+            case 't':
+                s_replay_realtime = true;
+                break;
+
+            case 'j':
+                ret_option.m_rpc = true;
+                break;
+
+            case 'z':
+                s_zero_heap = true;
+                break;
+
             case '?':
                 fprintf(stderr, "Invalid option\n");
                 exit(1);
@@ -168,24 +306,14 @@ int main(int argc, char **argv)
 {
     NNCli_Option_t option = parse_args_and_get_option(argc, argv);
     option.m_history_filename = "/tmp/history.txt";
-
-    static const NNCli_Command_t sample_status_cmd_config = {
-        .m_func = Sample_ShowStatusCmd,
-        .m_name = "sample-status",
-        .m_options = NULL,
-        .m_help_msg = "Show current sample status: <on/off>",
-    };
-
-    if (NNCli_RegisterCommand(&sample_status_cmd_config) != NN_CLI__SUCCESS)
-    {
-        return -1;
-    }
+    option.m_alias_filename = "/tmp/aliases.txt";
 
     static const NNCli_Command_t sample_ctrl_cmd_config = {
         .m_func = Sample_CtrlCmd,
         .m_name = "sample-ctrl",
         .m_options = "on/off",
         .m_help_msg = "Change sample status: <on/off>",
+        .m_complete_args = Sample_CompleteCtrlArgs,
     };
 
     if (NNCli_RegisterCommand(&sample_ctrl_cmd_config) != NN_CLI__SUCCESS)
@@ -193,15 +321,44 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    if (s_zero_heap)
+    {
+        const NNCli_Pool_t pools[] = {
+            {s_small_blocks, 64, 256},
+            {s_medium_blocks, 1024, 32},
+            {s_large_blocks, 16384, 4},
+        };
+        if (NNCli_UsePools(pools, sizeof(pools) / sizeof(pools[0])) !=
+            NN_CLI__SUCCESS)
+        {
+            return -1;
+        }
+    }
+
     if (NNCli_Init(&option) != NN_CLI__SUCCESS)
     {
         return -1;
     }
 
-    while (NNCli_Run() == NN_CLI__SUCCESS)
+    if (s_replay_filename != NULL)
     {
-        /* do nothing */
+        NNCli_ReplayOption_t replay_option = {
+            .m_realtime = s_replay_realtime,
+            .m_report = stderr,
+        };
+        return NNCli_Replay(s_replay_filename, &replay_option, NULL) ==
+                       NN_CLI__SUCCESS
+                   ? 0
+                   : -1;
     }
 
+    NNCli_Err_t err;
+    do
+    {
+        // In the async mode, NN_CLI__IN_PROGRESS is returned while a line is
+        // being edited.
+        err = NNCli_Run();
+    } while (err == NN_CLI__SUCCESS || err == NN_CLI__IN_PROGRESS);
+
     return 0;
 }
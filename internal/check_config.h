@@ -2,10 +2,237 @@
 
 #include "nn_cli_config.h"
 
+// Defaults for targets with little RAM, e.g. microcontrollers. Define this in
+// nn_cli_config.h or with the CMake option NN_CLI_LOW_FOOTPRINT. Each size
+// can still be overridden one by one.
+#ifdef NN_CLI__LOW_FOOTPRINT
+#ifndef NN_CLI__MAX_COMMAND_NUM
+#define NN_CLI__MAX_COMMAND_NUM 12
+#endif
+#ifndef NN_CLI__LINE_MAX_LEN
+#define NN_CLI__LINE_MAX_LEN 128
+#endif
+#ifndef NN_CLI__MAX_WORDS_PER_COMMAND
+#define NN_CLI__MAX_WORDS_PER_COMMAND 8
+#endif
+#ifndef NN_CLI__MAX_TOKENS_PER_LINE
+#define NN_CLI__MAX_TOKENS_PER_LINE 16
+#endif
+#ifndef NN_CLI__HINT_MAX_LEN
+#define NN_CLI__HINT_MAX_LEN 32
+#endif
+#ifndef NN_CLI__IO_READ_BUF_LEN
+#define NN_CLI__IO_READ_BUF_LEN 32
+#endif
+#ifndef NN_CLI__SHARE_EDIT_BUFFER
+#define NN_CLI__SHARE_EDIT_BUFFER 1
+#endif
+#ifndef NN_CLI__MAX_PIPELINE_STAGES
+#define NN_CLI__MAX_PIPELINE_STAGES 2
+#endif
+#ifndef NN_CLI__PIPELINE_LINE_MAX_LEN
+#define NN_CLI__PIPELINE_LINE_MAX_LEN 64
+#endif
+#ifndef NN_CLI__CACHE_ENTRY_NUM
+#define NN_CLI__CACHE_ENTRY_NUM 1
+#endif
+#ifndef NN_CLI__CACHE_OUTPUT_MAX_LEN
+#define NN_CLI__CACHE_OUTPUT_MAX_LEN 256
+#endif
+#ifndef NN_CLI__MAX_SCHEDULED_JOB_NUM
+#define NN_CLI__MAX_SCHEDULED_JOB_NUM 1
+#endif
+#ifndef NN_CLI__MAX_ALIAS_NUM
+#define NN_CLI__MAX_ALIAS_NUM 4
+#endif
+#ifndef NN_CLI__MAX_ARG_COMPLETIONS
+#define NN_CLI__MAX_ARG_COMPLETIONS 4
+#endif
+#ifndef NN_CLI__RPC_FRAME_MAX_LEN
+#define NN_CLI__RPC_FRAME_MAX_LEN 256
+#endif
+#ifndef NN_CLI__FOREACH_THREAD_NUM
+#define NN_CLI__FOREACH_THREAD_NUM 1
+#endif
+#ifndef NN_CLI__MAX_FOREACH_ITEM_NUM
+#define NN_CLI__MAX_FOREACH_ITEM_NUM 16
+#endif
+#ifndef NN_CLI__MAX_POOL_NUM
+#define NN_CLI__MAX_POOL_NUM 4
+#endif
+#ifndef NN_CLI__MAX_REPEAT_NUM
+#define NN_CLI__MAX_REPEAT_NUM 100
+#endif
+#ifndef NN_CLI__HISTORY_INDEX_MAX_NUM
+#define NN_CLI__HISTORY_INDEX_MAX_NUM 32
+#endif
+#ifndef NN_CLI__MAX_PLUGIN_NUM
+#define NN_CLI__MAX_PLUGIN_NUM 1
+#endif
+#ifndef NN_CLI__MAX_PLUGIN_COMMAND_NUM
+#define NN_CLI__MAX_PLUGIN_COMMAND_NUM 4
+#endif
+#endif
+
+// The number of commands registered with NNCli_RegisterCommand(). Commands
+// registered with NNCLI_COMMAND() do not count.
 #ifndef NN_CLI__MAX_COMMAND_NUM
 #define NN_CLI__MAX_COMMAND_NUM 200
 #endif
 
+// The longest line which can be run, including the null terminator, since a
+// line is split in a buffer of this size. The headless editor of `m_io` and
+// NNCli_FeedInput() takes longer lines, but they are rejected when they are
+// run. Also the size of the line buffers of the interactive prompt and the
+// scheduled commands.
+#ifndef NN_CLI__LINE_MAX_LEN
+#define NN_CLI__LINE_MAX_LEN 1024
+#endif
+
+// The number of words in a command, including its name.
+#ifndef NN_CLI__MAX_WORDS_PER_COMMAND
+#define NN_CLI__MAX_WORDS_PER_COMMAND 20
+#endif
+
+// The number of words, `|` and `;` in a line.
+#ifndef NN_CLI__MAX_TOKENS_PER_LINE
+#define NN_CLI__MAX_TOKENS_PER_LINE 64
+#endif
+
+// Options of a command longer than this are cut in the hint.
+#ifndef NN_CLI__HINT_MAX_LEN
+#define NN_CLI__HINT_MAX_LEN 256
+#endif
+
+// The input is read from `m_io` in chunks of this size.
+#ifndef NN_CLI__IO_READ_BUF_LEN
+#define NN_CLI__IO_READ_BUF_LEN 256
+#endif
+
+// If 1, the line being edited in the async mode and the one fed to
+// NNCli_FeedInput() or `m_io` are kept in the same buffer. Only one of these
+// inputs can be used then.
+#ifndef NN_CLI__SHARE_EDIT_BUFFER
+#define NN_CLI__SHARE_EDIT_BUFFER 0
+#endif
+
+// The number of stages in `cmd | filter | ...`, including the command.
+#ifndef NN_CLI__MAX_PIPELINE_STAGES
+#define NN_CLI__MAX_PIPELINE_STAGES 4
+#endif
+
+#ifndef NN_CLI__PIPELINE_LINE_MAX_LEN
+#define NN_CLI__PIPELINE_LINE_MAX_LEN 256
+#endif
+
+// The number of results of cacheable commands kept at the same time.
+#ifndef NN_CLI__CACHE_ENTRY_NUM
+#define NN_CLI__CACHE_ENTRY_NUM 8
+#endif
+
+// Output longer than this is not cached.
+#ifndef NN_CLI__CACHE_OUTPUT_MAX_LEN
+#define NN_CLI__CACHE_OUTPUT_MAX_LEN 4096
+#endif
+
+// The number of commands run periodically by `watch` or
+// NNCli_ScheduleCommand().
+#ifndef NN_CLI__MAX_SCHEDULED_JOB_NUM
+#define NN_CLI__MAX_SCHEDULED_JOB_NUM 8
+#endif
+
+// The number of aliases defined by `alias`.
+#ifndef NN_CLI__MAX_ALIAS_NUM
+#define NN_CLI__MAX_ALIAS_NUM 32
+#endif
+
+// How long Tab waits for `m_complete_args`. If it takes longer, it goes on in
+// the background and the next Tab uses its candidates. 0 never waits.
+#ifndef NN_CLI__ARG_COMPLETION_WAIT_MS
+#define NN_CLI__ARG_COMPLETION_WAIT_MS 50
+#endif
+
+// The candidates of arguments are fetched again after this.
+#ifndef NN_CLI__ARG_CANDIDATE_TTL_MS
+#define NN_CLI__ARG_CANDIDATE_TTL_MS 10000
+#endif
+
+// More candidates than this are not offered one by one by Tab.
+#ifndef NN_CLI__MAX_ARG_COMPLETIONS
+#define NN_CLI__MAX_ARG_COMPLETIONS 32
+#endif
+
+// The number of candidates an `m_complete_args` can add.
+#ifndef NN_CLI__MAX_ARG_CANDIDATE_NUM
+#define NN_CLI__MAX_ARG_CANDIDATE_NUM 1000000
+#endif
+
+// Request frames of the RPC mode longer than this are answered with an error.
+#ifndef NN_CLI__RPC_FRAME_MAX_LEN
+#define NN_CLI__RPC_FRAME_MAX_LEN 4096
+#endif
+
+// The number of threads `foreach` runs a thread-safe command on. 1 runs the
+// items one by one without threads.
+#ifndef NN_CLI__FOREACH_THREAD_NUM
+#define NN_CLI__FOREACH_THREAD_NUM 8
+#endif
+
+// The number of items `foreach` takes from a list or a file.
+#ifndef NN_CLI__MAX_FOREACH_ITEM_NUM
+#define NN_CLI__MAX_FOREACH_ITEM_NUM 4096
+#endif
+
+// The number of block sizes NNCli_UsePools() takes.
+#ifndef NN_CLI__MAX_POOL_NUM
+#define NN_CLI__MAX_POOL_NUM 8
+#endif
+
+// The number of runs `repeat` takes. Each run keeps its time until the end.
+#ifndef NN_CLI__MAX_REPEAT_NUM
+#define NN_CLI__MAX_REPEAT_NUM 100000
+#endif
+
+// The entries a shared history file is compacted to when it is opened with
+// more than NN_CLI__SHARED_HISTORY_COMPACT_FACTOR times as many.
+#ifndef NN_CLI__SHARED_HISTORY_MAX_NUM
+#define NN_CLI__SHARED_HISTORY_MAX_NUM 1000
+#endif
+#ifndef NN_CLI__SHARED_HISTORY_COMPACT_FACTOR
+#define NN_CLI__SHARED_HISTORY_COMPACT_FACTOR 4
+#endif
+
+// The number of distinct history entries suggested while a line is typed. The
+// oldest ones are forgotten first.
+#ifndef NN_CLI__HISTORY_INDEX_MAX_NUM
+#define NN_CLI__HISTORY_INDEX_MAX_NUM 100000
+#endif
+
+// The shared objects and the commands which the plugin manifest can list.
+// The commands also count in NN_CLI__MAX_COMMAND_NUM.
+#ifndef NN_CLI__MAX_PLUGIN_NUM
+#define NN_CLI__MAX_PLUGIN_NUM 16
+#endif
+#ifndef NN_CLI__MAX_PLUGIN_COMMAND_NUM
+#define NN_CLI__MAX_PLUGIN_COMMAND_NUM 64
+#endif
+
+// If 1, USDT probes are added for perf and bpftrace when sys/sdt.h is found.
+// They are single nops until they are traced. See nn_cli_trace.h.
+#ifndef NN_CLI__TRACE
+#define NN_CLI__TRACE 1
+#endif
+
+// The resolution of scheduled commands.
+#ifndef NN_CLI__TIMER_TICK_MS
+#define NN_CLI__TIMER_TICK_MS 10
+#endif
+
+// How long a resumable command runs before NNCli_ShouldYield() returns true.
+#ifndef NN_CLI__COMMAND_SLICE_MS
+#define NN_CLI__COMMAND_SLICE_MS 10
+#endif
+
 #ifndef NNCli_LogInfo
 #define NNCli_LogInfo(fmt, ...) printf("[NNCli][INFO]" fmt "\n", ##__VA_ARGS__)
 #endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "check_config.h"
+#include "nn_cli.h"
+
+// Aliases and macros of command lines, e.g. `st = sample-status` or
+// `restart = sample-stop $1 ; sample-start $1`. The definition is compiled
+// into a template of tokens when it is defined, so expanding it only splices
+// pointers into the token list of the line and nothing is parsed again.
+//
+// `$1` to `$9` are replaced with the arguments given to the alias. The
+// arguments which are not referred to are appended to the end of the
+// expansion, so an alias without `$N` works like a shell alias. A `$N` has to
+// be a whole token.
+
+typedef struct
+{
+    // NULL for a parameter.
+    char *m_token;
+    // 1 for `$1` and so on. 0 for a literal token.
+    uint8_t m_param;
+} NNCli_AliasToken_t;
+
+// The name, the tokens and their strings are allocated in one block.
+typedef struct
+{
+    char *m_name;
+    NNCli_AliasToken_t *m_tokens;
+    int m_token_num;
+    // The highest `$N` in the template.
+    int m_param_num;
+} NNCli_Alias_t;
+
+typedef struct
+{
+    NNCli_Alias_t *m_aliases[NN_CLI__MAX_ALIAS_NUM];
+    size_t m_num;
+    // Tokens at these addresses end a command, e.g. `|` and `;`. They are kept
+    // in the templates as they are.
+    char *m_separators[2];
+} NNCli_AliasTable_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void NNCli_AliasTableInit(NNCli_AliasTable_t *a_table, char *a_pipe_token,
+                              char *a_sequence_token);
+    // Removes all the aliases.
+    void NNCli_AliasTableClear(NNCli_AliasTable_t *a_table);
+
+    // Defines or redefines `a_name` as the tokens. The tokens are copied.
+    NNCli_Err_t NNCli_AliasDefine(NNCli_AliasTable_t *a_table,
+                                  const char *a_name, char *const *a_tokens,
+                                  int a_token_num);
+    NNCli_Err_t NNCli_AliasRemove(NNCli_AliasTable_t *a_table,
+                                  const char *a_name);
+    const NNCli_Alias_t *NNCli_AliasFind(const NNCli_AliasTable_t *a_table,
+                                         const char *a_name);
+
+    // Replaces the aliases at the start of each command with their templates.
+    // The tokens of an expansion are not expanded again, and point into the
+    // table until the alias is redefined or removed.
+    NNCli_Err_t NNCli_AliasExpand(const NNCli_AliasTable_t *a_table,
+                                  char **a_tokens, int a_token_num,
+                                  char **out_tokens, int a_max_token_num,
+                                  int *out_token_num);
+
+    // Writes the definition as `name = token ...`. Returns false if it does
+    // not fit in `a_len` bytes.
+    bool NNCli_AliasFormat(const NNCli_Alias_t *a_alias, char *a_buf,
+                           size_t a_len);
+
+#ifdef __cplusplus
+}
+#endif
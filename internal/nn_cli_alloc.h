@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "nn_cli.h"
+
+// Every allocation of nn_cli goes through NNCli_Malloc() and the others. So do
+// those of linenoise, which is built with nn_cli_alloc_override.h. They use
+// the allocator set by NNCli_AllocSet(), or the C library by default.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // NULL goes back to the C library.
+    void NNCli_AllocSet(const NNCli_Allocator_t *a_allocator);
+    // The number of calls of NNCli_Malloc() and the others which allocate,
+    // from all threads.
+    size_t NNCli_AllocGetCount(void);
+
+    void *NNCli_Malloc(size_t a_size);
+    void *NNCli_Calloc(size_t a_num, size_t a_size);
+    void *NNCli_Realloc(void *a_ptr, size_t a_size);
+    void NNCli_Free(void *a_ptr);
+    char *NNCli_Strdup(const char *a_str);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+// Included before each source of linenoise by the -include option, so that it
+// allocates through nn_cli. The C library headers come first, so that their
+// declarations are not replaced.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nn_cli_alloc.h"
+
+#define malloc(a_size) NNCli_Malloc(a_size)
+#define calloc(a_num, a_size) NNCli_Calloc(a_num, a_size)
+#define realloc(a_ptr, a_size) NNCli_Realloc(a_ptr, a_size)
+#define free(a_ptr) NNCli_Free(a_ptr)
+#define strdup(a_str) NNCli_Strdup(a_str)
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "check_config.h"
+#include "nn_cli.h"
+
+// Completes the arguments of commands with `m_complete_args`. The provider
+// runs in a worker thread, so a slow one does not stall the keystroke: the
+// lookup waits for it up to `m_wait_ms` and then leaves it running in the
+// background, and the next lookup takes its result.
+//
+// The candidates are sorted once they are fetched. They are kept for the same
+// command and preceding words while the argument is extended, and each
+// keystroke narrows the range of the previous one by binary search, so the
+// provider is not called again.
+
+struct NNCli_ArgCandidates
+{
+    // The strings separated by '\0'. Offsets are kept while adding, because
+    // the block moves when it grows.
+    char *m_strings;
+    size_t m_strings_len;
+    size_t m_strings_cap;
+    size_t *m_offsets;
+    size_t m_num;
+    size_t m_cap;
+    // Candidates which do not start with this are dropped.
+    const char *m_prefix;
+    // Sorted and unique. Built when the fetch has finished.
+    const char **m_sorted;
+    size_t m_sorted_num;
+};
+
+// A fetch is identified by the provider and the line up to the argument.
+typedef struct
+{
+    NNCli_CompleteArgsFunc_t m_func;
+    char m_head[NN_CLI__LINE_MAX_LEN];
+    // The argument typed when the provider was called.
+    char m_prefix[NN_CLI__LINE_MAX_LEN];
+} NNCli_ArgQuery_t;
+
+typedef struct
+{
+    pthread_mutex_t m_mutex;
+    // Signalled when a query is posted and when a fetch finishes.
+    pthread_cond_t m_cond;
+    pthread_t m_thread;
+    bool m_is_started;
+    bool m_is_stopping;
+    uint32_t m_wait_ms;
+    uint32_t m_ttl_ms;
+
+    // The latest query not taken by the worker yet.
+    bool m_has_request;
+    NNCli_ArgQuery_t m_request;
+    bool m_is_fetching;
+    NNCli_ArgQuery_t m_fetching;
+
+    bool m_has_result;
+    NNCli_ArgQuery_t m_result;
+    NNCli_ArgCandidates_t m_candidates;
+    uint64_t m_fetched_ms;
+    // The candidates in [m_lo, m_hi) start with `m_narrowed`.
+    char m_narrowed[NN_CLI__LINE_MAX_LEN];
+    size_t m_lo;
+    size_t m_hi;
+
+    // The number of times the provider has been called.
+    uint32_t m_fetch_num;
+} NNCli_ArgCompleter_t;
+
+// Called for each completion of the argument.
+typedef void (*NNCli_ArgCompletionAdd_t)(void *a_ctx, const char *a_candidate,
+                                         size_t a_len);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // `a_wait_ms` 0 never waits for the provider. The candidates are fetched
+    // again after `a_ttl_ms`.
+    void NNCli_ArgCompleterInit(NNCli_ArgCompleter_t *a_completer,
+                                uint32_t a_wait_ms, uint32_t a_ttl_ms);
+    // Waits for the provider being called, if any.
+    void NNCli_ArgCompleterDestroy(NNCli_ArgCompleter_t *a_completer);
+
+    // Completes `a_prefix`, the last argument of `a_head` + `a_prefix`.
+    // `a_head` starts with the command name and ends with a space. Up to
+    // `a_max_num` candidates are passed to `a_add`. If there are more, only
+    // their longest common prefix is passed, or the first `a_max_num` of them
+    // if it is not longer than `a_prefix`. Returns NN_CLI__IN_PROGRESS if the
+    // candidates are still being fetched.
+    NNCli_Err_t NNCli_ArgCompleterLookup(NNCli_ArgCompleter_t *a_completer,
+                                         NNCli_CompleteArgsFunc_t a_func,
+                                         const char *a_head,
+                                         const char *a_prefix,
+                                         size_t a_max_num,
+                                         NNCli_ArgCompletionAdd_t a_add,
+                                         void *a_ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "nn_cli.h"
+
+// A history file shared by several processes. Each entry is appended to the
+// file under flock(), and the entries appended by the other processes are
+// read from where this process has read up to, when inotify reports that the
+// file has been modified.
+//
+// The file is only rewritten when it is opened with more than
+// NN_CLI__SHARED_HISTORY_COMPACT_FACTOR times the entries to keep. The kept
+// entries are moved to the beginning in place, since the other processes
+// keep appending to the same file. A process which has read past the new end
+// skips the entry it lands in the middle of, and may miss the entries
+// appended before it merges again.
+
+typedef void (*NNCli_SharedHistoryAdd_t)(void *a_ctx, const char *a_line);
+
+typedef struct
+{
+    int m_fd;
+    // -1 if inotify is not available. The size of the file is checked every
+    // time then.
+    int m_inotify_fd;
+    // The entries before this have been read.
+    off_t m_offset;
+    // The number of entries read since the file was opened.
+    size_t m_entry_num;
+    // Set while the rest of an entry too long to read is skipped.
+    bool m_is_skipping;
+    NNCli_SharedHistoryAdd_t m_add;
+    void *m_ctx;
+} NNCli_SharedHistory_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Opens or creates the file, and passes the entries in it to `a_add`.
+    // The file is compacted to its last `a_max_num` entries if it has many
+    // more. 0 never compacts it.
+    NNCli_Err_t NNCli_SharedHistoryOpen(NNCli_SharedHistory_t *a_history,
+                                        const char *a_filename,
+                                        size_t a_max_num,
+                                        NNCli_SharedHistoryAdd_t a_add,
+                                        void *a_ctx);
+    void NNCli_SharedHistoryClose(NNCli_SharedHistory_t *a_history);
+
+    // Passes the entries appended by the other processes to `a_add`.
+    void NNCli_SharedHistoryMerge(NNCli_SharedHistory_t *a_history);
+
+    // Merges the entries of the other processes first, so that `a_add` gets
+    // the entries in the order of the file. `a_line` is not passed to it.
+    NNCli_Err_t NNCli_SharedHistoryAppend(NNCli_SharedHistory_t *a_history,
+                                          const char *a_line);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nn_cli.h"
+
+// An index of the history to suggest the most recent entry which starts with
+// what has been typed, like the autosuggestions of fish.
+//
+// The entries are kept sorted by the line without duplicates, so the entries
+// with a prefix are a range found by binary search. The most recent one in
+// the range is found with the largest sequence number of each block of
+// entries, so a short prefix which matches most of the history does not visit
+// every entry. The lines added since the last lookup are appended unsorted
+// and merged at the next lookup: one by one if they are few, or by sorting
+// everything, e.g. after a history file has been loaded.
+
+typedef struct
+{
+    char *m_line;
+    // Larger for the entries added later.
+    uint64_t m_seq;
+} NNCli_HistoryIndexEntry_t;
+
+typedef struct
+{
+    // Sorted in [0, m_sorted_num), followed by the lines not merged yet.
+    NNCli_HistoryIndexEntry_t *m_entries;
+    size_t m_num;
+    size_t m_sorted_num;
+    size_t m_capacity;
+    // The oldest entries over this are dropped when they are merged. 0 until
+    // the index is initialized.
+    size_t m_max_num;
+    uint64_t m_next_seq;
+    // The largest sequence number of each block of the sorted entries. The
+    // blocks are rebuilt when entries are merged.
+    uint64_t *m_block_seqs;
+    size_t m_block_num;
+    size_t m_block_capacity;
+} NNCli_HistoryIndex_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void NNCli_HistoryIndexInit(NNCli_HistoryIndex_t *a_index,
+                                size_t a_max_num);
+    // Releases the entries. The index has to be initialized again to be used.
+    void NNCli_HistoryIndexDestroy(NNCli_HistoryIndex_t *a_index);
+
+    // Makes `a_line` the most recent entry. The line is copied.
+    NNCli_Err_t NNCli_HistoryIndexAdd(NNCli_HistoryIndex_t *a_index,
+                                      const char *a_line);
+
+    // The most recent entry which starts with `a_prefix` and is longer than
+    // it, or NULL. It is valid until the next call of
+    // NNCli_HistoryIndexAdd(). An empty prefix suggests nothing.
+    const char *NNCli_HistoryIndexSuggest(NNCli_HistoryIndex_t *a_index,
+                                          const char *a_prefix);
+
+    // The number of distinct entries.
+    size_t NNCli_HistoryIndexGetNum(NNCli_HistoryIndex_t *a_index);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A line editor which does not need a terminal. Keystrokes are fed one byte at
+// a time and the echo is written through a callback, so it can be driven by
+// recorded sessions or in-memory input.
+
+typedef enum
+{
+    NN_CLI__LINE_EDITOR_EVENT_NONE,       // Editing continues.
+    NN_CLI__LINE_EDITOR_EVENT_LINE,       // Enter was pressed.
+    NN_CLI__LINE_EDITOR_EVENT_INTERRUPT,  // Ctrl-C dropped the line.
+    NN_CLI__LINE_EDITOR_EVENT_EOF,        // Ctrl-D on an empty line.
+} NNCli_LineEditorEvent_t;
+
+typedef void (*NNCli_LineEditorWrite_t)(void *a_ctx, const char *a_data,
+                                        size_t a_len);
+// Returns the rest of the line to suggest after `a_line`, or NULL. The string
+// has to stay valid until the next key is fed.
+typedef const char *(*NNCli_LineEditorHint_t)(void *a_ctx,
+                                              const char *a_line);
+
+typedef struct
+{
+    // A gap buffer. The line is m_buf[0, m_gap_start) followed by
+    // m_buf[m_gap_end, m_buf_size), so typing and deleting at the cursor only
+    // moves the gap when the cursor has moved since the last edit.
+    char *m_buf;
+    size_t m_buf_size;
+    size_t m_gap_start;
+    size_t m_gap_end;
+    // `m_buf` is allocated by the editor and grows as the line gets longer.
+    bool m_is_growable;
+    size_t m_len;
+    size_t m_pos;
+    const char *m_prompt;
+    NNCli_LineEditorWrite_t m_write;
+    void *m_ctx;
+    // The width of the terminal, or 0 if it is unknown. A line which does not
+    // fit is scrolled, and only the visible part from `m_scroll` is redrawn.
+    size_t m_columns;
+    size_t m_scroll;
+    // State of the escape sequence being read. See
+    // NNCli_LineEditorFeed().
+    int m_escape_state;
+    char m_escape_param;
+    // "\r\n" is one Enter.
+    bool m_last_was_cr;
+    // Suggests the rest of the line while the cursor is at its end. It is
+    // shown dimmed, and the right arrow or Ctrl-F accepts it.
+    NNCli_LineEditorHint_t m_hint;
+    void *m_hint_ctx;
+    // The number of characters of the hint on the screen.
+    size_t m_hint_len;
+} NNCli_LineEditor_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // `a_buf` keeps the line, and one byte of it is for the null terminator.
+    // If `a_buf` is NULL, the editor allocates the buffer and the line has no
+    // length limit. It is released by NNCli_LineEditorDestroy().
+    void NNCli_LineEditorInit(NNCli_LineEditor_t *a_editor, char *a_buf,
+                              size_t a_buf_size, const char *a_prompt,
+                              NNCli_LineEditorWrite_t a_write, void *a_ctx);
+    void NNCli_LineEditorDestroy(NNCli_LineEditor_t *a_editor);
+
+    // Takes effect from the next redraw. 0 draws the whole line.
+    void NNCli_LineEditorSetColumns(NNCli_LineEditor_t *a_editor,
+                                    size_t a_columns);
+
+    // Takes effect from the next key. NULL shows no hints.
+    void NNCli_LineEditorSetHint(NNCli_LineEditor_t *a_editor,
+                                 NNCli_LineEditorHint_t a_hint, void *a_ctx);
+
+    // Clears the line and writes the prompt.
+    void NNCli_LineEditorStart(NNCli_LineEditor_t *a_editor);
+
+    NNCli_LineEditorEvent_t NNCli_LineEditorFeed(NNCli_LineEditor_t *a_editor,
+                                                 char a_c);
+
+    // The line being edited. After NN_CLI__LINE_EDITOR_EVENT_LINE, this is the
+    // entered line until the editor is started again. The gap is moved to the
+    // end of the line to make it contiguous.
+    const char *NNCli_LineEditorGetLine(NNCli_LineEditor_t *a_editor);
+
+#ifdef __cplusplus
+}
+#endif
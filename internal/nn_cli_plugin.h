@@ -0,0 +1,86 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "check_config.h"
+#include "nn_cli.h"
+
+// Commands in shared objects which are loaded when they are first used. A
+// manifest lists the commands of each shared object, so they can be
+// registered, listed by `help` and completed by name without loading it:
+//
+//   # Comments and empty lines are skipped.
+//   plugin libsample_plugin.so
+//   command NAME|SYMBOL|HELP|OPTIONS|COMPLETE_SYMBOL
+//
+// The commands belong to the `plugin` line before them. A relative path is
+// relative to the directory of the manifest. SYMBOL is an NNCli_Func_t in the
+// shared object. OPTIONS and COMPLETE_SYMBOL, an NNCli_CompleteArgsFunc_t,
+// can be empty or left out.
+//
+// The registered commands call a proxy given to NNCli_PluginTableLoad(), which
+// finds the command by `argv[0]` and resolves it with NNCli_PluginResolve().
+// The shared object is opened then, under a mutex because the arguments are
+// completed in a worker thread.
+
+typedef struct
+{
+    char *m_path;
+    // NULL until one of the commands is used.
+    void *m_handle;
+} NNCli_Plugin_t;
+
+// The strings are allocated in the same block.
+typedef struct
+{
+    // `m_func` and `m_complete_args` are the proxies.
+    NNCli_Command_t m_command;
+    NNCli_Plugin_t *m_plugin;
+    const char *m_symbol;
+    // NULL if the arguments are not completed.
+    const char *m_complete_symbol;
+    // Resolved by NNCli_PluginResolve().
+    NNCli_Func_t m_func;
+    NNCli_CompleteArgsFunc_t m_complete_args;
+} NNCli_PluginCommand_t;
+
+typedef struct
+{
+    pthread_mutex_t m_mutex;
+    NNCli_Plugin_t *m_plugins[NN_CLI__MAX_PLUGIN_NUM];
+    size_t m_plugin_num;
+    NNCli_PluginCommand_t *m_commands[NN_CLI__MAX_PLUGIN_COMMAND_NUM];
+    size_t m_command_num;
+} NNCli_PluginTable_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void NNCli_PluginTableInit(NNCli_PluginTable_t *a_table);
+    // Closes the shared objects and removes the commands.
+    void NNCli_PluginTableClear(NNCli_PluginTable_t *a_table);
+
+    // Adds the commands in the manifest. Lines which cannot be parsed are
+    // skipped with a warning. Nothing is loaded.
+    NNCli_Err_t NNCli_PluginTableLoad(NNCli_PluginTable_t *a_table,
+                                      const char *a_filename,
+                                      NNCli_Func_t a_proxy,
+                                      NNCli_CompleteArgsFunc_t a_complete);
+
+    NNCli_PluginCommand_t *NNCli_PluginFind(NNCli_PluginTable_t *a_table,
+                                            const char *a_name);
+
+    // Opens the shared object of the command if it is not open yet, and
+    // resolves `m_func` and `m_complete_args`. Returns
+    // NN_CLI__EXTERNAL_LIB_ERROR if it cannot be opened or a symbol is
+    // missing. It is tried again the next time then.
+    NNCli_Err_t NNCli_PluginResolve(NNCli_PluginTable_t *a_table,
+                                    NNCli_PluginCommand_t *a_command);
+
+#ifdef __cplusplus
+}
+#endif
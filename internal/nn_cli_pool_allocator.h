@@ -0,0 +1,46 @@
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "check_config.h"
+#include "nn_cli.h"
+
+// Serves the allocations from fixed size blocks in the buffers given by the
+// user. Each pool keeps a free list in its free blocks, so both allocating and
+// freeing take a constant time for a given number of pools.
+
+typedef struct
+{
+    char *m_begin;
+    char *m_end;
+    // The first bytes of a free block point to the next one.
+    void *m_free_list;
+    NNCli_PoolUsage_t m_usage;
+} NNCli_BlockPool_t;
+
+typedef struct
+{
+    pthread_mutex_t m_mutex;
+    // Sorted by the block size.
+    NNCli_BlockPool_t m_pools[NN_CLI__MAX_POOL_NUM];
+    size_t m_pool_num;
+} NNCli_PoolAllocator_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Sets `out_allocator` to allocate from `a_allocator`.
+    NNCli_Err_t NNCli_PoolAllocatorInit(NNCli_PoolAllocator_t *a_allocator,
+                                        const NNCli_Pool_t *a_pools,
+                                        size_t a_pool_num,
+                                        NNCli_Allocator_t *out_allocator);
+    NNCli_Err_t NNCli_PoolAllocatorGetUsage(NNCli_PoolAllocator_t *a_allocator,
+                                            size_t a_index,
+                                            NNCli_PoolUsage_t *out_usage);
+
+#ifdef __cplusplus
+}
+#endif
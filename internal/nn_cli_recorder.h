@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "nn_cli.h"
+
+// A recording is the raw input of a session with the time each chunk was read.
+//
+//   header: "NNCLIREC" and a version byte
+//   chunk:  LEB128 microseconds since the previous chunk,
+//           LEB128 length, and the bytes
+//
+// A chunk is what one read() returned, which is one keystroke in most cases.
+#define NN_CLI__RECORD_VERSION 1
+#define NN_CLI__RECORD_CHUNK_MAX_LEN 256
+
+typedef struct
+{
+    FILE *m_file;
+    uint64_t m_last_time_us;
+} NNCli_RecordWriter_t;
+
+typedef struct
+{
+    FILE *m_file;
+    uint64_t m_time_us;
+} NNCli_RecordReader_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    NNCli_Err_t NNCli_RecordWriterOpen(NNCli_RecordWriter_t *a_writer,
+                                       const char *a_filename);
+    // `a_time_us` is the time since the recording started, and must not be
+    // earlier than that of the previous chunk. `a_len` is up to
+    // NN_CLI__RECORD_CHUNK_MAX_LEN.
+    NNCli_Err_t NNCli_RecordWriterWrite(NNCli_RecordWriter_t *a_writer,
+                                        uint64_t a_time_us, const char *a_data,
+                                        size_t a_len);
+    void NNCli_RecordWriterClose(NNCli_RecordWriter_t *a_writer);
+
+    NNCli_Err_t NNCli_RecordReaderOpen(NNCli_RecordReader_t *a_reader,
+                                       const char *a_filename);
+    // `out_data` needs NN_CLI__RECORD_CHUNK_MAX_LEN bytes. Returns
+    // NN_CLI__PROCESS_COMPLETED at the end of the recording.
+    NNCli_Err_t NNCli_RecordReaderNext(NNCli_RecordReader_t *a_reader,
+                                       uint64_t *out_time_us, char *out_data,
+                                       size_t *out_len);
+    void NNCli_RecordReaderClose(NNCli_RecordReader_t *a_reader);
+
+    // Records the input of this process until NNCli_RecorderStop() or exit().
+    // stdin is replaced with a pseudo terminal (or a pipe if stdin is not a
+    // terminal), and a thread relays the real input to it while recording
+    // it. When stdin is a terminal, stdout and stderr are relayed through the
+    // pseudo terminal too so that the order of the output is kept.
+    NNCli_Err_t NNCli_RecorderStart(const char *a_filename);
+    void NNCli_RecorderStop(void);
+
+#ifdef __cplusplus
+}
+#endif
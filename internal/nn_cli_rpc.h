@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "check_config.h"
+#include "nn_cli.h"
+
+// Frames of the RPC mode. Each request and response is a JSON object on a
+// line of its own:
+//
+//   {"id": 1, "line": "sample-ctrl on"}
+//   {"id": 1, "status": 0, "output": "Sample status changed to 'on'\n"}
+//
+// `id` is any JSON value given by the client, and is returned as it is so
+// that the responses can be matched with pipelined requests. `status` is the
+// NNCli_Err_t of the first command of the line which has failed, e.g.
+// NN_CLI__NOT_FOUND for an unknown command, and `output` is what the line
+// has printed. Other members of requests are ignored.
+
+#define NN_CLI__RPC_ID_MAX_LEN 64
+
+typedef struct
+{
+    // The JSON text of the id, or "null" if the request has none.
+    char m_id[NN_CLI__RPC_ID_MAX_LEN];
+    char m_line[NN_CLI__LINE_MAX_LEN];
+} NNCli_RpcRequest_t;
+
+// `a_frame` is NULL for a frame longer than NN_CLI__RPC_FRAME_MAX_LEN, which
+// has been dropped.
+typedef void (*NNCli_RpcFrameHandler_t)(void *a_ctx, const char *a_frame,
+                                        size_t a_len);
+
+// Splits the input into frames at newlines.
+typedef struct
+{
+    char m_buf[NN_CLI__RPC_FRAME_MAX_LEN];
+    size_t m_len;
+    // Set while the rest of a too long frame is skipped.
+    bool m_is_skipping;
+} NNCli_RpcReader_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void NNCli_RpcReaderInit(NNCli_RpcReader_t *a_reader);
+    // Passes each complete frame in `a_data` to `a_handler`, and keeps the
+    // rest for the next call. Returns the number of frames.
+    size_t NNCli_RpcReaderFeed(NNCli_RpcReader_t *a_reader, const char *a_data,
+                               size_t a_len, NNCli_RpcFrameHandler_t a_handler,
+                               void *a_ctx);
+    // Passes the frame without a newline at the end of the input, if any.
+    size_t NNCli_RpcReaderFinish(NNCli_RpcReader_t *a_reader,
+                                 NNCli_RpcFrameHandler_t a_handler,
+                                 void *a_ctx);
+
+    // `out_request->m_id` is set as far as the frame has been parsed, even if
+    // this fails.
+    NNCli_Err_t NNCli_RpcParseRequest(const char *a_frame, size_t a_len,
+                                      NNCli_RpcRequest_t *out_request);
+
+    // Writes the response frame including the newline to `a_buf` like
+    // snprintf(), and returns its length. `a_buf` can be NULL to get the
+    // length.
+    size_t NNCli_RpcFormatResponse(const char *a_id, NNCli_Err_t a_status,
+                                   const char *a_output, size_t a_output_len,
+                                   char *a_buf, size_t a_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A hierarchical timer wheel. Each level has 64 slots and each slot of a
+// level covers 64 slots of the level below it, so 4 levels cover 2^24 ticks.
+// Timers further than that are re-placed when they come close.
+#define NN_CLI__TIMER_WHEEL_LEVEL_NUM 4
+#define NN_CLI__TIMER_WHEEL_SLOT_BITS 6
+#define NN_CLI__TIMER_WHEEL_SLOT_NUM (1 << NN_CLI__TIMER_WHEEL_SLOT_BITS)
+
+typedef struct NNCli_Timer NNCli_Timer_t;
+
+// Called when the timer expires. The timer can be added again from here.
+typedef void (*NNCli_TimerCallback_t)(NNCli_Timer_t *a_timer, void *a_ctx);
+
+struct NNCli_Timer
+{
+    NNCli_Timer_t *m_next;
+    // Points to the `m_next` of the previous timer or the slot. NULL if the
+    // timer is not in the wheel.
+    NNCli_Timer_t **m_pprev;
+    uint64_t m_expire_tick;
+    NNCli_TimerCallback_t m_callback;
+    void *m_ctx;
+};
+
+typedef struct
+{
+    NNCli_Timer_t *m_slots[NN_CLI__TIMER_WHEEL_LEVEL_NUM]
+                          [NN_CLI__TIMER_WHEEL_SLOT_NUM];
+    // Timers which expire at this tick or earlier have been fired.
+    uint64_t m_current_tick;
+    size_t m_timer_num;
+} NNCli_TimerWheel_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void NNCli_TimerWheelInit(NNCli_TimerWheel_t *a_wheel,
+                              uint64_t a_now_tick);
+    void NNCli_TimerInit(NNCli_Timer_t *a_timer,
+                         NNCli_TimerCallback_t a_callback, void *a_ctx);
+    bool NNCli_TimerIsPending(const NNCli_Timer_t *a_timer);
+
+    // A timer which has already been expired fires at the next tick.
+    void NNCli_TimerWheelAdd(NNCli_TimerWheel_t *a_wheel,
+                             NNCli_Timer_t *a_timer, uint64_t a_expire_tick);
+    void NNCli_TimerWheelRemove(NNCli_TimerWheel_t *a_wheel,
+                                NNCli_Timer_t *a_timer);
+
+    // Gets the earliest tick at which a timer fires. Returns false if there
+    // are no timers.
+    bool NNCli_TimerWheelGetNextExpiry(const NNCli_TimerWheel_t *a_wheel,
+                                       uint64_t *out_tick);
+
+    // Fires the timers which expire up to `a_now_tick` in order and returns
+    // the number of them.
+    size_t NNCli_TimerWheelAdvance(NNCli_TimerWheel_t *a_wheel,
+                                   uint64_t a_now_tick);
+
+#ifdef __cplusplus
+}
+#endif
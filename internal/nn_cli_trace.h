@@ -0,0 +1,55 @@
+#pragma once
+
+#include "check_config.h"
+
+// USDT probes in the provider `nn_cli`, which perf and bpftrace can attach to
+// without rebuilding. Each probe is a nop with a note of where its arguments
+// are, so the arguments are still evaluated and have to be cheap. The probes
+// are left out if NN_CLI__TRACE is 0 or sys/sdt.h (systemtap-sdt-dev) is not
+// found. tools/bpftrace has scripts which use them.
+//
+//   run_start                             NNCli_Run() is called.
+//   run_end(int err)                      NNCli_Run() returns.
+//   line(const char *line)                A line has been entered.
+//   command_start(const char *line)       A line is dispatched.
+//   command_end(const char *line,         The line has run. `name` is its
+//               const char *name,         first word before the aliases are
+//               int res)                  expanded, or "" if it is empty.
+//                                         `res` is the NNCli_Err_t of the
+//                                         first of its commands which has
+//                                         failed, e.g. NN_CLI__NOT_FOUND.
+//   completion_start(const char *line)    Tab is completed.
+//   completion_end(const char *line,
+//                  size_t candidate_num)
+//   hint_start(const char *line)          A hint is looked up.
+//   hint_end(const char *line,            `hint` is NULL if there is none.
+//            const char *hint)
+//   history_save(const char *line)        The line has been saved to the
+//                                         history.
+//
+// The commands run by `time` and `repeat` nest their command_start and
+// command_end in the ones of their line.
+//
+// The four NNCli_Trace macros can be defined before this header instead, e.g.
+// by the tests to see the probes.
+
+#if NN_CLI__TRACE && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define NN_CLI__HAS_TRACE
+#endif
+#endif
+
+#ifndef NNCli_Trace0
+#ifdef NN_CLI__HAS_TRACE
+#define NNCli_Trace0(name) DTRACE_PROBE(nn_cli, name)
+#define NNCli_Trace1(name, a1) DTRACE_PROBE1(nn_cli, name, a1)
+#define NNCli_Trace2(name, a1, a2) DTRACE_PROBE2(nn_cli, name, a1, a2)
+#define NNCli_Trace3(name, a1, a2, a3) DTRACE_PROBE3(nn_cli, name, a1, a2, a3)
+#else
+#define NNCli_Trace0(name) ((void)0)
+#define NNCli_Trace1(name, a1) ((void)0)
+#define NNCli_Trace2(name, a1, a2) ((void)0)
+#define NNCli_Trace3(name, a1, a2, a3) ((void)0)
+#endif
+#endif
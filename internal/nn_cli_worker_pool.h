@@ -0,0 +1,63 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "check_config.h"
+#include "nn_cli.h"
+
+// Runs the jobs 0 .. `m_job_num` - 1 on a bounded number of threads. The jobs
+// are taken in order, and the caller waits for them in the same order, so
+// their results can be used as soon as the earlier ones are ready.
+//
+// The workers block all signals, so that Ctrl-C and the timeouts of the
+// commands are still handled by the thread which has started the pool.
+
+typedef void (*NNCli_WorkerJobFunc_t)(void *a_ctx, size_t a_index);
+
+typedef struct
+{
+    pthread_mutex_t m_mutex;
+    // Signalled each time a job finishes.
+    pthread_cond_t m_cond;
+    pthread_t m_threads[NN_CLI__FOREACH_THREAD_NUM];
+    size_t m_thread_num;
+    NNCli_WorkerJobFunc_t m_func;
+    void *m_ctx;
+    size_t m_job_num;
+    // The next job to be taken.
+    size_t m_next;
+    // One per job.
+    bool *m_is_done;
+    // Set by NNCli_WorkerPoolStop(). The jobs not taken yet are skipped.
+    bool m_is_stopping;
+} NNCli_WorkerPool_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Up to NN_CLI__FOREACH_THREAD_NUM threads are started, but no more than
+    // the jobs.
+    NNCli_Err_t NNCli_WorkerPoolStart(NNCli_WorkerPool_t *a_pool,
+                                      size_t a_thread_num, size_t a_job_num,
+                                      NNCli_WorkerJobFunc_t a_func,
+                                      void *a_ctx);
+
+    // Waits up to `a_timeout_ms` for the job. Returns NN_CLI__IN_PROGRESS if
+    // it is still running, and NN_CLI__CANCELLED if it has been skipped.
+    NNCli_Err_t NNCli_WorkerPoolWait(NNCli_WorkerPool_t *a_pool,
+                                     size_t a_index, uint32_t a_timeout_ms);
+
+    // Skips the jobs not taken yet. The running ones are not interrupted.
+    void NNCli_WorkerPoolStop(NNCli_WorkerPool_t *a_pool);
+
+    // Waits for the running jobs and the threads, and releases the pool.
+    void NNCli_WorkerPoolDestroy(NNCli_WorkerPool_t *a_pool);
+
+#ifdef __cplusplus
+}
+#endif
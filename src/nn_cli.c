@@ -1,17 +1,47 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // For fopencookie()
+#endif
+
 #include "nn_cli.h"
 
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
 #include <sys/select.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
 
 #include "check_config.h"
 #include "linenoise.h"
+#include "nn_cli_alloc.h"
+#include "nn_cli_alias.h"
+#include "nn_cli_arg_completer.h"
+#include "nn_cli_history.h"
+#include "nn_cli_history_index.h"
+#include "nn_cli_line_editor.h"
+#include "nn_cli_plugin.h"
+#include "nn_cli_pool_allocator.h"
+#include "nn_cli_recorder.h"
+#include "nn_cli_rpc.h"
+#include "nn_cli_timer_wheel.h"
+#include "nn_cli_trace.h"
+#include "nn_cli_worker_pool.h"
 
-#define MAX_NUM_OF_WORDS_PER_COMMAND 20
-#define COMMAND_STRING_MAX_LEN 1024
+#define DEFAULT_HEAD_LINES 10
+#define DEFAULT_WATCH_INTERVAL_SEC 2.0
+#define MAX_WATCH_INTERVAL_SEC (24.0 * 60 * 60)
 
 #define NNCli_AssertWithMsg(cond, ...) \
     if (!(cond))                       \
@@ -40,65 +70,534 @@ typedef struct
     size_t m_num;
 } CommandList_t;
 
+typedef ssize_t (*OutputSink_t)(void *a_ctx, const char *a_data, size_t a_len);
+
+typedef struct OutputCapture
+{
+    OutputSink_t m_sink;
+    void *m_ctx;
+    FILE *m_stream;
+    FILE *m_prev_stdout;
+    // The capture which has begun before this one.
+    struct OutputCapture *m_outer;
+} OutputCapture_t;
+
+typedef enum
+{
+    FILTER_GREP,
+    FILTER_HEAD,
+    FILTER_COUNT,
+} FilterType_t;
+
+typedef struct
+{
+    FilterType_t m_type;
+    const char *m_pattern;  // grep
+    bool m_invert;          // grep -v
+    bool m_ignore_case;     // grep -i
+    long m_limit;           // head
+    long m_lines;           // Lines which have reached this filter
+} Filter_t;
+
+typedef struct
+{
+    Filter_t m_filters[NN_CLI__MAX_PIPELINE_STAGES - 1];
+    size_t m_filter_num;
+    // The output is passed to filters line by line. A line longer than this
+    // buffer is passed in pieces.
+    char m_line[NN_CLI__PIPELINE_LINE_MAX_LEN];
+    size_t m_line_len;
+    // Set when no more output can get through, e.g. `head` got enough lines.
+    bool m_closed;
+    FILE *m_out;
+} Pipeline_t;
+
+typedef struct
+{
+    const NNCli_Command_t *m_command;
+    // The tokenized argv joined with '\0'.
+    char *m_key;
+    size_t m_key_len;
+    uint32_t m_key_hash;
+    char *m_output;
+    size_t m_output_len;
+    uint64_t m_expire_ms;
+    uint64_t m_last_used_ms;
+} CacheEntry_t;
+
+typedef struct
+{
+    FILE *m_out;
+    char *m_buf;
+    size_t m_len;
+    size_t m_capacity;
+    // Set if the output cannot be stored as a whole.
+    bool m_incomplete;
+} CacheRecorder_t;
+
+typedef struct
+{
+    char *m_buf;
+    size_t m_len;
+    size_t m_capacity;
+} OutputBuffer_t;
+
+typedef struct
+{
+    NNCli_Timer_t m_timer;
+    uint64_t m_interval_ticks;
+    uint32_t m_interval_ms;
+    bool m_in_use;
+    char m_command[NN_CLI__LINE_MAX_LEN];
+} ScheduledJob_t;
+
+typedef enum
+{
+    CANCEL_REASON_NONE,
+    CANCEL_REASON_INTERRUPTED,  // Ctrl-C or NNCli_CancelCommand()
+    CANCEL_REASON_TIMED_OUT,
+} CancelReason_t;
+
+typedef struct
+{
+    bool m_is_active;
+    uint64_t m_start_ns;
+    uint64_t m_start_cpu_ns;
+    long m_start_preempted_num;
+} LatencySample_t;
+
+typedef struct
+{
+    NNCli_ReplayStats_t *m_stats;
+    FILE *m_report;
+    // The time taken by the commands run by the current keystroke.
+    uint64_t m_command_ns;
+} ReplayContext_t;
+
+typedef struct
+{
+    const char *m_item;
+    OutputBuffer_t m_output;
+    // NN_CLI__IN_PROGRESS until the item has run.
+    NNCli_Err_t m_res;
+} ForeachJob_t;
+
+// Everything the workers of `foreach` use is kept here rather than on the
+// stack.
+typedef struct
+{
+    const NNCli_Command_t *m_command;
+    // The command and its arguments. `{}` in the arguments is replaced with
+    // the item.
+    char m_template_buf[NN_CLI__LINE_MAX_LEN];
+    char *m_template[NN_CLI__MAX_WORDS_PER_COMMAND];
+    int m_template_num;
+    char *m_items_buf;
+    ForeachJob_t *m_jobs;
+    size_t m_job_num;
+} Foreach_t;
+
+typedef struct
+{
+    const NNCli_Command_t *m_command;
+    int m_argc;
+    char **m_argv;
+    // NULL if the output is not filtered.
+    Pipeline_t *m_pipeline;
+    // See NNCli_GetResumeState().
+    void *m_state;
+    uint64_t m_start_ms;
+    uint32_t m_slice_num;
+    // Set by Ctrl-C at the prompt while the command is suspended.
+    bool m_is_cancel_requested;
+} CommandRun_t;
+
+// A command which has yielded and is resumed by NNCli_Run(). The arguments
+// and the rest of the line are copied, since the line is gone by then.
+typedef struct
+{
+    bool m_is_pending;
+    CommandRun_t m_run;
+    Pipeline_t m_pipeline;
+    char *m_argv[NN_CLI__MAX_WORDS_PER_COMMAND + 1];
+    // The arguments and the patterns of the filters.
+    char m_argv_buf[NN_CLI__LINE_MAX_LEN];
+    char *m_rest_tokens[NN_CLI__MAX_TOKENS_PER_LINE];
+    int m_rest_token_num;
+    char m_rest_buf[NN_CLI__LINE_MAX_LEN];
+} SuspendedCommand_t;
+
 static NNCli_AsyncOption_t s_async;
 static CommandList_t s_command_list;
 static char *s_history_filename;
+static bool s_is_history_shared = false;
+static NNCli_SharedHistory_t s_shared_history;
+// Every entry of the history, to suggest the rest of the line being typed.
+static NNCli_HistoryIndex_t s_history_index;
+static NNCli_AliasTable_t s_aliases;
+static NNCli_PluginTable_t s_plugins;
+static bool s_has_plugins = false;
+// NULL if the aliases are not saved.
+static char *s_alias_filename;
+static NNCli_ArgCompleter_t s_arg_completer;
 static bool s_is_initialized = false;
+static Pipeline_t *s_active_pipeline;
+static CacheEntry_t s_cache[NN_CLI__CACHE_ENTRY_NUM];
+static NNCli_CacheStats_t s_cache_stats;
+static NNCli_TimerWheel_t s_timer_wheel;
+static ScheduledJob_t s_jobs[NN_CLI__MAX_SCHEDULED_JOB_NUM];
+static NNCli_LineEditor_t s_line_editor;
+#if NN_CLI__SHARE_EDIT_BUFFER
+static char s_line_editor_buf[NN_CLI__LINE_MAX_LEN];
+#else
+static char s_async_edit_buf[NN_CLI__LINE_MAX_LEN];
+#endif
+static bool s_is_line_editor_started = false;
+static NNCli_Io_t s_io;
+static bool s_is_rpc = false;
+static NNCli_RpcReader_t s_rpc_reader;
+// Set while NNCli_ExecuteStream() runs a line, which has to finish before it
+// returns.
+static bool s_is_executing = false;
+// The thread which has called NNCli_Init(), and runs the commands.
+static pthread_t s_cli_thread;
+static OutputCapture_t *s_capture_top;
+// The cancellation token of the running command.
+static volatile sig_atomic_t s_cancel_reason = CANCEL_REASON_NONE;
+// Set while the alarm of the deadline is running.
+static volatile sig_atomic_t s_is_alarm_set = false;
+// ITIMER_REAL of the application, which is given back when the alarm stops.
+static struct itimerval s_prev_timer;
+static uint64_t s_prev_timer_saved_ns;
+static struct sigaction s_prev_sigint_action;
+static struct sigaction s_prev_sigalrm_action;
+// The size of the terminal. It is measured again only after SIGWINCH, so that
+// a terminal without TIOCGWINSZ, e.g. a serial console, is not asked each time.
+static int s_terminal_columns;
+static int s_terminal_rows;
+static volatile sig_atomic_t s_is_terminal_size_stale = true;
+// Set if the size has been measured with TIOCGWINSZ or given by
+// NNCli_SetTerminalSize(), rather than guessed.
+static bool s_is_terminal_size_known = false;
+static bool s_is_resize_watched = false;
+static struct sigaction s_prev_sigwinch_action;
+// NULL while no command is running. It is also read by
+// NNCli_CancelCommand(), which can be called from signal handlers.
+static CommandRun_t *volatile s_running_command;
+// The first failure of the commands of the line being run, which is kept
+// apart from the result of the dispatch of the line. The lines run by a
+// command, e.g. `time`, are nested in it.
+static NNCli_Err_t s_command_res = NN_CLI__SUCCESS;
+static int s_line_depth = 0;
+static uint64_t s_slice_end_ns;
+static SuspendedCommand_t s_suspended;
+// The output of `help`, kept until a command is registered or the terminal
+// width changes. Its `m_len` is 0 if it is not rendered.
+static OutputBuffer_t s_help_listing;
+static int s_help_listing_width;
+// Used after NNCli_UsePools().
+static NNCli_PoolAllocator_t s_pool_allocator;
+static Foreach_t s_foreach;
+static NNCli_WorkerPool_t s_foreach_pool;
+// Where a worker of `foreach` keeps the output of its item. NULL in the other
+// threads.
+static __thread OutputBuffer_t *s_worker_output;
+static bool s_is_latency_traced = false;
+static NNCli_LatencyHistogram_t s_latency[NN_CLI__LATENCY_KIND_NUM];
 
-static void completion(const char *buf, linenoiseCompletions *lc)
+// Separators are replaced with these tokens so that they can be distinguished
+// from arguments by their addresses.
+static char s_pipe_token[] = "|";
+static char s_sequence_token[] = ";";
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+    // Defined by the table generated by nn_cli_add_static_commands() and by
+    // the linker for the `nn_cli_commands` section. They are NULL if there
+    // are no static commands or the table is not generated.
+    extern const NNCli_StaticCommandTable_t nn_cli_static_command_table
+        __attribute__((weak));
+    extern const NNCli_Command_t __start_nn_cli_commands[]
+        __attribute__((weak));
+    extern const NNCli_Command_t __stop_nn_cli_commands[]
+        __attribute__((weak));
+#ifdef __cplusplus
+}
+#endif
+
+// FNV-1a with a seed, followed by a finalizer to spread the bits. This must be
+// the same as hash32() in tools/nn_cli_gen_commands.py.
+static uint32_t HashBytes(const char *a_data, size_t a_len, uint32_t a_seed)
+{
+    uint32_t hash = 2166136261u ^ a_seed;
+    for (size_t i = 0; i < a_len; i++)
+    {
+        hash ^= (unsigned char)a_data[i];
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x7feb352du;
+    hash ^= hash >> 15;
+    hash *= 0x846ca68bu;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/**
+ * Command table
+ */
+
+static bool HasStaticCommandTable(void)
+{
+    return &nn_cli_static_command_table != NULL;
+}
+
+static size_t GetSectionCommandNum(void)
+{
+    return __stop_nn_cli_commands - __start_nn_cli_commands;
+}
+
+static size_t GetStaticCommandNum(void)
+{
+    return HasStaticCommandTable() ? nn_cli_static_command_table.m_command_num
+                                   : GetSectionCommandNum();
+}
+
+static const NNCli_Command_t *GetStaticCommand(size_t a_index)
+{
+    return HasStaticCommandTable()
+               ? nn_cli_static_command_table.m_commands[a_index]
+               : &__start_nn_cli_commands[a_index];
+}
+
+static const NNCli_Command_t *FindStaticCommand(const char *a_name)
+{
+    const NNCli_StaticCommandTable_t *table = &nn_cli_static_command_table;
+    const NNCli_Command_t *command = NULL;
+
+    if (!HasStaticCommandTable())
+    {
+        // Without the generated table, the section is searched instead.
+        for (size_t i = 0; i < GetSectionCommandNum(); i++)
+        {
+            if (strcmp(a_name, __start_nn_cli_commands[i].m_name) == 0)
+            {
+                return &__start_nn_cli_commands[i];
+            }
+        }
+        return NULL;
+    }
+
+    if (table->m_command_num > 0)
+    {
+        size_t len = strlen(a_name);
+        uint16_t displacement =
+            table->m_displacements[HashBytes(a_name, len, 0) %
+                                   table->m_bucket_num];
+        uint16_t index =
+            table->m_slots[HashBytes(a_name, len, displacement) &
+                           (table->m_slot_num - 1)];
+        if (displacement != 0 && index != 0)
+        {
+            command = table->m_commands[index - 1];
+        }
+    }
+
+    return (command != NULL && strcmp(a_name, command->m_name) == 0) ? command
+                                                                      : NULL;
+}
+
+// Commands are indexed with the static ones first.
+static size_t GetCommandNum(void)
+{
+    return GetStaticCommandNum() + s_command_list.m_num;
+}
+
+static const NNCli_Command_t *GetCommand(size_t a_index)
+{
+    size_t static_num = GetStaticCommandNum();
+    return (a_index < static_num)
+               ? GetStaticCommand(a_index)
+               : s_command_list.m_command[a_index - static_num];
+}
+
+static const NNCli_Command_t *FindCommand(const char *a_name)
+{
+    const NNCli_Command_t *command = FindStaticCommand(a_name);
+    if (command != NULL)
+    {
+        return command;
+    }
+
+    for (size_t i = 0; i < s_command_list.m_num; i++)
+    {
+        if (strcmp(a_name, s_command_list.m_command[i]->m_name) == 0)
+        {
+            return s_command_list.m_command[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Adds the commands and aliases which start with `buf`. Returns false if
+// there are none.
+static bool CompleteCommandName(const char *buf, linenoiseCompletions *lc)
 {
-    NNCli_AssertOrReturnVoid(buf, "buf is NULL");
-    NNCli_AssertOrReturnVoid(lc, "lc is NULL");
+    NNCli_AssertOrReturn(buf, false, "buf is NULL");
+    NNCli_AssertOrReturn(lc, false, "lc is NULL");
 
     bool found = false;
-    for (int i = 0; i < s_command_list.m_num; i++)
+    for (size_t i = 0; i < GetCommandNum(); i++)
+    {
+        if (strncmp(buf, GetCommand(i)->m_name, strlen(buf)) == 0)
+        {
+            linenoiseAddCompletion(lc, GetCommand(i)->m_name);
+            found = true;
+        }
+    }
+    for (size_t i = 0; i < s_aliases.m_num; i++)
     {
-        if (strncmp(buf, s_command_list.m_command[i]->m_name, strlen(buf)) == 0)
+        if (strncmp(buf, s_aliases.m_aliases[i]->m_name, strlen(buf)) == 0)
         {
-            linenoiseAddCompletion(lc, s_command_list.m_command[i]->m_name);
+            linenoiseAddCompletion(lc, s_aliases.m_aliases[i]->m_name);
             found = true;
         }
     }
+    return found;
+}
+
+typedef struct
+{
+    linenoiseCompletions *m_completions;
+    const char *m_line;
+    size_t m_head_len;
+} ArgCompletionContext_t;
+
+static void AddArgCompletion(void *a_ctx, const char *a_candidate, size_t a_len)
+{
+    const ArgCompletionContext_t *ctx = (const ArgCompletionContext_t *)a_ctx;
+    char line[NN_CLI__LINE_MAX_LEN];
+
+    if (ctx->m_head_len + a_len < sizeof(line))
+    {
+        memcpy(line, ctx->m_line, ctx->m_head_len);
+        memcpy(&line[ctx->m_head_len], a_candidate, a_len);
+        line[ctx->m_head_len + a_len] = '\0';
+        linenoiseAddCompletion(ctx->m_completions, line);
+    }
+}
+
+// Completes the last word of `buf` with `m_complete_args` of the command.
+// Only the last command of a sequence is completed, and not the filters of a
+// pipeline.
+static void CompleteArguments(const char *buf, linenoiseCompletions *lc)
+{
+    const char *command_start = strrchr(buf, ';');
+    const char *arg = strrchr(buf, ' ') + 1;
+    char name[NN_CLI__LINE_MAX_LEN];
+    size_t name_len;
+    const NNCli_Command_t *command;
+    ArgCompletionContext_t ctx = {
+        .m_completions = lc,
+        .m_line = buf,
+        .m_head_len = (size_t)(arg - buf),
+    };
+
+    command_start = (command_start == NULL) ? buf : command_start + 1;
+    command_start += strspn(command_start, " ");
+    name_len = strcspn(command_start, " ");
+    if (strchr(command_start, '|') != NULL || arg <= command_start ||
+        name_len >= sizeof(name))
+    {
+        return;
+    }
+    memcpy(name, command_start, name_len);
+    name[name_len] = '\0';
+
+    command = FindCommand(name);
+    if (command == NULL || command->m_complete_args == NULL)
+    {
+        return;
+    }
+
+    // The words before the argument are a part of the query.
+    memcpy(name, command_start, arg - command_start);
+    name[arg - command_start] = '\0';
+    NNCli_ArgCompleterLookup(&s_arg_completer, command->m_complete_args, name,
+                             arg, NN_CLI__MAX_ARG_COMPLETIONS,
+                             AddArgCompletion, &ctx);
+}
+
+// The first word is the command name, and the words after it are arguments.
+// linenoise cannot accept a hint with the right arrow, so Tab takes the
+// suggestion from the history when there is nothing else to complete.
+static void CompleteLine(const char *buf, linenoiseCompletions *lc)
+{
+    const char *suggestion;
+
+    if (strchr(buf, ' ') == NULL)
+    {
+        CompleteCommandName(buf, lc);
+    }
+    else
+    {
+        CompleteArguments(buf, lc);
+    }
+    if (lc->len > 0)
+    {
+        return;
+    }
 
-    // If no candidate command exists, leave it as is and do not add a space by
-    // tab.
-    if (!found)
+    suggestion = NNCli_HistoryIndexSuggest(&s_history_index, buf);
+    if (suggestion != NULL)
+    {
+        linenoiseAddCompletion(lc, suggestion);
+    }
+    else
     {
+        // If no candidate exists, leave it as is and do not add a space by
+        // tab.
         linenoiseAddCompletion(lc, buf);
     }
 }
 
-static char *hints(const char *buf, int *color, int *bold)
+// The rest of the most recent history entry which starts with the line.
+static const char *SuggestFromHistory(void *a_ctx, const char *a_line)
+{
+    const char *entry = NNCli_HistoryIndexSuggest(&s_history_index, a_line);
+    return (entry != NULL) ? &entry[strlen(a_line)] : NULL;
+}
+
+static char *HintCommandOptions(const char *buf, int *color, int *bold)
 {
     NNCli_AssertOrReturn(buf, NULL, "buf is NULL");
     NNCli_AssertOrReturn(color, NULL, "color is NULL");
     NNCli_AssertOrReturn(bold, NULL, "bold is NULL");
 
-    static char option_str[COMMAND_STRING_MAX_LEN];
+    static char option_str[NN_CLI__HINT_MAX_LEN];
     memset(option_str, 0, sizeof(option_str));
 
     *color = 35;
     *bold = 0;
 
-    for (int i = 0; i < s_command_list.m_num; i++)
+    const NNCli_Command_t *command = FindCommand(buf);
+    if (command != NULL && command->m_options != NULL)
     {
-        if (strcmp(buf, s_command_list.m_command[i]->m_name) == 0 &&
-            s_command_list.m_command[i]->m_options != NULL)
-        {
-            option_str[0] = ' ';
-            // 2 byte (subtracted at the end ) = 1 byte (for the first move) + 1
-            // byte (of the last null character)
-            strncpy(&option_str[1], s_command_list.m_command[i]->m_options,
-                    sizeof(option_str) - 2);
-            break;
-        }
+        option_str[0] = ' ';
+        // 2 byte (subtracted at the end ) = 1 byte (for the first move) + 1
+        // byte (of the last null character)
+        strncpy(&option_str[1], command->m_options, sizeof(option_str) - 2);
     }
 
     return option_str;
 }
 
-static NNCli_Err_t SplitStringWithSpace(const char *a_raw_command,
-                                        char **out_tokens, int *out_token_count)
+// `a_buf` needs NN_CLI__LINE_MAX_LEN bytes, and keeps the tokens.
+static NNCli_Err_t SplitCommandLine(const char *a_raw_command, char *a_buf,
+                                    char **out_tokens, int *out_token_count)
 {
     NNCli_Err_t res = NN_CLI__INVALID_ARGS;
     NNCli_AssertOrReturn(a_raw_command, NN_CLI__INVALID_ARGS,
@@ -106,36 +605,50 @@ static NNCli_Err_t SplitStringWithSpace(const char *a_raw_command,
     NNCli_AssertOrReturn(out_tokens, NN_CLI__INVALID_ARGS,
                          "out_tokens is NULL");
 
-    static char str_copy[COMMAND_STRING_MAX_LEN];
     int token_count = 0;
-    char *context = NULL;
-    char *token;
+    char *cursor = a_buf;
 
-    if (strlen(a_raw_command) > COMMAND_STRING_MAX_LEN - 1)
+    if (strlen(a_raw_command) > NN_CLI__LINE_MAX_LEN - 1)
     {
         NNCli_LogError(
             "The length of the command exceeds the maximum limit: %d",
-            COMMAND_STRING_MAX_LEN);
+            NN_CLI__LINE_MAX_LEN);
         res = NN_CLI__EXCEED_CAPACITY;
         goto done;
     }
-    strncpy(str_copy, a_raw_command, sizeof(str_copy) - 1);
-    str_copy[sizeof(str_copy) - 1] = '\0';
-    token = strtok_r(str_copy, " ", &context);
+    strcpy(a_buf, a_raw_command);
 
-    while (token != NULL)
+    // Words are separated by spaces. `|` and `;` are tokens by themselves even
+    // if they are not surrounded by spaces.
+    while (*cursor != '\0')
     {
-        if (token_count == MAX_NUM_OF_WORDS_PER_COMMAND)
+        char *token;
+        if (*cursor == ' ')
+        {
+            *cursor++ = '\0';
+            continue;
+        }
+        else if (*cursor == '|' || *cursor == ';')
+        {
+            token = (*cursor == '|') ? s_pipe_token : s_sequence_token;
+            *cursor++ = '\0';
+        }
+        else
+        {
+            token = cursor;
+            cursor += strcspn(cursor, " |;");
+        }
+
+        if (token_count == NN_CLI__MAX_TOKENS_PER_LINE)
         {
             NNCli_LogError(
-                "The number of words in the command exceeds the "
+                "The number of words in the command line exceeds the "
                 "maximum limit: %d",
-                MAX_NUM_OF_WORDS_PER_COMMAND);
+                NN_CLI__MAX_TOKENS_PER_LINE);
             res = NN_CLI__EXCEED_CAPACITY;
             goto done;
         }
         out_tokens[token_count++] = token;
-        token = strtok_r(NULL, " ", &context);
     }
 
     *out_token_count = token_count;
@@ -145,152 +658,2879 @@ done:
     return res;
 }
 
-static NNCli_Err_t CallRegisteredCommand(const char *a_command)
+static void RecordCommandResult(NNCli_Err_t a_res)
 {
-    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
-    NNCli_AssertOrReturn(a_command, res, "a_command is NULL");
-
-    for (int i = 0; i < s_command_list.m_num; i++)
+    if (a_res != NN_CLI__SUCCESS && a_res != NN_CLI__IN_PROGRESS &&
+        s_command_res == NN_CLI__SUCCESS)
     {
-        char *args[MAX_NUM_OF_WORDS_PER_COMMAND];
-        int argc;
-        res = SplitStringWithSpace(a_command, args, &argc);
-        if (res != NN_CLI__SUCCESS)
-        {
-            goto done;
-        }
-
-        const char *first_command = args[0];
-        if (strcmp(first_command, s_command_list.m_command[i]->m_name) == 0)
-        {
-            if (s_command_list.m_command[i]->m_func(argc, args) !=
-                NN_CLI__SUCCESS)
-            {
-                NNCli_LogWarn("Command args are incorrect. %s | %s",
-                              s_command_list.m_command[i]->m_name,
-                              s_command_list.m_command[i]->m_help_msg);
-            }
-            res = NN_CLI__SUCCESS;
-            goto done;
-        }
+        s_command_res = a_res;
     }
-
-    // If the command is found, this function will be exited before this line.
-    NNCli_LogError("Command not found");
-    res = NN_CLI__SUCCESS;  // This is not an error.
-
-done:
-    return res;
 }
 
-static NNCli_Err_t GetInputAsync(char **out_string)
+static void ReportCommandResult(const NNCli_Command_t *a_command,
+                                NNCli_Err_t a_res)
 {
-    /* Asynchronous mode using the multiplexing API: wait for
-     * data on stdin, and simulate async data coming from some source
-     * using the select(2) timeout. */
-    NNCli_Err_t ret = NN_CLI__IN_PROGRESS;
-    static bool s_requires_init = true;
-    static struct linenoiseState ls;
-    static char buf[1024];
-    if (s_requires_init)
-    {
-        memset(buf, 0, sizeof(buf));
-        memset(&ls, 0, sizeof(ls));
-        s_requires_init = false;
-        linenoiseEditStart(&ls, -1, -1, buf, sizeof(buf), "> ");
-    }
-
-    fd_set readfds;
-    int retval;
-    struct timeval tv = s_async.m_timeout;
-
-    FD_ZERO(&readfds);
-    FD_SET(ls.ifd, &readfds);
-
-    retval = select(ls.ifd + 1, &readfds, NULL, NULL, &tv);
-    if (retval == -1)
+    RecordCommandResult(a_res);
+    if (a_res == NN_CLI__CANCELLED)
     {
-        perror("select()");
-        exit(1);
+        NNCli_LogWarn("%s has been %s", a_command->m_name,
+                      (s_cancel_reason == CANCEL_REASON_TIMED_OUT)
+                          ? "timed out"
+                          : "interrupted");
     }
-    else if (retval)
+    else if (a_res != NN_CLI__SUCCESS)
     {
-        *out_string = linenoiseEditFeed(&ls);
-        /* A NULL return means: line editing is continuing.
-         * Otherwise the user hit enter or stopped editing
-         * (CTRL+C/D). */
-        if (*out_string == linenoiseEditMore)
-        {
-            goto done;
-        }
+        NNCli_LogWarn("Command args are incorrect. %s | %s", a_command->m_name,
+                      a_command->m_help_msg);
     }
-    else
-    {
-        // Timeout occurred
+}
 
-        // static int s_debug_print_counter = 0;
-        // if (s_debug_print_counter < 3 || s_debug_print_counter % 10 == 0)
-        // {
-        //     linenoiseHide(&ls);
-        //     printf("...\r\n");
-        //     linenoiseShow(&ls);
-        // }
-        // ++s_debug_print_counter;
+/**
+ * Output capture
+ */
 
-        goto done;
-    }
+static ssize_t WriteToOutputSink(void *a_cookie, const char *a_data,
+                                 size_t a_len)
+{
+    OutputCapture_t *capture = (OutputCapture_t *)a_cookie;
+    return capture->m_sink(capture->m_ctx, a_data, a_len);
+}
 
-    linenoiseEditStop(&ls);
-    s_requires_init = true;
-    if (*out_string == NULL)
+// Everything written to stdout is passed to `a_sink` until EndOutputCapture()
+// is called. Captures can be nested.
+static NNCli_Err_t BeginOutputCapture(OutputCapture_t *a_capture,
+                                      OutputSink_t a_sink, void *a_ctx)
+{
+    static const cookie_io_functions_t s_funcs = {
+        .read = NULL,
+        .write = WriteToOutputSink,
+        .seek = NULL,
+        .close = NULL,
+    };
+
+    a_capture->m_sink = a_sink;
+    a_capture->m_ctx = a_ctx;
+    a_capture->m_stream = fopencookie(a_capture, "w", s_funcs);
+    if (a_capture->m_stream == NULL)
     {
-        exit(0); /* Ctrl+D/C. */
+        NNCli_LogError("Failed to open a stream to capture the output");
+        return NN_CLI__EXTERNAL_LIB_ERROR;
     }
+    // Pass the output to the sink line by line instead of waiting for the
+    // stream buffer to be filled up.
+    setvbuf(a_capture->m_stream, NULL, _IOLBF, 0);
 
-    ret = NN_CLI__SUCCESS;
+    fflush(stdout);
+    a_capture->m_prev_stdout = stdout;
+    stdout = a_capture->m_stream;
+    a_capture->m_outer = s_capture_top;
+    s_capture_top = a_capture;
 
-done:
-    return ret;
+    return NN_CLI__SUCCESS;
 }
 
-static NNCli_Err_t GetInputSync(char **out_string)
+static void EndOutputCapture(OutputCapture_t *a_capture)
 {
-    char *line = linenoise("> ");
-    if (line == NULL)
-    {
-        return NN_CLI__PROCESS_COMPLETED;
-    }
-
-    *out_string = line;
-    return NN_CLI__SUCCESS;
+    s_capture_top = a_capture->m_outer;
+    stdout = a_capture->m_prev_stdout;
+    // The output left in the stream buffer is passed to the sink here.
+    fclose(a_capture->m_stream);
 }
 
 /**
- * Default CLI commands
+ * Pipeline filters
  */
 
-static void ShowAllCommands(void)
+static bool ParseFilter(int argc, char **argv, Filter_t *out_filter)
 {
-    for (int i = 0; i < s_command_list.m_num; i++)
-    {
-        printf("%s: %s\n", s_command_list.m_command[i]->m_name,
-               s_command_list.m_command[i]->m_help_msg);
-    }
-}
+    memset(out_filter, 0, sizeof(*out_filter));
 
-static NNCli_Err_t HelpCommand(int argc, char **argv)
-{
-    if (argc != 1)
+    if (strcmp(argv[0], "grep") == 0)
     {
-        return NN_CLI__INVALID_ARGS;
-    }
-
-    ShowAllCommands();
-    return NN_CLI__SUCCESS;
-}
-
-static NNCli_Err_t HistoryLenCommand(int argc, char **argv)
-{
+        out_filter->m_type = FILTER_GREP;
+        int i = 1;
+        for (; i < argc && argv[i][0] == '-'; i++)
+        {
+            if (strcmp(argv[i], "-v") == 0)
+            {
+                out_filter->m_invert = true;
+            }
+            else if (strcmp(argv[i], "-i") == 0)
+            {
+                out_filter->m_ignore_case = true;
+            }
+            else
+            {
+                NNCli_LogError("Unknown grep option: %s", argv[i]);
+                return false;
+            }
+        }
+        if (i != argc - 1)
+        {
+            NNCli_LogError("Usage: grep [-v] [-i] pattern");
+            return false;
+        }
+        out_filter->m_pattern = argv[i];
+    }
+    else if (strcmp(argv[0], "head") == 0)
+    {
+        out_filter->m_type = FILTER_HEAD;
+        out_filter->m_limit = DEFAULT_HEAD_LINES;
+        if (argc == 2)
+        {
+            char *end;
+            out_filter->m_limit = strtol(argv[1], &end, 10);
+            if (*end != '\0' || end == argv[1] || out_filter->m_limit < 0)
+            {
+                NNCli_LogError("Usage: head [lines]");
+                return false;
+            }
+        }
+        else if (argc != 1)
+        {
+            NNCli_LogError("Usage: head [lines]");
+            return false;
+        }
+    }
+    else if (strcmp(argv[0], "count") == 0)
+    {
+        out_filter->m_type = FILTER_COUNT;
+        if (argc != 1)
+        {
+            NNCli_LogError("Usage: count");
+            return false;
+        }
+    }
+    else
+    {
+        NNCli_LogError("Unknown filter: %s", argv[0]);
+        return false;
+    }
+
+    return true;
+}
+
+static bool GrepMatches(const Filter_t *a_filter, const char *a_line)
+{
+    const char *found = a_filter->m_ignore_case
+                            ? strcasestr(a_line, a_filter->m_pattern)
+                            : strstr(a_line, a_filter->m_pattern);
+    return found != NULL;
+}
+
+// Passes `a_line` through the filters from `a_first` and writes it out if it
+// gets through all of them.
+static void PushLineToFilters(Pipeline_t *a_pipeline, size_t a_first,
+                              const char *a_line)
+{
+    for (size_t i = a_first; i < a_pipeline->m_filter_num; i++)
+    {
+        Filter_t *filter = &a_pipeline->m_filters[i];
+        filter->m_lines++;
+        switch (filter->m_type)
+        {
+            case FILTER_GREP:
+                if (GrepMatches(filter, a_line) == filter->m_invert)
+                {
+                    return;
+                }
+                break;
+
+            case FILTER_HEAD:
+                if (filter->m_lines > filter->m_limit)
+                {
+                    return;
+                }
+                if (filter->m_lines == filter->m_limit)
+                {
+                    // Nothing after this line can get through this filter, so
+                    // the command does not have to produce more output.
+                    a_pipeline->m_closed = true;
+                }
+                break;
+
+            case FILTER_COUNT:
+                // Only the number of lines is written out at the end.
+                return;
+        }
+    }
+
+    fputs(a_line, a_pipeline->m_out);
+}
+
+static ssize_t WriteToPipeline(void *a_ctx, const char *a_data, size_t a_len)
+{
+    Pipeline_t *pipeline = (Pipeline_t *)a_ctx;
+    if (pipeline->m_closed)
+    {
+        errno = EPIPE;
+        return -1;
+    }
+
+    size_t offset = 0;
+    while (offset < a_len && !pipeline->m_closed)
+    {
+        const char *data = &a_data[offset];
+        const char *newline = (const char *)memchr(data, '\n', a_len - offset);
+        size_t chunk_len = (newline != NULL) ? (size_t)(newline - data) + 1
+                                             : a_len - offset;
+        bool is_line_end = (newline != NULL);
+
+        size_t room = sizeof(pipeline->m_line) - 1 - pipeline->m_line_len;
+        if (chunk_len >= room)
+        {
+            chunk_len = room;
+            is_line_end = true;
+        }
+
+        memcpy(&pipeline->m_line[pipeline->m_line_len], data, chunk_len);
+        pipeline->m_line_len += chunk_len;
+        offset += chunk_len;
+
+        if (is_line_end)
+        {
+            pipeline->m_line[pipeline->m_line_len] = '\0';
+            PushLineToFilters(pipeline, 0, pipeline->m_line);
+            pipeline->m_line_len = 0;
+        }
+    }
+
+    // The rest is discarded if the pipeline has been closed in the middle.
+    return a_len;
+}
+
+static void FinishPipeline(Pipeline_t *a_pipeline)
+{
+    // The last line may not end with a newline.
+    if (a_pipeline->m_line_len > 0 && !a_pipeline->m_closed)
+    {
+        a_pipeline->m_line[a_pipeline->m_line_len] = '\0';
+        PushLineToFilters(a_pipeline, 0, a_pipeline->m_line);
+        a_pipeline->m_line_len = 0;
+    }
+
+    for (size_t i = 0; i < a_pipeline->m_filter_num; i++)
+    {
+        const Filter_t *filter = &a_pipeline->m_filters[i];
+        if (filter->m_type == FILTER_COUNT)
+        {
+            char count_line[32];
+            snprintf(count_line, sizeof(count_line), "%ld\n", filter->m_lines);
+            PushLineToFilters(a_pipeline, i + 1, count_line);
+        }
+    }
+
+    fflush(a_pipeline->m_out);
+}
+
+/**
+ * Result cache
+ */
+
+static uint64_t GetMonotonicNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+static uint64_t GetMonotonicMs(void) { return GetMonotonicNs() / 1000000; }
+
+static void ClearCacheEntry(CacheEntry_t *a_entry)
+{
+    NNCli_Free(a_entry->m_key);
+    NNCli_Free(a_entry->m_output);
+    memset(a_entry, 0, sizeof(*a_entry));
+}
+
+static CacheEntry_t *FindCacheEntry(const NNCli_Command_t *a_command,
+                                    const char *a_key, size_t a_key_len,
+                                    uint32_t a_key_hash)
+{
+    for (size_t i = 0; i < NN_CLI__CACHE_ENTRY_NUM; i++)
+    {
+        CacheEntry_t *entry = &s_cache[i];
+        if (entry->m_command == a_command && entry->m_key_hash == a_key_hash &&
+            entry->m_key_len == a_key_len &&
+            memcmp(entry->m_key, a_key, a_key_len) == 0)
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+// Returns an unused entry, or the least recently used one if all are in use.
+static CacheEntry_t *GetCacheEntryToStore(uint64_t a_now_ms)
+{
+    CacheEntry_t *victim = &s_cache[0];
+    for (size_t i = 0; i < NN_CLI__CACHE_ENTRY_NUM; i++)
+    {
+        CacheEntry_t *entry = &s_cache[i];
+        if (entry->m_command == NULL || entry->m_expire_ms <= a_now_ms)
+        {
+            ClearCacheEntry(entry);
+            return entry;
+        }
+        if (entry->m_last_used_ms < victim->m_last_used_ms)
+        {
+            victim = entry;
+        }
+    }
+
+    s_cache_stats.m_evictions++;
+    ClearCacheEntry(victim);
+    return victim;
+}
+
+static ssize_t WriteToCacheRecorder(void *a_ctx, const char *a_data,
+                                    size_t a_len)
+{
+    CacheRecorder_t *recorder = (CacheRecorder_t *)a_ctx;
+
+    if (!recorder->m_incomplete)
+    {
+        if (recorder->m_len + a_len > NN_CLI__CACHE_OUTPUT_MAX_LEN)
+        {
+            recorder->m_incomplete = true;
+        }
+        else if (recorder->m_len + a_len > recorder->m_capacity)
+        {
+            size_t capacity = recorder->m_capacity * 2;
+            if (capacity < recorder->m_len + a_len)
+            {
+                capacity = recorder->m_len + a_len;
+            }
+            char *buf = (char *)NNCli_Realloc(recorder->m_buf, capacity);
+            if (buf == NULL)
+            {
+                recorder->m_incomplete = true;
+            }
+            else
+            {
+                recorder->m_buf = buf;
+                recorder->m_capacity = capacity;
+            }
+        }
+    }
+    if (!recorder->m_incomplete)
+    {
+        memcpy(&recorder->m_buf[recorder->m_len], a_data, a_len);
+        recorder->m_len += a_len;
+    }
+
+    // The output is still shown while it is recorded.
+    if (fwrite(a_data, 1, a_len, recorder->m_out) != a_len)
+    {
+        recorder->m_incomplete = true;
+        errno = EPIPE;
+        return -1;
+    }
+    return a_len;
+}
+
+// Calls a cacheable command, or replays its output if the same command line
+// has been run within its TTL.
+static NNCli_Err_t InvokeCachedCommand(const NNCli_Command_t *a_command,
+                                       int argc, char **argv)
+{
+    NNCli_Err_t res;
+    char key[NN_CLI__LINE_MAX_LEN];
+    size_t key_len = 0;
+    uint32_t key_hash;
+    uint64_t now_ms = GetMonotonicMs();
+    CacheEntry_t *entry;
+    CacheRecorder_t recorder;
+    OutputCapture_t capture;
+
+    for (int i = 0; i < argc; i++)
+    {
+        size_t len = strlen(argv[i]) + 1;
+        if (key_len + len > sizeof(key))
+        {
+            // Too long to be a key. This does not happen for split lines.
+            return a_command->m_func(argc, argv);
+        }
+        memcpy(&key[key_len], argv[i], len);
+        key_len += len;
+    }
+    key_hash = HashBytes(key, key_len, 0);
+
+    entry = FindCacheEntry(a_command, key, key_len, key_hash);
+    if (entry != NULL && entry->m_expire_ms > now_ms)
+    {
+        s_cache_stats.m_hits++;
+        entry->m_last_used_ms = now_ms;
+        fwrite(entry->m_output, 1, entry->m_output_len, stdout);
+        return NN_CLI__SUCCESS;
+    }
+    s_cache_stats.m_misses++;
+    if (entry != NULL)
+    {
+        ClearCacheEntry(entry);
+    }
+
+    memset(&recorder, 0, sizeof(recorder));
+    if (BeginOutputCapture(&capture, WriteToCacheRecorder, &recorder) !=
+        NN_CLI__SUCCESS)
+    {
+        return a_command->m_func(argc, argv);
+    }
+    recorder.m_out = capture.m_prev_stdout;
+    res = a_command->m_func(argc, argv);
+    EndOutputCapture(&capture);
+
+    // Only successful results are reused. A cancelled command may have
+    // returned early with a part of its output.
+    if (res == NN_CLI__SUCCESS && !recorder.m_incomplete &&
+        s_cancel_reason == CANCEL_REASON_NONE)
+    {
+        entry = GetCacheEntryToStore(now_ms);
+        entry->m_key = (char *)NNCli_Malloc(key_len);
+        if (entry->m_key != NULL)
+        {
+            memcpy(entry->m_key, key, key_len);
+            entry->m_command = a_command;
+            entry->m_key_len = key_len;
+            entry->m_key_hash = key_hash;
+            entry->m_output = recorder.m_buf;
+            entry->m_output_len = recorder.m_len;
+            entry->m_expire_ms = now_ms + a_command->m_cache_ttl_ms;
+            entry->m_last_used_ms = now_ms;
+            recorder.m_buf = NULL;
+        }
+    }
+    NNCli_Free(recorder.m_buf);
+
+    return res;
+}
+
+/**
+ * Cancellation and deadlines
+ */
+
+static void StartAlarm(uint32_t a_ms)
+{
+    struct itimerval timer = {
+        .it_interval = {.tv_sec = 0, .tv_usec = 0},
+        .it_value = {.tv_sec = a_ms / 1000,
+                     .tv_usec = (suseconds_t)(a_ms % 1000) * 1000},
+    };
+    s_is_alarm_set = true;
+    s_prev_timer_saved_ns = GetMonotonicNs();
+    setitimer(ITIMER_REAL, &timer, &s_prev_timer);
+}
+
+static void StopAlarm(void)
+{
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_REAL, &timer, NULL);
+    s_is_alarm_set = false;
+}
+
+// Sets the timer of the application again with the time it has left. One
+// which would have expired while the command was running expires at once.
+static void RestorePrevAlarm(void)
+{
+    uint64_t elapsed_us = (GetMonotonicNs() - s_prev_timer_saved_ns) / 1000;
+    uint64_t left_us = (uint64_t)s_prev_timer.it_value.tv_sec * 1000000 +
+                       (uint64_t)s_prev_timer.it_value.tv_usec;
+
+    if (left_us == 0)
+    {
+        return;
+    }
+    left_us = (left_us > elapsed_us) ? left_us - elapsed_us : 1;
+    s_prev_timer.it_value.tv_sec = (time_t)(left_us / 1000000);
+    s_prev_timer.it_value.tv_usec = (suseconds_t)(left_us % 1000000);
+    setitimer(ITIMER_REAL, &s_prev_timer, NULL);
+}
+
+// Commands are only cancelled through the token. Jumping out of a signal
+// handler would leave the locks the command holds, e.g. of stdio or malloc,
+// held for good.
+static void Cancel(CancelReason_t a_reason)
+{
+    if (s_cancel_reason == CANCEL_REASON_NONE)
+    {
+        s_cancel_reason = a_reason;
+    }
+}
+
+// A blocking call in the command returns EINTR on each Ctrl-C, so a command
+// which retries it can still check NNCli_IsCancelled().
+static void OnInterrupt(int a_signal) { Cancel(CANCEL_REASON_INTERRUPTED); }
+
+// The deadline of the command.
+static void OnAlarm(int a_signal) { Cancel(CANCEL_REASON_TIMED_OUT); }
+
+// The signals are handled only while a command is running. At the prompt,
+// Ctrl-C is a key handled by linenoise.
+static void StartCancelSignals(const CommandRun_t *a_run)
+{
+    uint32_t timeout_ms = a_run->m_command->m_timeout_ms;
+    uint64_t elapsed_ms = GetMonotonicMs() - a_run->m_start_ms;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    // No SA_RESTART, so that blocking calls in the command return EINTR.
+    action.sa_flags = 0;
+
+    s_cancel_reason = CANCEL_REASON_NONE;
+    action.sa_handler = OnInterrupt;
+    sigaction(SIGINT, &action, &s_prev_sigint_action);
+    action.sa_handler = OnAlarm;
+    sigaction(SIGALRM, &action, &s_prev_sigalrm_action);
+
+    // The deadline is counted from the first slice of the command.
+    if (a_run->m_is_cancel_requested)
+    {
+        Cancel(CANCEL_REASON_INTERRUPTED);
+    }
+    else if (timeout_ms > 0 && elapsed_ms >= timeout_ms)
+    {
+        Cancel(CANCEL_REASON_TIMED_OUT);
+    }
+    else if (timeout_ms > 0)
+    {
+        StartAlarm(timeout_ms - elapsed_ms);
+    }
+}
+
+// Most commands have no timeout and are not cancelled, so the timer is left
+// alone unless it has been set. Ctrl-C cannot set it once SIGINT is restored.
+static void StopCancelSignals(void)
+{
+    bool was_alarm_set = s_is_alarm_set;
+
+    sigaction(SIGINT, &s_prev_sigint_action, NULL);
+    if (was_alarm_set)
+    {
+        StopAlarm();
+    }
+    sigaction(SIGALRM, &s_prev_sigalrm_action, NULL);
+    if (was_alarm_set)
+    {
+        RestorePrevAlarm();
+    }
+}
+
+static NNCli_Err_t InvokeCommandBody(CommandRun_t *a_run)
+{
+    // Only the first slice can be served from the cache, since a command
+    // which has yielded is in the middle of its work.
+    if ((a_run->m_command->m_flags & NN_CLI__COMMAND_FLAG_CACHEABLE) &&
+        a_run->m_slice_num == 0)
+    {
+        return InvokeCachedCommand(a_run->m_command, a_run->m_argc,
+                                   a_run->m_argv);
+    }
+    return a_run->m_command->m_func(a_run->m_argc, a_run->m_argv);
+}
+
+// Runs one slice of the command. Commands run by another command share its
+// deadline and its slice.
+static NNCli_Err_t InvokeCommand(CommandRun_t *a_run)
+{
+    NNCli_Err_t res;
+    CommandRun_t *prev_running_command = s_running_command;
+    bool is_outermost = (prev_running_command == NULL);
+
+    if (is_outermost)
+    {
+        StartCancelSignals(a_run);
+        s_slice_end_ns =
+            GetMonotonicNs() + (uint64_t)NN_CLI__COMMAND_SLICE_MS * 1000000;
+    }
+    s_running_command = a_run;
+    res = InvokeCommandBody(a_run);
+    s_running_command = prev_running_command;
+    a_run->m_slice_num++;
+
+    if (is_outermost)
+    {
+        StopCancelSignals();
+    }
+    if (s_cancel_reason != CANCEL_REASON_NONE)
+    {
+        res = NN_CLI__CANCELLED;
+    }
+    return res;
+}
+
+static void InitCommandRun(CommandRun_t *a_run,
+                           const NNCli_Command_t *a_command, int argc,
+                           char **argv, Pipeline_t *a_pipeline)
+{
+    memset(a_run, 0, sizeof(*a_run));
+    a_run->m_command = a_command;
+    a_run->m_argc = argc;
+    a_run->m_argv = argv;
+    a_run->m_pipeline = a_pipeline;
+    a_run->m_start_ms = GetMonotonicMs();
+}
+
+// Runs a slice of the command, and reports the result when it has finished.
+// Returns NN_CLI__IN_PROGRESS if the command has yielded.
+static NNCli_Err_t RunCommandSlice(CommandRun_t *a_run)
+{
+    NNCli_Err_t res = NN_CLI__SUCCESS;
+    Pipeline_t *pipeline = a_run->m_pipeline;
+    Pipeline_t *prev_pipeline = s_active_pipeline;
+    OutputCapture_t capture;
+    NNCli_Err_t command_res;
+
+    if (pipeline != NULL)
+    {
+        res = BeginOutputCapture(&capture, WriteToPipeline, pipeline);
+        if (res != NN_CLI__SUCCESS)
+        {
+            goto done;
+        }
+        pipeline->m_out = capture.m_prev_stdout;
+        s_active_pipeline = pipeline;
+    }
+
+    command_res = InvokeCommand(a_run);
+
+    if (pipeline != NULL)
+    {
+        EndOutputCapture(&capture);
+        s_active_pipeline = prev_pipeline;
+    }
+    if (command_res == NN_CLI__IN_PROGRESS)
+    {
+        return NN_CLI__IN_PROGRESS;
+    }
+
+    if (pipeline != NULL)
+    {
+        FinishPipeline(pipeline);
+    }
+    ReportCommandResult(a_run->m_command, command_res);
+
+done:
+    NNCli_Free(a_run->m_state);
+    a_run->m_state = NULL;
+    return res;
+}
+
+// The tokens of a line fit in NN_CLI__LINE_MAX_LEN bytes, since they are
+// copied from it.
+static char *CopyToken(char *a_buf, size_t *a_used, const char *a_token)
+{
+    size_t len = strlen(a_token) + 1;
+    char *copy = (char *)memcpy(&a_buf[*a_used], a_token, len);
+    *a_used += len;
+    return copy;
+}
+
+// The separator tokens are kept as they are.
+static int CopyTokens(char **a_tokens, int a_token_num, char *a_buf,
+                      char **out_tokens)
+{
+    size_t used = 0;
+    for (int i = 0; i < a_token_num; i++)
+    {
+        if (a_tokens[i] == s_pipe_token || a_tokens[i] == s_sequence_token)
+        {
+            out_tokens[i] = a_tokens[i];
+        }
+        else
+        {
+            out_tokens[i] = CopyToken(a_buf, &used, a_tokens[i]);
+        }
+    }
+    return a_token_num;
+}
+
+static bool IsIoEnabled(void) { return s_io.m_read != NULL; }
+
+static void MeasureTerminalSize(void)
+{
+    struct winsize size;
+    const char *columns = getenv("COLUMNS");
+    const char *rows = getenv("LINES");
+
+    s_is_terminal_size_stale = false;
+    if (!IsIoEnabled() && ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 &&
+        size.ws_col > 0)
+    {
+        s_terminal_columns = size.ws_col;
+        s_terminal_rows = size.ws_row;
+        s_is_terminal_size_known = true;
+        return;
+    }
+    if (s_is_terminal_size_known)
+    {
+        // Given by NNCli_SetTerminalSize().
+        return;
+    }
+    s_terminal_columns =
+        (columns != NULL && atoi(columns) > 0) ? atoi(columns) : 80;
+    s_terminal_rows = (rows != NULL && atoi(rows) > 0) ? atoi(rows) : 0;
+}
+
+static int GetTerminalWidth(void)
+{
+    if (s_is_terminal_size_stale)
+    {
+        MeasureTerminalSize();
+    }
+    return s_terminal_columns;
+}
+
+// Installed with SA_SIGINFO, so that a previous handler which takes
+// `a_info` and `a_ucontext` gets them.
+static void OnTerminalResize(int a_signal, siginfo_t *a_info, void *a_ucontext)
+{
+    s_is_terminal_size_stale = true;
+    if (s_prev_sigwinch_action.sa_flags & SA_SIGINFO)
+    {
+        s_prev_sigwinch_action.sa_sigaction(a_signal, a_info, a_ucontext);
+    }
+    else if (s_prev_sigwinch_action.sa_handler != SIG_DFL &&
+             s_prev_sigwinch_action.sa_handler != SIG_IGN)
+    {
+        s_prev_sigwinch_action.sa_handler(a_signal);
+    }
+}
+
+// The handler of the application, if any, is still called.
+static void WatchTerminalResize(void)
+{
+    struct sigaction action;
+
+    if (s_is_resize_watched)
+    {
+        return;
+    }
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = OnTerminalResize;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART | SA_SIGINFO;
+    if (sigaction(SIGWINCH, &action, &s_prev_sigwinch_action) == 0)
+    {
+        s_is_resize_watched = true;
+    }
+}
+
+// Only the commands run from a line at the top level can be resumed by
+// NNCli_Run(), and the sync mode has no chance to resume them while waiting
+// for the next line.
+static bool CanSuspendCommand(void)
+{
+    return (s_async.m_enabled || IsIoEnabled()) && !s_is_rpc &&
+           !s_is_executing &&
+           s_running_command == NULL && !s_suspended.m_is_pending;
+}
+
+static void SuspendCommand(const CommandRun_t *a_run)
+{
+    SuspendedCommand_t *suspended = &s_suspended;
+    size_t used = 0;
+
+    suspended->m_run = *a_run;
+    for (int i = 0; i < a_run->m_argc; i++)
+    {
+        suspended->m_argv[i] =
+            CopyToken(suspended->m_argv_buf, &used, a_run->m_argv[i]);
+    }
+    suspended->m_argv[a_run->m_argc] = NULL;
+    suspended->m_run.m_argv = suspended->m_argv;
+
+    // The patterns of the filters are in the line too.
+    if (a_run->m_pipeline != NULL)
+    {
+        suspended->m_pipeline = *a_run->m_pipeline;
+        suspended->m_run.m_pipeline = &suspended->m_pipeline;
+        for (size_t i = 0; i < suspended->m_pipeline.m_filter_num; i++)
+        {
+            Filter_t *filter = &suspended->m_pipeline.m_filters[i];
+            if (filter->m_pattern != NULL)
+            {
+                filter->m_pattern =
+                    CopyToken(suspended->m_argv_buf, &used, filter->m_pattern);
+            }
+        }
+    }
+    suspended->m_rest_token_num = 0;
+    suspended->m_is_pending = true;
+}
+
+// Runs the command to the end, or suspends it if it yields and can be
+// resumed later. Returns NN_CLI__IN_PROGRESS if it has been suspended.
+static NNCli_Err_t RunCommand(CommandRun_t *a_run)
+{
+    NNCli_Err_t res = RunCommandSlice(a_run);
+    if (res == NN_CLI__IN_PROGRESS && CanSuspendCommand())
+    {
+        SuspendCommand(a_run);
+        return NN_CLI__IN_PROGRESS;
+    }
+    while (res == NN_CLI__IN_PROGRESS)
+    {
+        res = RunCommandSlice(a_run);
+    }
+    return res;
+}
+
+// Runs `cmd | filter | ...`. The command output is passed to the filters
+// chunk by chunk while the command is running.
+static NNCli_Err_t RunPipeline(const NNCli_Command_t *a_command,
+                               int *a_stage_argc, char ***a_stage_argv,
+                               size_t a_stage_num)
+{
+    NNCli_Err_t res = NN_CLI__SUCCESS;
+    Pipeline_t pipeline;
+    CommandRun_t run;
+
+    memset(&pipeline, 0, sizeof(pipeline));
+    for (size_t i = 1; i < a_stage_num; i++)
+    {
+        Filter_t *filter = &pipeline.m_filters[pipeline.m_filter_num++];
+        if (!ParseFilter(a_stage_argc[i], a_stage_argv[i], filter))
+        {
+            RecordCommandResult(NN_CLI__INVALID_ARGS);
+            goto done;
+        }
+        if (filter->m_type == FILTER_HEAD && filter->m_limit == 0)
+        {
+            pipeline.m_closed = true;
+        }
+    }
+
+    InitCommandRun(&run, a_command, a_stage_argc[0], a_stage_argv[0],
+                   &pipeline);
+    res = RunCommand(&run);
+
+done:
+    return res;
+}
+
+static NNCli_Err_t CallPipeline(char **a_tokens, int a_token_count)
+{
+    NNCli_Err_t res = NN_CLI__SUCCESS;
+    int stage_argc[NN_CLI__MAX_PIPELINE_STAGES];
+    char **stage_argv[NN_CLI__MAX_PIPELINE_STAGES];
+    size_t stage_num = 0;
+    int begin = 0;
+    const NNCli_Command_t *command;
+    CommandRun_t run;
+
+    for (int i = 0; i <= a_token_count; i++)
+    {
+        if (i < a_token_count && a_tokens[i] != s_pipe_token)
+        {
+            continue;
+        }
+
+        if (i == begin)
+        {
+            NNCli_LogError("Missing command in pipeline");
+            RecordCommandResult(NN_CLI__INVALID_ARGS);
+            goto done;
+        }
+        if (stage_num == NN_CLI__MAX_PIPELINE_STAGES)
+        {
+            NNCli_LogError(
+                "The number of pipeline stages exceeds the maximum limit: %d",
+                NN_CLI__MAX_PIPELINE_STAGES);
+            RecordCommandResult(NN_CLI__EXCEED_CAPACITY);
+            goto done;
+        }
+        if (i - begin > NN_CLI__MAX_WORDS_PER_COMMAND)
+        {
+            NNCli_LogError(
+                "The number of words in the command exceeds the "
+                "maximum limit: %d",
+                NN_CLI__MAX_WORDS_PER_COMMAND);
+            RecordCommandResult(NN_CLI__EXCEED_CAPACITY);
+            goto done;
+        }
+
+        stage_argc[stage_num] = i - begin;
+        stage_argv[stage_num] = &a_tokens[begin];
+        stage_num++;
+        begin = i + 1;
+    }
+
+    command = FindCommand(stage_argv[0][0]);
+    if (command == NULL)
+    {
+        NNCli_LogError("Command not found");
+        RecordCommandResult(NN_CLI__NOT_FOUND);
+        goto done;
+    }
+
+    if (stage_num == 1)
+    {
+        InitCommandRun(&run, command, stage_argc[0], stage_argv[0], NULL);
+        res = RunCommand(&run);
+    }
+    else
+    {
+        res = RunPipeline(command, stage_argc, stage_argv, stage_num);
+    }
+
+done:
+    return res;
+}
+
+// `cmd1 ; cmd2` runs the pipelines one after another. If a command is
+// suspended, the rest of the line runs after it has finished.
+static NNCli_Err_t RunTokens(char **a_tokens, int a_token_count)
+{
+    NNCli_Err_t res = NN_CLI__SUCCESS;
+    int begin = 0;
+
+    for (int i = 0; i <= a_token_count; i++)
+    {
+        if (i < a_token_count && a_tokens[i] != s_sequence_token)
+        {
+            continue;
+        }
+
+        if (i > begin)
+        {
+            res = CallPipeline(&a_tokens[begin], i - begin);
+            if (res == NN_CLI__IN_PROGRESS)
+            {
+                if (i < a_token_count)
+                {
+                    s_suspended.m_rest_token_num = CopyTokens(
+                        &a_tokens[i + 1], a_token_count - i - 1,
+                        s_suspended.m_rest_buf, s_suspended.m_rest_tokens);
+                }
+                break;
+            }
+            if (res != NN_CLI__SUCCESS)
+            {
+                goto done;
+            }
+        }
+        begin = i + 1;
+    }
+
+    res = NN_CLI__SUCCESS;
+
+done:
+    return res;
+}
+
+/**
+ * Aliases
+ */
+
+static void SaveAliases(void)
+{
+    char buf[NN_CLI__LINE_MAX_LEN];
+    FILE *file;
+
+    if (s_alias_filename == NULL)
+    {
+        return;
+    }
+    file = fopen(s_alias_filename, "w");
+    if (file == NULL)
+    {
+        NNCli_LogError("Failed to save the aliases to %s", s_alias_filename);
+        return;
+    }
+    for (size_t i = 0; i < s_aliases.m_num; i++)
+    {
+        if (NNCli_AliasFormat(s_aliases.m_aliases[i], buf, sizeof(buf)))
+        {
+            fprintf(file, "%s\n", buf);
+        }
+    }
+    fclose(file);
+}
+
+// Each line of the file is `name = token ...`.
+static void LoadAliases(void)
+{
+    char line[NN_CLI__LINE_MAX_LEN];
+    char buf[NN_CLI__LINE_MAX_LEN];
+    char *tokens[NN_CLI__MAX_TOKENS_PER_LINE];
+    int token_count;
+    FILE *file = fopen(s_alias_filename, "r");
+
+    if (file == NULL)
+    {
+        return;
+    }
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line[strcspn(line, "\n")] = '\0';
+        if (SplitCommandLine(line, buf, tokens, &token_count) !=
+                NN_CLI__SUCCESS ||
+            token_count < 3 || strcmp(tokens[1], "=") != 0 ||
+            NNCli_AliasDefine(&s_aliases, tokens[0], &tokens[2],
+                              token_count - 2) != NN_CLI__SUCCESS)
+        {
+            NNCli_LogWarn("Skipped an alias in %s: %s", s_alias_filename,
+                          line);
+        }
+    }
+    fclose(file);
+}
+
+// `alias NAME = ...` and `alias -d NAME` take the whole line, so that the
+// definition can have `|` and `;`. The tokens of a line may point into an
+// alias, so the lines nested in a command, e.g. by `time` or NNCli_Execute(),
+// can't change aliases.
+static bool IsAliasChange(char **a_tokens, int a_token_count)
+{
+    return a_token_count >= 3 && strcmp(a_tokens[0], "alias") == 0 &&
+           (strcmp(a_tokens[1], "-d") == 0 || strcmp(a_tokens[2], "=") == 0);
+}
+
+static NNCli_Err_t ChangeAlias(char **a_tokens, int a_token_count)
+{
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+
+    if (strcmp(a_tokens[1], "-d") == 0)
+    {
+        if (a_token_count == 3)
+        {
+            res = NNCli_AliasRemove(&s_aliases, a_tokens[2]);
+        }
+    }
+    else
+    {
+        res = NNCli_AliasDefine(&s_aliases, a_tokens[1], &a_tokens[3],
+                                a_token_count - 3);
+    }
+
+    if (res == NN_CLI__SUCCESS)
+    {
+        SaveAliases();
+    }
+    return res;
+}
+
+// `out_command_res`, if not NULL, gets the first failure of the commands of
+// this line, while the one of an outer line is kept in `s_command_res`.
+static NNCli_Err_t CallRegisteredCommand(const char *a_command,
+                                         NNCli_Err_t *out_command_res)
+{
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+    NNCli_AssertOrReturn(a_command, res, "a_command is NULL");
+
+    char buf[NN_CLI__LINE_MAX_LEN];
+    char *tokens[NN_CLI__MAX_TOKENS_PER_LINE];
+    char *expanded_tokens[NN_CLI__MAX_TOKENS_PER_LINE];
+    int token_count = 0;
+    int expanded_count;
+    NNCli_Err_t outer_command_res =
+        (s_line_depth > 0) ? s_command_res : NN_CLI__SUCCESS;
+    s_line_depth++;
+    s_command_res = NN_CLI__SUCCESS;
+    NNCli_Trace1(command_start, a_command);
+    res = SplitCommandLine(a_command, buf, tokens, &token_count);
+    if (res != NN_CLI__SUCCESS)
+    {
+        goto done;
+    }
+
+    // Like the failures of commands, those of aliases don't fail the line.
+    if (IsAliasChange(tokens, token_count))
+    {
+        if (s_line_depth > 1)
+        {
+            NNCli_LogError("Aliases can't be changed while a command is "
+                           "running");
+            RecordCommandResult(NN_CLI__NOT_READY);
+        }
+        else
+        {
+            RecordCommandResult(ChangeAlias(tokens, token_count));
+        }
+        goto done;
+    }
+    res = NNCli_AliasExpand(&s_aliases, tokens, token_count, expanded_tokens,
+                            NN_CLI__MAX_TOKENS_PER_LINE, &expanded_count);
+    if (res != NN_CLI__SUCCESS)
+    {
+        RecordCommandResult(res);
+        res = NN_CLI__SUCCESS;
+        goto done;
+    }
+
+    res = RunTokens(expanded_tokens, expanded_count);
+
+done:
+    RecordCommandResult(res);
+    NNCli_Trace3(command_end, a_command, (token_count > 0) ? tokens[0] : "",
+                 (int)s_command_res);
+    if (out_command_res != NULL)
+    {
+        *out_command_res = s_command_res;
+    }
+    s_line_depth--;
+    // The failure of a nested line is also the one of the outer line, unless
+    // that has failed before.
+    if (outer_command_res != NN_CLI__SUCCESS)
+    {
+        s_command_res = outer_command_res;
+    }
+    return res;
+}
+
+// Runs a slice of the suspended command.
+static void ResumeSuspendedCommand(void)
+{
+    char rest_buf[NN_CLI__LINE_MAX_LEN];
+    char *rest_tokens[NN_CLI__MAX_TOKENS_PER_LINE];
+    int rest_token_num;
+
+    if (!s_suspended.m_is_pending ||
+        RunCommandSlice(&s_suspended.m_run) == NN_CLI__IN_PROGRESS)
+    {
+        return;
+    }
+
+    // The rest of the line can suspend another command.
+    rest_token_num =
+        CopyTokens(s_suspended.m_rest_tokens, s_suspended.m_rest_token_num,
+                   rest_buf, rest_tokens);
+    s_suspended.m_is_pending = false;
+    RunTokens(rest_tokens, rest_token_num);
+}
+
+static void CancelSuspendedCommand(void)
+{
+    if (s_suspended.m_is_pending)
+    {
+        s_suspended.m_run.m_is_cancel_requested = true;
+    }
+}
+
+/**
+ * Latency tracing
+ */
+
+static uint64_t GetThreadCpuNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+static long GetPreemptedNum(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) != 0)
+    {
+        return 0;
+    }
+    return usage.ru_nivcsw;
+}
+
+static void RecordLatency(NNCli_LatencyKind_t a_kind, uint64_t a_ns)
+{
+    NNCli_LatencyHistogram_t *histogram = &s_latency[a_kind];
+    uint64_t us = a_ns / 1000;
+    size_t bucket = 0;
+    while (us >= 2 && bucket < NN_CLI__LATENCY_BUCKET_NUM - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+
+    histogram->m_buckets[bucket]++;
+    histogram->m_count++;
+    histogram->m_total_ns += a_ns;
+    if (a_ns > histogram->m_max_ns)
+    {
+        histogram->m_max_ns = a_ns;
+    }
+}
+
+// Call this as soon as the input wait returns with a key.
+static void BeginKeystrokeSample(LatencySample_t *a_sample)
+{
+    a_sample->m_is_active = s_is_latency_traced;
+    if (a_sample->m_is_active)
+    {
+        a_sample->m_start_ns = GetMonotonicNs();
+        a_sample->m_start_cpu_ns = GetThreadCpuNs();
+        a_sample->m_start_preempted_num = GetPreemptedNum();
+    }
+}
+
+// Call this after the echo has been written. Does nothing if the sample has
+// ended already.
+static void EndKeystrokeSample(LatencySample_t *a_sample)
+{
+    if (!a_sample->m_is_active)
+    {
+        return;
+    }
+    a_sample->m_is_active = false;
+
+    uint64_t elapsed_ns = GetMonotonicNs() - a_sample->m_start_ns;
+    uint64_t cpu_ns = GetThreadCpuNs() - a_sample->m_start_cpu_ns;
+    RecordLatency(NN_CLI__LATENCY_KEYSTROKE, elapsed_ns);
+    if (elapsed_ns > cpu_ns)
+    {
+        RecordLatency((GetPreemptedNum() > a_sample->m_start_preempted_num)
+                          ? NN_CLI__LATENCY_PREEMPTED
+                          : NN_CLI__LATENCY_BLOCKED,
+                      elapsed_ns - cpu_ns);
+    }
+}
+
+static void completion(const char *buf, linenoiseCompletions *lc)
+{
+    uint64_t start_ns = s_is_latency_traced ? GetMonotonicNs() : 0;
+    NNCli_Trace1(completion_start, buf);
+    CompleteLine(buf, lc);
+    NNCli_Trace2(completion_end, buf, lc->len);
+    if (s_is_latency_traced)
+    {
+        RecordLatency(NN_CLI__LATENCY_COMPLETION, GetMonotonicNs() - start_ns);
+    }
+}
+
+static char *hints(const char *buf, int *color, int *bold)
+{
+    uint64_t start_ns = s_is_latency_traced ? GetMonotonicNs() : 0;
+    const char *suggestion;
+    char *hint;
+    NNCli_Trace1(hint_start, buf);
+    suggestion = SuggestFromHistory(NULL, buf);
+    // The suggestion from the history replaces the hint of the options, since
+    // the line it completes may not be the command of the options.
+    if (suggestion != NULL)
+    {
+        // Dimmed like the autosuggestions of fish.
+        *color = 90;
+        *bold = 0;
+        hint = (char *)suggestion;
+    }
+    else
+    {
+        hint = HintCommandOptions(buf, color, bold);
+    }
+    if (s_is_latency_traced)
+    {
+        RecordLatency(NN_CLI__LATENCY_HINTS, GetMonotonicNs() - start_ns);
+    }
+    NNCli_Trace2(hint_end, buf, hint);
+    return hint;
+}
+
+static void ShowLatencyHistogram(const char *a_name,
+                                 const NNCli_LatencyHistogram_t *a_histogram)
+{
+    if (a_histogram->m_count == 0)
+    {
+        printf("%s: no samples\n", a_name);
+        return;
+    }
+
+    printf("%s: %u samples, avg %.1f us, max %.1f us\n", a_name,
+           (unsigned)a_histogram->m_count,
+           a_histogram->m_total_ns / 1000.0 / a_histogram->m_count,
+           a_histogram->m_max_ns / 1000.0);
+    for (size_t i = 0; i < NN_CLI__LATENCY_BUCKET_NUM; i++)
+    {
+        if (a_histogram->m_buckets[i] == 0)
+        {
+            continue;
+        }
+        if (i == NN_CLI__LATENCY_BUCKET_NUM - 1)
+        {
+            printf("  %8lu us -          : %u\n", 1UL << i,
+                   (unsigned)a_histogram->m_buckets[i]);
+        }
+        else
+        {
+            printf("  %8lu us - %8lu us: %u\n", (i == 0) ? 0UL : 1UL << i,
+                   1UL << (i + 1), (unsigned)a_histogram->m_buckets[i]);
+        }
+    }
+}
+
+/**
+ * Scheduled commands
+ */
+
+static uint64_t GetCurrentTick(void)
+{
+    return GetMonotonicMs() / NN_CLI__TIMER_TICK_MS;
+}
+
+static void RunScheduledJob(NNCli_Timer_t *a_timer, void *a_ctx)
+{
+    ScheduledJob_t *job = (ScheduledJob_t *)a_ctx;
+    uint64_t now_tick = GetCurrentTick();
+    uint64_t next_tick = a_timer->m_expire_tick + job->m_interval_ticks;
+    if (next_tick <= now_tick)
+    {
+        // Skip the runs missed while the loop was blocked, instead of running
+        // them all at once.
+        next_tick += ((now_tick - next_tick) / job->m_interval_ticks + 1) *
+                     job->m_interval_ticks;
+    }
+    NNCli_TimerWheelAdd(&s_timer_wheel, &job->m_timer, next_tick);
+
+    CallRegisteredCommand(job->m_command, NULL);
+}
+
+// The terminal is in raw mode while a line is edited, so "\n" does not return
+// the cursor to the beginning of the line.
+static void WriteWithCarriageReturn(FILE *a_out, const char *a_data,
+                                    size_t a_len)
+{
+    for (size_t i = 0; i < a_len; i++)
+    {
+        if (a_data[i] == '\n')
+        {
+            fputc('\r', a_out);
+        }
+        fputc(a_data[i], a_out);
+    }
+}
+
+// The output which cannot be stored is dropped.
+static ssize_t WriteToBuffer(void *a_ctx, const char *a_data, size_t a_len)
+{
+    OutputBuffer_t *buffer = (OutputBuffer_t *)a_ctx;
+    if (buffer->m_len + a_len > buffer->m_capacity)
+    {
+        size_t capacity = (buffer->m_len + a_len) * 2;
+        char *buf = (char *)NNCli_Realloc(buffer->m_buf, capacity);
+        if (buf == NULL)
+        {
+            return a_len;
+        }
+        buffer->m_buf = buf;
+        buffer->m_capacity = capacity;
+    }
+    memcpy(&buffer->m_buf[buffer->m_len], a_data, a_len);
+    buffer->m_len += a_len;
+    return a_len;
+}
+
+// Runs the due jobs and a slice of the suspended command. `a_editing` is the
+// line being edited, which is hidden while their output is printed. NULL if
+// no line is being edited.
+static void RunBackgroundCommands(struct linenoiseState *a_editing)
+{
+    uint64_t now_tick = GetCurrentTick();
+    uint64_t next_tick;
+    OutputCapture_t capture;
+    OutputBuffer_t output;
+    bool is_captured = false;
+
+    if ((!NNCli_TimerWheelGetNextExpiry(&s_timer_wheel, &next_tick) ||
+         next_tick > now_tick) &&
+        !s_suspended.m_is_pending)
+    {
+        NNCli_TimerWheelAdvance(&s_timer_wheel, now_tick);
+        return;
+    }
+
+    // The output is held so that the line is not redrawn when a slice of the
+    // suspended command prints nothing.
+    memset(&output, 0, sizeof(output));
+    if (a_editing != NULL)
+    {
+        is_captured = (BeginOutputCapture(&capture, WriteToBuffer, &output) ==
+                       NN_CLI__SUCCESS);
+    }
+
+    NNCli_TimerWheelAdvance(&s_timer_wheel, now_tick);
+    ResumeSuspendedCommand();
+
+    if (is_captured)
+    {
+        EndOutputCapture(&capture);
+        if (output.m_len > 0)
+        {
+            linenoiseHide(a_editing);
+            if (isatty(a_editing->ofd))
+            {
+                WriteWithCarriageReturn(stdout, output.m_buf, output.m_len);
+            }
+            else
+            {
+                fwrite(output.m_buf, 1, output.m_len, stdout);
+            }
+            fflush(stdout);
+            linenoiseShow(a_editing);
+        }
+        NNCli_Free(output.m_buf);
+    }
+}
+
+// Shortens `a_timeout` so that select() returns when the next job is due, or
+// at once while a command is suspended.
+static void LimitTimeoutToNextJob(struct timeval *a_timeout)
+{
+    uint64_t next_tick;
+    if (s_suspended.m_is_pending)
+    {
+        a_timeout->tv_sec = 0;
+        a_timeout->tv_usec = 0;
+        return;
+    }
+    if (!NNCli_TimerWheelGetNextExpiry(&s_timer_wheel, &next_tick))
+    {
+        return;
+    }
+
+    uint64_t now_us = GetMonotonicMs() * 1000;
+    uint64_t due_us = next_tick * NN_CLI__TIMER_TICK_MS * 1000;
+    uint64_t wait_us = (due_us > now_us) ? due_us - now_us : 0;
+    uint64_t timeout_us =
+        (uint64_t)a_timeout->tv_sec * 1000000 + a_timeout->tv_usec;
+    if (wait_us < timeout_us)
+    {
+        a_timeout->tv_sec = wait_us / 1000000;
+        a_timeout->tv_usec = wait_us % 1000000;
+    }
+}
+
+// The buffer of the line edited with the multiplexing API of linenoise.
+static char *GetLinenoiseEditBuffer(void)
+{
+#if NN_CLI__SHARE_EDIT_BUFFER
+    return s_line_editor_buf;
+#else
+    return s_async_edit_buf;
+#endif
+}
+
+static void AddToHistory(void *a_ctx, const char *a_line)
+{
+    linenoiseHistoryAdd(a_line);
+    NNCli_HistoryIndexAdd(&s_history_index, a_line);
+}
+
+// linenoise does not show its history, so the file it has loaded is read
+// again for the index.
+static void IndexHistoryFile(const char *a_filename)
+{
+    char buf[NN_CLI__LINE_MAX_LEN];
+    FILE *file = fopen(a_filename, "r");
+    if (file == NULL)
+    {
+        return;
+    }
+    while (fgets(buf, sizeof(buf), file) != NULL)
+    {
+        buf[strcspn(buf, "\r\n")] = '\0';
+        if (buf[0] != '\0')
+        {
+            NNCli_HistoryIndexAdd(&s_history_index, buf);
+        }
+    }
+    fclose(file);
+}
+
+// Takes in the entries which the other processes have added, so that they can
+// be recalled by the next key.
+static void MergeSharedHistory(void)
+{
+    if (s_is_history_shared)
+    {
+        NNCli_SharedHistoryMerge(&s_shared_history);
+    }
+}
+
+// linenoise measures the terminal when a line is started. The cached size
+// follows a resize while the line is edited. A guessed size is not used,
+// because linenoise can ask the terminal itself.
+static void UpdateLinenoiseColumns(struct linenoiseState *a_state)
+{
+    int columns = GetTerminalWidth();
+    if (s_is_terminal_size_known)
+    {
+        a_state->cols = columns;
+    }
+}
+
+static NNCli_Err_t GetInputAsync(char **out_string)
+{
+    /* Asynchronous mode using the multiplexing API: wait for
+     * data on stdin, and simulate async data coming from some source
+     * using the select(2) timeout. */
+    NNCli_Err_t ret = NN_CLI__IN_PROGRESS;
+    static bool s_requires_init = true;
+    static struct linenoiseState ls;
+    char *buf = GetLinenoiseEditBuffer();
+    if (s_requires_init)
+    {
+        memset(buf, 0, NN_CLI__LINE_MAX_LEN);
+        memset(&ls, 0, sizeof(ls));
+        s_requires_init = false;
+        linenoiseEditStart(&ls, -1, -1, buf, NN_CLI__LINE_MAX_LEN, "> ");
+    }
+
+    fd_set readfds;
+    int retval;
+    int edit_errno;
+    struct timeval tv = s_async.m_timeout;
+    LatencySample_t sample;
+    uint64_t wait_start_ns = GetMonotonicNs();
+    uint64_t timeout_ns;
+    LimitTimeoutToNextJob(&tv);
+    timeout_ns =
+        (uint64_t)tv.tv_sec * 1000000000 + (uint64_t)tv.tv_usec * 1000;
+
+    FD_ZERO(&readfds);
+    FD_SET(ls.ifd, &readfds);
+
+    retval = select(ls.ifd + 1, &readfds, NULL, NULL, &tv);
+    // The jobs run before the key are a part of its latency.
+    BeginKeystrokeSample(&sample);
+    if (retval == -1)
+    {
+        if (errno != EINTR)
+        {
+            perror("select()");
+            ret = NN_CLI__GENERAL_ERROR;
+        }
+        goto done;
+    }
+
+    RunBackgroundCommands(&ls);
+
+    if (retval)
+    {
+        MergeSharedHistory();
+        UpdateLinenoiseColumns(&ls);
+        *out_string = linenoiseEditFeed(&ls);
+        EndKeystrokeSample(&sample);
+        /* A NULL return means: line editing is continuing.
+         * Otherwise the user hit enter or stopped editing
+         * (CTRL+C/D). */
+        if (*out_string == linenoiseEditMore)
+        {
+            goto done;
+        }
+    }
+    else
+    {
+        // Timeout occurred
+        if (sample.m_is_active)
+        {
+            uint64_t waited_ns = sample.m_start_ns - wait_start_ns;
+            uint64_t late_ns =
+                (waited_ns > timeout_ns) ? waited_ns - timeout_ns : 0;
+            RecordLatency(NN_CLI__LATENCY_WAKEUP, late_ns);
+        }
+
+        // static int s_debug_print_counter = 0;
+        // if (s_debug_print_counter < 3 || s_debug_print_counter % 10 == 0)
+        // {
+        //     linenoiseHide(&ls);
+        //     printf("...\r\n");
+        //     linenoiseShow(&ls);
+        // }
+        // ++s_debug_print_counter;
+
+        goto done;
+    }
+
+    edit_errno = errno;
+    linenoiseEditStop(&ls);
+    s_requires_init = true;
+    if (*out_string == NULL)
+    {
+        // Ctrl-C drops the line and Ctrl-D ends the input. The application
+        // decides what to do after that.
+        if (edit_errno == EAGAIN)
+        {
+            CancelSuspendedCommand();
+        }
+        ret = (edit_errno == EAGAIN) ? NN_CLI__IN_PROGRESS
+                                     : NN_CLI__PROCESS_COMPLETED;
+        goto done;
+    }
+
+    ret = NN_CLI__SUCCESS;
+
+done:
+    return ret;
+}
+
+// linenoise() does not return until the whole line has been typed, so the
+// line is edited with the multiplexing API to see each key.
+static NNCli_Err_t GetInputSyncTraced(char **out_string)
+{
+    struct linenoiseState ls;
+    fd_set readfds;
+    LatencySample_t sample;
+    char *line;
+    int edit_errno;
+
+    if (linenoiseEditStart(&ls, -1, -1, GetLinenoiseEditBuffer(),
+                           NN_CLI__LINE_MAX_LEN, "> ") == -1)
+    {
+        return NN_CLI__EXTERNAL_LIB_ERROR;
+    }
+
+    do
+    {
+        FD_ZERO(&readfds);
+        FD_SET(ls.ifd, &readfds);
+        if (select(ls.ifd + 1, &readfds, NULL, NULL, NULL) == -1)
+        {
+            line = linenoiseEditMore;
+            continue;
+        }
+        BeginKeystrokeSample(&sample);
+        MergeSharedHistory();
+        UpdateLinenoiseColumns(&ls);
+        line = linenoiseEditFeed(&ls);
+        EndKeystrokeSample(&sample);
+    } while (line == linenoiseEditMore);
+
+    edit_errno = errno;
+    linenoiseEditStop(&ls);
+    if (line == NULL)
+    {
+        // Ctrl-C drops the line and Ctrl-D ends the input.
+        return (edit_errno == EAGAIN) ? NN_CLI__IN_PROGRESS
+                                      : NN_CLI__PROCESS_COMPLETED;
+    }
+
+    *out_string = line;
+    return NN_CLI__SUCCESS;
+}
+
+static NNCli_Err_t GetInputSync(char **out_string)
+{
+    if (s_is_latency_traced && isatty(STDIN_FILENO))
+    {
+        return GetInputSyncTraced(out_string);
+    }
+
+    // The entries added while the line is edited are merged at the next line.
+    MergeSharedHistory();
+    errno = 0;
+    char *line = linenoise("> ");
+    if (line == NULL)
+    {
+        // Ctrl-C drops the line and Ctrl-D ends the input.
+        return (errno == EAGAIN) ? NN_CLI__IN_PROGRESS
+                                 : NN_CLI__PROCESS_COMPLETED;
+    }
+
+    *out_string = line;
+    return NN_CLI__SUCCESS;
+}
+
+// Runs the line and adds it to the history if it has succeeded.
+static void AddLineToHistory(const char *a_line)
+{
+    if (s_is_history_shared)
+    {
+        NNCli_SharedHistoryAppend(&s_shared_history, a_line);
+        linenoiseHistoryAdd(a_line);
+        NNCli_HistoryIndexAdd(&s_history_index, a_line);
+    }
+    else
+    {
+        linenoiseHistoryAdd(a_line); /* Add to the history. */
+        linenoiseHistorySave(
+            s_history_filename); /* Save the history on disk. */
+        NNCli_HistoryIndexAdd(&s_history_index, a_line);
+    }
+    NNCli_Trace1(history_save, a_line);
+}
+
+static NNCli_Err_t ProcessLine(const char *a_line)
+{
+    NNCli_Err_t err = NN_CLI__SUCCESS;
+    NNCli_Trace1(line, a_line);
+    if (a_line[0] != '\0')
+    {
+        err = CallRegisteredCommand(a_line, NULL);
+        if (err == NN_CLI__SUCCESS)
+        {
+            AddLineToHistory(a_line);
+        }
+    }
+    return err;
+}
+
+/**
+ * NNCli_Execute()
+ */
+
+typedef struct
+{
+    char *m_buf;
+    size_t m_size;
+    size_t m_len;
+    bool m_is_truncated;
+} FixedBuffer_t;
+
+typedef struct
+{
+    NNCli_OutputFunc_t m_func;
+    void *m_ctx;
+} OutputStream_t;
+
+// The output which does not fit is dropped, and the rest is still consumed.
+static void WriteToFixedBuffer(void *a_ctx, const char *a_data, size_t a_len)
+{
+    FixedBuffer_t *buffer = (FixedBuffer_t *)a_ctx;
+    size_t len = a_len;
+
+    if (buffer->m_len + len >= buffer->m_size)
+    {
+        len = buffer->m_size - 1 - buffer->m_len;
+        buffer->m_is_truncated = true;
+    }
+    memcpy(&buffer->m_buf[buffer->m_len], a_data, len);
+    buffer->m_len += len;
+    buffer->m_buf[buffer->m_len] = '\0';
+}
+
+static ssize_t WriteToOutputStream(void *a_ctx, const char *a_data,
+                                   size_t a_len)
+{
+    OutputStream_t *stream = (OutputStream_t *)a_ctx;
+    if (stream->m_func != NULL)
+    {
+        stream->m_func(stream->m_ctx, a_data, a_len);
+    }
+    return a_len;
+}
+
+/**
+ * RPC mode
+ */
+
+// The I/O of the RPC mode if `m_io` is not given.
+static ssize_t ReadStdin(void *a_ctx, char *a_buf, size_t a_len)
+{
+    return read(STDIN_FILENO, a_buf, a_len);
+}
+
+static ssize_t WriteStdout(void *a_ctx, const char *a_data, size_t a_len)
+{
+    return write(STDOUT_FILENO, a_data, a_len);
+}
+
+// Runs the line of a request. The response is added to `a_ctx`, an
+// OutputBuffer_t, so that the responses of the requests read at once are
+// written together.
+static void RunRpcFrame(void *a_ctx, const char *a_frame, size_t a_len)
+{
+    OutputBuffer_t *responses = (OutputBuffer_t *)a_ctx;
+    NNCli_RpcRequest_t request;
+    NNCli_Err_t res = NN_CLI__EXCEED_CAPACITY;
+    OutputBuffer_t output;
+    OutputCapture_t capture;
+    char *response;
+    size_t response_len;
+
+    if (a_len == 0)
+    {
+        // Empty lines can be used to keep the connection alive.
+        return;
+    }
+
+    memset(&output, 0, sizeof(output));
+    strcpy(request.m_id, "null");
+    if (a_frame != NULL)
+    {
+        res = NNCli_RpcParseRequest(a_frame, a_len, &request);
+    }
+    if (res == NN_CLI__SUCCESS)
+    {
+        res = BeginOutputCapture(&capture, WriteToBuffer, &output);
+    }
+    if (res == NN_CLI__SUCCESS)
+    {
+        // The status is the result of the commands, while the dispatch only
+        // fails if the line cannot be run at all.
+        NNCli_Err_t command_res;
+        res = CallRegisteredCommand(request.m_line, &command_res);
+        if (res == NN_CLI__SUCCESS)
+        {
+            res = command_res;
+        }
+        EndOutputCapture(&capture);
+    }
+
+    response_len = NNCli_RpcFormatResponse(request.m_id, res, output.m_buf,
+                                           output.m_len, NULL, 0);
+    response = (char *)NNCli_Malloc(response_len + 1);
+    if (response != NULL)
+    {
+        NNCli_RpcFormatResponse(request.m_id, res, output.m_buf, output.m_len,
+                                response, response_len + 1);
+        WriteToBuffer(responses, response, response_len);
+        NNCli_Free(response);
+    }
+    NNCli_Free(output.m_buf);
+}
+
+static void WriteRpcResponses(const OutputBuffer_t *a_responses)
+{
+    const char *data = a_responses->m_buf;
+    size_t len = a_responses->m_len;
+
+    // Nothing written to stdout before should come after the responses.
+    fflush(stdout);
+    while (len > 0)
+    {
+        ssize_t written = s_io.m_write(s_io.m_ctx, data, len);
+        if (written < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+            {
+                continue;
+            }
+            NNCli_LogError("Failed to write RPC responses");
+            return;
+        }
+        data += written;
+        len -= written;
+    }
+}
+
+// Runs the requests completed by `a_data`, and the last one without a newline
+// if `a_is_end` is set. Returns NN_CLI__IN_PROGRESS if no request has been
+// completed.
+static NNCli_Err_t FeedRpc(const char *a_data, size_t a_len, bool a_is_end)
+{
+    OutputBuffer_t responses;
+    size_t frame_num;
+
+    memset(&responses, 0, sizeof(responses));
+    frame_num = NNCli_RpcReaderFeed(&s_rpc_reader, a_data, a_len, RunRpcFrame,
+                                    &responses);
+    if (a_is_end)
+    {
+        frame_num +=
+            NNCli_RpcReaderFinish(&s_rpc_reader, RunRpcFrame, &responses);
+    }
+    WriteRpcResponses(&responses);
+    NNCli_Free(responses.m_buf);
+
+    return (frame_num > 0) ? NN_CLI__SUCCESS : NN_CLI__IN_PROGRESS;
+}
+
+/**
+ * Headless input
+ */
+
+static ssize_t WriteToIo(void *a_ctx, const char *a_data, size_t a_len)
+{
+    return s_io.m_write(s_io.m_ctx, a_data, a_len);
+}
+
+static void WriteEcho(void *a_ctx, const char *a_data, size_t a_len)
+{
+    if (!IsIoEnabled() || s_io.m_echo)
+    {
+        fwrite(a_data, 1, a_len, stdout);
+    }
+}
+
+static void RunEditedLine(ReplayContext_t *a_replay)
+{
+    const char *line = NNCli_LineEditorGetLine(&s_line_editor);
+    uint64_t start_ns = GetMonotonicNs();
+    uint64_t elapsed_ns;
+
+    ProcessLine(line);
+
+    if (a_replay == NULL || line[0] == '\0')
+    {
+        return;
+    }
+
+    elapsed_ns = GetMonotonicNs() - start_ns;
+    a_replay->m_command_ns += elapsed_ns;
+    a_replay->m_stats->m_command_num++;
+    a_replay->m_stats->m_command_total_ns += elapsed_ns;
+    if (elapsed_ns > a_replay->m_stats->m_command_max_ns)
+    {
+        a_replay->m_stats->m_command_max_ns = elapsed_ns;
+    }
+    if (a_replay->m_report != NULL)
+    {
+        fprintf(a_replay->m_report, "command %u \"%s\": %.1f us\n",
+                a_replay->m_stats->m_command_num, line, elapsed_ns / 1000.0);
+    }
+}
+
+// `a_replay` is NULL unless a recording is replayed.
+static NNCli_Err_t FeedInput(const char *a_data, size_t a_len,
+                             ReplayContext_t *a_replay)
+{
+    NNCli_Err_t res = NN_CLI__IN_PROGRESS;
+    OutputCapture_t capture;
+    bool is_captured = false;
+    LatencySample_t sample;
+
+    if (s_is_rpc)
+    {
+        return FeedRpc(a_data, a_len, false);
+    }
+
+    // The input fed at once is one keystroke, e.g. one read() of `m_io`.
+    BeginKeystrokeSample(&sample);
+    MergeSharedHistory();
+    if (IsIoEnabled())
+    {
+        is_captured = (BeginOutputCapture(&capture, WriteToIo, NULL) ==
+                       NN_CLI__SUCCESS);
+    }
+
+    if (!s_is_line_editor_started)
+    {
+#if NN_CLI__SHARE_EDIT_BUFFER
+        NNCli_LineEditorInit(&s_line_editor, s_line_editor_buf,
+                             sizeof(s_line_editor_buf), "> ", WriteEcho, NULL);
+#else
+        // The line grows as it is typed. A line longer than
+        // NN_CLI__LINE_MAX_LEN is rejected with an error when it is run.
+        NNCli_LineEditorInit(&s_line_editor, NULL, 0, "> ", WriteEcho, NULL);
+#endif
+        NNCli_LineEditorSetHint(&s_line_editor, SuggestFromHistory, NULL);
+        NNCli_LineEditorStart(&s_line_editor);
+        s_is_line_editor_started = true;
+    }
+    // Cached, so this costs nothing unless the terminal has been resized.
+    NNCli_LineEditorSetColumns(&s_line_editor, GetTerminalWidth());
+
+    for (size_t i = 0; i < a_len; i++)
+    {
+        switch (NNCli_LineEditorFeed(&s_line_editor, a_data[i]))
+        {
+            case NN_CLI__LINE_EDITOR_EVENT_LINE:
+                // The command is not a part of the keystroke.
+                fflush(stdout);
+                EndKeystrokeSample(&sample);
+                RunEditedLine(a_replay);
+                NNCli_LineEditorStart(&s_line_editor);
+                res = NN_CLI__SUCCESS;
+                break;
+
+            case NN_CLI__LINE_EDITOR_EVENT_INTERRUPT:
+                CancelSuspendedCommand();
+                NNCli_LineEditorStart(&s_line_editor);
+                break;
+
+            case NN_CLI__LINE_EDITOR_EVENT_EOF:
+                NNCli_LineEditorDestroy(&s_line_editor);
+                s_is_line_editor_started = false;
+                res = NN_CLI__PROCESS_COMPLETED;
+                goto done;
+
+            default:
+                break;
+        }
+    }
+
+done:
+    fflush(stdout);
+    EndKeystrokeSample(&sample);
+    if (is_captured)
+    {
+        EndOutputCapture(&capture);
+    }
+    return res;
+}
+
+// Runs the due jobs and the lines in the input read from `s_io`.
+static NNCli_Err_t RunWithIo(void)
+{
+    char buf[NN_CLI__IO_READ_BUF_LEN];
+    ssize_t len;
+    OutputCapture_t capture;
+
+    // The output of the jobs would break the frames of the RPC mode.
+    if (!s_is_rpc &&
+        BeginOutputCapture(&capture, WriteToIo, NULL) == NN_CLI__SUCCESS)
+    {
+        RunBackgroundCommands(NULL);
+        EndOutputCapture(&capture);
+    }
+
+    len = s_io.m_read(s_io.m_ctx, buf, sizeof(buf));
+    if (len < 0)
+    {
+        return (errno == EAGAIN || errno == EINTR) ? NN_CLI__IN_PROGRESS
+                                                   : NN_CLI__GENERAL_ERROR;
+    }
+    if (len == 0)
+    {
+        if (s_is_rpc)
+        {
+            FeedRpc(NULL, 0, true);
+        }
+        return NN_CLI__PROCESS_COMPLETED;
+    }
+
+    return FeedInput(buf, len, NULL);
+}
+
+static void SleepUntilNs(uint64_t a_time_ns)
+{
+    struct timespec time = {
+        .tv_sec = (time_t)(a_time_ns / 1000000000),
+        .tv_nsec = (long)(a_time_ns % 1000000000),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL) ==
+           EINTR)
+    {
+    }
+}
+
+static void ReportReplayKeystroke(ReplayContext_t *a_replay,
+                                  uint64_t a_time_us, size_t a_len,
+                                  uint64_t a_elapsed_ns)
+{
+    NNCli_ReplayStats_t *stats = a_replay->m_stats;
+    stats->m_keystroke_num++;
+    stats->m_keystroke_total_ns += a_elapsed_ns;
+    if (a_elapsed_ns > stats->m_keystroke_max_ns)
+    {
+        stats->m_keystroke_max_ns = a_elapsed_ns;
+    }
+
+    if (a_replay->m_report != NULL)
+    {
+        fprintf(a_replay->m_report, "key %u at %.3f ms: %zu bytes, %.1f us\n",
+                stats->m_keystroke_num, a_time_us / 1000.0, a_len,
+                a_elapsed_ns / 1000.0);
+    }
+}
+
+static void ReportReplaySummary(FILE *a_report,
+                                const NNCli_ReplayStats_t *a_stats)
+{
+    fprintf(a_report, "keystrokes: %u, mean %.1f us, max %.1f us\n",
+            a_stats->m_keystroke_num,
+            a_stats->m_keystroke_num > 0 ? a_stats->m_keystroke_total_ns /
+                                               1000.0 / a_stats->m_keystroke_num
+                                         : 0.0,
+            a_stats->m_keystroke_max_ns / 1000.0);
+    fprintf(a_report, "commands: %u, mean %.1f us, max %.1f us\n",
+            a_stats->m_command_num,
+            a_stats->m_command_num > 0 ? a_stats->m_command_total_ns / 1000.0 /
+                                             a_stats->m_command_num
+                                       : 0.0,
+            a_stats->m_command_max_ns / 1000.0);
+}
+
+/**
+ * Default CLI commands
+ */
+
+static void ShowScheduledJobs(void)
+{
+    for (size_t i = 0; i < NN_CLI__MAX_SCHEDULED_JOB_NUM; i++)
+    {
+        if (s_jobs[i].m_in_use)
+        {
+            printf("[%zu] every %.1fs: %s\n", i + 1,
+                   s_jobs[i].m_interval_ms / 1000.0, s_jobs[i].m_command);
+        }
+    }
+}
+
+static NNCli_Err_t WatchCommand(int argc, char **argv)
+{
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+    double interval_sec = DEFAULT_WATCH_INTERVAL_SEC;
+    uint32_t interval_ms;
+    int first = 1;
+    char command[NN_CLI__LINE_MAX_LEN] = {0};
+    size_t len = 0;
+    int job_id;
+
+    if (argc == 1)
+    {
+        ShowScheduledJobs();
+        res = NN_CLI__SUCCESS;
+        goto done;
+    }
+
+    if (strcmp(argv[1], "-c") == 0)
+    {
+        if (argc == 3)
+        {
+            res = NNCli_CancelScheduledCommand(atoi(argv[2]));
+        }
+        goto done;
+    }
+
+    if (strcmp(argv[1], "-n") == 0)
+    {
+        char *end;
+        if (argc < 4)
+        {
+            goto done;
+        }
+        interval_sec = strtod(argv[2], &end);
+        // strtod() also accepts "nan" and "inf".
+        if (*end != '\0' || end == argv[2] || !isfinite(interval_sec) ||
+            interval_sec <= 0 || interval_sec > MAX_WATCH_INTERVAL_SEC)
+        {
+            goto done;
+        }
+        first = 3;
+    }
+
+    for (int i = first; i < argc; i++)
+    {
+        len += snprintf(&command[len], sizeof(command) - len, "%s%s",
+                        (i == first) ? "" : " ", argv[i]);
+        if (len >= sizeof(command))
+        {
+            res = NN_CLI__EXCEED_CAPACITY;
+            goto done;
+        }
+    }
+
+    interval_ms = (uint32_t)(interval_sec * 1000 + 0.5);
+    if (interval_ms == 0)
+    {
+        res = NN_CLI__INVALID_ARGS;
+        goto done;
+    }
+    res = NNCli_ScheduleCommand(command, interval_ms, &job_id);
+    if (res == NN_CLI__SUCCESS)
+    {
+        printf("[%d] every %.1fs: %s\n", job_id, interval_sec, command);
+    }
+
+done:
+    return res;
+}
+
+/**
+ * foreach
+ */
+
+// Splits `{a,b,c}` or the lines of `@file` into the items of `s_foreach`.
+static NNCli_Err_t ParseForeachItems(const char *a_arg)
+{
+    size_t len = strlen(a_arg);
+    size_t item_num = 0;
+    size_t max_item_num;
+    char *cursor;
+    char separator = ',';
+
+    if (a_arg[0] == '@')
+    {
+        FILE *fp = fopen(&a_arg[1], "r");
+        long size;
+        if (fp == NULL)
+        {
+            printf("Cannot open %s\n", &a_arg[1]);
+            return NN_CLI__INVALID_ARGS;
+        }
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        s_foreach.m_items_buf =
+            (char *)NNCli_Malloc((size > 0 ? size : 0) + 1);
+        len = (s_foreach.m_items_buf != NULL && size > 0)
+                  ? fread(s_foreach.m_items_buf, 1, size, fp)
+                  : 0;
+        fclose(fp);
+        separator = '\n';
+    }
+    else if (len >= 2 && a_arg[0] == '{' && a_arg[len - 1] == '}')
+    {
+        len -= 2;
+        s_foreach.m_items_buf = (char *)NNCli_Malloc(len + 1);
+        if (s_foreach.m_items_buf != NULL)
+        {
+            memcpy(s_foreach.m_items_buf, &a_arg[1], len);
+        }
+    }
+    else
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    if (s_foreach.m_items_buf == NULL)
+    {
+        return NN_CLI__GENERAL_ERROR;
+    }
+    s_foreach.m_items_buf[len] = '\0';
+
+    // Sized by the separators, so that a short list takes a small block.
+    for (size_t i = 0; i < len; i++)
+    {
+        item_num += (s_foreach.m_items_buf[i] == separator);
+    }
+    if (item_num >= NN_CLI__MAX_FOREACH_ITEM_NUM)
+    {
+        item_num = NN_CLI__MAX_FOREACH_ITEM_NUM - 1;
+    }
+    s_foreach.m_jobs =
+        (ForeachJob_t *)NNCli_Calloc(item_num + 1, sizeof(ForeachJob_t));
+    if (s_foreach.m_jobs == NULL)
+    {
+        return NN_CLI__GENERAL_ERROR;
+    }
+    max_item_num = item_num + 1;
+    item_num = 0;
+
+    // Empty items, e.g. blank lines, are skipped.
+    cursor = s_foreach.m_items_buf;
+    while (cursor != NULL)
+    {
+        char *item = cursor;
+        cursor = strchr(cursor, separator);
+        if (cursor != NULL)
+        {
+            *cursor++ = '\0';
+        }
+        item[strcspn(item, "\r")] = '\0';
+        if (item[0] == '\0')
+        {
+            continue;
+        }
+        if (item_num == max_item_num)
+        {
+            printf("Too many items. The limit is %d\n",
+                   NN_CLI__MAX_FOREACH_ITEM_NUM);
+            return NN_CLI__EXCEED_CAPACITY;
+        }
+        s_foreach.m_jobs[item_num].m_item = item;
+        s_foreach.m_jobs[item_num].m_res = NN_CLI__IN_PROGRESS;
+        item_num++;
+    }
+    s_foreach.m_job_num = item_num;
+    return (item_num > 0) ? NN_CLI__SUCCESS : NN_CLI__INVALID_ARGS;
+}
+
+// Copies `a_arg` with `{}` replaced with `a_item`. Returns NULL if `a_buf`
+// is full.
+static char *ExpandForeachArg(char *a_buf, size_t *a_used, const char *a_arg,
+                              const char *a_item, bool *io_has_placeholder)
+{
+    char *expanded = &a_buf[*a_used];
+    size_t item_len = strlen(a_item);
+
+    while (*a_arg != '\0')
+    {
+        const char *text = a_arg;
+        size_t len = 1;
+        if (a_arg[0] == '{' && a_arg[1] == '}')
+        {
+            text = a_item;
+            len = item_len;
+            a_arg++;
+            *io_has_placeholder = true;
+        }
+        a_arg++;
+
+        if (*a_used + len + 1 > NN_CLI__LINE_MAX_LEN)
+        {
+            return NULL;
+        }
+        memcpy(&a_buf[*a_used], text, len);
+        *a_used += len;
+    }
+    a_buf[(*a_used)++] = '\0';
+    return expanded;
+}
+
+// The item is added as the last argument if no argument has `{}`. Returns
+// argc, or -1 if the command does not fit.
+static int BuildForeachArgv(const char *a_item, char *a_buf, char **out_argv)
+{
+    size_t used = 0;
+    bool has_placeholder = false;
+    int argc = 0;
+
+    out_argv[argc++] = s_foreach.m_template[0];
+    for (int i = 1; i < s_foreach.m_template_num; i++)
+    {
+        out_argv[argc] = ExpandForeachArg(a_buf, &used, s_foreach.m_template[i],
+                                          a_item, &has_placeholder);
+        if (out_argv[argc++] == NULL)
+        {
+            return -1;
+        }
+    }
+    if (!has_placeholder)
+    {
+        if (argc == NN_CLI__MAX_WORDS_PER_COMMAND)
+        {
+            return -1;
+        }
+        out_argv[argc] =
+            ExpandForeachArg(a_buf, &used, a_item, "", &has_placeholder);
+        if (out_argv[argc++] == NULL)
+        {
+            return -1;
+        }
+    }
+    out_argv[argc] = NULL;
+    return argc;
+}
+
+// Runs in a worker of `s_foreach_pool`. The command is called directly, and
+// shares the deadline of `foreach` like those run in order.
+static void RunForeachJob(void *a_ctx, size_t a_index)
+{
+    ForeachJob_t *job = &s_foreach.m_jobs[a_index];
+    char buf[NN_CLI__LINE_MAX_LEN];
+    char *argv[NN_CLI__MAX_WORDS_PER_COMMAND + 1];
+    int argc = BuildForeachArgv(job->m_item, buf, argv);
+
+    if (argc < 0)
+    {
+        job->m_res = NN_CLI__EXCEED_CAPACITY;
+        return;
+    }
+    if (NNCli_IsCancelled())
+    {
+        job->m_res = NN_CLI__CANCELLED;
+        return;
+    }
+    s_worker_output = &job->m_output;
+    job->m_res = s_foreach.m_command->m_func(argc, argv);
+    s_worker_output = NULL;
+}
+
+// The workers write to their own buffers. The rest, e.g. the outputs printed
+// in order by the main thread, goes to the stdout outside.
+static ssize_t WriteForeachOutput(void *a_ctx, const char *a_data,
+                                  size_t a_len)
+{
+    OutputCapture_t *capture = (OutputCapture_t *)a_ctx;
+    if (s_worker_output != NULL)
+    {
+        return WriteToBuffer(s_worker_output, a_data, a_len);
+    }
+    return fwrite(a_data, 1, a_len, capture->m_prev_stdout);
+}
+
+static NNCli_Err_t RunForeachInParallel(void)
+{
+    NNCli_Err_t res;
+    OutputCapture_t capture;
+
+    res = BeginOutputCapture(&capture, WriteForeachOutput, &capture);
+    if (res != NN_CLI__SUCCESS)
+    {
+        return res;
+    }
+    // An unbuffered stream passes each write to the sink in the thread which
+    // has made it.
+    setvbuf(capture.m_stream, NULL, _IONBF, 0);
+
+    res = NNCli_WorkerPoolStart(&s_foreach_pool, NN_CLI__FOREACH_THREAD_NUM,
+                                s_foreach.m_job_num, RunForeachJob, NULL);
+    for (size_t i = 0; res == NN_CLI__SUCCESS && i < s_foreach.m_job_num;
+         i++)
+    {
+        ForeachJob_t *job = &s_foreach.m_jobs[i];
+        NNCli_Err_t wait_res;
+
+        // Ctrl-C is handled by this thread while it is waiting.
+        while ((wait_res = NNCli_WorkerPoolWait(&s_foreach_pool, i,
+                                                NN_CLI__TIMER_TICK_MS)) ==
+               NN_CLI__IN_PROGRESS)
+        {
+            if (NNCli_IsCancelled())
+            {
+                NNCli_WorkerPoolStop(&s_foreach_pool);
+            }
+        }
+        if (wait_res == NN_CLI__SUCCESS && job->m_output.m_len > 0)
+        {
+            fwrite(job->m_output.m_buf, 1, job->m_output.m_len, stdout);
+        }
+        NNCli_Free(job->m_output.m_buf);
+        memset(&job->m_output, 0, sizeof(job->m_output));
+    }
+    if (res == NN_CLI__SUCCESS)
+    {
+        NNCli_WorkerPoolDestroy(&s_foreach_pool);
+    }
+
+    EndOutputCapture(&capture);
+    return res;
+}
+
+// The commands which are not thread-safe run one by one in this thread, and
+// their output is printed as it comes. They share the deadline of `foreach`,
+// and are not suspended when they yield.
+static void RunForeachInOrder(void)
+{
+    char buf[NN_CLI__LINE_MAX_LEN];
+    char *argv[NN_CLI__MAX_WORDS_PER_COMMAND + 1];
+    CommandRun_t run;
+    NNCli_Err_t res;
+
+    for (size_t i = 0; i < s_foreach.m_job_num && !NNCli_IsCancelled(); i++)
+    {
+        ForeachJob_t *job = &s_foreach.m_jobs[i];
+        int argc = BuildForeachArgv(job->m_item, buf, argv);
+        if (argc < 0)
+        {
+            job->m_res = NN_CLI__EXCEED_CAPACITY;
+            continue;
+        }
+        InitCommandRun(&run, s_foreach.m_command, argc, argv, NULL);
+        do
+        {
+            res = InvokeCommand(&run);
+        } while (res == NN_CLI__IN_PROGRESS);
+        NNCli_Free(run.m_state);
+        job->m_res = res;
+    }
+}
+
+static void PrintForeachSummary(void)
+{
+    size_t succeeded = 0;
+    size_t failed = 0;
+
+    for (size_t i = 0; i < s_foreach.m_job_num; i++)
+    {
+        if (s_foreach.m_jobs[i].m_res == NN_CLI__SUCCESS)
+        {
+            succeeded++;
+        }
+        else if (s_foreach.m_jobs[i].m_res != NN_CLI__IN_PROGRESS)
+        {
+            failed++;
+        }
+    }
+
+    printf("foreach: %zu succeeded, %zu failed", succeeded, failed);
+    if (succeeded + failed < s_foreach.m_job_num)
+    {
+        printf(", %zu skipped", s_foreach.m_job_num - succeeded - failed);
+    }
+    printf("\n");
+    if (failed > 0)
+    {
+        printf("failed:");
+        for (size_t i = 0; i < s_foreach.m_job_num; i++)
+        {
+            NNCli_Err_t res = s_foreach.m_jobs[i].m_res;
+            if (res != NN_CLI__SUCCESS && res != NN_CLI__IN_PROGRESS)
+            {
+                printf(" %s", s_foreach.m_jobs[i].m_item);
+            }
+        }
+        printf("\n");
+    }
+}
+
+static void ReleaseForeach(void)
+{
+    if (s_foreach_pool.m_is_done != NULL)
+    {
+        NNCli_WorkerPoolDestroy(&s_foreach_pool);
+    }
+    if (s_foreach.m_jobs != NULL)
+    {
+        for (size_t i = 0; i < s_foreach.m_job_num; i++)
+        {
+            NNCli_Free(s_foreach.m_jobs[i].m_output.m_buf);
+        }
+    }
+    NNCli_Free(s_foreach.m_jobs);
+    NNCli_Free(s_foreach.m_items_buf);
+    memset(&s_foreach, 0, sizeof(s_foreach));
+}
+
+static NNCli_Err_t ForeachCommand(int argc, char **argv)
+{
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+
+    // `s_foreach` is in use if this is nested in another `foreach`, e.g. by
+    // `time` or an alias.
+    if (s_foreach.m_command != NULL)
+    {
+        printf("foreach cannot be nested\n");
+        return NN_CLI__NOT_READY;
+    }
+    if (argc < 3)
+    {
+        goto done;
+    }
+
+    s_foreach.m_command = FindCommand(argv[2]);
+    if (s_foreach.m_command == NULL)
+    {
+        printf("Command not found: %s\n", argv[2]);
+        goto done;
+    }
+    if (s_foreach.m_command->m_func == ForeachCommand)
+    {
+        goto done;
+    }
+    s_foreach.m_template_num = CopyTokens(&argv[2], argc - 2,
+                                          s_foreach.m_template_buf,
+                                          s_foreach.m_template);
+
+    res = ParseForeachItems(argv[1]);
+    if (res != NN_CLI__SUCCESS)
+    {
+        goto done;
+    }
+
+    // The cache is used only by this thread, so a cacheable command runs in
+    // order.
+    if ((s_foreach.m_command->m_flags & NN_CLI__COMMAND_FLAG_THREAD_SAFE) &&
+        !(s_foreach.m_command->m_flags & NN_CLI__COMMAND_FLAG_CACHEABLE) &&
+        NN_CLI__FOREACH_THREAD_NUM > 1)
+    {
+        res = RunForeachInParallel();
+    }
+    else
+    {
+        RunForeachInOrder();
+    }
+    PrintForeachSummary();
+    if (res == NN_CLI__SUCCESS && NNCli_IsCancelled())
+    {
+        res = NN_CLI__CANCELLED;
+    }
+
+done:
+    ReleaseForeach();
+    return res;
+}
+
+/**
+ * time and repeat
+ */
+
+static uint64_t GetProcessCpuNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+// Joins the words back into the line they have been split from. Returns false
+// if it does not fit in `a_buf`.
+static bool JoinArgs(int argc, char **argv, char *a_buf)
+{
+    size_t used = 0;
+    for (int i = 0; i < argc; i++)
+    {
+        size_t len = strlen(argv[i]);
+        if (used + len + 1 > NN_CLI__LINE_MAX_LEN)
+        {
+            return false;
+        }
+        memcpy(&a_buf[used], argv[i], len);
+        used += len;
+        a_buf[used++] = (i + 1 < argc) ? ' ' : '\0';
+    }
+    return argc > 0;
+}
+
+static ssize_t DiscardOutput(void *a_ctx, const char *a_data, size_t a_len)
+{
+    return a_len;
+}
+
+static int CompareNs(const void *a_lhs, const void *a_rhs)
+{
+    uint64_t lhs = *(const uint64_t *)a_lhs;
+    uint64_t rhs = *(const uint64_t *)a_rhs;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+// The command runs as if it had been entered, including its aliases and
+// pipelines, so that the dispatch is measured too.
+static NNCli_Err_t TimeCommand(int argc, char **argv)
+{
+    char line[NN_CLI__LINE_MAX_LEN];
+    uint64_t start_ns;
+    uint64_t start_cpu_ns;
+    size_t start_alloc_num;
+
+    if (!JoinArgs(argc - 1, &argv[1], line))
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    start_alloc_num = NNCli_AllocGetCount();
+    start_cpu_ns = GetProcessCpuNs();
+    start_ns = GetMonotonicNs();
+    CallRegisteredCommand(line, NULL);
+    uint64_t elapsed_ns = GetMonotonicNs() - start_ns;
+    uint64_t cpu_ns = GetProcessCpuNs() - start_cpu_ns;
+
+    printf("real %.3f ms, cpu %.3f ms, %zu allocations\n", elapsed_ns / 1e6,
+           cpu_ns / 1e6, NNCli_AllocGetCount() - start_alloc_num);
+    return NN_CLI__SUCCESS;
+}
+
+// Runs the command N times without its output, and shows the distribution of
+// the times. Ctrl-C stops it with the runs so far.
+static NNCli_Err_t RepeatCommand(int argc, char **argv)
+{
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+    char line[NN_CLI__LINE_MAX_LEN];
+    char *end;
+    long run_num;
+    long done_num = 0;
+    uint64_t *samples = NULL;
+    uint64_t total_ns = 0;
+    OutputCapture_t capture;
+
+    if (argc < 3 || !JoinArgs(argc - 2, &argv[2], line))
+    {
+        goto done;
+    }
+    run_num = strtol(argv[1], &end, 10);
+    if (*end != '\0' || run_num <= 0 || run_num > NN_CLI__MAX_REPEAT_NUM)
+    {
+        goto done;
+    }
+    samples = (uint64_t *)NNCli_Malloc(run_num * sizeof(uint64_t));
+    if (samples == NULL)
+    {
+        res = NN_CLI__GENERAL_ERROR;
+        goto done;
+    }
+
+    res = BeginOutputCapture(&capture, DiscardOutput, NULL);
+    if (res != NN_CLI__SUCCESS)
+    {
+        goto done;
+    }
+    while (done_num < run_num && !NNCli_IsCancelled())
+    {
+        uint64_t start_ns = GetMonotonicNs();
+        CallRegisteredCommand(line, NULL);
+        samples[done_num] = GetMonotonicNs() - start_ns;
+        total_ns += samples[done_num++];
+    }
+    EndOutputCapture(&capture);
+    if (done_num == 0)
+    {
+        res = NN_CLI__CANCELLED;
+        goto done;
+    }
+
+    qsort(samples, done_num, sizeof(uint64_t), CompareNs);
+    printf("%ld runs: min %.1f us, mean %.1f us, p99 %.1f us, max %.1f us\n",
+           done_num, samples[0] / 1e3, total_ns / 1e3 / done_num,
+           samples[(done_num * 99 + 99) / 100 - 1] / 1e3,
+           samples[done_num - 1] / 1e3);
+
+done:
+    NNCli_Free(samples);
+    return res;
+}
+
+static void AppendToBuffer(OutputBuffer_t *a_buffer, const char *a_format, ...)
+{
+    char text[NN_CLI__LINE_MAX_LEN];
+    va_list args;
+    int len;
+
+    va_start(args, a_format);
+    len = vsnprintf(text, sizeof(text), a_format, args);
+    va_end(args);
+    if (len > 0)
+    {
+        WriteToBuffer(a_buffer, text,
+                      ((size_t)len < sizeof(text)) ? (size_t)len
+                                                   : sizeof(text) - 1);
+    }
+}
+
+// Appends `a_text` wrapped at spaces so that each line fits in `a_width`.
+// The lines after the first one are indented by `a_indent`.
+static void AppendWrapped(OutputBuffer_t *a_buffer, const char *a_text,
+                          int a_indent, int a_width)
+{
+    int room = a_width - a_indent;
+    size_t len = strlen(a_text);
+
+    // Too narrow to wrap nicely.
+    if (room < 20)
+    {
+        room = (int)len;
+    }
+    while (len > (size_t)room)
+    {
+        size_t cut = room;
+        while (cut > 0 && a_text[cut] != ' ')
+        {
+            cut--;
+        }
+        if (cut == 0)
+        {
+            cut = room;
+        }
+        WriteToBuffer(a_buffer, a_text, cut);
+        AppendToBuffer(a_buffer, "\n%*s", a_indent, "");
+        a_text += cut;
+        len -= cut;
+        while (*a_text == ' ')
+        {
+            a_text++;
+            len--;
+        }
+    }
+    WriteToBuffer(a_buffer, a_text, len);
+    WriteToBuffer(a_buffer, "\n", 1);
+}
+
+// Names are right-aligned so that each line reads `name: help`, and the help
+// messages start at the same column.
+static void AppendCommandSummary(OutputBuffer_t *a_buffer,
+                                 const NNCli_Command_t *a_command,
+                                 int a_name_width, int a_width)
+{
+    int name_len = (int)strlen(a_command->m_name);
+    int indent = (name_len > a_name_width ? name_len : a_name_width) + 2;
+
+    AppendToBuffer(a_buffer, "%*s: ", a_name_width, a_command->m_name);
+    AppendWrapped(a_buffer, a_command->m_help_msg, indent, a_width);
+}
+
+// `^word` matches the names starting with `word`, and `word` the names
+// containing it. NULL matches all.
+static bool MatchesHelpFilter(const NNCli_Command_t *a_command,
+                              const char *a_filter)
+{
+    if (a_filter == NULL)
+    {
+        return true;
+    }
+    if (a_filter[0] == '^')
+    {
+        return strncmp(a_command->m_name, &a_filter[1],
+                       strlen(&a_filter[1])) == 0;
+    }
+    return strstr(a_command->m_name, a_filter) != NULL;
+}
+
+static void RenderCommandList(OutputBuffer_t *a_buffer, const char *a_filter,
+                              int a_width)
+{
+    int name_width = 0;
+
+    for (size_t i = 0; i < GetCommandNum(); i++)
+    {
+        int len = (int)strlen(GetCommand(i)->m_name);
+        if (MatchesHelpFilter(GetCommand(i), a_filter) && len > name_width)
+        {
+            name_width = len;
+        }
+    }
+    // A long name does not push all the help messages to the right.
+    if (name_width > a_width / 3)
+    {
+        name_width = a_width / 3;
+    }
+
+    for (size_t i = 0; i < GetCommandNum(); i++)
+    {
+        if (MatchesHelpFilter(GetCommand(i), a_filter))
+        {
+            AppendCommandSummary(a_buffer, GetCommand(i), name_width, a_width);
+        }
+    }
+}
+
+static void RenderCommandDetail(OutputBuffer_t *a_buffer,
+                                const NNCli_Command_t *a_command, int a_width)
+{
+    AppendCommandSummary(a_buffer, a_command, (int)strlen(a_command->m_name),
+                         a_width);
+    AppendToBuffer(a_buffer, "  usage: %s%s%s\n", a_command->m_name,
+                   (a_command->m_options != NULL) ? " " : "",
+                   (a_command->m_options != NULL) ? a_command->m_options : "");
+    if (a_command->m_flags & NN_CLI__COMMAND_FLAG_CACHEABLE)
+    {
+        AppendToBuffer(a_buffer, "  output is cached for %u ms\n",
+                       (unsigned)a_command->m_cache_ttl_ms);
+    }
+    if (a_command->m_timeout_ms != 0)
+    {
+        AppendToBuffer(a_buffer, "  times out after %u ms\n",
+                       (unsigned)a_command->m_timeout_ms);
+    }
+    if (a_command->m_complete_args != NULL)
+    {
+        AppendToBuffer(a_buffer, "  arguments are completed by Tab\n");
+    }
+}
+
+static void InvalidateHelpListing(void)
+{
+    s_help_listing.m_len = 0;
+    s_help_listing_width = 0;
+}
+
+// `help` shows all commands, `help COMMAND` the details of the command, and
+// `help [^]WORD` the commands whose names contain or start with WORD. The
+// output is written at once, so that it costs one write on slow links.
+static NNCli_Err_t HelpCommand(int argc, char **argv)
+{
+    int width = GetTerminalWidth();
+    OutputBuffer_t output = {0};
+    const NNCli_Command_t *command;
+
+    if (argc > 2)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    if (argc == 1)
+    {
+        if (s_help_listing.m_len == 0 || s_help_listing_width != width)
+        {
+            InvalidateHelpListing();
+            RenderCommandList(&s_help_listing, NULL, width);
+            s_help_listing_width = width;
+        }
+        fwrite(s_help_listing.m_buf, 1, s_help_listing.m_len, stdout);
+        return NN_CLI__SUCCESS;
+    }
+
+    command = FindCommand(argv[1]);
+    if (command != NULL)
+    {
+        RenderCommandDetail(&output, command, width);
+    }
+    else
+    {
+        RenderCommandList(&output, argv[1], width);
+    }
+
+    if (output.m_len == 0)
+    {
+        printf("No command matches %s\n", argv[1]);
+    }
+    else
+    {
+        fwrite(output.m_buf, 1, output.m_len, stdout);
+    }
+    NNCli_Free(output.m_buf);
+    return NN_CLI__SUCCESS;
+}
+
+static NNCli_Err_t HistoryLenCommand(int argc, char **argv)
+{
     if (argc != 2)
     {
         return NN_CLI__INVALID_ARGS;
@@ -329,12 +3569,146 @@ done:
     return res;
 }
 
+static NNCli_Err_t CacheCommand(int argc, char **argv)
+{
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+    if (argc == 1)
+    {
+        printf("hits: %u, misses: %u, evictions: %u\n",
+               (unsigned)s_cache_stats.m_hits, (unsigned)s_cache_stats.m_misses,
+               (unsigned)s_cache_stats.m_evictions);
+    }
+    else if (strcmp(argv[1], "clear") == 0 && argc <= 3)
+    {
+        NNCli_InvalidateCache(argc == 3 ? argv[2] : NULL);
+    }
+    else
+    {
+        goto done;
+    }
+
+    res = NN_CLI__SUCCESS;
+
+done:
+    return res;
+}
+
+static NNCli_Err_t LatencyCommand(int argc, char **argv)
+{
+    static const char *const s_names[NN_CLI__LATENCY_KIND_NUM] = {
+        "keystroke", "completion", "hints", "blocked", "preempted", "wakeup",
+    };
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+
+    if (argc == 1)
+    {
+        printf("Latency tracing is %s\n", s_is_latency_traced ? "on" : "off");
+        for (int i = 0; i < NN_CLI__LATENCY_KIND_NUM; i++)
+        {
+            ShowLatencyHistogram(s_names[i], &s_latency[i]);
+        }
+    }
+    else if (argc != 2)
+    {
+        goto done;
+    }
+    else if (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "off") == 0)
+    {
+        NNCli_SetLatencyTracing(strcmp(argv[1], "on") == 0);
+    }
+    else if (strcmp(argv[1], "reset") == 0)
+    {
+        NNCli_ResetLatencyHistograms();
+    }
+    else
+    {
+        goto done;
+    }
+
+    res = NN_CLI__SUCCESS;
+
+done:
+    return res;
+}
+
+static NNCli_Err_t PoolsCommand(int argc, char **argv)
+{
+    NNCli_PoolUsage_t usage;
+    if (argc != 1)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    printf("%8s %8s %8s %8s %8s %8s\n", "block", "total", "used", "peak",
+           "largest", "failed");
+    for (size_t i = 0; NNCli_GetPoolUsage(i, &usage) == NN_CLI__SUCCESS; i++)
+    {
+        printf("%8zu %8zu %8zu %8zu %8zu %8zu\n", usage.m_block_size,
+               usage.m_block_num, usage.m_used_num, usage.m_peak_num,
+               usage.m_largest_size, usage.m_failed_num);
+    }
+    return NN_CLI__SUCCESS;
+}
+
+static NNCli_Err_t PluginsCommand(int argc, char **argv)
+{
+    if (argc != 1)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    for (size_t i = 0; i < s_plugins.m_plugin_num; i++)
+    {
+        const NNCli_Plugin_t *plugin = s_plugins.m_plugins[i];
+        printf("%s: %s\n", plugin->m_path,
+               (plugin->m_handle != NULL) ? "loaded" : "not loaded");
+        for (size_t j = 0; j < s_plugins.m_command_num; j++)
+        {
+            if (s_plugins.m_commands[j]->m_plugin == plugin)
+            {
+                printf("  %s\n", s_plugins.m_commands[j]->m_command.m_name);
+            }
+        }
+    }
+    return NN_CLI__SUCCESS;
+}
+
+static NNCli_Err_t AliasCommand(int argc, char **argv)
+{
+    char buf[NN_CLI__LINE_MAX_LEN];
+    const NNCli_Alias_t *alias;
+
+    if (argc == 1)
+    {
+        for (size_t i = 0; i < s_aliases.m_num; i++)
+        {
+            if (NNCli_AliasFormat(s_aliases.m_aliases[i], buf, sizeof(buf)))
+            {
+                printf("%s\n", buf);
+            }
+        }
+        return NN_CLI__SUCCESS;
+    }
+    if (argc != 2)
+    {
+        // A change after `;` or in an alias reaches here.
+        NNCli_LogError("An alias is defined or removed by a line of its own");
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    alias = NNCli_AliasFind(&s_aliases, argv[1]);
+    if (alias == NULL || !NNCli_AliasFormat(alias, buf, sizeof(buf)))
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    printf("%s\n", buf);
+    return NN_CLI__SUCCESS;
+}
+
 static void RegisterDefaultCommand(void)
 {
     static const NNCli_Command_t help_command = {
         .m_func = HelpCommand,
         .m_name = "help",
-        .m_options = NULL,
+        .m_options = "[command / [^]word]",
         .m_help_msg = "Show registered commands",
     };
     NNCli_Err_t help_res = NNCli_RegisterCommand(&help_command);
@@ -361,6 +3735,152 @@ static void RegisterDefaultCommand(void)
     NNCli_Err_t mask_res = NNCli_RegisterCommand(&mask_command);
     NNCli_AssertWithMsg(mask_res == NN_CLI__SUCCESS,
                         "Failed to register mask command: %d", mask_res);
+
+    static const NNCli_Command_t cache_command = {
+        .m_func = CacheCommand,
+        .m_name = "cache",
+        .m_options = "[clear [command]]",
+        .m_help_msg = "Show cache statistics or drop cached results",
+    };
+    NNCli_Err_t cache_res = NNCli_RegisterCommand(&cache_command);
+    NNCli_AssertWithMsg(cache_res == NN_CLI__SUCCESS,
+                        "Failed to register cache command: %d", cache_res);
+
+    static const NNCli_Command_t watch_command = {
+        .m_func = WatchCommand,
+        .m_name = "watch",
+        .m_options = "[-n sec] command / -c job",
+        .m_help_msg = "Run a command periodically, or list/cancel the jobs",
+    };
+    NNCli_Err_t watch_res = NNCli_RegisterCommand(&watch_command);
+    NNCli_AssertWithMsg(watch_res == NN_CLI__SUCCESS,
+                        "Failed to register watch command: %d", watch_res);
+
+    static const NNCli_Command_t latency_command = {
+        .m_func = LatencyCommand,
+        .m_name = "latency",
+        .m_options = "[on/off/reset]",
+        .m_help_msg = "Show or control the latency tracing of the input",
+    };
+    NNCli_Err_t latency_res = NNCli_RegisterCommand(&latency_command);
+    NNCli_AssertWithMsg(latency_res == NN_CLI__SUCCESS,
+                        "Failed to register latency command: %d",
+                        latency_res);
+
+    static const NNCli_Command_t alias_command = {
+        .m_func = AliasCommand,
+        .m_name = "alias",
+        .m_options = "[name [= command ...]] / -d name",
+        .m_help_msg = "Define, remove or show aliases of command lines",
+    };
+    NNCli_Err_t alias_res = NNCli_RegisterCommand(&alias_command);
+    NNCli_AssertWithMsg(alias_res == NN_CLI__SUCCESS,
+                        "Failed to register alias command: %d", alias_res);
+
+    static const NNCli_Command_t foreach_command = {
+        .m_func = ForeachCommand,
+        .m_name = "foreach",
+        .m_options = "{a,b,...}/@file command [args with {}]",
+        .m_help_msg = "Run a command for each item and summarize the results",
+    };
+    NNCli_Err_t foreach_res = NNCli_RegisterCommand(&foreach_command);
+    NNCli_AssertWithMsg(foreach_res == NN_CLI__SUCCESS,
+                        "Failed to register foreach command: %d", foreach_res);
+
+    static const NNCli_Command_t time_command = {
+        .m_func = TimeCommand,
+        .m_name = "time",
+        .m_options = "command [args]",
+        .m_help_msg = "Run a command and show its time and allocations",
+    };
+    NNCli_Err_t time_res = NNCli_RegisterCommand(&time_command);
+    NNCli_AssertWithMsg(time_res == NN_CLI__SUCCESS,
+                        "Failed to register time command: %d", time_res);
+
+    static const NNCli_Command_t repeat_command = {
+        .m_func = RepeatCommand,
+        .m_name = "repeat",
+        .m_options = "N command [args]",
+        .m_help_msg = "Run a command N times quietly and show the times",
+    };
+    NNCli_Err_t repeat_res = NNCli_RegisterCommand(&repeat_command);
+    NNCli_AssertWithMsg(repeat_res == NN_CLI__SUCCESS,
+                        "Failed to register repeat command: %d", repeat_res);
+
+    if (s_pool_allocator.m_pool_num > 0)
+    {
+        static const NNCli_Command_t pools_command = {
+            .m_func = PoolsCommand,
+            .m_name = "pools",
+            .m_options = NULL,
+            .m_help_msg = "Show the usage of the memory pools",
+        };
+        NNCli_Err_t pools_res = NNCli_RegisterCommand(&pools_command);
+        NNCli_AssertWithMsg(pools_res == NN_CLI__SUCCESS,
+                            "Failed to register pools command: %d",
+                            pools_res);
+    }
+}
+
+/**
+ * Plugins
+ */
+
+// Every command of the plugins runs through this. The shared object is
+// loaded at the first call.
+static NNCli_Err_t RunPluginCommand(int argc, char **argv)
+{
+    NNCli_PluginCommand_t *command = NNCli_PluginFind(&s_plugins, argv[0]);
+    if (command == NULL ||
+        NNCli_PluginResolve(&s_plugins, command) != NN_CLI__SUCCESS)
+    {
+        return NN_CLI__EXTERNAL_LIB_ERROR;
+    }
+    return command->m_func(argc, argv);
+}
+
+// Called in the worker thread of the argument completion.
+static void CompletePluginArgs(int argc, char **argv,
+                               NNCli_ArgCandidates_t *a_candidates)
+{
+    NNCli_PluginCommand_t *command = NNCli_PluginFind(&s_plugins, argv[0]);
+    if (command != NULL &&
+        NNCli_PluginResolve(&s_plugins, command) == NN_CLI__SUCCESS)
+    {
+        command->m_complete_args(argc, argv, a_candidates);
+    }
+}
+
+// Registers the commands in the manifest without loading the plugins.
+static NNCli_Err_t LoadPlugins(const char *a_filename)
+{
+    static const NNCli_Command_t plugins_command = {
+        .m_func = PluginsCommand,
+        .m_name = "plugins",
+        .m_options = NULL,
+        .m_help_msg = "Show the plugins and whether they have been loaded",
+    };
+    NNCli_Err_t res;
+
+    NNCli_PluginTableInit(&s_plugins);
+    s_has_plugins = true;
+    res = NNCli_PluginTableLoad(&s_plugins, a_filename, RunPluginCommand,
+                                CompletePluginArgs);
+    if (res != NN_CLI__SUCCESS)
+    {
+        return res;
+    }
+
+    for (size_t i = 0; i < s_plugins.m_command_num; i++)
+    {
+        if (NNCli_RegisterCommand(&s_plugins.m_commands[i]->m_command) !=
+            NN_CLI__SUCCESS)
+        {
+            NNCli_LogWarn("Skipped the plugin command %s",
+                          s_plugins.m_commands[i]->m_command.m_name);
+        }
+    }
+    return NNCli_RegisterCommand(&plugins_command);
 }
 
 static bool CheckOrCreateFile(const char *filename)
@@ -399,6 +3919,15 @@ NNCli_Err_t NNCli_RegisterCommand(const NNCli_Command_t *a_cmd)
         goto done;
     }
 
+    if ((a_cmd->m_flags & NN_CLI__COMMAND_FLAG_CACHEABLE) &&
+        a_cmd->m_cache_ttl_ms == 0)
+    {
+        NNCli_LogError("%s command is cacheable but its TTL is 0",
+                       a_cmd->m_name);
+        res = NN_CLI__INVALID_ARGS;
+        goto done;
+    }
+
     if (s_command_list.m_num >= NN_CLI__MAX_COMMAND_NUM)
     {
         NNCli_LogError(
@@ -408,23 +3937,128 @@ NNCli_Err_t NNCli_RegisterCommand(const NNCli_Command_t *a_cmd)
         goto done;
     }
 
-    for (size_t i = 0; i < s_command_list.m_num; i++)
+    if (FindCommand(a_cmd->m_name) != NULL)
     {
-        if (strcmp(s_command_list.m_command[i]->m_name, a_cmd->m_name) == 0)
-        {
-            NNCli_LogError("%s command is already registered", a_cmd->m_name);
-            res = NN_CLI__DUPLICATE;
-            goto done;
-        }
+        NNCli_LogError("%s command is already registered", a_cmd->m_name);
+        res = NN_CLI__DUPLICATE;
+        goto done;
     }
 
     s_command_list.m_command[s_command_list.m_num] = a_cmd;
     s_command_list.m_num++;
+    InvalidateHelpListing();
+
+done:
+    return res;
+}
+
+bool NNCli_IsOutputClosed(void)
+{
+    return s_active_pipeline != NULL && s_active_pipeline->m_closed;
+}
+
+void NNCli_InvalidateCache(const char *a_name)
+{
+    for (size_t i = 0; i < NN_CLI__CACHE_ENTRY_NUM; i++)
+    {
+        CacheEntry_t *entry = &s_cache[i];
+        if (entry->m_command != NULL &&
+            (a_name == NULL || strcmp(entry->m_command->m_name, a_name) == 0))
+        {
+            ClearCacheEntry(entry);
+        }
+    }
+}
+
+NNCli_Err_t NNCli_GetCacheStats(NNCli_CacheStats_t *out_stats)
+{
+    NNCli_AssertOrReturn(out_stats, NN_CLI__INVALID_ARGS, "out_stats is NULL");
+    *out_stats = s_cache_stats;
+    return NN_CLI__SUCCESS;
+}
+
+NNCli_Err_t NNCli_ScheduleCommand(const char *a_command,
+                                  uint32_t a_interval_ms, int *out_job_id)
+{
+    NNCli_Err_t res = NN_CLI__NOT_READY;
+    ScheduledJob_t *job = NULL;
+
+    if (!IsInitialized())
+    {
+        NNCli_LogError("NNCli is not initialized");
+        goto done;
+    }
+
+    res = NN_CLI__INVALID_ARGS;
+    if (a_command == NULL || strlen(a_command) == 0 || a_interval_ms == 0)
+    {
+        NNCli_LogError("An invalid command was attempted to be scheduled");
+        goto done;
+    }
+
+    res = NN_CLI__EXCEED_CAPACITY;
+    if (strlen(a_command) > NN_CLI__LINE_MAX_LEN - 1)
+    {
+        NNCli_LogError(
+            "The length of the command exceeds the maximum limit: %d",
+            NN_CLI__LINE_MAX_LEN);
+        goto done;
+    }
+    for (size_t i = 0; i < NN_CLI__MAX_SCHEDULED_JOB_NUM; i++)
+    {
+        if (!s_jobs[i].m_in_use)
+        {
+            job = &s_jobs[i];
+            break;
+        }
+    }
+    if (job == NULL)
+    {
+        NNCli_LogError("The maximum number of scheduled commands is %d",
+                       NN_CLI__MAX_SCHEDULED_JOB_NUM);
+        goto done;
+    }
+
+    job->m_in_use = true;
+    strcpy(job->m_command, a_command);
+    job->m_interval_ms = a_interval_ms;
+    job->m_interval_ticks =
+        (a_interval_ms + NN_CLI__TIMER_TICK_MS - 1) / NN_CLI__TIMER_TICK_MS;
+    NNCli_TimerInit(&job->m_timer, RunScheduledJob, job);
+    NNCli_TimerWheelAdd(&s_timer_wheel, &job->m_timer,
+                        GetCurrentTick() + job->m_interval_ticks);
+    if (!s_async.m_enabled && !IsIoEnabled())
+    {
+        // linenoise() blocks until a line is entered.
+        NNCli_LogWarn("Scheduled commands only run between lines in the sync "
+                      "mode");
+    }
+
+    if (out_job_id != NULL)
+    {
+        *out_job_id = (int)(job - s_jobs) + 1;
+    }
+    res = NN_CLI__SUCCESS;
 
 done:
     return res;
 }
 
+NNCli_Err_t NNCli_CancelScheduledCommand(int a_job_id)
+{
+    if (a_job_id < 1 || a_job_id > NN_CLI__MAX_SCHEDULED_JOB_NUM ||
+        !s_jobs[a_job_id - 1].m_in_use)
+    {
+        NNCli_LogError("Job %d is not scheduled", a_job_id);
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    ScheduledJob_t *job = &s_jobs[a_job_id - 1];
+    NNCli_TimerWheelRemove(&s_timer_wheel, &job->m_timer);
+    job->m_in_use = false;
+    return NN_CLI__SUCCESS;
+}
+
 NNCli_Err_t NNCli_Init(const NNCli_Option_t *a_option)
 {
     NNCli_Err_t res = NN_CLI__IN_PROGRESS;
@@ -455,6 +4089,7 @@ NNCli_Err_t NNCli_Init(const NNCli_Option_t *a_option)
         res = NN_CLI__GENERAL_ERROR;
         goto done;
     }
+    s_cli_thread = pthread_self();
 
     /* Parse options, with --multiline we enable multi line editing. */
     if (a_option->m_enable_multi_line)
@@ -475,13 +4110,40 @@ NNCli_Err_t NNCli_Init(const NNCli_Option_t *a_option)
         NNCli_LogInfo("Async mode enabled");
         s_async = a_option->m_async;
     }
+    if (a_option->m_io != NULL)
+    {
+        if (a_option->m_io->m_read == NULL ||
+            a_option->m_io->m_write == NULL ||
+            a_option->m_record_filename != NULL)
+        {
+            NNCli_LogError("a_option->m_io is invalid");
+            goto done;
+        }
+    }
+    if (a_option->m_rpc && a_option->m_record_filename != NULL)
+    {
+        NNCli_LogError("a_option->m_rpc cannot be used with recording");
+        goto done;
+    }
+    if (a_option->m_record_filename != NULL)
+    {
+        // Started before linenoise sets up the terminal, because stdin is
+        // replaced.
+        res = NNCli_RecorderStart(a_option->m_record_filename);
+        if (res != NN_CLI__SUCCESS)
+        {
+            goto done;
+        }
+        NNCli_LogInfo("Recording the input to %s",
+                      a_option->m_record_filename);
+    }
 
     NNCli_AssertOrReturn(s_history_filename == NULL, NN_CLI__GENERAL_ERROR,
                          "s_history_filename is not NULL");
     // This is not released by free() until the end, because it is used to save
     // the command each time.
     s_history_filename =
-        (char *)malloc(strlen(a_option->m_history_filename) + 1);
+        (char *)NNCli_Malloc(strlen(a_option->m_history_filename) + 1);
     if (s_history_filename == NULL)
     {
         res = NN_CLI__GENERAL_ERROR;
@@ -492,20 +4154,90 @@ NNCli_Err_t NNCli_Init(const NNCli_Option_t *a_option)
 
     /* Load history from file. The history file is just a plain text file
      * where entries are separated by newlines. */
-    if (linenoiseHistoryLoad(s_history_filename))
+    NNCli_HistoryIndexInit(&s_history_index, NN_CLI__HISTORY_INDEX_MAX_NUM);
+    if (a_option->m_share_history)
+    {
+        res = NNCli_SharedHistoryOpen(&s_shared_history, s_history_filename,
+                                      NN_CLI__SHARED_HISTORY_MAX_NUM,
+                                      AddToHistory, NULL);
+        if (res != NN_CLI__SUCCESS)
+        {
+            goto done;
+        }
+        s_is_history_shared = true;
+    }
+    else if (linenoiseHistoryLoad(s_history_filename))
     {
         res = NN_CLI__EXTERNAL_LIB_ERROR;
         goto done;
     }
+    else
+    {
+        IndexHistoryFile(s_history_filename);
+    }
+
+    NNCli_AliasTableInit(&s_aliases, s_pipe_token, s_sequence_token);
+    NNCli_ArgCompleterInit(&s_arg_completer, NN_CLI__ARG_COMPLETION_WAIT_MS,
+                           NN_CLI__ARG_CANDIDATE_TTL_MS);
+    if (a_option->m_alias_filename != NULL)
+    {
+        s_alias_filename =
+            (char *)NNCli_Malloc(strlen(a_option->m_alias_filename) + 1);
+        if (s_alias_filename == NULL)
+        {
+            res = NN_CLI__GENERAL_ERROR;
+            NNCli_LogError("Failed to allocate memory for alias filename");
+            goto done;
+        }
+        strcpy(s_alias_filename, a_option->m_alias_filename);
+        LoadAliases();
+    }
 
     // Register basic commands such as help.
     RegisterDefaultCommand();
 
+    if (a_option->m_plugin_manifest_filename != NULL)
+    {
+        res = LoadPlugins(a_option->m_plugin_manifest_filename);
+        if (res != NN_CLI__SUCCESS)
+        {
+            goto done;
+        }
+    }
+
+    NNCli_TimerWheelInit(&s_timer_wheel, GetCurrentTick());
+
+    if (HasStaticCommandTable() &&
+        GetSectionCommandNum() != nn_cli_static_command_table.m_command_num)
+    {
+        NNCli_LogWarn(
+            "Some NNCLI_COMMAND() are not in the generated table. Check the "
+            "sources passed to nn_cli_add_static_commands()");
+    }
+
     /* Set the completion callback. This will be called every time the
      * user uses the <tab> key. */
     linenoiseSetCompletionCallback(completion);
     linenoiseSetHintsCallback(hints);
 
+    if (a_option->m_io != NULL)
+    {
+        s_io = *a_option->m_io;
+    }
+    else if (a_option->m_rpc)
+    {
+        s_io.m_read = ReadStdin;
+        s_io.m_write = WriteStdout;
+    }
+    if (a_option->m_rpc)
+    {
+        s_is_rpc = true;
+        NNCli_RpcReaderInit(&s_rpc_reader);
+    }
+    if (!IsIoEnabled() && isatty(STDOUT_FILENO))
+    {
+        WatchTerminalResize();
+    }
     s_is_initialized = true;
     res = NN_CLI__SUCCESS;
 
@@ -518,19 +4250,27 @@ done:
  * and presses enter. linenoise() is called at GetInputAsync() and
  * GetInputSync().
  *
- * The typed string is returned as a malloc() allocated string by
- * linenoise, so the user needs to free() it. */
+ * The typed string is allocated by linenoise with NNCli_Malloc(), so the
+ * user needs to NNCli_Free() it. */
 NNCli_Err_t NNCli_Run(void)
 {
     NNCli_Err_t err = NN_CLI__NOT_READY;
     char *line;
+    NNCli_Trace0(run_start);
     if (!IsInitialized())
     {
         NNCli_LogError("NNCli is not initialized");
         goto done;
     }
 
-    if (s_async.m_enabled)
+    if (IsIoEnabled())
+    {
+        // Lines are run while they are fed, so there is nothing to do after
+        // this.
+        err = RunWithIo();
+        goto done;
+    }
+    else if (s_async.m_enabled)
     {
         err = GetInputAsync(&line);
         if (err != NN_CLI__SUCCESS)
@@ -540,6 +4280,9 @@ NNCli_Err_t NNCli_Run(void)
     }
     else
     {
+        // Jobs cannot run while linenoise() is waiting for a line, so the due
+        // ones are run before it.
+        RunBackgroundCommands(NULL);
         err = GetInputSync(&line);
         if (err != NN_CLI__SUCCESS)
         {
@@ -548,18 +4291,289 @@ NNCli_Err_t NNCli_Run(void)
     }
 
     /* Do something with the string. */
-    if (line[0] != '\0')
+    err = ProcessLine(line);
+    NNCli_Free(line);
+
+done:
+    NNCli_Trace1(run_end, (int)err);
+    return err;
+}
+
+NNCli_Err_t NNCli_FeedInput(const char *a_data, size_t a_len)
+{
+    if (!IsInitialized())
     {
-        err = CallRegisteredCommand(line);
-        if (err == NN_CLI__SUCCESS)
+        NNCli_LogError("NNCli is not initialized");
+        return NN_CLI__NOT_READY;
+    }
+    NNCli_AssertOrReturn(a_data != NULL || a_len == 0, NN_CLI__INVALID_ARGS,
+                         "a_data is NULL");
+
+    return FeedInput(a_data, a_len, NULL);
+}
+
+NNCli_Err_t NNCli_ExecuteStream(const char *a_line, NNCli_OutputFunc_t a_output,
+                                void *a_ctx, uint32_t a_flags)
+{
+    NNCli_Err_t res;
+    NNCli_Err_t command_res = NN_CLI__SUCCESS;
+    OutputStream_t stream = {a_output, a_ctx};
+    OutputCapture_t capture;
+    bool was_executing = s_is_executing;
+
+    if (!IsInitialized())
+    {
+        NNCli_LogError("NNCli is not initialized");
+        return NN_CLI__NOT_READY;
+    }
+    // The output is captured by replacing stdout of the process, which would
+    // also take what the other threads print.
+    if (!pthread_equal(pthread_self(), s_cli_thread))
+    {
+        NNCli_LogError("NNCli_Execute() is called from another thread than "
+                       "NNCli_Init()");
+        return NN_CLI__NOT_READY;
+    }
+    NNCli_AssertOrReturn(a_line != NULL, NN_CLI__INVALID_ARGS,
+                         "a_line is NULL");
+
+    res = BeginOutputCapture(&capture, WriteToOutputStream, &stream);
+    if (res != NN_CLI__SUCCESS)
+    {
+        return res;
+    }
+    s_is_executing = true;
+    res = CallRegisteredCommand(a_line, &command_res);
+    s_is_executing = was_executing;
+    EndOutputCapture(&capture);
+
+    // As with a typed line, the line is added if it has been dispatched, even
+    // if a command has failed.
+    if (res == NN_CLI__SUCCESS && a_line[0] != '\0' &&
+        (a_flags & NN_CLI__EXECUTE_FLAG_ADD_HISTORY))
+    {
+        AddLineToHistory(a_line);
+    }
+    if (res == NN_CLI__SUCCESS)
+    {
+        res = command_res;
+    }
+    return res;
+}
+
+NNCli_Err_t NNCli_Execute(const char *a_line, char *out_buf, size_t a_buf_len)
+{
+    NNCli_Err_t res;
+    FixedBuffer_t buffer = {out_buf, a_buf_len, 0, false};
+
+    NNCli_AssertOrReturn(out_buf != NULL && a_buf_len > 0,
+                         NN_CLI__INVALID_ARGS, "out_buf is empty");
+    out_buf[0] = '\0';
+    res = NNCli_ExecuteStream(a_line, WriteToFixedBuffer, &buffer,
+                              NN_CLI__EXECUTE_FLAG_NONE);
+    if (res == NN_CLI__SUCCESS && buffer.m_is_truncated)
+    {
+        res = NN_CLI__EXCEED_CAPACITY;
+    }
+    return res;
+}
+
+NNCli_Err_t NNCli_Replay(const char *a_filename,
+                         const NNCli_ReplayOption_t *a_option,
+                         NNCli_ReplayStats_t *out_stats)
+{
+    NNCli_Err_t res = NN_CLI__NOT_READY;
+    NNCli_RecordReader_t reader = {0};
+    NNCli_ReplayStats_t stats = {0};
+    ReplayContext_t replay = {&stats, NULL, 0};
+    char chunk[NN_CLI__RECORD_CHUNK_MAX_LEN];
+    size_t chunk_len;
+    uint64_t chunk_us;
+    uint64_t start_ns;
+    uint64_t feed_start_ns;
+    NNCli_Err_t feed_res = NN_CLI__IN_PROGRESS;
+
+    if (!IsInitialized())
+    {
+        NNCli_LogError("NNCli is not initialized");
+        goto done;
+    }
+    res = NN_CLI__INVALID_ARGS;
+    if (a_filename == NULL || a_option == NULL)
+    {
+        NNCli_LogError("a_filename or a_option is NULL");
+        goto done;
+    }
+
+    res = NNCli_RecordReaderOpen(&reader, a_filename);
+    if (res != NN_CLI__SUCCESS)
+    {
+        goto done;
+    }
+
+    replay.m_report = a_option->m_report;
+    start_ns = GetMonotonicNs();
+    while (feed_res != NN_CLI__PROCESS_COMPLETED &&
+           (res = NNCli_RecordReaderNext(&reader, &chunk_us, chunk,
+                                         &chunk_len)) == NN_CLI__SUCCESS)
+    {
+        if (a_option->m_realtime)
         {
-            linenoiseHistoryAdd(line); /* Add to the history. */
-            linenoiseHistorySave(
-                s_history_filename); /* Save the history on disk. */
+            SleepUntilNs(start_ns + chunk_us * 1000);
         }
+
+        replay.m_command_ns = 0;
+        feed_start_ns = GetMonotonicNs();
+        feed_res = FeedInput(chunk, chunk_len, &replay);
+        // Replaying does not wait for suspended commands between keystrokes.
+        while (s_suspended.m_is_pending)
+        {
+            ResumeSuspendedCommand();
+        }
+        ReportReplayKeystroke(
+            &replay, chunk_us, chunk_len,
+            GetMonotonicNs() - feed_start_ns - replay.m_command_ns);
+    }
+    // Both the end of the recording and Ctrl-D finish the replay.
+    if (res == NN_CLI__PROCESS_COMPLETED)
+    {
+        res = NN_CLI__SUCCESS;
+    }
+
+    if (a_option->m_report != NULL)
+    {
+        ReportReplaySummary(a_option->m_report, &stats);
+    }
+    if (out_stats != NULL)
+    {
+        *out_stats = stats;
     }
-    free(line);
 
 done:
-    return err;
+    NNCli_RecordReaderClose(&reader);
+    return res;
+}
+
+void NNCli_SetLatencyTracing(bool a_enable) { s_is_latency_traced = a_enable; }
+
+NNCli_Err_t NNCli_GetLatencyHistogram(NNCli_LatencyKind_t a_kind,
+                                      NNCli_LatencyHistogram_t *out_histogram)
+{
+    NNCli_AssertOrReturn(out_histogram, NN_CLI__INVALID_ARGS,
+                         "out_histogram is NULL");
+    if (a_kind < 0 || a_kind >= NN_CLI__LATENCY_KIND_NUM)
+    {
+        NNCli_LogError("Unknown latency kind: %d", a_kind);
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    *out_histogram = s_latency[a_kind];
+    return NN_CLI__SUCCESS;
+}
+
+void NNCli_ResetLatencyHistograms(void)
+{
+    memset(s_latency, 0, sizeof(s_latency));
+}
+
+bool NNCli_ShouldYield(void)
+{
+    // A worker of `foreach` cannot be resumed.
+    if (s_worker_output != NULL)
+    {
+        return false;
+    }
+    return s_running_command != NULL &&
+           (GetMonotonicNs() >= s_slice_end_ns || NNCli_IsCancelled());
+}
+
+void *NNCli_GetResumeState(size_t a_size)
+{
+    if (s_running_command == NULL || s_worker_output != NULL)
+    {
+        return NULL;
+    }
+    if (s_running_command->m_state == NULL)
+    {
+        s_running_command->m_state = NNCli_Calloc(1, a_size);
+    }
+    return s_running_command->m_state;
+}
+
+bool NNCli_IsCancelled(void)
+{
+    return s_cancel_reason != CANCEL_REASON_NONE;
+}
+
+void NNCli_CancelCommand(void)
+{
+    if (s_running_command != NULL)
+    {
+        Cancel(CANCEL_REASON_INTERRUPTED);
+    }
+}
+
+NNCli_Err_t NNCli_SetTerminalSize(int a_columns, int a_rows)
+{
+    if (a_columns <= 0 || a_rows < 0)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    s_terminal_columns = a_columns;
+    s_terminal_rows = a_rows;
+    s_is_terminal_size_known = true;
+    s_is_terminal_size_stale = false;
+    return NN_CLI__SUCCESS;
+}
+
+NNCli_Err_t NNCli_GetTerminalSize(int *out_columns, int *out_rows)
+{
+    NNCli_AssertOrReturn(out_columns, NN_CLI__INVALID_ARGS,
+                         "out_columns is NULL");
+    NNCli_AssertOrReturn(out_rows, NN_CLI__INVALID_ARGS, "out_rows is NULL");
+    GetTerminalWidth();
+    *out_columns = s_terminal_columns;
+    *out_rows = s_terminal_rows;
+    return NN_CLI__SUCCESS;
+}
+
+NNCli_Err_t NNCli_SetAllocator(const NNCli_Allocator_t *a_allocator)
+{
+    if (IsInitialized() || s_pool_allocator.m_pool_num > 0)
+    {
+        NNCli_LogError("The allocator has to be set once before NNCli_Init()");
+        return NN_CLI__NOT_READY;
+    }
+    if (a_allocator != NULL &&
+        (a_allocator->m_malloc == NULL || a_allocator->m_realloc == NULL ||
+         a_allocator->m_free == NULL))
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    NNCli_AllocSet(a_allocator);
+    return NN_CLI__SUCCESS;
+}
+
+NNCli_Err_t NNCli_UsePools(const NNCli_Pool_t *a_pools, size_t a_pool_num)
+{
+    NNCli_Err_t res;
+    NNCli_Allocator_t allocator;
+
+    if (IsInitialized() || s_pool_allocator.m_pool_num > 0)
+    {
+        NNCli_LogError("The allocator has to be set once before NNCli_Init()");
+        return NN_CLI__NOT_READY;
+    }
+    res = NNCli_PoolAllocatorInit(&s_pool_allocator, a_pools, a_pool_num,
+                                  &allocator);
+    if (res == NN_CLI__SUCCESS)
+    {
+        NNCli_AllocSet(&allocator);
+    }
+    return res;
+}
+
+NNCli_Err_t NNCli_GetPoolUsage(size_t a_index, NNCli_PoolUsage_t *out_usage)
+{
+    return NNCli_PoolAllocatorGetUsage(&s_pool_allocator, a_index, out_usage);
 }
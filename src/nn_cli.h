@@ -1,7 +1,11 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <sys/time.h>
+#include <sys/types.h>
 
 typedef enum
 {
@@ -18,35 +22,265 @@ typedef enum
                                 // internally. This may not always be an error.
     NN_CLI__DUPLICATE,          // It means that the data is duplicated.
     NN_CLI__NOT_READY,          // The function or module is not ready yet.
+    NN_CLI__CANCELLED,          // The command has been stopped by Ctrl-C or
+                                // its timeout.
+    NN_CLI__NOT_FOUND,          // The command has not been found.
 } NNCli_Err_t;
 
 typedef NNCli_Err_t (*NNCli_Func_t)(int argc, char **argv);
 
+typedef struct NNCli_ArgCandidates NNCli_ArgCandidates_t;
+
+// Adds the candidates of `argv[argc - 1]`, the argument being completed, with
+// NNCli_AddArgCandidate(). `argv[0]` is the command name. It is called in a
+// worker thread. The candidates are cached and narrowed while the argument is
+// typed, so all of them can be added for the prefix it is called with.
+typedef void (*NNCli_CompleteArgsFunc_t)(int argc, char **argv,
+                                         NNCli_ArgCandidates_t *a_candidates);
+
+typedef enum
+{
+    NN_CLI__COMMAND_FLAG_NONE = 0,
+    // The command only reads something and prints it. Its output is reused
+    // for the same arguments until `m_cache_ttl_ms` passes.
+    NN_CLI__COMMAND_FLAG_CACHEABLE = 1 << 0,
+    // `foreach` may run the command for several items at the same time in
+    // worker threads. Such a command does not yield, does not use
+    // NNCli_GetResumeState(), and touches only state guarded by itself. Its
+    // output is still kept apart for each item. A command which is also
+    // cacheable runs for one item at a time, so that its output is cached.
+    NN_CLI__COMMAND_FLAG_THREAD_SAFE = 1 << 1,
+} NNCli_CommandFlag_t;
+
 typedef struct
 {
     // `m_func` should return `NN_CLI__SUCCESS` if no error occurs.
     // If an error occurs, return another error.
     // The type of these errors does not affect the operation.
+    // `NN_CLI__IN_PROGRESS` means that the command has not finished yet, and
+    // it is called again with the same arguments. See NNCli_ShouldYield().
     NNCli_Func_t m_func;
     const char *m_name;
     const char *m_options;
     const char *m_help_msg;
+    // Bitwise OR of `NNCli_CommandFlag_t`.
+    uint32_t m_flags;
+    // Required for `NN_CLI__COMMAND_FLAG_CACHEABLE`.
+    uint32_t m_cache_ttl_ms;
+    // If not 0, the command is cancelled when it runs longer than this, i.e.
+    // NNCli_IsCancelled() returns true and blocking calls return EINTR. The
+    // command is not stopped, so one which never checks it still keeps the
+    // console until it returns. SIGALRM and ITIMER_REAL are used for this
+    // while the command is running, and a timer of the application is set
+    // again with the time it has left afterwards. A command run by another
+    // one, e.g. by `foreach` or `time`, has the deadline of that one instead.
+    uint32_t m_timeout_ms;
+    // If not NULL, Tab completes the arguments with the candidates from this.
+    NNCli_CompleteArgsFunc_t m_complete_args;
 } NNCli_Command_t;
 
+// Passed the output of NNCli_ExecuteStream() as it is printed.
+typedef void (*NNCli_OutputFunc_t)(void *a_ctx, const char *a_data,
+                                   size_t a_len);
+
+typedef enum
+{
+    NN_CLI__EXECUTE_FLAG_NONE = 0,
+    // Adds the line to the history as if it had been typed.
+    NN_CLI__EXECUTE_FLAG_ADD_HISTORY = 1 << 0,
+} NNCli_ExecuteFlag_t;
+
+typedef struct
+{
+    uint32_t m_hits;
+    uint32_t m_misses;
+    // The number of results dropped to store newer ones.
+    uint32_t m_evictions;
+} NNCli_CacheStats_t;
+
+// The commands registered with NNCLI_COMMAND(). This table is generated at
+// build time by nn_cli_add_static_commands() in
+// cmake/NNCliStaticCommands.cmake.
+typedef struct
+{
+    // Sorted by name.
+    const NNCli_Command_t *const *m_commands;
+    size_t m_command_num;
+    // Perfect hash: the displacement of the bucket of a name decides its slot.
+    // Slots have the index of the command + 1, or 0 if they are empty.
+    const uint16_t *m_displacements;
+    size_t m_bucket_num;
+    const uint16_t *m_slots;
+    size_t m_slot_num;
+} NNCli_StaticCommandTable_t;
+
+#ifdef __cplusplus
+#define NN_CLI__EXTERN_C extern "C"
+#else
+#define NN_CLI__EXTERN_C extern
+#endif
+
+// Registers a command at build time instead of NNCli_RegisterCommand(), e.g.
+//
+//   NNCLI_COMMAND(sample_status,
+//                 .m_func = Sample_ShowStatusCmd,
+//                 .m_name = "sample-status",
+//                 .m_options = NULL,
+//                 .m_help_msg = "Show current sample status");
+//
+// The descriptor is placed in the `nn_cli_commands` section. `m_name` has to
+// be a string literal so that the table can be generated from the sources.
+#define NNCLI_COMMAND(a_ident, ...)                                          \
+    NN_CLI__EXTERN_C const NNCli_Command_t nn_cli_static_command_##a_ident;   \
+    const NNCli_Command_t nn_cli_static_command_##a_ident __attribute__((     \
+        used, section("nn_cli_commands"),                                    \
+        aligned(__alignof__(NNCli_Command_t)))) = {__VA_ARGS__}
+
 typedef struct
 {
     bool m_enabled;
     struct timeval m_timeout;
 } NNCli_AsyncOption_t;
 
+// Input and output used instead of the terminal, e.g. to run scripted
+// sessions in memory. The line is edited without linenoise in this case.
+typedef struct
+{
+    // Reads up to `a_len` bytes of raw keystrokes. Returns the number of bytes
+    // read, 0 at the end of the input, or -1 with errno set. EAGAIN means that
+    // there is no input for now.
+    ssize_t (*m_read)(void *a_ctx, char *a_buf, size_t a_len);
+    // Writes the output of the commands, and the prompt and the echo if
+    // `m_echo` is set. Returns the number of bytes written or -1.
+    ssize_t (*m_write)(void *a_ctx, const char *a_data, size_t a_len);
+    void *m_ctx;
+    bool m_echo;
+} NNCli_Io_t;
+
 typedef struct
 {
     bool m_enable_multi_line;
     bool m_show_key_codes;
     NNCli_AsyncOption_t m_async;
     const char *m_history_filename;
+    // If not NULL, the raw input of the session is recorded to this file with
+    // the time of each keystroke. It can be replayed with NNCli_Replay().
+    const char *m_record_filename;
+    // If not NULL, NNCli_Run() reads and writes through this instead of
+    // stdin and stdout. It cannot be used with `m_record_filename`.
+    const NNCli_Io_t *m_io;
+    // Set this when several processes use the same `m_history_filename`.
+    // Each entry is appended to the file under flock() instead of rewriting
+    // the file, and the entries of the other processes are merged while the
+    // line is edited. The file is compacted to the latest entries when it is
+    // opened, once it has grown to several times the history length.
+    bool m_share_history;
+    // If not NULL, the aliases defined by `alias` are loaded from this file
+    // and saved to it each time they are changed.
+    const char *m_alias_filename;
+    // Runs NNCli_Run() in the RPC mode for programs instead of the prompt.
+    // Each line of the input is a JSON request and is answered with its
+    // status and output, without editing or echo. See nn_cli_rpc.h for the
+    // frames. Requests can be sent without waiting for the responses. It
+    // cannot be used with `m_record_filename`.
+    bool m_rpc;
+    // If not NULL, the commands listed in this manifest are registered, and
+    // the shared object of a command is loaded when one of its commands is
+    // first run or its arguments are completed. See nn_cli_plugin.h for the
+    // format. The `plugins` command shows which ones have been loaded.
+    const char *m_plugin_manifest_filename;
 } NNCli_Option_t;
 
+typedef struct
+{
+    // Feeds the keystrokes at the recorded intervals. Otherwise they are fed
+    // as fast as possible.
+    bool m_realtime;
+    // If not NULL, the time taken by each keystroke and command is written
+    // here.
+    FILE *m_report;
+} NNCli_ReplayOption_t;
+
+typedef struct
+{
+    // Keystrokes are timed without the commands they have run.
+    uint32_t m_keystroke_num;
+    uint64_t m_keystroke_total_ns;
+    uint64_t m_keystroke_max_ns;
+    uint32_t m_command_num;
+    uint64_t m_command_total_ns;
+    uint64_t m_command_max_ns;
+} NNCli_ReplayStats_t;
+
+// What is measured by the latency tracing. A keystroke is measured from the
+// time the input wait returns with it to the end of its echo. The time the
+// thread was not running in it is split by whether it was preempted, which
+// shows whether the delay comes from the terminal or from the scheduler.
+typedef enum
+{
+    NN_CLI__LATENCY_KEYSTROKE,
+    NN_CLI__LATENCY_COMPLETION,  // The Tab completion callback
+    NN_CLI__LATENCY_HINTS,       // The hints callback
+    NN_CLI__LATENCY_BLOCKED,     // Waiting for writes in a keystroke
+    NN_CLI__LATENCY_PREEMPTED,   // Waiting for a CPU in a keystroke
+    NN_CLI__LATENCY_WAKEUP,  // How late the input wait ends after its timeout
+    NN_CLI__LATENCY_KIND_NUM,
+} NNCli_LatencyKind_t;
+
+#define NN_CLI__LATENCY_BUCKET_NUM 20
+
+typedef struct
+{
+    // `m_buckets[i]` counts the samples from 2^i to 2^(i+1) microseconds. The
+    // first bucket also counts shorter ones and the last one longer ones.
+    uint32_t m_buckets[NN_CLI__LATENCY_BUCKET_NUM];
+    uint32_t m_count;
+    uint64_t m_total_ns;
+    uint64_t m_max_ns;
+} NNCli_LatencyHistogram_t;
+
+// Where nn_cli and linenoise allocate memory from. See NNCli_SetAllocator().
+// The functions may be called from the worker threads of `foreach` and the
+// argument completion at the same time.
+typedef struct
+{
+    void *(*m_malloc)(void *a_ctx, size_t a_size);
+    // `a_ptr` may be NULL, as with realloc().
+    void *(*m_realloc)(void *a_ctx, void *a_ptr, size_t a_size);
+    void (*m_free)(void *a_ctx, void *a_ptr);
+    void *m_ctx;
+} NNCli_Allocator_t;
+
+// Blocks of one size for NNCli_UsePools().
+typedef struct
+{
+    // `m_block_size` * `m_block_num` bytes aligned like max_align_t, e.g.
+    // declared with NN_CLI__POOL_BUF().
+    void *m_buf;
+    // A multiple of the alignment of max_align_t.
+    size_t m_block_size;
+    size_t m_block_num;
+} NNCli_Pool_t;
+
+#define NN_CLI__POOL_BUF(a_name, a_block_size, a_block_num)          \
+    max_align_t a_name[((a_block_size) * (a_block_num) +             \
+                        sizeof(max_align_t) - 1) /                   \
+                       sizeof(max_align_t)]
+
+typedef struct
+{
+    size_t m_block_size;
+    size_t m_block_num;
+    size_t m_used_num;
+    // The high-water mark of `m_used_num`.
+    size_t m_peak_num;
+    // The largest request which has come to this pool.
+    size_t m_largest_size;
+    // The requests which have failed, because this pool and the larger ones
+    // were full. The requests larger than any block count for the last pool.
+    size_t m_failed_num;
+} NNCli_PoolUsage_t;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -56,6 +290,119 @@ extern "C"
     NNCli_Err_t NNCli_Init(const NNCli_Option_t *a_option);
     NNCli_Err_t NNCli_Run(void);
 
+    // Returns true if the output of the running command is no longer read,
+    // e.g. `head` in `cmd | head 5` has got enough lines. A command which
+    // prints a lot can check this to stop early.
+    bool NNCli_IsOutputClosed(void);
+
+    // Returns true if the running command should stop, because Ctrl-C has
+    // been pressed or its `m_timeout_ms` has passed. Long commands should
+    // check this and return. Blocking calls in the command return EINTR when
+    // it is cancelled, and again on each Ctrl-C after that. A command which
+    // never checks this keeps the console until it returns.
+    bool NNCli_IsCancelled(void);
+    // Cancels the running command. This can be called from signal handlers
+    // and other threads.
+    void NNCli_CancelCommand(void);
+
+    // A long command can run in slices so that the input is not blocked. It
+    // returns NN_CLI__IN_PROGRESS when this returns true, and continues from
+    // its state when it is called again. In the async mode and with `m_io`,
+    // NNCli_Run() runs a slice between input polls, and the rest of its line
+    // after it has finished. One command runs in the background at a time;
+    // in other cases it is called again at once until it finishes. Ctrl-C at
+    // the prompt cancels it, and `m_timeout_ms` spans all its slices.
+    bool NNCli_ShouldYield(void);
+    // Returns the state of the running command, which is zero-initialized
+    // when the command is called for the first time, and kept until it
+    // returns another result than NN_CLI__IN_PROGRESS. NULL outside commands.
+    void *NNCli_GetResumeState(size_t a_size);
+
+    // Drops the cached results of the command `a_name`, or all cached results
+    // if `a_name` is NULL. Call this when the state a cacheable command shows
+    // has been changed.
+    void NNCli_InvalidateCache(const char *a_name);
+    NNCli_Err_t NNCli_GetCacheStats(NNCli_CacheStats_t *out_stats);
+
+    // Called from `m_complete_args`. Candidates which do not start with the
+    // argument being completed are ignored.
+    NNCli_Err_t NNCli_AddArgCandidate(NNCli_ArgCandidates_t *a_candidates,
+                                      const char *a_candidate);
+
+    // Runs `a_command` every `a_interval_ms` from NNCli_Run(). In the async
+    // mode, the input wait ends when a command is due. In the sync mode, due
+    // commands are only run before waiting for the next line, which is
+    // warned about when one is scheduled.
+    NNCli_Err_t NNCli_ScheduleCommand(const char *a_command,
+                                      uint32_t a_interval_ms, int *out_job_id);
+    NNCli_Err_t NNCli_CancelScheduledCommand(int a_job_id);
+
+    // Processes raw keystrokes without a terminal, as if they had been typed.
+    // The echo and the output of the commands are printed to stdout, or
+    // written to `m_io` if it is set, and the commands run when Enter is fed.
+    // The line has no length limit while it is edited, but one longer than
+    // NN_CLI__LINE_MAX_LEN - 1 bytes is not run, and an error is logged
+    // instead. Returns NN_CLI__SUCCESS if a line has been entered,
+    // NN_CLI__IN_PROGRESS if not, and NN_CLI__PROCESS_COMPLETED if Ctrl-D is
+    // fed on an empty line.
+    NNCli_Err_t NNCli_FeedInput(const char *a_data, size_t a_len);
+
+    // Runs a line as if it had been entered, and puts what it prints in
+    // `out_buf` with a null terminator instead of stdout. It is not added to
+    // the history. The line runs to the end even if it yields. Since stdout
+    // of the process is replaced meanwhile, this returns NN_CLI__NOT_READY
+    // unless it is called from the thread of NNCli_Init() and NNCli_Run(),
+    // e.g. in a command or between the calls of NNCli_Run(). Other threads,
+    // e.g. of a REST bridge, pass their lines to that one. Returns the result
+    // of the first command of the line which has failed, e.g.
+    // NN_CLI__NOT_FOUND for an unknown command, or NN_CLI__EXCEED_CAPACITY if
+    // the output has been truncated.
+    NNCli_Err_t NNCli_Execute(const char *a_line, char *out_buf,
+                              size_t a_buf_len);
+    // Passes the output to `a_output` while the line runs instead. NULL
+    // drops it. `a_flags` is a bitwise OR of `NNCli_ExecuteFlag_t`.
+    NNCli_Err_t NNCli_ExecuteStream(const char *a_line,
+                                    NNCli_OutputFunc_t a_output, void *a_ctx,
+                                    uint32_t a_flags);
+
+    // Feeds a recording made with `m_record_filename` by NNCli_FeedInput().
+    NNCli_Err_t NNCli_Replay(const char *a_filename,
+                             const NNCli_ReplayOption_t *a_option,
+                             NNCli_ReplayStats_t *out_stats);
+
+    // Turns the latency tracing of the input on or off. It is off at first,
+    // and can also be turned on by the `latency on` command. In the sync
+    // mode, the line is read key by key while it is on.
+    void NNCli_SetLatencyTracing(bool a_enable);
+    NNCli_Err_t NNCli_GetLatencyHistogram(
+        NNCli_LatencyKind_t a_kind, NNCli_LatencyHistogram_t *out_histogram);
+    void NNCli_ResetLatencyHistograms(void);
+
+    // Sets the size of the terminal, e.g. for a serial console or a telnet
+    // session where it cannot be measured. The size is cached, and is only
+    // measured again when SIGWINCH reports that the terminal has been
+    // resized. This size is kept if it still cannot be measured then.
+    // `a_rows` is 0 if it is unknown.
+    NNCli_Err_t NNCli_SetTerminalSize(int a_columns, int a_rows);
+    // `out_rows` is 0 if it is unknown.
+    NNCli_Err_t NNCli_GetTerminalSize(int *out_columns, int *out_rows);
+
+    // Routes the allocations of nn_cli and linenoise to `a_allocator`, or
+    // back to malloc() if it is NULL. This has to be called before
+    // NNCli_Init(), so that nothing is freed with another allocator.
+    NNCli_Err_t NNCli_SetAllocator(const NNCli_Allocator_t *a_allocator);
+    // Serves the allocations of nn_cli and linenoise from `a_pools` instead
+    // of the heap. A request takes the smallest free block it fits in, and
+    // fails if there is none, e.g. a line is not added to the history then.
+    // The pools are sorted by `m_block_size`, and are used until the process
+    // ends. The C library may still use the heap, e.g. for threads and FILE.
+    // This has to be called before NNCli_Init(). The `pools` command shows
+    // their usage then.
+    NNCli_Err_t NNCli_UsePools(const NNCli_Pool_t *a_pools, size_t a_pool_num);
+    // Returns NN_CLI__INVALID_ARGS if there is no `a_index`th pool.
+    NNCli_Err_t NNCli_GetPoolUsage(size_t a_index,
+                                   NNCli_PoolUsage_t *out_usage);
+
 #ifdef __cplusplus
 }
 #endif
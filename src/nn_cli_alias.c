@@ -0,0 +1,316 @@
+#include "nn_cli_alias.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nn_cli_alloc.h"
+
+static bool IsSeparator(const NNCli_AliasTable_t *a_table, const char *a_token)
+{
+    return a_token == a_table->m_separators[0] ||
+           a_token == a_table->m_separators[1];
+}
+
+// Returns N for `$N`, or 0.
+static uint8_t GetParam(const char *a_token)
+{
+    if (a_token[0] == '$' && a_token[1] >= '1' && a_token[1] <= '9' &&
+        a_token[2] == '\0')
+    {
+        return (uint8_t)(a_token[1] - '0');
+    }
+    return 0;
+}
+
+static bool IsValidName(const NNCli_AliasTable_t *a_table, const char *a_name)
+{
+    return a_name != NULL && a_name[0] != '\0' &&
+           !IsSeparator(a_table, a_name) && strchr(a_name, '=') == NULL &&
+           GetParam(a_name) == 0;
+}
+
+static size_t FindIndex(const NNCli_AliasTable_t *a_table, const char *a_name)
+{
+    size_t i;
+    for (i = 0; i < a_table->m_num; i++)
+    {
+        if (strcmp(a_table->m_aliases[i]->m_name, a_name) == 0)
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+// Compiles the tokens into a template.
+static NNCli_Alias_t *NewAlias(const NNCli_AliasTable_t *a_table,
+                               const char *a_name, char *const *a_tokens,
+                               int a_token_num)
+{
+    size_t text_len = strlen(a_name) + 1;
+    NNCli_Alias_t *alias;
+    char *text;
+
+    for (int i = 0; i < a_token_num; i++)
+    {
+        if (!IsSeparator(a_table, a_tokens[i]) && GetParam(a_tokens[i]) == 0)
+        {
+            text_len += strlen(a_tokens[i]) + 1;
+        }
+    }
+
+    alias = (NNCli_Alias_t *)NNCli_Malloc(
+        sizeof(NNCli_Alias_t) + a_token_num * sizeof(NNCli_AliasToken_t) +
+        text_len);
+    if (alias == NULL)
+    {
+        return NULL;
+    }
+    alias->m_tokens = (NNCli_AliasToken_t *)(alias + 1);
+    alias->m_token_num = a_token_num;
+    alias->m_param_num = 0;
+    text = (char *)&alias->m_tokens[a_token_num];
+    alias->m_name = strcpy(text, a_name);
+    text += strlen(a_name) + 1;
+
+    for (int i = 0; i < a_token_num; i++)
+    {
+        NNCli_AliasToken_t *token = &alias->m_tokens[i];
+        token->m_param = IsSeparator(a_table, a_tokens[i])
+                             ? 0
+                             : GetParam(a_tokens[i]);
+        if (token->m_param != 0)
+        {
+            token->m_token = NULL;
+            if (token->m_param > alias->m_param_num)
+            {
+                alias->m_param_num = token->m_param;
+            }
+        }
+        else if (IsSeparator(a_table, a_tokens[i]))
+        {
+            token->m_token = a_tokens[i];
+        }
+        else
+        {
+            token->m_token = strcpy(text, a_tokens[i]);
+            text += strlen(a_tokens[i]) + 1;
+        }
+    }
+    return alias;
+}
+
+void NNCli_AliasTableInit(NNCli_AliasTable_t *a_table, char *a_pipe_token,
+                          char *a_sequence_token)
+{
+    memset(a_table, 0, sizeof(*a_table));
+    a_table->m_separators[0] = a_pipe_token;
+    a_table->m_separators[1] = a_sequence_token;
+}
+
+void NNCli_AliasTableClear(NNCli_AliasTable_t *a_table)
+{
+    for (size_t i = 0; i < a_table->m_num; i++)
+    {
+        NNCli_Free(a_table->m_aliases[i]);
+        a_table->m_aliases[i] = NULL;
+    }
+    a_table->m_num = 0;
+}
+
+NNCli_Err_t NNCli_AliasDefine(NNCli_AliasTable_t *a_table,
+                              const char *a_name, char *const *a_tokens,
+                              int a_token_num)
+{
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+    size_t index;
+    NNCli_Alias_t *alias;
+
+    if (!IsValidName(a_table, a_name) || a_token_num <= 0 ||
+        IsSeparator(a_table, a_tokens[0]))
+    {
+        NNCli_LogError("Invalid alias: %s", a_name != NULL ? a_name : "");
+        goto done;
+    }
+    index = FindIndex(a_table, a_name);
+    if (a_token_num > NN_CLI__MAX_TOKENS_PER_LINE)
+    {
+        NNCli_LogError("The alias is longer than %d tokens",
+                       NN_CLI__MAX_TOKENS_PER_LINE);
+        res = NN_CLI__EXCEED_CAPACITY;
+        goto done;
+    }
+    if (index == a_table->m_num && a_table->m_num == NN_CLI__MAX_ALIAS_NUM)
+    {
+        NNCli_LogError("The number of aliases exceeds the maximum limit: %d",
+                       NN_CLI__MAX_ALIAS_NUM);
+        res = NN_CLI__EXCEED_CAPACITY;
+        goto done;
+    }
+
+    alias = NewAlias(a_table, a_name, a_tokens, a_token_num);
+    if (alias == NULL)
+    {
+        NNCli_LogError("Failed to allocate memory for alias %s", a_name);
+        res = NN_CLI__GENERAL_ERROR;
+        goto done;
+    }
+
+    if (index == a_table->m_num)
+    {
+        a_table->m_num++;
+    }
+    else
+    {
+        NNCli_Free(a_table->m_aliases[index]);
+    }
+    a_table->m_aliases[index] = alias;
+    res = NN_CLI__SUCCESS;
+
+done:
+    return res;
+}
+
+NNCli_Err_t NNCli_AliasRemove(NNCli_AliasTable_t *a_table, const char *a_name)
+{
+    size_t index = FindIndex(a_table, a_name);
+    if (index == a_table->m_num)
+    {
+        NNCli_LogError("No such alias: %s", a_name);
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    NNCli_Free(a_table->m_aliases[index]);
+    // The order of definition is kept for listing.
+    memmove(&a_table->m_aliases[index], &a_table->m_aliases[index + 1],
+            (a_table->m_num - index - 1) * sizeof(a_table->m_aliases[0]));
+    a_table->m_aliases[--a_table->m_num] = NULL;
+    return NN_CLI__SUCCESS;
+}
+
+const NNCli_Alias_t *NNCli_AliasFind(const NNCli_AliasTable_t *a_table,
+                                     const char *a_name)
+{
+    size_t index = FindIndex(a_table, a_name);
+    return (index < a_table->m_num) ? a_table->m_aliases[index] : NULL;
+}
+
+NNCli_Err_t NNCli_AliasExpand(const NNCli_AliasTable_t *a_table,
+                              char **a_tokens, int a_token_num,
+                              char **out_tokens, int a_max_token_num,
+                              int *out_token_num)
+{
+    NNCli_Err_t res = NN_CLI__EXCEED_CAPACITY;
+    int out_num = 0;
+    int i = 0;
+
+    while (i < a_token_num)
+    {
+        const NNCli_Alias_t *alias = NULL;
+        int arg_num = 0;
+        uint16_t used_args = 0;
+
+        if (i == 0 || IsSeparator(a_table, a_tokens[i - 1]))
+        {
+            alias = NNCli_AliasFind(a_table, a_tokens[i]);
+        }
+        if (alias == NULL)
+        {
+            if (out_num == a_max_token_num)
+            {
+                goto done;
+            }
+            out_tokens[out_num++] = a_tokens[i++];
+            continue;
+        }
+
+        // The arguments are the tokens up to the end of the command.
+        while (i + 1 + arg_num < a_token_num &&
+               !IsSeparator(a_table, a_tokens[i + 1 + arg_num]))
+        {
+            arg_num++;
+        }
+        if (arg_num < alias->m_param_num)
+        {
+            NNCli_LogError("%s needs %d arguments", alias->m_name,
+                           alias->m_param_num);
+            res = NN_CLI__INVALID_ARGS;
+            goto done;
+        }
+
+        for (int t = 0; t < alias->m_token_num; t++)
+        {
+            const NNCli_AliasToken_t *token = &alias->m_tokens[t];
+            if (out_num == a_max_token_num)
+            {
+                goto done;
+            }
+            if (token->m_param == 0)
+            {
+                out_tokens[out_num++] = token->m_token;
+                continue;
+            }
+            out_tokens[out_num++] = a_tokens[i + token->m_param];
+            used_args |= 1u << token->m_param;
+        }
+        for (int a = 1; a <= arg_num; a++)
+        {
+            if (a <= 9 && (used_args & (1u << a)) != 0)
+            {
+                continue;
+            }
+            if (out_num == a_max_token_num)
+            {
+                goto done;
+            }
+            out_tokens[out_num++] = a_tokens[i + a];
+        }
+        i += 1 + arg_num;
+    }
+
+    *out_token_num = out_num;
+    res = NN_CLI__SUCCESS;
+
+done:
+    if (res == NN_CLI__EXCEED_CAPACITY)
+    {
+        NNCli_LogError(
+            "The number of words in the expanded line exceeds the maximum "
+            "limit: %d",
+            a_max_token_num);
+    }
+    return res;
+}
+
+bool NNCli_AliasFormat(const NNCli_Alias_t *a_alias, char *a_buf,
+                       size_t a_len)
+{
+    size_t used = 0;
+    int len = snprintf(a_buf, a_len, "%s =", a_alias->m_name);
+    if (len < 0 || (size_t)len >= a_len)
+    {
+        return false;
+    }
+    used = len;
+
+    for (int i = 0; i < a_alias->m_token_num; i++)
+    {
+        const NNCli_AliasToken_t *token = &a_alias->m_tokens[i];
+        if (token->m_param != 0)
+        {
+            len = snprintf(&a_buf[used], a_len - used, " $%d",
+                           token->m_param);
+        }
+        else
+        {
+            len = snprintf(&a_buf[used], a_len - used, " %s", token->m_token);
+        }
+        if (len < 0 || (size_t)len >= a_len - used)
+        {
+            return false;
+        }
+        used += len;
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+#include "nn_cli_alloc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// All functions are NULL while the C library is used.
+static NNCli_Allocator_t s_allocator;
+static size_t s_alloc_num;
+
+void NNCli_AllocSet(const NNCli_Allocator_t *a_allocator)
+{
+    if (a_allocator == NULL)
+    {
+        memset(&s_allocator, 0, sizeof(s_allocator));
+        return;
+    }
+    s_allocator = *a_allocator;
+}
+
+size_t NNCli_AllocGetCount(void)
+{
+    return __atomic_load_n(&s_alloc_num, __ATOMIC_RELAXED);
+}
+
+void *NNCli_Malloc(size_t a_size)
+{
+    __atomic_add_fetch(&s_alloc_num, 1, __ATOMIC_RELAXED);
+    if (s_allocator.m_malloc == NULL)
+    {
+        return malloc(a_size);
+    }
+    return s_allocator.m_malloc(s_allocator.m_ctx, a_size);
+}
+
+void *NNCli_Calloc(size_t a_num, size_t a_size)
+{
+    void *ptr;
+    if (a_size != 0 && a_num > SIZE_MAX / a_size)
+    {
+        return NULL;
+    }
+    ptr = NNCli_Malloc(a_num * a_size);
+    if (ptr != NULL)
+    {
+        memset(ptr, 0, a_num * a_size);
+    }
+    return ptr;
+}
+
+void *NNCli_Realloc(void *a_ptr, size_t a_size)
+{
+    __atomic_add_fetch(&s_alloc_num, 1, __ATOMIC_RELAXED);
+    if (s_allocator.m_realloc == NULL)
+    {
+        return realloc(a_ptr, a_size);
+    }
+    return s_allocator.m_realloc(s_allocator.m_ctx, a_ptr, a_size);
+}
+
+void NNCli_Free(void *a_ptr)
+{
+    if (s_allocator.m_free == NULL)
+    {
+        free(a_ptr);
+        return;
+    }
+    s_allocator.m_free(s_allocator.m_ctx, a_ptr);
+}
+
+char *NNCli_Strdup(const char *a_str)
+{
+    size_t len = strlen(a_str) + 1;
+    char *copy = (char *)NNCli_Malloc(len);
+    if (copy != NULL)
+    {
+        memcpy(copy, a_str, len);
+    }
+    return copy;
+}
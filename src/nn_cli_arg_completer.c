@@ -0,0 +1,415 @@
+#include "nn_cli_arg_completer.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nn_cli_alloc.h"
+
+static uint64_t GetMonotonicMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static bool StartsWith(const char *a_str, const char *a_prefix)
+{
+    return strncmp(a_str, a_prefix, strlen(a_prefix)) == 0;
+}
+
+/**
+ * Candidates
+ */
+
+static void InitCandidates(NNCli_ArgCandidates_t *a_candidates,
+                           const char *a_prefix)
+{
+    memset(a_candidates, 0, sizeof(*a_candidates));
+    a_candidates->m_prefix = a_prefix;
+}
+
+static void FreeCandidates(NNCli_ArgCandidates_t *a_candidates)
+{
+    NNCli_Free(a_candidates->m_strings);
+    NNCli_Free(a_candidates->m_offsets);
+    NNCli_Free(a_candidates->m_sorted);
+    InitCandidates(a_candidates, NULL);
+}
+
+static int CompareCandidates(const void *a_lhs, const void *a_rhs)
+{
+    return strcmp(*(const char *const *)a_lhs, *(const char *const *)a_rhs);
+}
+
+static void SortCandidates(NNCli_ArgCandidates_t *a_candidates)
+{
+    size_t num = 0;
+
+    if (a_candidates->m_num == 0)
+    {
+        return;
+    }
+    a_candidates->m_sorted =
+        (const char **)NNCli_Malloc(a_candidates->m_num * sizeof(char *));
+    if (a_candidates->m_sorted == NULL)
+    {
+        NNCli_LogError("Failed to allocate memory for the candidates");
+        return;
+    }
+    for (size_t i = 0; i < a_candidates->m_num; i++)
+    {
+        a_candidates->m_sorted[i] =
+            &a_candidates->m_strings[a_candidates->m_offsets[i]];
+    }
+    qsort(a_candidates->m_sorted, a_candidates->m_num, sizeof(char *),
+          CompareCandidates);
+
+    for (size_t i = 0; i < a_candidates->m_num; i++)
+    {
+        if (num == 0 ||
+            strcmp(a_candidates->m_sorted[num - 1],
+                   a_candidates->m_sorted[i]) != 0)
+        {
+            a_candidates->m_sorted[num++] = a_candidates->m_sorted[i];
+        }
+    }
+    a_candidates->m_sorted_num = num;
+}
+
+static bool Grow(void **a_block, size_t *a_cap, size_t a_needed,
+                 size_t a_elem_size)
+{
+    size_t cap = (*a_cap == 0) ? 64 : *a_cap;
+    void *block;
+
+    if (a_needed <= *a_cap)
+    {
+        return true;
+    }
+    while (cap < a_needed)
+    {
+        cap *= 2;
+    }
+    block = NNCli_Realloc(*a_block, cap * a_elem_size);
+    if (block == NULL)
+    {
+        return false;
+    }
+    *a_block = block;
+    *a_cap = cap;
+    return true;
+}
+
+NNCli_Err_t NNCli_AddArgCandidate(NNCli_ArgCandidates_t *a_candidates,
+                                  const char *a_candidate)
+{
+    size_t len;
+
+    if (a_candidates == NULL || a_candidate == NULL)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    if (a_candidates->m_prefix != NULL &&
+        !StartsWith(a_candidate, a_candidates->m_prefix))
+    {
+        return NN_CLI__SUCCESS;
+    }
+    if (a_candidates->m_num == NN_CLI__MAX_ARG_CANDIDATE_NUM)
+    {
+        return NN_CLI__EXCEED_CAPACITY;
+    }
+
+    len = strlen(a_candidate) + 1;
+    if (!Grow((void **)&a_candidates->m_strings, &a_candidates->m_strings_cap,
+              a_candidates->m_strings_len + len, 1) ||
+        !Grow((void **)&a_candidates->m_offsets, &a_candidates->m_cap,
+              a_candidates->m_num + 1, sizeof(size_t)))
+    {
+        NNCli_LogError("Failed to allocate memory for the candidates");
+        return NN_CLI__GENERAL_ERROR;
+    }
+    memcpy(&a_candidates->m_strings[a_candidates->m_strings_len], a_candidate,
+           len);
+    a_candidates->m_offsets[a_candidates->m_num++] =
+        a_candidates->m_strings_len;
+    a_candidates->m_strings_len += len;
+    return NN_CLI__SUCCESS;
+}
+
+/**
+ * Worker
+ */
+
+// Calls the provider with the words of the head and the prefix.
+static void Fetch(const NNCli_ArgQuery_t *a_query,
+                  NNCli_ArgCandidates_t *out_candidates)
+{
+    char buf[NN_CLI__LINE_MAX_LEN];
+    char *argv[NN_CLI__MAX_WORDS_PER_COMMAND];
+    int argc = 0;
+    char *save = NULL;
+
+    strcpy(buf, a_query->m_head);
+    for (char *word = strtok_r(buf, " ", &save); word != NULL;
+         word = strtok_r(NULL, " ", &save))
+    {
+        if (argc == NN_CLI__MAX_WORDS_PER_COMMAND - 1)
+        {
+            return;
+        }
+        argv[argc++] = word;
+    }
+    argv[argc++] = (char *)a_query->m_prefix;
+
+    a_query->m_func(argc, argv, out_candidates);
+    SortCandidates(out_candidates);
+}
+
+static void *RunWorker(void *a_arg)
+{
+    NNCli_ArgCompleter_t *completer = (NNCli_ArgCompleter_t *)a_arg;
+    NNCli_ArgCandidates_t candidates;
+
+    pthread_mutex_lock(&completer->m_mutex);
+    while (!completer->m_is_stopping)
+    {
+        if (!completer->m_has_request)
+        {
+            pthread_cond_wait(&completer->m_cond, &completer->m_mutex);
+            continue;
+        }
+
+        completer->m_fetching = completer->m_request;
+        completer->m_has_request = false;
+        completer->m_is_fetching = true;
+        completer->m_fetch_num++;
+        pthread_mutex_unlock(&completer->m_mutex);
+
+        // `m_fetching` is only changed by this thread.
+        InitCandidates(&candidates, completer->m_fetching.m_prefix);
+        Fetch(&completer->m_fetching, &candidates);
+
+        pthread_mutex_lock(&completer->m_mutex);
+        FreeCandidates(&completer->m_candidates);
+        completer->m_candidates = candidates;
+        completer->m_candidates.m_prefix = NULL;
+        completer->m_result = completer->m_fetching;
+        completer->m_has_result = true;
+        completer->m_fetched_ms = GetMonotonicMs();
+        strcpy(completer->m_narrowed, completer->m_result.m_prefix);
+        completer->m_lo = 0;
+        completer->m_hi = candidates.m_sorted_num;
+        completer->m_is_fetching = false;
+        pthread_cond_broadcast(&completer->m_cond);
+    }
+    pthread_mutex_unlock(&completer->m_mutex);
+    return NULL;
+}
+
+/**
+ * Lookup
+ */
+
+static bool IsSameQuery(const NNCli_ArgQuery_t *a_query,
+                        NNCli_CompleteArgsFunc_t a_func, const char *a_head,
+                        const char *a_prefix)
+{
+    return a_query->m_func == a_func && strcmp(a_query->m_head, a_head) == 0 &&
+           StartsWith(a_prefix, a_query->m_prefix);
+}
+
+static bool HasResult(const NNCli_ArgCompleter_t *a_completer,
+                      NNCli_CompleteArgsFunc_t a_func, const char *a_head,
+                      const char *a_prefix)
+{
+    return a_completer->m_has_result &&
+           IsSameQuery(&a_completer->m_result, a_func, a_head, a_prefix) &&
+           GetMonotonicMs() - a_completer->m_fetched_ms <
+               a_completer->m_ttl_ms;
+}
+
+// The first index in [a_lo, a_hi) whose candidate is not less than `a_prefix`,
+// or not less than anything starting with it if `a_is_upper`.
+static size_t SearchCandidates(const char **a_sorted, size_t a_lo,
+                               size_t a_hi, const char *a_prefix,
+                               bool a_is_upper)
+{
+    size_t len = strlen(a_prefix);
+    while (a_lo < a_hi)
+    {
+        size_t mid = a_lo + (a_hi - a_lo) / 2;
+        int cmp = strncmp(a_sorted[mid], a_prefix, a_is_upper ? len : SIZE_MAX);
+        if (cmp < 0 || (a_is_upper && cmp == 0))
+        {
+            a_lo = mid + 1;
+        }
+        else
+        {
+            a_hi = mid;
+        }
+    }
+    return a_lo;
+}
+
+// Narrows the previous range if the prefix has been extended since then.
+static void Narrow(NNCli_ArgCompleter_t *a_completer, const char *a_prefix)
+{
+    const char **sorted = a_completer->m_candidates.m_sorted;
+    size_t lo = 0;
+    size_t hi = a_completer->m_candidates.m_sorted_num;
+
+    if (StartsWith(a_prefix, a_completer->m_narrowed))
+    {
+        lo = a_completer->m_lo;
+        hi = a_completer->m_hi;
+    }
+    lo = SearchCandidates(sorted, lo, hi, a_prefix, false);
+    hi = SearchCandidates(sorted, lo, hi, a_prefix, true);
+
+    strcpy(a_completer->m_narrowed, a_prefix);
+    a_completer->m_lo = lo;
+    a_completer->m_hi = hi;
+}
+
+static void AddCompletions(const NNCli_ArgCompleter_t *a_completer,
+                           const char *a_prefix, size_t a_max_num,
+                           NNCli_ArgCompletionAdd_t a_add, void *a_ctx)
+{
+    const char **sorted = a_completer->m_candidates.m_sorted;
+    size_t lo = a_completer->m_lo;
+    size_t hi = a_completer->m_hi;
+    size_t common = 0;
+
+    if (hi - lo > a_max_num)
+    {
+        // The common prefix of a sorted range is that of its ends.
+        while (sorted[lo][common] != '\0' &&
+               sorted[lo][common] == sorted[hi - 1][common])
+        {
+            common++;
+        }
+        if (common > strlen(a_prefix))
+        {
+            a_add(a_ctx, sorted[lo], common);
+            return;
+        }
+        hi = lo + a_max_num;
+    }
+    for (size_t i = lo; i < hi; i++)
+    {
+        a_add(a_ctx, sorted[i], strlen(sorted[i]));
+    }
+}
+
+static void WaitForFetch(NNCli_ArgCompleter_t *a_completer)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += a_completer->m_wait_ms / 1000;
+    deadline.tv_nsec += (long)(a_completer->m_wait_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while (a_completer->m_has_request || a_completer->m_is_fetching)
+    {
+        if (pthread_cond_timedwait(&a_completer->m_cond, &a_completer->m_mutex,
+                                   &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+}
+
+void NNCli_ArgCompleterInit(NNCli_ArgCompleter_t *a_completer,
+                            uint32_t a_wait_ms, uint32_t a_ttl_ms)
+{
+    pthread_condattr_t attr;
+
+    memset(a_completer, 0, sizeof(*a_completer));
+    a_completer->m_wait_ms = a_wait_ms;
+    a_completer->m_ttl_ms = a_ttl_ms;
+    pthread_mutex_init(&a_completer->m_mutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&a_completer->m_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void NNCli_ArgCompleterDestroy(NNCli_ArgCompleter_t *a_completer)
+{
+    if (a_completer->m_is_started)
+    {
+        pthread_mutex_lock(&a_completer->m_mutex);
+        a_completer->m_is_stopping = true;
+        pthread_cond_broadcast(&a_completer->m_cond);
+        pthread_mutex_unlock(&a_completer->m_mutex);
+        pthread_join(a_completer->m_thread, NULL);
+    }
+    FreeCandidates(&a_completer->m_candidates);
+    pthread_cond_destroy(&a_completer->m_cond);
+    pthread_mutex_destroy(&a_completer->m_mutex);
+    memset(a_completer, 0, sizeof(*a_completer));
+}
+
+NNCli_Err_t NNCli_ArgCompleterLookup(NNCli_ArgCompleter_t *a_completer,
+                                     NNCli_CompleteArgsFunc_t a_func,
+                                     const char *a_head, const char *a_prefix,
+                                     size_t a_max_num,
+                                     NNCli_ArgCompletionAdd_t a_add,
+                                     void *a_ctx)
+{
+    NNCli_Err_t res = NN_CLI__SUCCESS;
+
+    if (strlen(a_head) >= NN_CLI__LINE_MAX_LEN ||
+        strlen(a_prefix) >= NN_CLI__LINE_MAX_LEN)
+    {
+        return NN_CLI__EXCEED_CAPACITY;
+    }
+
+    pthread_mutex_lock(&a_completer->m_mutex);
+    if (!HasResult(a_completer, a_func, a_head, a_prefix))
+    {
+        // A fetch which will have the candidates is waited for instead of
+        // being posted again.
+        if (!(a_completer->m_is_fetching &&
+              IsSameQuery(&a_completer->m_fetching, a_func, a_head,
+                          a_prefix)))
+        {
+            a_completer->m_request.m_func = a_func;
+            strcpy(a_completer->m_request.m_head, a_head);
+            strcpy(a_completer->m_request.m_prefix, a_prefix);
+            a_completer->m_has_request = true;
+            pthread_cond_broadcast(&a_completer->m_cond);
+        }
+        if (!a_completer->m_is_started)
+        {
+            if (pthread_create(&a_completer->m_thread, NULL, RunWorker,
+                               a_completer) != 0)
+            {
+                NNCli_LogError("Failed to start the completion thread");
+                res = NN_CLI__GENERAL_ERROR;
+                goto done;
+            }
+            a_completer->m_is_started = true;
+        }
+        WaitForFetch(a_completer);
+    }
+
+    res = NN_CLI__IN_PROGRESS;
+    if (HasResult(a_completer, a_func, a_head, a_prefix))
+    {
+        Narrow(a_completer, a_prefix);
+        AddCompletions(a_completer, a_prefix, a_max_num, a_add, a_ctx);
+        res = NN_CLI__SUCCESS;
+    }
+
+done:
+    pthread_mutex_unlock(&a_completer->m_mutex);
+    return res;
+}
@@ -0,0 +1,290 @@
+#include "nn_cli_history.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "check_config.h"
+
+// Entries longer than this are skipped.
+#define READ_BUF_LEN (NN_CLI__LINE_MAX_LEN + 1)
+
+// Reads the complete entries after `m_offset`. An entry being appended by a
+// writer which does not lock the file is read when its newline arrives.
+static void ReadTail(NNCli_SharedHistory_t *a_history)
+{
+    char buf[READ_BUF_LEN];
+    struct stat st;
+
+    if (fstat(a_history->m_fd, &st) == 0 && st.st_size < a_history->m_offset)
+    {
+        // Someone has truncated or rewritten the file. Only what is appended
+        // after this is read.
+        a_history->m_offset = st.st_size;
+    }
+    if (a_history->m_offset > 0 && !a_history->m_is_skipping &&
+        pread(a_history->m_fd, buf, 1, a_history->m_offset - 1) == 1 &&
+        buf[0] != '\n')
+    {
+        // The file has been compacted, and the offset is in an entry now.
+        a_history->m_is_skipping = true;
+    }
+
+    for (;;)
+    {
+        ssize_t len =
+            pread(a_history->m_fd, buf, sizeof(buf), a_history->m_offset);
+        if (len <= 0)
+        {
+            break;
+        }
+
+        size_t start = 0;
+        for (size_t i = 0; i < (size_t)len; i++)
+        {
+            if (buf[i] != '\n')
+            {
+                continue;
+            }
+            buf[i] = '\0';
+            if (!a_history->m_is_skipping && i > start)
+            {
+                a_history->m_add(a_history->m_ctx, &buf[start]);
+                a_history->m_entry_num++;
+            }
+            a_history->m_is_skipping = false;
+            start = i + 1;
+        }
+
+        if (start == 0)
+        {
+            if ((size_t)len < sizeof(buf))
+            {
+                break;
+            }
+            a_history->m_is_skipping = true;
+            start = len;
+        }
+        a_history->m_offset += start;
+    }
+}
+
+// The offset of the last `a_entry_num` entries before `a_end`.
+static off_t FindTail(int a_fd, off_t a_end, size_t a_entry_num)
+{
+    char buf[READ_BUF_LEN];
+    off_t pos = a_end;
+    size_t newline_num = 0;
+
+    while (pos > 0)
+    {
+        size_t len = (pos < (off_t)sizeof(buf)) ? (size_t)pos : sizeof(buf);
+        pos -= len;
+        if (pread(a_fd, buf, len, pos) != (ssize_t)len)
+        {
+            break;
+        }
+        for (size_t i = len; i-- > 0;)
+        {
+            // The first newline is the end of the last entry.
+            if (buf[i] == '\n' && ++newline_num > a_entry_num)
+            {
+                return pos + i + 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Moves the last `a_max_num` entries to the beginning of the file. Call this
+// under the exclusive lock. The file is written through another descriptor,
+// since pwrite() ignores the offset with O_APPEND. If this is interrupted,
+// the file has some entries twice, but none is lost.
+static void Compact(NNCli_SharedHistory_t *a_history, const char *a_filename,
+                    size_t a_max_num)
+{
+    char buf[READ_BUF_LEN];
+    struct stat st;
+    off_t from;
+    off_t done = 0;
+    int fd;
+
+    if (fstat(a_history->m_fd, &st) != 0)
+    {
+        return;
+    }
+    from = FindTail(a_history->m_fd, a_history->m_offset, a_max_num);
+    fd = open(a_filename, O_WRONLY | O_CLOEXEC);
+    if (from == 0 || fd < 0)
+    {
+        goto done;
+    }
+
+    // A partial entry after the offset is kept too.
+    while (from + done < st.st_size)
+    {
+        ssize_t len = pread(a_history->m_fd, buf, sizeof(buf), from + done);
+        if (len <= 0 || pwrite(fd, buf, len, done) != len)
+        {
+            NNCli_LogError("Failed to compact the history: %s",
+                           strerror(errno));
+            goto done;
+        }
+        done += len;
+    }
+    if (ftruncate(fd, done) == 0)
+    {
+        a_history->m_offset -= from;
+    }
+
+done:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+// Returns true if the file may have grown since it was read last time.
+static bool IsModified(NNCli_SharedHistory_t *a_history)
+{
+    struct inotify_event events[8];
+    bool is_modified = false;
+
+    if (a_history->m_inotify_fd < 0)
+    {
+        struct stat st;
+        return fstat(a_history->m_fd, &st) != 0 ||
+               st.st_size != a_history->m_offset;
+    }
+
+    while (read(a_history->m_inotify_fd, events, sizeof(events)) > 0)
+    {
+        is_modified = true;
+    }
+    return is_modified;
+}
+
+NNCli_Err_t NNCli_SharedHistoryOpen(NNCli_SharedHistory_t *a_history,
+                                    const char *a_filename, size_t a_max_num,
+                                    NNCli_SharedHistoryAdd_t a_add,
+                                    void *a_ctx)
+{
+    if (a_history == NULL || a_filename == NULL || a_add == NULL)
+    {
+        NNCli_LogError("An invalid shared history");
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    memset(a_history, 0, sizeof(*a_history));
+    a_history->m_add = a_add;
+    a_history->m_ctx = a_ctx;
+    a_history->m_fd =
+        open(a_filename, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (a_history->m_fd < 0)
+    {
+        NNCli_LogError("Failed to open %s: %s", a_filename, strerror(errno));
+        return NN_CLI__GENERAL_ERROR;
+    }
+
+    // Watched before reading so that no append is missed in between.
+    a_history->m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (a_history->m_inotify_fd >= 0 &&
+        inotify_add_watch(a_history->m_inotify_fd, a_filename, IN_MODIFY) < 0)
+    {
+        close(a_history->m_inotify_fd);
+        a_history->m_inotify_fd = -1;
+    }
+    if (a_history->m_inotify_fd < 0)
+    {
+        NNCli_LogWarn("inotify is not available for %s", a_filename);
+    }
+
+    flock(a_history->m_fd, LOCK_EX);
+    ReadTail(a_history);
+    if (a_max_num > 0 && a_history->m_entry_num >
+                             a_max_num * NN_CLI__SHARED_HISTORY_COMPACT_FACTOR)
+    {
+        Compact(a_history, a_filename, a_max_num);
+    }
+    flock(a_history->m_fd, LOCK_UN);
+    return NN_CLI__SUCCESS;
+}
+
+void NNCli_SharedHistoryClose(NNCli_SharedHistory_t *a_history)
+{
+    if (a_history->m_inotify_fd >= 0)
+    {
+        close(a_history->m_inotify_fd);
+    }
+    if (a_history->m_fd >= 0)
+    {
+        close(a_history->m_fd);
+    }
+    a_history->m_fd = -1;
+    a_history->m_inotify_fd = -1;
+}
+
+void NNCli_SharedHistoryMerge(NNCli_SharedHistory_t *a_history)
+{
+    if (a_history->m_fd < 0 || !IsModified(a_history))
+    {
+        return;
+    }
+
+    // Appends are done under the exclusive lock, so no half of an entry is
+    // read.
+    flock(a_history->m_fd, LOCK_SH);
+    ReadTail(a_history);
+    flock(a_history->m_fd, LOCK_UN);
+}
+
+NNCli_Err_t NNCli_SharedHistoryAppend(NNCli_SharedHistory_t *a_history,
+                                      const char *a_line)
+{
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+    size_t len = strlen(a_line);
+    char buf[READ_BUF_LEN];
+    struct stat st;
+
+    if (a_history->m_fd < 0 || len + 1 > sizeof(buf) ||
+        strchr(a_line, '\n') != NULL)
+    {
+        goto done;
+    }
+    // One write() keeps the entry in one piece.
+    memcpy(buf, a_line, len);
+    buf[len] = '\n';
+
+    res = NN_CLI__GENERAL_ERROR;
+    if (flock(a_history->m_fd, LOCK_EX) != 0)
+    {
+        NNCli_LogError("Failed to lock the history: %s", strerror(errno));
+        goto done;
+    }
+
+    ReadTail(a_history);
+    if (write(a_history->m_fd, buf, len + 1) == (ssize_t)(len + 1))
+    {
+        res = NN_CLI__SUCCESS;
+    }
+    else
+    {
+        NNCli_LogError("Failed to append to the history: %s",
+                       strerror(errno));
+    }
+    // The own entry is not read back.
+    if (fstat(a_history->m_fd, &st) == 0)
+    {
+        a_history->m_offset = st.st_size;
+    }
+
+    flock(a_history->m_fd, LOCK_UN);
+
+done:
+    return res;
+}
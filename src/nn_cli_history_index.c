@@ -0,0 +1,375 @@
+#include "nn_cli_history_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "nn_cli_alloc.h"
+
+// Up to this number of new lines are inserted one by one. More are merged by
+// sorting all the entries.
+#define HISTORY_INDEX_INSERT_MAX_NUM 8
+// The first allocation of the entries.
+#define HISTORY_INDEX_MIN_CAPACITY 16
+// The number of entries in a block of `m_block_seqs`.
+#define HISTORY_INDEX_BLOCK_LEN 64
+
+static int CompareEntries(const void *a_lhs, const void *a_rhs)
+{
+    const NNCli_HistoryIndexEntry_t *lhs =
+        (const NNCli_HistoryIndexEntry_t *)a_lhs;
+    const NNCli_HistoryIndexEntry_t *rhs =
+        (const NNCli_HistoryIndexEntry_t *)a_rhs;
+    int cmp = strcmp(lhs->m_line, rhs->m_line);
+    if (cmp != 0)
+    {
+        return cmp;
+    }
+    // The most recent one of the same lines comes first and is kept.
+    return (lhs->m_seq < rhs->m_seq) ? 1 : (lhs->m_seq > rhs->m_seq) ? -1 : 0;
+}
+
+static int CompareSeqs(const void *a_lhs, const void *a_rhs)
+{
+    uint64_t lhs = *(const uint64_t *)a_lhs;
+    uint64_t rhs = *(const uint64_t *)a_rhs;
+    return (lhs < rhs) ? -1 : (lhs > rhs) ? 1 : 0;
+}
+
+// The first sorted entry which is not less than `a_line`.
+static size_t LowerBound(const NNCli_HistoryIndex_t *a_index,
+                         const char *a_line)
+{
+    size_t low = 0;
+    size_t high = a_index->m_sorted_num;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (strcmp(a_index->m_entries[mid].m_line, a_line) < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// The first sorted entry from `a_from` which does not start with `a_prefix`.
+// The entries from `a_from` are not less than `a_prefix`, so the ones which
+// start with it come first.
+static size_t PrefixEnd(const NNCli_HistoryIndex_t *a_index, size_t a_from,
+                        const char *a_prefix, size_t a_prefix_len)
+{
+    size_t low = a_from;
+    size_t high = a_index->m_sorted_num;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (strncmp(a_index->m_entries[mid].m_line, a_prefix, a_prefix_len) ==
+            0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void InsertOne(NNCli_HistoryIndex_t *a_index)
+{
+    NNCli_HistoryIndexEntry_t *entries = a_index->m_entries;
+    NNCli_HistoryIndexEntry_t entry = entries[a_index->m_sorted_num];
+    size_t pos = LowerBound(a_index, entry.m_line);
+
+    if (pos < a_index->m_sorted_num &&
+        strcmp(entries[pos].m_line, entry.m_line) == 0)
+    {
+        // The line is already there, and is now the most recent.
+        entries[pos].m_seq = entry.m_seq;
+        NNCli_Free(entry.m_line);
+        a_index->m_num--;
+        memmove(&entries[a_index->m_sorted_num],
+                &entries[a_index->m_sorted_num + 1],
+                (a_index->m_num - a_index->m_sorted_num) * sizeof(entry));
+        return;
+    }
+
+    memmove(&entries[pos + 1], &entries[pos],
+            (a_index->m_sorted_num - pos) * sizeof(entry));
+    entries[pos] = entry;
+    a_index->m_sorted_num++;
+}
+
+static void SortAll(NNCli_HistoryIndex_t *a_index)
+{
+    NNCli_HistoryIndexEntry_t *entries = a_index->m_entries;
+    size_t num = 0;
+
+    qsort(entries, a_index->m_num, sizeof(entries[0]), CompareEntries);
+    for (size_t i = 0; i < a_index->m_num; i++)
+    {
+        if (num > 0 && strcmp(entries[num - 1].m_line, entries[i].m_line) == 0)
+        {
+            NNCli_Free(entries[i].m_line);
+            continue;
+        }
+        entries[num++] = entries[i];
+    }
+    a_index->m_num = num;
+    a_index->m_sorted_num = num;
+}
+
+// Drops the oldest entries over `m_max_num`. The sequence numbers are unique,
+// so the entries up to the threshold are exactly the ones to drop.
+static void DropOldest(NNCli_HistoryIndex_t *a_index)
+{
+    NNCli_HistoryIndexEntry_t *entries = a_index->m_entries;
+    size_t drop_num;
+    uint64_t *seqs;
+    uint64_t threshold;
+    size_t num = 0;
+
+    if (a_index->m_num <= a_index->m_max_num)
+    {
+        return;
+    }
+
+    drop_num = a_index->m_num - a_index->m_max_num;
+    if (drop_num == 1)
+    {
+        // The common case, one line added to a full index.
+        size_t oldest = 0;
+        for (size_t i = 1; i < a_index->m_num; i++)
+        {
+            if (entries[i].m_seq < entries[oldest].m_seq)
+            {
+                oldest = i;
+            }
+        }
+        NNCli_Free(entries[oldest].m_line);
+        a_index->m_num--;
+        memmove(&entries[oldest], &entries[oldest + 1],
+                (a_index->m_num - oldest) * sizeof(entries[0]));
+        a_index->m_sorted_num = a_index->m_num;
+        return;
+    }
+
+    seqs = (uint64_t *)NNCli_Malloc(a_index->m_num * sizeof(uint64_t));
+    if (seqs == NULL)
+    {
+        // They are dropped at the next merge.
+        return;
+    }
+    for (size_t i = 0; i < a_index->m_num; i++)
+    {
+        seqs[i] = entries[i].m_seq;
+    }
+    qsort(seqs, a_index->m_num, sizeof(seqs[0]), CompareSeqs);
+    threshold = seqs[drop_num - 1];
+    NNCli_Free(seqs);
+
+    for (size_t i = 0; i < a_index->m_num; i++)
+    {
+        if (entries[i].m_seq <= threshold)
+        {
+            NNCli_Free(entries[i].m_line);
+            continue;
+        }
+        entries[num++] = entries[i];
+    }
+    a_index->m_num = num;
+    a_index->m_sorted_num = num;
+}
+
+static void BuildBlocks(NNCli_HistoryIndex_t *a_index)
+{
+    size_t block_num = (a_index->m_sorted_num + HISTORY_INDEX_BLOCK_LEN - 1) /
+                       HISTORY_INDEX_BLOCK_LEN;
+
+    if (block_num > a_index->m_block_capacity)
+    {
+        uint64_t *block_seqs = (uint64_t *)NNCli_Realloc(
+            a_index->m_block_seqs, block_num * 2 * sizeof(uint64_t));
+        if (block_seqs == NULL)
+        {
+            // The entries are visited one by one.
+            a_index->m_block_num = 0;
+            return;
+        }
+        a_index->m_block_seqs = block_seqs;
+        a_index->m_block_capacity = block_num * 2;
+    }
+
+    memset(a_index->m_block_seqs, 0, block_num * sizeof(uint64_t));
+    for (size_t i = 0; i < a_index->m_sorted_num; i++)
+    {
+        uint64_t *block_seq =
+            &a_index->m_block_seqs[i / HISTORY_INDEX_BLOCK_LEN];
+        if (a_index->m_entries[i].m_seq > *block_seq)
+        {
+            *block_seq = a_index->m_entries[i].m_seq;
+        }
+    }
+    a_index->m_block_num = block_num;
+}
+
+// The index of the most recent entry in [a_begin, a_end), which is not empty.
+static size_t FindMostRecent(const NNCli_HistoryIndex_t *a_index,
+                             size_t a_begin, size_t a_end)
+{
+    const NNCli_HistoryIndexEntry_t *entries = a_index->m_entries;
+    size_t best = a_begin;
+    size_t i = a_begin;
+
+    while (i < a_end)
+    {
+        size_t block = i / HISTORY_INDEX_BLOCK_LEN;
+        size_t block_end = (block + 1) * HISTORY_INDEX_BLOCK_LEN;
+        if (i % HISTORY_INDEX_BLOCK_LEN == 0 && block_end <= a_end &&
+            block < a_index->m_block_num)
+        {
+            // The whole block is in the range. Its entries are only visited
+            // if it has a more recent one.
+            if (a_index->m_block_seqs[block] > entries[best].m_seq)
+            {
+                for (size_t j = i; j < block_end; j++)
+                {
+                    if (entries[j].m_seq > entries[best].m_seq)
+                    {
+                        best = j;
+                    }
+                }
+            }
+            i = block_end;
+            continue;
+        }
+        if (entries[i].m_seq > entries[best].m_seq)
+        {
+            best = i;
+        }
+        i++;
+    }
+    return best;
+}
+
+static void Merge(NNCli_HistoryIndex_t *a_index)
+{
+    if (a_index->m_sorted_num == a_index->m_num)
+    {
+        return;
+    }
+
+    if (a_index->m_num - a_index->m_sorted_num <= HISTORY_INDEX_INSERT_MAX_NUM)
+    {
+        while (a_index->m_sorted_num < a_index->m_num)
+        {
+            InsertOne(a_index);
+        }
+    }
+    else
+    {
+        SortAll(a_index);
+    }
+    DropOldest(a_index);
+    BuildBlocks(a_index);
+}
+
+void NNCli_HistoryIndexInit(NNCli_HistoryIndex_t *a_index, size_t a_max_num)
+{
+    memset(a_index, 0, sizeof(*a_index));
+    a_index->m_max_num = a_max_num;
+}
+
+void NNCli_HistoryIndexDestroy(NNCli_HistoryIndex_t *a_index)
+{
+    for (size_t i = 0; i < a_index->m_num; i++)
+    {
+        NNCli_Free(a_index->m_entries[i].m_line);
+    }
+    NNCli_Free(a_index->m_entries);
+    NNCli_Free(a_index->m_block_seqs);
+    memset(a_index, 0, sizeof(*a_index));
+}
+
+NNCli_Err_t NNCli_HistoryIndexAdd(NNCli_HistoryIndex_t *a_index,
+                                  const char *a_line)
+{
+    char *line;
+
+    if (a_index->m_max_num == 0)
+    {
+        return NN_CLI__NOT_READY;
+    }
+
+    // A long run of lines without lookups, e.g. a history file being loaded,
+    // is merged on the way so that it does not keep more than twice the
+    // limit.
+    if (a_index->m_num >= a_index->m_max_num * 2)
+    {
+        Merge(a_index);
+    }
+
+    if (a_index->m_num == a_index->m_capacity)
+    {
+        size_t capacity = (a_index->m_capacity < HISTORY_INDEX_MIN_CAPACITY)
+                              ? HISTORY_INDEX_MIN_CAPACITY
+                              : a_index->m_capacity * 2;
+        NNCli_HistoryIndexEntry_t *entries =
+            (NNCli_HistoryIndexEntry_t *)NNCli_Realloc(
+                a_index->m_entries, capacity * sizeof(entries[0]));
+        if (entries == NULL)
+        {
+            return NN_CLI__EXCEED_CAPACITY;
+        }
+        a_index->m_entries = entries;
+        a_index->m_capacity = capacity;
+    }
+
+    line = NNCli_Strdup(a_line);
+    if (line == NULL)
+    {
+        return NN_CLI__EXCEED_CAPACITY;
+    }
+    a_index->m_entries[a_index->m_num].m_line = line;
+    a_index->m_entries[a_index->m_num].m_seq = a_index->m_next_seq++;
+    a_index->m_num++;
+    return NN_CLI__SUCCESS;
+}
+
+const char *NNCli_HistoryIndexSuggest(NNCli_HistoryIndex_t *a_index,
+                                      const char *a_prefix)
+{
+    size_t prefix_len = strlen(a_prefix);
+    size_t begin;
+    size_t end;
+
+    if (prefix_len == 0)
+    {
+        return NULL;
+    }
+
+    Merge(a_index);
+    begin = LowerBound(a_index, a_prefix);
+    end = PrefixEnd(a_index, begin, a_prefix, prefix_len);
+    // The prefix itself sorts first, and is not suggested.
+    if (begin < end && a_index->m_entries[begin].m_line[prefix_len] == '\0')
+    {
+        begin++;
+    }
+    if (begin == end)
+    {
+        return NULL;
+    }
+    return a_index->m_entries[FindMostRecent(a_index, begin, end)].m_line;
+}
+
+size_t NNCli_HistoryIndexGetNum(NNCli_HistoryIndex_t *a_index)
+{
+    Merge(a_index);
+    return a_index->m_num;
+}
@@ -0,0 +1,586 @@
+#include "nn_cli_line_editor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nn_cli_alloc.h"
+
+// The first allocation of a growable buffer.
+#define LINE_EDITOR_MIN_BUF_SIZE 64
+
+enum
+{
+    ESCAPE_NONE,
+    ESCAPE_STARTED,  // ESC
+    ESCAPE_CSI,      // ESC [
+    ESCAPE_SS3,      // ESC O
+};
+
+enum
+{
+    KEY_CTRL_A = 1,
+    KEY_CTRL_B = 2,
+    KEY_CTRL_C = 3,
+    KEY_CTRL_D = 4,
+    KEY_CTRL_E = 5,
+    KEY_CTRL_F = 6,
+    KEY_BACKSPACE_ASCII = 8,
+    KEY_LINE_FEED = 10,
+    KEY_CTRL_K = 11,
+    KEY_ENTER = 13,
+    KEY_CTRL_U = 21,
+    KEY_CTRL_W = 23,
+    KEY_ESC = 27,
+    KEY_BACKSPACE = 127,
+};
+
+static void Write(const NNCli_LineEditor_t *a_editor, const char *a_data,
+                  size_t a_len)
+{
+    if (a_len > 0)
+    {
+        a_editor->m_write(a_editor->m_ctx, a_data, a_len);
+    }
+}
+
+static void WriteString(const NNCli_LineEditor_t *a_editor, const char *a_str)
+{
+    Write(a_editor, a_str, strlen(a_str));
+}
+
+static char CharAt(const NNCli_LineEditor_t *a_editor, size_t a_pos)
+{
+    return (a_pos < a_editor->m_gap_start)
+               ? a_editor->m_buf[a_pos]
+               : a_editor->m_buf[a_pos + a_editor->m_gap_end -
+                                 a_editor->m_gap_start];
+}
+
+// Writes the characters in [a_from, a_to) of the line.
+static void WriteRange(const NNCli_LineEditor_t *a_editor, size_t a_from,
+                       size_t a_to)
+{
+    size_t gap_len = a_editor->m_gap_end - a_editor->m_gap_start;
+    if (a_from < a_editor->m_gap_start)
+    {
+        size_t end = (a_to < a_editor->m_gap_start) ? a_to
+                                                    : a_editor->m_gap_start;
+        Write(a_editor, &a_editor->m_buf[a_from], end - a_from);
+        a_from = end;
+    }
+    if (a_from < a_to)
+    {
+        Write(a_editor, &a_editor->m_buf[a_from + gap_len], a_to - a_from);
+    }
+}
+
+// The number of characters shown after the prompt. 0 if all are shown.
+static size_t GetVisibleWidth(const NNCli_LineEditor_t *a_editor)
+{
+    size_t prompt_len = strlen(a_editor->m_prompt);
+    if (a_editor->m_columns == 0)
+    {
+        return 0;
+    }
+    // The last column is left for the cursor.
+    return (a_editor->m_columns > prompt_len + 1)
+               ? a_editor->m_columns - prompt_len - 1
+               : 1;
+}
+
+// The hint for the line, or NULL. Hints are only shown while the cursor is at
+// the end of the line.
+static const char *GetHint(NNCli_LineEditor_t *a_editor)
+{
+    if (a_editor->m_hint == NULL || a_editor->m_len == 0 ||
+        a_editor->m_pos != a_editor->m_len)
+    {
+        return NULL;
+    }
+    return a_editor->m_hint(a_editor->m_hint_ctx,
+                            NNCli_LineEditorGetLine(a_editor));
+}
+
+// Writes the part of the hint which fits on the screen after the line, and
+// returns its length.
+static size_t WriteHint(NNCli_LineEditor_t *a_editor, const char *a_hint)
+{
+    size_t width = GetVisibleWidth(a_editor);
+    size_t len = strlen(a_hint);
+
+    if (width != 0)
+    {
+        size_t shown_len = a_editor->m_len - a_editor->m_scroll;
+        size_t room = (width > shown_len) ? width - shown_len : 0;
+        if (len > room)
+        {
+            len = room;
+        }
+    }
+    if (len > 0)
+    {
+        WriteString(a_editor, "\x1b[90m");
+        Write(a_editor, a_hint, len);
+        WriteString(a_editor, "\x1b[0m");
+    }
+    return len;
+}
+
+// Erases the hint on the screen. The cursor is at the end of the line while
+// it is shown.
+static void EraseHint(NNCli_LineEditor_t *a_editor)
+{
+    if (a_editor->m_hint_len > 0)
+    {
+        WriteString(a_editor, "\x1b[0K");
+        a_editor->m_hint_len = 0;
+    }
+}
+
+// Redraws the prompt and the line, and moves the cursor to `m_pos`. If the
+// line is wider than the terminal, only the part around the cursor is drawn.
+static void Refresh(NNCli_LineEditor_t *a_editor)
+{
+    char seq[32];
+    size_t width = GetVisibleWidth(a_editor);
+    size_t end = a_editor->m_len;
+    const char *hint;
+
+    if (width == 0)
+    {
+        a_editor->m_scroll = 0;
+    }
+    else
+    {
+        if (a_editor->m_pos < a_editor->m_scroll)
+        {
+            a_editor->m_scroll = a_editor->m_pos;
+        }
+        else if (a_editor->m_pos > a_editor->m_scroll + width)
+        {
+            a_editor->m_scroll = a_editor->m_pos - width;
+        }
+        if (end > a_editor->m_scroll + width)
+        {
+            end = a_editor->m_scroll + width;
+        }
+    }
+
+    WriteString(a_editor, "\r");
+    WriteString(a_editor, a_editor->m_prompt);
+    WriteRange(a_editor, a_editor->m_scroll, end);
+    WriteString(a_editor, "\x1b[0K");
+    hint = GetHint(a_editor);
+    a_editor->m_hint_len = (hint != NULL) ? WriteHint(a_editor, hint) : 0;
+
+    size_t column =
+        strlen(a_editor->m_prompt) + a_editor->m_pos - a_editor->m_scroll;
+    WriteString(a_editor, "\r");
+    if (column > 0)
+    {
+        snprintf(seq, sizeof(seq), "\x1b[%zuC", column);
+        WriteString(a_editor, seq);
+    }
+}
+
+static void MoveGap(NNCli_LineEditor_t *a_editor, size_t a_pos)
+{
+    char *buf = a_editor->m_buf;
+    if (a_pos < a_editor->m_gap_start)
+    {
+        size_t num = a_editor->m_gap_start - a_pos;
+        memmove(&buf[a_editor->m_gap_end - num], &buf[a_pos], num);
+        a_editor->m_gap_start -= num;
+        a_editor->m_gap_end -= num;
+    }
+    else if (a_pos > a_editor->m_gap_start)
+    {
+        size_t num = a_pos - a_editor->m_gap_start;
+        memmove(&buf[a_editor->m_gap_start], &buf[a_editor->m_gap_end], num);
+        a_editor->m_gap_start += num;
+        a_editor->m_gap_end += num;
+    }
+}
+
+// Makes room for one more character and the null terminator. The buffer is
+// doubled, so typing is amortized O(1) however long the line is.
+static bool ReserveGap(NNCli_LineEditor_t *a_editor)
+{
+    size_t tail_len = a_editor->m_buf_size - a_editor->m_gap_end;
+    size_t buf_size;
+    char *buf;
+
+    if (a_editor->m_gap_end - a_editor->m_gap_start >= 2)
+    {
+        return true;
+    }
+    if (!a_editor->m_is_growable)
+    {
+        return false;
+    }
+
+    buf_size = (a_editor->m_buf_size < LINE_EDITOR_MIN_BUF_SIZE / 2)
+                   ? LINE_EDITOR_MIN_BUF_SIZE
+                   : a_editor->m_buf_size * 2;
+    buf = (char *)NNCli_Realloc(a_editor->m_buf, buf_size);
+    if (buf == NULL)
+    {
+        return false;
+    }
+    memmove(&buf[buf_size - tail_len], &buf[a_editor->m_gap_end], tail_len);
+    a_editor->m_buf = buf;
+    a_editor->m_buf_size = buf_size;
+    a_editor->m_gap_end = buf_size - tail_len;
+    return true;
+}
+
+// Replaces the hint after the character just typed at the end of the line.
+static void UpdateHint(NNCli_LineEditor_t *a_editor)
+{
+    char seq[32];
+    const char *hint = GetHint(a_editor);
+
+    if (hint == NULL)
+    {
+        EraseHint(a_editor);
+        return;
+    }
+
+    WriteString(a_editor, "\x1b[0K");
+    a_editor->m_hint_len = WriteHint(a_editor, hint);
+    if (a_editor->m_hint_len > 0)
+    {
+        snprintf(seq, sizeof(seq), "\x1b[%zuD", a_editor->m_hint_len);
+        WriteString(a_editor, seq);
+    }
+}
+
+static void Insert(NNCli_LineEditor_t *a_editor, char a_c)
+{
+    if (!ReserveGap(a_editor))
+    {
+        return;
+    }
+
+    MoveGap(a_editor, a_editor->m_pos);
+    a_editor->m_buf[a_editor->m_gap_start++] = a_c;
+    a_editor->m_len++;
+    a_editor->m_pos++;
+
+    if (a_editor->m_pos == a_editor->m_len &&
+        (a_editor->m_columns == 0 ||
+         a_editor->m_pos <= a_editor->m_scroll + GetVisibleWidth(a_editor)))
+    {
+        // Typing at the end of the line is the common case, so only the
+        // character and the hint are written.
+        Write(a_editor, &a_c, 1);
+        UpdateHint(a_editor);
+    }
+    else
+    {
+        Refresh(a_editor);
+    }
+}
+
+// Deletes `a_num` characters before `m_pos`.
+static void DeleteBefore(NNCli_LineEditor_t *a_editor, size_t a_num)
+{
+    if (a_num == 0)
+    {
+        return;
+    }
+
+    MoveGap(a_editor, a_editor->m_pos);
+    a_editor->m_gap_start -= a_num;
+    a_editor->m_pos -= a_num;
+    a_editor->m_len -= a_num;
+    Refresh(a_editor);
+}
+
+// Deletes `a_num` characters from `m_pos`.
+static void DeleteAfter(NNCli_LineEditor_t *a_editor, size_t a_num)
+{
+    if (a_num == 0)
+    {
+        return;
+    }
+
+    MoveGap(a_editor, a_editor->m_pos);
+    a_editor->m_gap_end += a_num;
+    a_editor->m_len -= a_num;
+    Refresh(a_editor);
+}
+
+static void Clear(NNCli_LineEditor_t *a_editor)
+{
+    a_editor->m_len = 0;
+    a_editor->m_pos = 0;
+    a_editor->m_scroll = 0;
+    a_editor->m_hint_len = 0;
+    a_editor->m_gap_start = 0;
+    a_editor->m_gap_end = a_editor->m_buf_size;
+}
+
+static void MoveCursor(NNCli_LineEditor_t *a_editor, size_t a_pos)
+{
+    if (a_pos != a_editor->m_pos)
+    {
+        a_editor->m_pos = a_pos;
+        Refresh(a_editor);
+    }
+}
+
+// Appends the hint to the line.
+static void AcceptHint(NNCli_LineEditor_t *a_editor)
+{
+    const char *hint = GetHint(a_editor);
+    if (hint == NULL || hint[0] == '\0')
+    {
+        return;
+    }
+
+    MoveGap(a_editor, a_editor->m_len);
+    for (; *hint != '\0' && ReserveGap(a_editor); hint++)
+    {
+        a_editor->m_buf[a_editor->m_gap_start++] = *hint;
+        a_editor->m_len++;
+    }
+    a_editor->m_pos = a_editor->m_len;
+    Refresh(a_editor);
+}
+
+// Moves the cursor one character to the right, or accepts the hint at the end
+// of the line.
+static void MoveRight(NNCli_LineEditor_t *a_editor)
+{
+    if (a_editor->m_pos < a_editor->m_len)
+    {
+        MoveCursor(a_editor, a_editor->m_pos + 1);
+    }
+    else
+    {
+        AcceptHint(a_editor);
+    }
+}
+
+static void HandleEscapeSequence(NNCli_LineEditor_t *a_editor, char a_c)
+{
+    switch (a_c)
+    {
+        case 'C':
+            MoveRight(a_editor);
+            break;
+
+        case 'D':
+            if (a_editor->m_pos > 0)
+            {
+                MoveCursor(a_editor, a_editor->m_pos - 1);
+            }
+            break;
+
+        case 'H':
+            MoveCursor(a_editor, 0);
+            break;
+
+        case 'F':
+            MoveCursor(a_editor, a_editor->m_len);
+            break;
+
+        case '~':
+            // ESC [ 3 ~ is Delete.
+            if (a_editor->m_escape_param == '3' &&
+                a_editor->m_pos < a_editor->m_len)
+            {
+                DeleteAfter(a_editor, 1);
+            }
+            break;
+
+        default:
+            // Other keys such as the history are not supported.
+            break;
+    }
+}
+
+void NNCli_LineEditorInit(NNCli_LineEditor_t *a_editor, char *a_buf,
+                          size_t a_buf_size, const char *a_prompt,
+                          NNCli_LineEditorWrite_t a_write, void *a_ctx)
+{
+    memset(a_editor, 0, sizeof(*a_editor));
+    a_editor->m_buf = a_buf;
+    a_editor->m_buf_size = (a_buf != NULL) ? a_buf_size : 0;
+    a_editor->m_is_growable = (a_buf == NULL);
+    a_editor->m_prompt = a_prompt;
+    a_editor->m_write = a_write;
+    a_editor->m_ctx = a_ctx;
+    Clear(a_editor);
+}
+
+void NNCli_LineEditorDestroy(NNCli_LineEditor_t *a_editor)
+{
+    if (a_editor->m_is_growable)
+    {
+        NNCli_Free(a_editor->m_buf);
+        a_editor->m_buf = NULL;
+        a_editor->m_buf_size = 0;
+        Clear(a_editor);
+    }
+}
+
+void NNCli_LineEditorSetColumns(NNCli_LineEditor_t *a_editor,
+                                size_t a_columns)
+{
+    a_editor->m_columns = a_columns;
+}
+
+void NNCli_LineEditorSetHint(NNCli_LineEditor_t *a_editor,
+                             NNCli_LineEditorHint_t a_hint, void *a_ctx)
+{
+    a_editor->m_hint = a_hint;
+    a_editor->m_hint_ctx = a_ctx;
+}
+
+void NNCli_LineEditorStart(NNCli_LineEditor_t *a_editor)
+{
+    Clear(a_editor);
+    a_editor->m_escape_state = ESCAPE_NONE;
+    WriteString(a_editor, a_editor->m_prompt);
+}
+
+NNCli_LineEditorEvent_t NNCli_LineEditorFeed(NNCli_LineEditor_t *a_editor,
+                                             char a_c)
+{
+    bool last_was_cr = a_editor->m_last_was_cr;
+    a_editor->m_last_was_cr = (a_c == KEY_ENTER);
+
+    switch (a_editor->m_escape_state)
+    {
+        case ESCAPE_STARTED:
+            a_editor->m_escape_state = (a_c == '[')   ? ESCAPE_CSI
+                                       : (a_c == 'O') ? ESCAPE_SS3
+                                                      : ESCAPE_NONE;
+            a_editor->m_escape_param = '\0';
+            return NN_CLI__LINE_EDITOR_EVENT_NONE;
+
+        case ESCAPE_CSI:
+            if (a_c >= '0' && a_c <= '9')
+            {
+                a_editor->m_escape_param = a_c;
+                return NN_CLI__LINE_EDITOR_EVENT_NONE;
+            }
+            // Otherwise this is the final byte.
+            // Fall through
+        case ESCAPE_SS3:
+            a_editor->m_escape_state = ESCAPE_NONE;
+            HandleEscapeSequence(a_editor, a_c);
+            return NN_CLI__LINE_EDITOR_EVENT_NONE;
+
+        default:
+            break;
+    }
+
+    switch (a_c)
+    {
+        case KEY_LINE_FEED:
+            if (last_was_cr)
+            {
+                break;
+            }
+            // Fall through
+        case KEY_ENTER:
+            EraseHint(a_editor);
+            WriteString(a_editor, "\r\n");
+            return NN_CLI__LINE_EDITOR_EVENT_LINE;
+
+        case KEY_CTRL_C:
+            EraseHint(a_editor);
+            WriteString(a_editor, "^C\r\n");
+            Clear(a_editor);
+            return NN_CLI__LINE_EDITOR_EVENT_INTERRUPT;
+
+        case KEY_CTRL_D:
+            if (a_editor->m_len == 0)
+            {
+                WriteString(a_editor, "\r\n");
+                return NN_CLI__LINE_EDITOR_EVENT_EOF;
+            }
+            if (a_editor->m_pos < a_editor->m_len)
+            {
+                DeleteAfter(a_editor, 1);
+            }
+            break;
+
+        case KEY_BACKSPACE:
+        case KEY_BACKSPACE_ASCII:
+            DeleteBefore(a_editor, (a_editor->m_pos > 0) ? 1 : 0);
+            break;
+
+        case KEY_CTRL_A:
+            MoveCursor(a_editor, 0);
+            break;
+
+        case KEY_CTRL_E:
+            MoveCursor(a_editor, a_editor->m_len);
+            break;
+
+        case KEY_CTRL_B:
+            if (a_editor->m_pos > 0)
+            {
+                MoveCursor(a_editor, a_editor->m_pos - 1);
+            }
+            break;
+
+        case KEY_CTRL_F:
+            MoveRight(a_editor);
+            break;
+
+        case KEY_CTRL_K:
+            DeleteAfter(a_editor, a_editor->m_len - a_editor->m_pos);
+            break;
+
+        case KEY_CTRL_U:
+            DeleteBefore(a_editor, a_editor->m_pos);
+            break;
+
+        case KEY_CTRL_W:
+        {
+            size_t start = a_editor->m_pos;
+            while (start > 0 && CharAt(a_editor, start - 1) == ' ')
+            {
+                start--;
+            }
+            while (start > 0 && CharAt(a_editor, start - 1) != ' ')
+            {
+                start--;
+            }
+            DeleteBefore(a_editor, a_editor->m_pos - start);
+            break;
+        }
+
+        case KEY_ESC:
+            a_editor->m_escape_state = ESCAPE_STARTED;
+            break;
+
+        default:
+            // Other control characters such as Tab are ignored.
+            if ((unsigned char)a_c >= ' ')
+            {
+                Insert(a_editor, a_c);
+            }
+            break;
+    }
+
+    return NN_CLI__LINE_EDITOR_EVENT_NONE;
+}
+
+const char *NNCli_LineEditorGetLine(NNCli_LineEditor_t *a_editor)
+{
+    if (a_editor->m_buf == NULL)
+    {
+        return "";
+    }
+    // The gap has room for the null terminator.
+    MoveGap(a_editor, a_editor->m_len);
+    a_editor->m_buf[a_editor->m_len] = '\0';
+    return a_editor->m_buf;
+}
@@ -0,0 +1,252 @@
+#include "nn_cli_plugin.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nn_cli_alloc.h"
+
+// NAME|SYMBOL|HELP|OPTIONS|COMPLETE_SYMBOL
+#define PLUGIN_FIELD_NUM 5
+
+// `a_path` relative to the directory of the manifest.
+static NNCli_Plugin_t *NewPlugin(const char *a_manifest, const char *a_path)
+{
+    const char *slash = strrchr(a_manifest, '/');
+    size_t dir_len = (a_path[0] == '/') ? 0
+                     : (slash != NULL)  ? (size_t)(slash - a_manifest) + 1
+                                        : 2;
+    size_t path_len = strlen(a_path);
+    NNCli_Plugin_t *plugin = (NNCli_Plugin_t *)NNCli_Malloc(
+        sizeof(NNCli_Plugin_t) + dir_len + path_len + 1);
+    if (plugin == NULL)
+    {
+        return NULL;
+    }
+
+    plugin->m_path = (char *)(plugin + 1);
+    plugin->m_handle = NULL;
+    // A path without a slash would be searched for in the library paths.
+    memcpy(plugin->m_path, (slash != NULL) ? a_manifest : "./", dir_len);
+    memcpy(&plugin->m_path[dir_len], a_path, path_len + 1);
+    return plugin;
+}
+
+// Splits `a_line` at `|` in place. The fields which are left out are empty.
+static void SplitFields(char *a_line, char **out_fields)
+{
+    char *cursor = a_line;
+    for (int i = 0; i < PLUGIN_FIELD_NUM; i++)
+    {
+        out_fields[i] = cursor;
+        cursor += strcspn(cursor, "|");
+        if (*cursor != '\0')
+        {
+            *cursor++ = '\0';
+        }
+    }
+}
+
+static NNCli_PluginCommand_t *NewCommand(char *a_line, NNCli_Plugin_t *a_plugin,
+                                         NNCli_Func_t a_proxy,
+                                         NNCli_CompleteArgsFunc_t a_complete)
+{
+    char *fields[PLUGIN_FIELD_NUM];
+    size_t lens[PLUGIN_FIELD_NUM];
+    size_t total_len = 0;
+    NNCli_PluginCommand_t *command;
+    char *strings[PLUGIN_FIELD_NUM];
+    char *cursor;
+
+    SplitFields(a_line, fields);
+    if (fields[0][0] == '\0' || strchr(fields[0], ' ') != NULL ||
+        fields[1][0] == '\0' || fields[2][0] == '\0')
+    {
+        return NULL;
+    }
+    for (int i = 0; i < PLUGIN_FIELD_NUM; i++)
+    {
+        lens[i] = strlen(fields[i]);
+        total_len += lens[i] + 1;
+    }
+
+    command = (NNCli_PluginCommand_t *)NNCli_Malloc(
+        sizeof(NNCli_PluginCommand_t) + total_len);
+    if (command == NULL)
+    {
+        return NULL;
+    }
+    cursor = (char *)(command + 1);
+    for (int i = 0; i < PLUGIN_FIELD_NUM; i++)
+    {
+        strings[i] = cursor;
+        memcpy(cursor, fields[i], lens[i] + 1);
+        cursor += lens[i] + 1;
+    }
+
+    memset(command, 0, sizeof(*command));
+    command->m_command.m_func = a_proxy;
+    command->m_command.m_name = strings[0];
+    command->m_command.m_help_msg = strings[2];
+    command->m_command.m_options = (lens[3] > 0) ? strings[3] : NULL;
+    command->m_command.m_complete_args = (lens[4] > 0) ? a_complete : NULL;
+    command->m_plugin = a_plugin;
+    command->m_symbol = strings[1];
+    command->m_complete_symbol = (lens[4] > 0) ? strings[4] : NULL;
+    return command;
+}
+
+void NNCli_PluginTableInit(NNCli_PluginTable_t *a_table)
+{
+    memset(a_table, 0, sizeof(*a_table));
+    pthread_mutex_init(&a_table->m_mutex, NULL);
+}
+
+void NNCli_PluginTableClear(NNCli_PluginTable_t *a_table)
+{
+    pthread_mutex_lock(&a_table->m_mutex);
+    for (size_t i = 0; i < a_table->m_command_num; i++)
+    {
+        NNCli_Free(a_table->m_commands[i]);
+    }
+    for (size_t i = 0; i < a_table->m_plugin_num; i++)
+    {
+        if (a_table->m_plugins[i]->m_handle != NULL)
+        {
+            dlclose(a_table->m_plugins[i]->m_handle);
+        }
+        NNCli_Free(a_table->m_plugins[i]);
+    }
+    a_table->m_command_num = 0;
+    a_table->m_plugin_num = 0;
+    pthread_mutex_unlock(&a_table->m_mutex);
+}
+
+NNCli_Err_t NNCli_PluginTableLoad(NNCli_PluginTable_t *a_table,
+                                  const char *a_filename, NNCli_Func_t a_proxy,
+                                  NNCli_CompleteArgsFunc_t a_complete)
+{
+    NNCli_Err_t res = NN_CLI__SUCCESS;
+    char line[NN_CLI__LINE_MAX_LEN];
+    NNCli_Plugin_t *plugin = NULL;
+    FILE *file = fopen(a_filename, "r");
+
+    if (file == NULL)
+    {
+        NNCli_LogError("Failed to open the plugin manifest %s", a_filename);
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#')
+        {
+            continue;
+        }
+
+        if (strncmp(line, "plugin ", 7) == 0 && line[7] != '\0')
+        {
+            if (a_table->m_plugin_num >= NN_CLI__MAX_PLUGIN_NUM)
+            {
+                res = NN_CLI__EXCEED_CAPACITY;
+                break;
+            }
+            plugin = NewPlugin(a_filename, &line[7]);
+            if (plugin == NULL)
+            {
+                res = NN_CLI__EXCEED_CAPACITY;
+                break;
+            }
+            a_table->m_plugins[a_table->m_plugin_num++] = plugin;
+        }
+        else if (strncmp(line, "command ", 8) == 0 && plugin != NULL)
+        {
+            NNCli_PluginCommand_t *command;
+            if (a_table->m_command_num >= NN_CLI__MAX_PLUGIN_COMMAND_NUM)
+            {
+                res = NN_CLI__EXCEED_CAPACITY;
+                break;
+            }
+            command = NewCommand(&line[8], plugin, a_proxy, a_complete);
+            if (command == NULL)
+            {
+                NNCli_LogWarn("Skipped a command in %s", a_filename);
+                continue;
+            }
+            a_table->m_commands[a_table->m_command_num++] = command;
+        }
+        else
+        {
+            NNCli_LogWarn("Skipped a line in %s: %s", a_filename, line);
+        }
+    }
+
+    fclose(file);
+    return res;
+}
+
+NNCli_PluginCommand_t *NNCli_PluginFind(NNCli_PluginTable_t *a_table,
+                                        const char *a_name)
+{
+    for (size_t i = 0; i < a_table->m_command_num; i++)
+    {
+        if (strcmp(a_table->m_commands[i]->m_command.m_name, a_name) == 0)
+        {
+            return a_table->m_commands[i];
+        }
+    }
+    return NULL;
+}
+
+NNCli_Err_t NNCli_PluginResolve(NNCli_PluginTable_t *a_table,
+                                NNCli_PluginCommand_t *a_command)
+{
+    NNCli_Err_t res = NN_CLI__EXTERNAL_LIB_ERROR;
+    NNCli_Plugin_t *plugin = a_command->m_plugin;
+    NNCli_Func_t func;
+    NNCli_CompleteArgsFunc_t complete_args = NULL;
+
+    pthread_mutex_lock(&a_table->m_mutex);
+    if (a_command->m_func != NULL)
+    {
+        res = NN_CLI__SUCCESS;
+        goto done;
+    }
+
+    if (plugin->m_handle == NULL)
+    {
+        // The functions which the plugin calls are bound when they are first
+        // called, so that opening it costs less.
+        plugin->m_handle = dlopen(plugin->m_path, RTLD_LAZY | RTLD_LOCAL);
+        if (plugin->m_handle == NULL)
+        {
+            NNCli_LogError("Failed to load %s: %s", plugin->m_path, dlerror());
+            goto done;
+        }
+    }
+
+    func = (NNCli_Func_t)dlsym(plugin->m_handle, a_command->m_symbol);
+    if (a_command->m_complete_symbol != NULL)
+    {
+        complete_args = (NNCli_CompleteArgsFunc_t)dlsym(
+            plugin->m_handle, a_command->m_complete_symbol);
+    }
+    if (func == NULL ||
+        (a_command->m_complete_symbol != NULL && complete_args == NULL))
+    {
+        NNCli_LogError("%s does not have the functions of %s", plugin->m_path,
+                       a_command->m_command.m_name);
+        goto done;
+    }
+
+    // `m_func` is set last, so the command is resolved once it is not NULL.
+    a_command->m_complete_args = complete_args;
+    a_command->m_func = func;
+    res = NN_CLI__SUCCESS;
+
+done:
+    pthread_mutex_unlock(&a_table->m_mutex);
+    return res;
+}
@@ -0,0 +1,198 @@
+#include "nn_cli_pool_allocator.h"
+
+#include <stdint.h>
+#include <string.h>
+
+static NNCli_BlockPool_t *FindBlockPool(NNCli_PoolAllocator_t *a_allocator,
+                                        const void *a_ptr)
+{
+    for (size_t i = 0; i < a_allocator->m_pool_num; i++)
+    {
+        NNCli_BlockPool_t *pool = &a_allocator->m_pools[i];
+        if ((const char *)a_ptr >= pool->m_begin &&
+            (const char *)a_ptr < pool->m_end)
+        {
+            return pool;
+        }
+    }
+    return NULL;
+}
+
+// A request which does not fit in the smallest pool for it spills over to the
+// larger ones.
+static void *AllocateBlock(void *a_ctx, size_t a_size)
+{
+    NNCli_PoolAllocator_t *allocator = (NNCli_PoolAllocator_t *)a_ctx;
+    void *block = NULL;
+    size_t first = 0;
+    NNCli_PoolUsage_t *usage;
+
+    pthread_mutex_lock(&allocator->m_mutex);
+    while (first < allocator->m_pool_num &&
+           allocator->m_pools[first].m_usage.m_block_size < a_size)
+    {
+        first++;
+    }
+    for (size_t i = first; i < allocator->m_pool_num; i++)
+    {
+        NNCli_BlockPool_t *pool = &allocator->m_pools[i];
+        if (pool->m_free_list != NULL)
+        {
+            block = pool->m_free_list;
+            pool->m_free_list = *(void **)block;
+            pool->m_usage.m_used_num++;
+            if (pool->m_usage.m_used_num > pool->m_usage.m_peak_num)
+            {
+                pool->m_usage.m_peak_num = pool->m_usage.m_used_num;
+            }
+            break;
+        }
+    }
+
+    usage = &allocator->m_pools[first < allocator->m_pool_num
+                                    ? first
+                                    : allocator->m_pool_num - 1]
+                 .m_usage;
+    if (a_size > usage->m_largest_size)
+    {
+        usage->m_largest_size = a_size;
+    }
+    if (block == NULL)
+    {
+        usage->m_failed_num++;
+    }
+    pthread_mutex_unlock(&allocator->m_mutex);
+    return block;
+}
+
+static void FreeBlock(void *a_ctx, void *a_ptr)
+{
+    NNCli_PoolAllocator_t *allocator = (NNCli_PoolAllocator_t *)a_ctx;
+    NNCli_BlockPool_t *pool;
+
+    if (a_ptr == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&allocator->m_mutex);
+    pool = FindBlockPool(allocator, a_ptr);
+    NNCli_Assert(pool != NULL);
+    if (pool != NULL)
+    {
+        *(void **)a_ptr = pool->m_free_list;
+        pool->m_free_list = a_ptr;
+        pool->m_usage.m_used_num--;
+    }
+    pthread_mutex_unlock(&allocator->m_mutex);
+}
+
+// The block is kept if the new size still fits in it.
+static void *ReallocateBlock(void *a_ctx, void *a_ptr, size_t a_size)
+{
+    NNCli_PoolAllocator_t *allocator = (NNCli_PoolAllocator_t *)a_ctx;
+    NNCli_BlockPool_t *pool;
+    size_t block_size = 0;
+    void *block;
+
+    if (a_ptr == NULL)
+    {
+        return AllocateBlock(a_ctx, a_size);
+    }
+    pthread_mutex_lock(&allocator->m_mutex);
+    pool = FindBlockPool(allocator, a_ptr);
+    NNCli_Assert(pool != NULL);
+    if (pool != NULL)
+    {
+        block_size = pool->m_usage.m_block_size;
+        if (a_size <= block_size && a_size > pool->m_usage.m_largest_size)
+        {
+            pool->m_usage.m_largest_size = a_size;
+        }
+    }
+    pthread_mutex_unlock(&allocator->m_mutex);
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+    if (a_size <= block_size)
+    {
+        return a_ptr;
+    }
+
+    // The old block is kept if there is no larger one, as with realloc().
+    block = AllocateBlock(a_ctx, a_size);
+    if (block != NULL)
+    {
+        memcpy(block, a_ptr, block_size);
+        FreeBlock(a_ctx, a_ptr);
+    }
+    return block;
+}
+
+NNCli_Err_t NNCli_PoolAllocatorInit(NNCli_PoolAllocator_t *a_allocator,
+                                    const NNCli_Pool_t *a_pools,
+                                    size_t a_pool_num,
+                                    NNCli_Allocator_t *out_allocator)
+{
+    const size_t align = __alignof__(max_align_t);
+
+    if (a_pool_num == 0 || a_pool_num > NN_CLI__MAX_POOL_NUM)
+    {
+        NNCli_LogError("The number of pools has to be 1 to %d",
+                       NN_CLI__MAX_POOL_NUM);
+        return NN_CLI__INVALID_ARGS;
+    }
+    for (size_t i = 0; i < a_pool_num; i++)
+    {
+        const NNCli_Pool_t *pool = &a_pools[i];
+        if (pool->m_buf == NULL || pool->m_block_num == 0 ||
+            pool->m_block_size == 0 || pool->m_block_size % align != 0 ||
+            (uintptr_t)pool->m_buf % align != 0 ||
+            (i > 0 && pool->m_block_size <= a_pools[i - 1].m_block_size))
+        {
+            NNCli_LogError("Pool %zu is invalid", i);
+            return NN_CLI__INVALID_ARGS;
+        }
+    }
+
+    memset(a_allocator, 0, sizeof(*a_allocator));
+    pthread_mutex_init(&a_allocator->m_mutex, NULL);
+    for (size_t i = 0; i < a_pool_num; i++)
+    {
+        NNCli_BlockPool_t *pool = &a_allocator->m_pools[i];
+        size_t block_size = a_pools[i].m_block_size;
+
+        pool->m_begin = (char *)a_pools[i].m_buf;
+        pool->m_end = pool->m_begin + block_size * a_pools[i].m_block_num;
+        pool->m_usage.m_block_size = block_size;
+        pool->m_usage.m_block_num = a_pools[i].m_block_num;
+        // Linked from the end, so that the blocks are taken in address order.
+        for (size_t j = a_pools[i].m_block_num; j > 0; j--)
+        {
+            char *block = pool->m_begin + (j - 1) * block_size;
+            *(void **)block = pool->m_free_list;
+            pool->m_free_list = block;
+        }
+    }
+    a_allocator->m_pool_num = a_pool_num;
+
+    out_allocator->m_malloc = AllocateBlock;
+    out_allocator->m_realloc = ReallocateBlock;
+    out_allocator->m_free = FreeBlock;
+    out_allocator->m_ctx = a_allocator;
+    return NN_CLI__SUCCESS;
+}
+
+NNCli_Err_t NNCli_PoolAllocatorGetUsage(NNCli_PoolAllocator_t *a_allocator,
+                                        size_t a_index,
+                                        NNCli_PoolUsage_t *out_usage)
+{
+    if (a_index >= a_allocator->m_pool_num)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    pthread_mutex_lock(&a_allocator->m_mutex);
+    *out_usage = a_allocator->m_pools[a_index].m_usage;
+    pthread_mutex_unlock(&a_allocator->m_mutex);
+    return NN_CLI__SUCCESS;
+}
@@ -0,0 +1,527 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "nn_cli_recorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "check_config.h"
+
+static const char s_magic[] = "NNCLIREC";
+#define MAGIC_LEN (sizeof(s_magic) - 1)
+
+typedef struct
+{
+    bool m_is_running;
+    NNCli_RecordWriter_t m_writer;
+    uint64_t m_start_us;
+    pthread_t m_thread;
+    // Wakes up the thread to stop it.
+    int m_stop_pipe[2];
+    // The original stdin, stdout and stderr. The output ones are -1 if they
+    // are not relayed.
+    int m_real_in;
+    int m_real_out;
+    int m_real_err;
+    // The master of the pseudo terminal, or the write end of the pipe which
+    // has replaced stdin.
+    int m_relay_fd;
+    bool m_is_tty;
+    struct termios m_orig_termios;
+} Recorder_t;
+
+static Recorder_t s_recorder = {.m_is_running = false};
+
+/**
+ * Recording file
+ */
+
+static bool WriteVarint(FILE *a_file, uint64_t a_value)
+{
+    do
+    {
+        unsigned char byte = a_value & 0x7f;
+        a_value >>= 7;
+        if (a_value != 0)
+        {
+            byte |= 0x80;
+        }
+        if (fputc(byte, a_file) == EOF)
+        {
+            return false;
+        }
+    } while (a_value != 0);
+    return true;
+}
+
+static bool ReadVarint(FILE *a_file, uint64_t *out_value)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = fgetc(a_file);
+        if (byte == EOF)
+        {
+            return false;
+        }
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *out_value = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+NNCli_Err_t NNCli_RecordWriterOpen(NNCli_RecordWriter_t *a_writer,
+                                   const char *a_filename)
+{
+    if (a_writer == NULL || a_filename == NULL)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    a_writer->m_last_time_us = 0;
+    a_writer->m_file = fopen(a_filename, "wb");
+    if (a_writer->m_file == NULL)
+    {
+        NNCli_LogError("Failed to open %s: %s", a_filename, strerror(errno));
+        return NN_CLI__GENERAL_ERROR;
+    }
+
+    fwrite(s_magic, 1, MAGIC_LEN, a_writer->m_file);
+    fputc(NN_CLI__RECORD_VERSION, a_writer->m_file);
+    return NN_CLI__SUCCESS;
+}
+
+NNCli_Err_t NNCli_RecordWriterWrite(NNCli_RecordWriter_t *a_writer,
+                                    uint64_t a_time_us, const char *a_data,
+                                    size_t a_len)
+{
+    if (a_writer->m_file == NULL)
+    {
+        return NN_CLI__NOT_READY;
+    }
+    if (a_len > NN_CLI__RECORD_CHUNK_MAX_LEN ||
+        a_time_us < a_writer->m_last_time_us)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    if (!WriteVarint(a_writer->m_file, a_time_us - a_writer->m_last_time_us) ||
+        !WriteVarint(a_writer->m_file, a_len) ||
+        fwrite(a_data, 1, a_len, a_writer->m_file) != a_len)
+    {
+        return NN_CLI__GENERAL_ERROR;
+    }
+    a_writer->m_last_time_us = a_time_us;
+
+    // Keep what has been typed even if the process crashes.
+    fflush(a_writer->m_file);
+    return NN_CLI__SUCCESS;
+}
+
+void NNCli_RecordWriterClose(NNCli_RecordWriter_t *a_writer)
+{
+    if (a_writer->m_file != NULL)
+    {
+        fclose(a_writer->m_file);
+        a_writer->m_file = NULL;
+    }
+}
+
+NNCli_Err_t NNCli_RecordReaderOpen(NNCli_RecordReader_t *a_reader,
+                                   const char *a_filename)
+{
+    NNCli_Err_t res = NN_CLI__INVALID_ARGS;
+    char header[MAGIC_LEN + 1];
+
+    if (a_reader == NULL || a_filename == NULL)
+    {
+        goto done;
+    }
+
+    a_reader->m_time_us = 0;
+    a_reader->m_file = fopen(a_filename, "rb");
+    if (a_reader->m_file == NULL)
+    {
+        NNCli_LogError("Failed to open %s: %s", a_filename, strerror(errno));
+        res = NN_CLI__GENERAL_ERROR;
+        goto done;
+    }
+
+    if (fread(header, 1, sizeof(header), a_reader->m_file) != sizeof(header) ||
+        memcmp(header, s_magic, MAGIC_LEN) != 0 ||
+        header[MAGIC_LEN] != NN_CLI__RECORD_VERSION)
+    {
+        NNCli_LogError("%s is not a recording", a_filename);
+        NNCli_RecordReaderClose(a_reader);
+        goto done;
+    }
+
+    res = NN_CLI__SUCCESS;
+
+done:
+    return res;
+}
+
+NNCli_Err_t NNCli_RecordReaderNext(NNCli_RecordReader_t *a_reader,
+                                   uint64_t *out_time_us, char *out_data,
+                                   size_t *out_len)
+{
+    uint64_t delta_us;
+    uint64_t len;
+
+    if (a_reader->m_file == NULL)
+    {
+        return NN_CLI__NOT_READY;
+    }
+
+    if (!ReadVarint(a_reader->m_file, &delta_us))
+    {
+        return feof(a_reader->m_file) ? NN_CLI__PROCESS_COMPLETED
+                                      : NN_CLI__GENERAL_ERROR;
+    }
+    if (!ReadVarint(a_reader->m_file, &len) ||
+        len > NN_CLI__RECORD_CHUNK_MAX_LEN ||
+        fread(out_data, 1, len, a_reader->m_file) != len)
+    {
+        NNCli_LogError("The recording is broken");
+        return NN_CLI__GENERAL_ERROR;
+    }
+
+    a_reader->m_time_us += delta_us;
+    *out_time_us = a_reader->m_time_us;
+    *out_len = len;
+    return NN_CLI__SUCCESS;
+}
+
+void NNCli_RecordReaderClose(NNCli_RecordReader_t *a_reader)
+{
+    if (a_reader->m_file != NULL)
+    {
+        fclose(a_reader->m_file);
+        a_reader->m_file = NULL;
+    }
+}
+
+/**
+ * Recording the input of the process
+ */
+
+static uint64_t GetMonotonicUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void WriteAll(int a_fd, const char *a_data, size_t a_len)
+{
+    while (a_len > 0)
+    {
+        ssize_t written = write(a_fd, a_data, a_len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        a_data += written;
+        a_len -= written;
+    }
+}
+
+static void *RelayInput(void *a_arg)
+{
+    Recorder_t *recorder = (Recorder_t *)a_arg;
+    char buf[NN_CLI__RECORD_CHUNK_MAX_LEN];
+    struct pollfd fds[3] = {
+        {.fd = recorder->m_real_in, .events = POLLIN, .revents = 0},
+        // Output to stdout and stderr comes out of the master.
+        {.fd = recorder->m_is_tty ? recorder->m_relay_fd : -1,
+         .events = POLLIN,
+         .revents = 0},
+        {.fd = recorder->m_stop_pipe[0], .events = POLLIN, .revents = 0},
+    };
+
+    while (fds[2].revents == 0)
+    {
+        if (poll(fds, 3, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents != 0)
+        {
+            ssize_t len = read(recorder->m_real_in, buf, sizeof(buf));
+            if (len > 0)
+            {
+                NNCli_RecordWriterWrite(&recorder->m_writer,
+                                        GetMonotonicUs() - recorder->m_start_us,
+                                        buf, len);
+                WriteAll(recorder->m_relay_fd, buf, len);
+            }
+            else if (len == 0 || errno != EINTR)
+            {
+                fds[0].fd = -1;
+                if (!recorder->m_is_tty)
+                {
+                    // The process reads the end of the input.
+                    close(recorder->m_relay_fd);
+                    recorder->m_relay_fd = -1;
+                }
+            }
+        }
+
+        if (fds[1].revents != 0)
+        {
+            ssize_t len = read(recorder->m_relay_fd, buf, sizeof(buf));
+            if (len > 0)
+            {
+                WriteAll(recorder->m_real_out, buf, len);
+            }
+            else if (len == 0 || errno != EINTR)
+            {
+                fds[1].fd = -1;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Replaces stdin, and stdout and stderr if they are the terminal, with a
+// pseudo terminal which has the same settings as the real one. The real
+// terminal is set to raw mode because the pseudo terminal does the line
+// discipline.
+static NNCli_Err_t SetUpPseudoTerminal(Recorder_t *a_recorder)
+{
+    NNCli_Err_t res = NN_CLI__GENERAL_ERROR;
+    struct termios raw;
+    struct winsize size;
+    int slave = -1;
+
+    a_recorder->m_relay_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (a_recorder->m_relay_fd < 0 || grantpt(a_recorder->m_relay_fd) != 0 ||
+        unlockpt(a_recorder->m_relay_fd) != 0)
+    {
+        NNCli_LogError("Failed to open a pseudo terminal: %s",
+                       strerror(errno));
+        goto done;
+    }
+    slave = open(ptsname(a_recorder->m_relay_fd), O_RDWR | O_NOCTTY);
+    if (slave < 0 ||
+        tcgetattr(a_recorder->m_real_in, &a_recorder->m_orig_termios) != 0)
+    {
+        NNCli_LogError("Failed to set up the pseudo terminal: %s",
+                       strerror(errno));
+        goto done;
+    }
+
+    tcsetattr(slave, TCSANOW, &a_recorder->m_orig_termios);
+    if (ioctl(a_recorder->m_real_in, TIOCGWINSZ, &size) == 0)
+    {
+        ioctl(slave, TIOCSWINSZ, &size);
+    }
+    raw = a_recorder->m_orig_termios;
+    cfmakeraw(&raw);
+    tcsetattr(a_recorder->m_real_in, TCSANOW, &raw);
+
+    fflush(stdout);
+    fflush(stderr);
+    if (isatty(STDOUT_FILENO))
+    {
+        a_recorder->m_real_out = dup(STDOUT_FILENO);
+        dup2(slave, STDOUT_FILENO);
+    }
+    if (isatty(STDERR_FILENO))
+    {
+        a_recorder->m_real_err = dup(STDERR_FILENO);
+        dup2(slave, STDERR_FILENO);
+    }
+    dup2(slave, STDIN_FILENO);
+
+    res = NN_CLI__SUCCESS;
+
+done:
+    if (slave >= 0)
+    {
+        close(slave);
+    }
+    return res;
+}
+
+static NNCli_Err_t SetUpPipe(Recorder_t *a_recorder)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        NNCli_LogError("Failed to create a pipe: %s", strerror(errno));
+        return NN_CLI__GENERAL_ERROR;
+    }
+
+    dup2(fds[0], STDIN_FILENO);
+    close(fds[0]);
+    a_recorder->m_relay_fd = fds[1];
+    return NN_CLI__SUCCESS;
+}
+
+// Writes what is left in the pseudo terminal after the thread has stopped.
+static void DrainPseudoTerminal(Recorder_t *a_recorder)
+{
+    char buf[NN_CLI__RECORD_CHUNK_MAX_LEN];
+    ssize_t len;
+
+    fcntl(a_recorder->m_relay_fd, F_SETFL,
+          fcntl(a_recorder->m_relay_fd, F_GETFL) | O_NONBLOCK);
+    while ((len = read(a_recorder->m_relay_fd, buf, sizeof(buf))) > 0)
+    {
+        if (a_recorder->m_real_out >= 0)
+        {
+            WriteAll(a_recorder->m_real_out, buf, len);
+        }
+    }
+}
+
+static void RestoreFd(int *a_saved_fd, int a_fd)
+{
+    if (*a_saved_fd >= 0)
+    {
+        dup2(*a_saved_fd, a_fd);
+        close(*a_saved_fd);
+        *a_saved_fd = -1;
+    }
+}
+
+NNCli_Err_t NNCli_RecorderStart(const char *a_filename)
+{
+    NNCli_Err_t res = NN_CLI__IN_PROGRESS;
+    static bool s_is_atexit_registered = false;
+    Recorder_t *recorder = &s_recorder;
+
+    if (recorder->m_is_running)
+    {
+        goto done;
+    }
+
+    memset(recorder, 0, sizeof(*recorder));
+    recorder->m_real_in = recorder->m_real_out = recorder->m_real_err = -1;
+    recorder->m_relay_fd = -1;
+    recorder->m_stop_pipe[0] = recorder->m_stop_pipe[1] = -1;
+
+    res = NNCli_RecordWriterOpen(&recorder->m_writer, a_filename);
+    if (res != NN_CLI__SUCCESS)
+    {
+        goto done;
+    }
+
+    res = NN_CLI__GENERAL_ERROR;
+    if (pipe(recorder->m_stop_pipe) != 0)
+    {
+        NNCli_LogError("Failed to create a pipe: %s", strerror(errno));
+        goto done;
+    }
+
+    recorder->m_real_in = dup(STDIN_FILENO);
+    recorder->m_is_tty = isatty(STDIN_FILENO);
+    res = recorder->m_is_tty ? SetUpPseudoTerminal(recorder)
+                             : SetUpPipe(recorder);
+    if (res != NN_CLI__SUCCESS)
+    {
+        goto done;
+    }
+
+    recorder->m_start_us = GetMonotonicUs();
+    if (pthread_create(&recorder->m_thread, NULL, RelayInput, recorder) != 0)
+    {
+        NNCli_LogError("Failed to start the recorder thread");
+        res = NN_CLI__GENERAL_ERROR;
+        goto done;
+    }
+    recorder->m_is_running = true;
+
+    if (!s_is_atexit_registered)
+    {
+        // The real terminal has to be restored even if the process exits
+        // without stopping the recorder.
+        atexit(NNCli_RecorderStop);
+        s_is_atexit_registered = true;
+    }
+
+done:
+    if (res != NN_CLI__SUCCESS && res != NN_CLI__IN_PROGRESS)
+    {
+        RestoreFd(&recorder->m_real_out, STDOUT_FILENO);
+        RestoreFd(&recorder->m_real_err, STDERR_FILENO);
+        if (recorder->m_is_tty && recorder->m_real_in >= 0)
+        {
+            tcsetattr(recorder->m_real_in, TCSANOW,
+                      &recorder->m_orig_termios);
+        }
+        RestoreFd(&recorder->m_real_in, STDIN_FILENO);
+        for (int i = 0; i < 2; i++)
+        {
+            if (recorder->m_stop_pipe[i] >= 0)
+            {
+                close(recorder->m_stop_pipe[i]);
+            }
+        }
+        if (recorder->m_relay_fd >= 0)
+        {
+            close(recorder->m_relay_fd);
+        }
+        NNCli_RecordWriterClose(&recorder->m_writer);
+    }
+    return res;
+}
+
+void NNCli_RecorderStop(void)
+{
+    Recorder_t *recorder = &s_recorder;
+    if (!recorder->m_is_running)
+    {
+        return;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    WriteAll(recorder->m_stop_pipe[1], "", 1);
+    pthread_join(recorder->m_thread, NULL);
+    close(recorder->m_stop_pipe[0]);
+    close(recorder->m_stop_pipe[1]);
+
+    if (recorder->m_is_tty)
+    {
+        DrainPseudoTerminal(recorder);
+        RestoreFd(&recorder->m_real_out, STDOUT_FILENO);
+        RestoreFd(&recorder->m_real_err, STDERR_FILENO);
+        tcsetattr(recorder->m_real_in, TCSANOW, &recorder->m_orig_termios);
+    }
+    RestoreFd(&recorder->m_real_in, STDIN_FILENO);
+    if (recorder->m_relay_fd >= 0)
+    {
+        close(recorder->m_relay_fd);
+    }
+
+    NNCli_RecordWriterClose(&recorder->m_writer);
+    recorder->m_is_running = false;
+}
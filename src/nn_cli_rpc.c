@@ -0,0 +1,460 @@
+#include "nn_cli_rpc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct
+{
+    const char *m_cur;
+    const char *m_end;
+} Parser_t;
+
+/**
+ * Frames
+ */
+
+void NNCli_RpcReaderInit(NNCli_RpcReader_t *a_reader)
+{
+    a_reader->m_len = 0;
+    a_reader->m_is_skipping = false;
+}
+
+size_t NNCli_RpcReaderFeed(NNCli_RpcReader_t *a_reader, const char *a_data,
+                           size_t a_len, NNCli_RpcFrameHandler_t a_handler,
+                           void *a_ctx)
+{
+    size_t frame_num = 0;
+
+    while (a_len > 0)
+    {
+        const char *newline = (const char *)memchr(a_data, '\n', a_len);
+        size_t chunk_len = (newline != NULL) ? (size_t)(newline - a_data)
+                                             : a_len;
+
+        if (!a_reader->m_is_skipping)
+        {
+            if (a_reader->m_len + chunk_len > sizeof(a_reader->m_buf))
+            {
+                a_reader->m_is_skipping = true;
+            }
+            else
+            {
+                memcpy(&a_reader->m_buf[a_reader->m_len], a_data, chunk_len);
+                a_reader->m_len += chunk_len;
+            }
+        }
+        if (newline == NULL)
+        {
+            break;
+        }
+
+        a_handler(a_ctx, a_reader->m_is_skipping ? NULL : a_reader->m_buf,
+                  a_reader->m_len);
+        frame_num++;
+        a_reader->m_len = 0;
+        a_reader->m_is_skipping = false;
+        a_data += chunk_len + 1;
+        a_len -= chunk_len + 1;
+    }
+    return frame_num;
+}
+
+size_t NNCli_RpcReaderFinish(NNCli_RpcReader_t *a_reader,
+                             NNCli_RpcFrameHandler_t a_handler, void *a_ctx)
+{
+    if (a_reader->m_len == 0 && !a_reader->m_is_skipping)
+    {
+        return 0;
+    }
+    return NNCli_RpcReaderFeed(a_reader, "\n", 1, a_handler, a_ctx);
+}
+
+/**
+ * Requests
+ */
+
+static void SkipSpaces(Parser_t *a_parser)
+{
+    while (a_parser->m_cur < a_parser->m_end &&
+           strchr(" \t\r\n", *a_parser->m_cur) != NULL)
+    {
+        a_parser->m_cur++;
+    }
+}
+
+static bool Consume(Parser_t *a_parser, char a_char)
+{
+    SkipSpaces(a_parser);
+    if (a_parser->m_cur < a_parser->m_end && *a_parser->m_cur == a_char)
+    {
+        a_parser->m_cur++;
+        return true;
+    }
+    return false;
+}
+
+static bool ParseHex4(Parser_t *a_parser, uint32_t *out_value)
+{
+    uint32_t value = 0;
+
+    if (a_parser->m_end - a_parser->m_cur < 4)
+    {
+        return false;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        char c = *a_parser->m_cur++;
+        value <<= 4;
+        if (c >= '0' && c <= '9')
+        {
+            value |= c - '0';
+        }
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        {
+            value |= (c | 0x20) - 'a' + 10;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    *out_value = value;
+    return true;
+}
+
+// Returns the number of bytes of the code point in UTF-8.
+static size_t EncodeUtf8(uint32_t a_code, char *a_out)
+{
+    if (a_code < 0x80)
+    {
+        a_out[0] = (char)a_code;
+        return 1;
+    }
+    if (a_code < 0x800)
+    {
+        a_out[0] = (char)(0xc0 | (a_code >> 6));
+        a_out[1] = (char)(0x80 | (a_code & 0x3f));
+        return 2;
+    }
+    if (a_code < 0x10000)
+    {
+        a_out[0] = (char)(0xe0 | (a_code >> 12));
+        a_out[1] = (char)(0x80 | ((a_code >> 6) & 0x3f));
+        a_out[2] = (char)(0x80 | (a_code & 0x3f));
+        return 3;
+    }
+    a_out[0] = (char)(0xf0 | (a_code >> 18));
+    a_out[1] = (char)(0x80 | ((a_code >> 12) & 0x3f));
+    a_out[2] = (char)(0x80 | ((a_code >> 6) & 0x3f));
+    a_out[3] = (char)(0x80 | (a_code & 0x3f));
+    return 4;
+}
+
+static bool ParseEscape(Parser_t *a_parser, char *out_bytes, size_t *out_len)
+{
+    static const char s_escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+    uint32_t code;
+    char c;
+
+    if (a_parser->m_cur == a_parser->m_end)
+    {
+        return false;
+    }
+    c = *a_parser->m_cur++;
+    if (c != 'u')
+    {
+        for (size_t i = 0; i + 1 < sizeof(s_escapes); i += 2)
+        {
+            if (s_escapes[i] == c)
+            {
+                out_bytes[0] = s_escapes[i + 1];
+                *out_len = 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (!ParseHex4(a_parser, &code))
+    {
+        return false;
+    }
+    if (code >= 0xd800 && code < 0xdc00)
+    {
+        // A surrogate pair.
+        uint32_t low;
+        if (a_parser->m_end - a_parser->m_cur < 2 ||
+            a_parser->m_cur[0] != '\\' || a_parser->m_cur[1] != 'u')
+        {
+            return false;
+        }
+        a_parser->m_cur += 2;
+        if (!ParseHex4(a_parser, &low) || low < 0xdc00 || low >= 0xe000)
+        {
+            return false;
+        }
+        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+    }
+    else if (code >= 0xdc00 && code < 0xe000)
+    {
+        return false;
+    }
+    *out_len = EncodeUtf8(code, out_bytes);
+    return true;
+}
+
+// Parses a string into `a_out`, or skips it if `a_out` is NULL.
+static bool ParseString(Parser_t *a_parser, char *a_out, size_t a_out_len)
+{
+    size_t len = 0;
+
+    if (!Consume(a_parser, '"'))
+    {
+        return false;
+    }
+    while (a_parser->m_cur < a_parser->m_end && *a_parser->m_cur != '"')
+    {
+        char bytes[4];
+        size_t byte_num = 1;
+
+        bytes[0] = *a_parser->m_cur++;
+        if (bytes[0] == '\\' && !ParseEscape(a_parser, bytes, &byte_num))
+        {
+            return false;
+        }
+        if (a_out != NULL)
+        {
+            if (len + byte_num >= a_out_len)
+            {
+                return false;
+            }
+            memcpy(&a_out[len], bytes, byte_num);
+        }
+        len += byte_num;
+    }
+    if (a_parser->m_cur == a_parser->m_end)
+    {
+        return false;
+    }
+    a_parser->m_cur++;
+    if (a_out != NULL)
+    {
+        a_out[len] = '\0';
+    }
+    return true;
+}
+
+// Skips any value including objects and arrays.
+static bool SkipValue(Parser_t *a_parser)
+{
+    int depth = 0;
+
+    do
+    {
+        SkipSpaces(a_parser);
+        if (a_parser->m_cur == a_parser->m_end)
+        {
+            return false;
+        }
+        switch (*a_parser->m_cur)
+        {
+            case '"':
+                if (!ParseString(a_parser, NULL, 0))
+                {
+                    return false;
+                }
+                break;
+            case '{':
+            case '[':
+                depth++;
+                a_parser->m_cur++;
+                break;
+            case '}':
+            case ']':
+                depth--;
+                a_parser->m_cur++;
+                break;
+            case ',':
+            case ':':
+                if (depth == 0)
+                {
+                    return false;
+                }
+                a_parser->m_cur++;
+                break;
+            default:
+                // A number or a literal.
+                if (strchr(" \t\r\n,:{}[]\"", *a_parser->m_cur) != NULL)
+                {
+                    return false;
+                }
+                while (a_parser->m_cur < a_parser->m_end &&
+                       strchr(" \t\r\n,:{}[]\"", *a_parser->m_cur) == NULL)
+                {
+                    a_parser->m_cur++;
+                }
+                break;
+        }
+    } while (depth > 0);
+    return depth == 0;
+}
+
+NNCli_Err_t NNCli_RpcParseRequest(const char *a_frame, size_t a_len,
+                                  NNCli_RpcRequest_t *out_request)
+{
+    Parser_t parser = {.m_cur = a_frame, .m_end = a_frame + a_len};
+    bool has_line = false;
+
+    strcpy(out_request->m_id, "null");
+    out_request->m_line[0] = '\0';
+    if (!Consume(&parser, '{'))
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    if (Consume(&parser, '}'))
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    do
+    {
+        char key[8];
+        const char *value;
+
+        // Unknown keys longer than `key` are skipped as well.
+        Parser_t key_parser = parser;
+        if (!ParseString(&key_parser, key, sizeof(key)))
+        {
+            key[0] = '\0';
+            if (!ParseString(&parser, NULL, 0))
+            {
+                return NN_CLI__INVALID_ARGS;
+            }
+        }
+        else
+        {
+            parser = key_parser;
+        }
+        if (!Consume(&parser, ':'))
+        {
+            return NN_CLI__INVALID_ARGS;
+        }
+
+        SkipSpaces(&parser);
+        value = parser.m_cur;
+        if (strcmp(key, "line") == 0)
+        {
+            if (!ParseString(&parser, out_request->m_line,
+                             sizeof(out_request->m_line)))
+            {
+                return NN_CLI__INVALID_ARGS;
+            }
+            has_line = true;
+        }
+        else if (!SkipValue(&parser))
+        {
+            return NN_CLI__INVALID_ARGS;
+        }
+        else if (strcmp(key, "id") == 0)
+        {
+            size_t id_len = parser.m_cur - value;
+            if (id_len >= sizeof(out_request->m_id))
+            {
+                return NN_CLI__EXCEED_CAPACITY;
+            }
+            memcpy(out_request->m_id, value, id_len);
+            out_request->m_id[id_len] = '\0';
+        }
+    } while (Consume(&parser, ','));
+
+    if (!Consume(&parser, '}'))
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    SkipSpaces(&parser);
+    return (parser.m_cur == parser.m_end && has_line) ? NN_CLI__SUCCESS
+                                                      : NN_CLI__INVALID_ARGS;
+}
+
+/**
+ * Responses
+ */
+
+static void Put(char *a_buf, size_t a_len, size_t *a_pos, const char *a_data,
+                size_t a_data_len)
+{
+    if (*a_pos < a_len)
+    {
+        size_t room = a_len - *a_pos;
+        memcpy(&a_buf[*a_pos], a_data,
+               (a_data_len < room) ? a_data_len : room);
+    }
+    *a_pos += a_data_len;
+}
+
+size_t NNCli_RpcFormatResponse(const char *a_id, NNCli_Err_t a_status,
+                               const char *a_output, size_t a_output_len,
+                               char *a_buf, size_t a_len)
+{
+    char text[64];
+    size_t pos = 0;
+    int len;
+
+    if (a_buf == NULL)
+    {
+        a_len = 0;
+    }
+
+    Put(a_buf, a_len, &pos, "{\"id\":", 6);
+    Put(a_buf, a_len, &pos, a_id, strlen(a_id));
+    len = snprintf(text, sizeof(text), ",\"status\":%d,\"output\":\"",
+                   (int)a_status);
+    Put(a_buf, a_len, &pos, text, len);
+
+    for (size_t i = 0; i < a_output_len; i++)
+    {
+        unsigned char c = (unsigned char)a_output[i];
+        const char *escape = NULL;
+        switch (c)
+        {
+            case '"':
+                escape = "\\\"";
+                break;
+            case '\\':
+                escape = "\\\\";
+                break;
+            case '\n':
+                escape = "\\n";
+                break;
+            case '\r':
+                escape = "\\r";
+                break;
+            case '\t':
+                escape = "\\t";
+                break;
+            default:
+                break;
+        }
+        if (escape != NULL)
+        {
+            Put(a_buf, a_len, &pos, escape, 2);
+        }
+        else if (c < 0x20 || c == 0x7f)
+        {
+            len = snprintf(text, sizeof(text), "\\u%04x", c);
+            Put(a_buf, a_len, &pos, text, len);
+        }
+        else
+        {
+            Put(a_buf, a_len, &pos, &a_output[i], 1);
+        }
+    }
+    Put(a_buf, a_len, &pos, "\"}\n", 3);
+
+    if (a_len > 0)
+    {
+        a_buf[(pos < a_len) ? pos : a_len - 1] = '\0';
+    }
+    return pos;
+}
@@ -0,0 +1,226 @@
+#include "nn_cli_timer_wheel.h"
+
+#include <string.h>
+
+#define SLOT_MASK ((uint64_t)NN_CLI__TIMER_WHEEL_SLOT_NUM - 1)
+#define LEVEL_SHIFT(level) (NN_CLI__TIMER_WHEEL_SLOT_BITS * (level))
+#define MAX_DELTA \
+    (((uint64_t)1 << LEVEL_SHIFT(NN_CLI__TIMER_WHEEL_LEVEL_NUM)) - 1)
+
+static void LinkTimer(NNCli_Timer_t **a_head, NNCli_Timer_t *a_timer)
+{
+    a_timer->m_next = *a_head;
+    if (*a_head != NULL)
+    {
+        (*a_head)->m_pprev = &a_timer->m_next;
+    }
+    *a_head = a_timer;
+    a_timer->m_pprev = a_head;
+}
+
+static void UnlinkTimer(NNCli_Timer_t *a_timer)
+{
+    *a_timer->m_pprev = a_timer->m_next;
+    if (a_timer->m_next != NULL)
+    {
+        a_timer->m_next->m_pprev = a_timer->m_pprev;
+    }
+    a_timer->m_next = NULL;
+    a_timer->m_pprev = NULL;
+}
+
+static void PlaceTimer(NNCli_TimerWheel_t *a_wheel, NNCli_Timer_t *a_timer)
+{
+    uint64_t expire = a_timer->m_expire_tick;
+    if (expire <= a_wheel->m_current_tick)
+    {
+        expire = a_wheel->m_current_tick + 1;
+    }
+    uint64_t delta = expire - a_wheel->m_current_tick;
+    if (delta > MAX_DELTA)
+    {
+        // Placed at the end of the wheel and placed again when cascaded.
+        delta = MAX_DELTA;
+        expire = a_wheel->m_current_tick + delta;
+    }
+
+    int level = 0;
+    while (level < NN_CLI__TIMER_WHEEL_LEVEL_NUM - 1 &&
+           delta >= ((uint64_t)1 << LEVEL_SHIFT(level + 1)))
+    {
+        level++;
+    }
+
+    size_t slot = (expire >> LEVEL_SHIFT(level)) & SLOT_MASK;
+    LinkTimer(&a_wheel->m_slots[level][slot], a_timer);
+}
+
+// Moves the timers in the current slot of `a_level` to the lower levels.
+static void Cascade(NNCli_TimerWheel_t *a_wheel, int a_level)
+{
+    size_t slot = (a_wheel->m_current_tick >> LEVEL_SHIFT(a_level)) & SLOT_MASK;
+    NNCli_Timer_t *timer = a_wheel->m_slots[a_level][slot];
+    a_wheel->m_slots[a_level][slot] = NULL;
+
+    while (timer != NULL)
+    {
+        NNCli_Timer_t *next = timer->m_next;
+        timer->m_next = NULL;
+        timer->m_pprev = NULL;
+        PlaceTimer(a_wheel, timer);
+        timer = next;
+    }
+}
+
+static size_t FireCurrentSlot(NNCli_TimerWheel_t *a_wheel)
+{
+    size_t fired = 0;
+    size_t slot = a_wheel->m_current_tick & SLOT_MASK;
+
+    // Callbacks may add timers to this slot again, so take the list first.
+    NNCli_Timer_t *timer = a_wheel->m_slots[0][slot];
+    a_wheel->m_slots[0][slot] = NULL;
+    if (timer != NULL)
+    {
+        timer->m_pprev = &timer;
+    }
+
+    while (timer != NULL)
+    {
+        NNCli_Timer_t *current = timer;
+        UnlinkTimer(current);
+        if (current->m_expire_tick > a_wheel->m_current_tick)
+        {
+            // Beyond the range of the wheel when it was added.
+            PlaceTimer(a_wheel, current);
+            continue;
+        }
+
+        a_wheel->m_timer_num--;
+        fired++;
+        current->m_callback(current, current->m_ctx);
+    }
+
+    return fired;
+}
+
+void NNCli_TimerWheelInit(NNCli_TimerWheel_t *a_wheel, uint64_t a_now_tick)
+{
+    memset(a_wheel, 0, sizeof(*a_wheel));
+    a_wheel->m_current_tick = a_now_tick;
+}
+
+void NNCli_TimerInit(NNCli_Timer_t *a_timer, NNCli_TimerCallback_t a_callback,
+                     void *a_ctx)
+{
+    memset(a_timer, 0, sizeof(*a_timer));
+    a_timer->m_callback = a_callback;
+    a_timer->m_ctx = a_ctx;
+}
+
+bool NNCli_TimerIsPending(const NNCli_Timer_t *a_timer)
+{
+    return a_timer->m_pprev != NULL;
+}
+
+void NNCli_TimerWheelAdd(NNCli_TimerWheel_t *a_wheel, NNCli_Timer_t *a_timer,
+                         uint64_t a_expire_tick)
+{
+    NNCli_TimerWheelRemove(a_wheel, a_timer);
+    a_timer->m_expire_tick = a_expire_tick;
+    PlaceTimer(a_wheel, a_timer);
+    a_wheel->m_timer_num++;
+}
+
+void NNCli_TimerWheelRemove(NNCli_TimerWheel_t *a_wheel,
+                            NNCli_Timer_t *a_timer)
+{
+    if (NNCli_TimerIsPending(a_timer))
+    {
+        UnlinkTimer(a_timer);
+        a_wheel->m_timer_num--;
+    }
+}
+
+bool NNCli_TimerWheelGetNextExpiry(const NNCli_TimerWheel_t *a_wheel,
+                                   uint64_t *out_tick)
+{
+    bool found = false;
+    uint64_t earliest = UINT64_MAX;
+
+    if (a_wheel->m_timer_num == 0)
+    {
+        return false;
+    }
+
+    // In each level, slots after the current one cover later ticks, so only
+    // the first non-empty slot of each level has to be checked.
+    for (int level = 0; level < NN_CLI__TIMER_WHEEL_LEVEL_NUM; level++)
+    {
+        uint64_t current_slot = a_wheel->m_current_tick >> LEVEL_SHIFT(level);
+        for (uint64_t i = 1; i <= NN_CLI__TIMER_WHEEL_SLOT_NUM; i++)
+        {
+            const NNCli_Timer_t *timer =
+                a_wheel->m_slots[level][(current_slot + i) & SLOT_MASK];
+            if (timer == NULL)
+            {
+                continue;
+            }
+
+            for (; timer != NULL; timer = timer->m_next)
+            {
+                uint64_t expire = timer->m_expire_tick;
+                if (expire <= a_wheel->m_current_tick)
+                {
+                    expire = a_wheel->m_current_tick + 1;
+                }
+                if (expire < earliest)
+                {
+                    earliest = expire;
+                }
+            }
+            found = true;
+            break;
+        }
+    }
+
+    if (found)
+    {
+        *out_tick = earliest;
+    }
+    return found;
+}
+
+size_t NNCli_TimerWheelAdvance(NNCli_TimerWheel_t *a_wheel, uint64_t a_now_tick)
+{
+    size_t fired = 0;
+
+    while (a_wheel->m_current_tick < a_now_tick)
+    {
+        if (a_wheel->m_timer_num == 0)
+        {
+            a_wheel->m_current_tick = a_now_tick;
+            break;
+        }
+
+        a_wheel->m_current_tick++;
+
+        // When the lower level goes around, the next slot of the upper level
+        // is moved down. Start from the highest level which goes forward.
+        int level = 1;
+        while (level < NN_CLI__TIMER_WHEEL_LEVEL_NUM &&
+               (a_wheel->m_current_tick &
+                (((uint64_t)1 << LEVEL_SHIFT(level)) - 1)) == 0)
+        {
+            level++;
+        }
+        for (int i = level - 1; i >= 1; i--)
+        {
+            Cascade(a_wheel, i);
+        }
+
+        fired += FireCurrentSlot(a_wheel);
+    }
+
+    return fired;
+}
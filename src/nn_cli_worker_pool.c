@@ -0,0 +1,144 @@
+#include "nn_cli_worker_pool.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nn_cli_alloc.h"
+
+static void *RunWorker(void *a_arg)
+{
+    NNCli_WorkerPool_t *pool = (NNCli_WorkerPool_t *)a_arg;
+
+    pthread_mutex_lock(&pool->m_mutex);
+    while (!pool->m_is_stopping && pool->m_next < pool->m_job_num)
+    {
+        size_t index = pool->m_next++;
+
+        pthread_mutex_unlock(&pool->m_mutex);
+        pool->m_func(pool->m_ctx, index);
+        pthread_mutex_lock(&pool->m_mutex);
+
+        pool->m_is_done[index] = true;
+        pthread_cond_broadcast(&pool->m_cond);
+    }
+    pthread_mutex_unlock(&pool->m_mutex);
+    return NULL;
+}
+
+NNCli_Err_t NNCli_WorkerPoolStart(NNCli_WorkerPool_t *a_pool,
+                                  size_t a_thread_num, size_t a_job_num,
+                                  NNCli_WorkerJobFunc_t a_func, void *a_ctx)
+{
+    pthread_condattr_t attr;
+    sigset_t all_signals;
+    sigset_t prev_signals;
+
+    memset(a_pool, 0, sizeof(*a_pool));
+    a_pool->m_func = a_func;
+    a_pool->m_ctx = a_ctx;
+    a_pool->m_job_num = a_job_num;
+    a_pool->m_is_done = (bool *)NNCli_Calloc(a_job_num + 1, sizeof(bool));
+    if (a_pool->m_is_done == NULL)
+    {
+        NNCli_LogError("Failed to allocate memory for %zu jobs", a_job_num);
+        return NN_CLI__GENERAL_ERROR;
+    }
+    pthread_mutex_init(&a_pool->m_mutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&a_pool->m_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (a_thread_num > NN_CLI__FOREACH_THREAD_NUM)
+    {
+        a_thread_num = NN_CLI__FOREACH_THREAD_NUM;
+    }
+    if (a_thread_num > a_job_num)
+    {
+        a_thread_num = a_job_num;
+    }
+
+    // The threads inherit the signal mask.
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &prev_signals);
+    for (size_t i = 0; i < a_thread_num; i++)
+    {
+        if (pthread_create(&a_pool->m_threads[i], NULL, RunWorker, a_pool) !=
+            0)
+        {
+            break;
+        }
+        a_pool->m_thread_num++;
+    }
+    pthread_sigmask(SIG_SETMASK, &prev_signals, NULL);
+
+    if (a_pool->m_thread_num == 0 && a_job_num > 0)
+    {
+        NNCli_LogError("Failed to start the worker threads");
+        NNCli_WorkerPoolDestroy(a_pool);
+        return NN_CLI__GENERAL_ERROR;
+    }
+    return NN_CLI__SUCCESS;
+}
+
+NNCli_Err_t NNCli_WorkerPoolWait(NNCli_WorkerPool_t *a_pool, size_t a_index,
+                                 uint32_t a_timeout_ms)
+{
+    NNCli_Err_t res = NN_CLI__IN_PROGRESS;
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += a_timeout_ms / 1000;
+    deadline.tv_nsec += (long)(a_timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&a_pool->m_mutex);
+    while (true)
+    {
+        if (a_pool->m_is_done[a_index])
+        {
+            res = NN_CLI__SUCCESS;
+            break;
+        }
+        if (a_index >= a_pool->m_next && a_pool->m_is_stopping)
+        {
+            res = NN_CLI__CANCELLED;
+            break;
+        }
+        if (pthread_cond_timedwait(&a_pool->m_cond, &a_pool->m_mutex,
+                                   &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&a_pool->m_mutex);
+    return res;
+}
+
+void NNCli_WorkerPoolStop(NNCli_WorkerPool_t *a_pool)
+{
+    pthread_mutex_lock(&a_pool->m_mutex);
+    a_pool->m_is_stopping = true;
+    pthread_cond_broadcast(&a_pool->m_cond);
+    pthread_mutex_unlock(&a_pool->m_mutex);
+}
+
+void NNCli_WorkerPoolDestroy(NNCli_WorkerPool_t *a_pool)
+{
+    NNCli_WorkerPoolStop(a_pool);
+    for (size_t i = 0; i < a_pool->m_thread_num; i++)
+    {
+        pthread_join(a_pool->m_threads[i], NULL);
+    }
+    pthread_cond_destroy(&a_pool->m_cond);
+    pthread_mutex_destroy(&a_pool->m_mutex);
+    NNCli_Free(a_pool->m_is_done);
+    memset(a_pool, 0, sizeof(*a_pool));
+}
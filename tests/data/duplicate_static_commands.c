@@ -0,0 +1,11 @@
+// Input of the nn_cli_gen_commands_duplicate test. The generator has to reject
+// it because "dup" is registered twice.
+#include "nn_cli.h"
+
+static NNCli_Err_t DummyCmd(int argc, char **argv)
+{
+    return NN_CLI__SUCCESS;
+}
+
+NNCLI_COMMAND(dup_first, .m_func = DummyCmd, .m_name = "dup");
+NNCLI_COMMAND(dup_second, .m_func = DummyCmd, .m_name = "dup");
@@ -1,4 +1,6 @@
+import json
 import os
+import subprocess
 import pytest
 from typing import Generator
 
@@ -49,3 +51,40 @@ def test_sample_command(example_cli: ProcessIO) -> None:
     print("=== Sample command: invalid argument ===")
     assert example_cli.run_command("sample-status invalid", "Error input!")
     assert example_cli.run_command("sample-ctrl", "Error input!")
+
+
+def test_pipeline(example_cli: ProcessIO) -> None:
+    print("=== Pipeline and command sequence ===")
+    assert example_cli.run_command(
+        "help | grep mask", "mask: Turn on/off masking of input characters")
+
+    assert example_cli.run_command(
+        "sample-ctrl on ; sample-status", "Sample status: 'on'")
+
+
+def test_rpc_pipelining() -> None:
+    print("=== RPC mode ===")
+    THIS_FILE_PATH = os.path.abspath(__file__)
+    EXECUTABLE_FILE_PATH = os.path.join(
+        os.path.dirname(THIS_FILE_PATH), "../../examples/build/nn_cli_sample")
+
+    # All the requests are sent before any response is read.
+    requests = [
+        {"id": 1, "line": "sample-ctrl on"},
+        {"id": 2, "line": "sample-status"},
+        {"id": "x", "line": "sample-ctrl"},
+        {"id": 4, "line": "help | grep mask"},
+    ]
+    result = subprocess.run(
+        [EXECUTABLE_FILE_PATH, "--rpc"],
+        input="".join(json.dumps(r) + "\n" for r in requests),
+        capture_output=True, text=True, timeout=10)
+    assert result.returncode == 0
+
+    responses = [json.loads(line) for line in result.stdout.splitlines()]
+    assert [r["id"] for r in responses] == [1, 2, "x", 4]
+    assert responses[0]["status"] == 0
+    assert "Sample status changed to 'on'" in responses[0]["output"]
+    assert "Sample status: 'on'" in responses[1]["output"]
+    assert "Error input!" in responses[2]["output"]
+    assert "mask: Turn on/off masking" in responses[3]["output"]
@@ -0,0 +1,180 @@
+#include "nn_cli_alias.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+char s_pipe[] = "|";
+char s_sequence[] = ";";
+
+// Splits the line at spaces as nn_cli does. The strings are kept by
+// `a_storage`.
+std::vector<char *> Tokenize(const std::string &a_line,
+                             std::vector<std::string> *a_storage)
+{
+    std::istringstream stream(a_line);
+    std::string word;
+    std::vector<char *> tokens;
+
+    a_storage->clear();
+    while (stream >> word)
+    {
+        a_storage->push_back(word);
+    }
+    for (std::string &token : *a_storage)
+    {
+        tokens.push_back(token == "|"   ? s_pipe
+                         : token == ";" ? s_sequence
+                                        : &token[0]);
+    }
+    return tokens;
+}
+
+std::string Join(char *const *a_tokens, int a_token_num)
+{
+    std::string line;
+    for (int i = 0; i < a_token_num; i++)
+    {
+        line += (i == 0 ? "" : " ") + std::string(a_tokens[i]);
+    }
+    return line;
+}
+}  // namespace
+
+class NNCliAliasTest : public ::testing::Test
+{
+   protected:
+    void SetUp() override
+    {
+        NNCli_AliasTableInit(&m_table, s_pipe, s_sequence);
+    }
+
+    void TearDown() override { NNCli_AliasTableClear(&m_table); }
+
+    NNCli_Err_t Define(const char *a_name, const std::string &a_tokens)
+    {
+        std::vector<std::string> storage;
+        std::vector<char *> tokens = Tokenize(a_tokens, &storage);
+        return NNCli_AliasDefine(&m_table, a_name, tokens.data(),
+                                 (int)tokens.size());
+    }
+
+    // Returns the expanded line, or "error".
+    std::string Expand(const std::string &a_line, int a_max_token_num = 64)
+    {
+        std::vector<char *> tokens = Tokenize(a_line, &m_line_storage);
+        std::vector<char *> expanded(a_max_token_num);
+        int expanded_num;
+        if (NNCli_AliasExpand(&m_table, tokens.data(), (int)tokens.size(),
+                              expanded.data(), a_max_token_num,
+                              &expanded_num) != NN_CLI__SUCCESS)
+        {
+            return "error";
+        }
+        // A separator of the template is the same token as in the line.
+        for (int i = 0; i < expanded_num; i++)
+        {
+            if (std::string(expanded[i]) == "|")
+            {
+                EXPECT_EQ(expanded[i], s_pipe);
+            }
+        }
+        return Join(expanded.data(), expanded_num);
+    }
+
+    NNCli_AliasTable_t m_table;
+    std::vector<std::string> m_line_storage;
+};
+
+TEST_F(NNCliAliasTest, AliasIsExpandedAtCommands)
+{
+    ASSERT_EQ(Define("st", "sample-status"), NN_CLI__SUCCESS);
+
+    EXPECT_EQ(Expand("st"), "sample-status");
+    EXPECT_EQ(Expand("st -v | grep on"), "sample-status -v | grep on");
+    EXPECT_EQ(Expand("help ; st"), "help ; sample-status");
+    // Only the name of a command is expanded.
+    EXPECT_EQ(Expand("echo st"), "echo st");
+}
+
+TEST_F(NNCliAliasTest, MacroTakesArguments)
+{
+    ASSERT_EQ(Define("restart", "sample-ctrl off $1 ; sample-ctrl on $1 $2"),
+              NN_CLI__SUCCESS);
+
+    EXPECT_EQ(Expand("restart a b"),
+              "sample-ctrl off a ; sample-ctrl on a b");
+    // Arguments which are not referred to are appended.
+    EXPECT_EQ(Expand("restart a b c"),
+              "sample-ctrl off a ; sample-ctrl on a b c");
+    EXPECT_EQ(Expand("restart a"), "error");
+    EXPECT_EQ(Expand("restart a b | head 1"),
+              "sample-ctrl off a ; sample-ctrl on a b | head 1");
+}
+
+TEST_F(NNCliAliasTest, ExpansionIsNotExpandedAgain)
+{
+    ASSERT_EQ(Define("help", "help -v"), NN_CLI__SUCCESS);
+    ASSERT_EQ(Define("h", "help"), NN_CLI__SUCCESS);
+
+    EXPECT_EQ(Expand("help"), "help -v");
+    EXPECT_EQ(Expand("h"), "help");
+}
+
+TEST_F(NNCliAliasTest, RedefineAndRemove)
+{
+    ASSERT_EQ(Define("st", "sample-status"), NN_CLI__SUCCESS);
+    ASSERT_EQ(Define("ls", "help"), NN_CLI__SUCCESS);
+    ASSERT_EQ(Define("st", "sample-status -v"), NN_CLI__SUCCESS);
+    EXPECT_EQ(m_table.m_num, 2);
+    EXPECT_EQ(Expand("st"), "sample-status -v");
+
+    EXPECT_EQ(NNCli_AliasRemove(&m_table, "st"), NN_CLI__SUCCESS);
+    EXPECT_EQ(NNCli_AliasRemove(&m_table, "st"), NN_CLI__INVALID_ARGS);
+    EXPECT_EQ(Expand("st"), "st");
+    EXPECT_STREQ(m_table.m_aliases[0]->m_name, "ls");
+}
+
+TEST_F(NNCliAliasTest, InvalidDefinitions)
+{
+    EXPECT_EQ(Define("", "help"), NN_CLI__INVALID_ARGS);
+    EXPECT_EQ(Define("a=b", "help"), NN_CLI__INVALID_ARGS);
+    EXPECT_EQ(Define("$1", "help"), NN_CLI__INVALID_ARGS);
+    EXPECT_EQ(Define("empty", ""), NN_CLI__INVALID_ARGS);
+    EXPECT_EQ(Define("pipe", "| head"), NN_CLI__INVALID_ARGS);
+    EXPECT_EQ(m_table.m_num, 0);
+
+    for (int i = 0; i < NN_CLI__MAX_ALIAS_NUM; i++)
+    {
+        ASSERT_EQ(Define(("a" + std::to_string(i)).c_str(), "help"),
+                  NN_CLI__SUCCESS);
+    }
+    EXPECT_EQ(Define("one-more", "help"), NN_CLI__EXCEED_CAPACITY);
+    // Redefinition does not need room.
+    EXPECT_EQ(Define("a0", "help -v"), NN_CLI__SUCCESS);
+}
+
+TEST_F(NNCliAliasTest, ExpansionIsLimited)
+{
+    ASSERT_EQ(Define("four", "a b c d"), NN_CLI__SUCCESS);
+
+    EXPECT_EQ(Expand("four e", 5), "a b c d e");
+    EXPECT_EQ(Expand("four e f", 5), "error");
+}
+
+TEST_F(NNCliAliasTest, FormatRestoresDefinition)
+{
+    ASSERT_EQ(Define("restart", "sample-ctrl off $1 ; sample-ctrl on $1"),
+              NN_CLI__SUCCESS);
+    const NNCli_Alias_t *alias = NNCli_AliasFind(&m_table, "restart");
+    ASSERT_NE(alias, nullptr);
+
+    char buf[64];
+    ASSERT_TRUE(NNCli_AliasFormat(alias, buf, sizeof(buf)));
+    EXPECT_STREQ(buf, "restart = sample-ctrl off $1 ; sample-ctrl on $1");
+    EXPECT_FALSE(NNCli_AliasFormat(alias, buf, 20));
+}
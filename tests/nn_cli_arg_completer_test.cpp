@@ -0,0 +1,165 @@
+#include "nn_cli_arg_completer.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace
+{
+const int kInterfaceNum = 100000;
+std::atomic<int> s_slow_provider_ms(0);
+std::vector<std::string> s_last_argv;
+
+// if-00000 ... if-99999, added in reverse order and twice.
+void CompleteInterfaces(int argc, char **argv,
+                        NNCli_ArgCandidates_t *a_candidates)
+{
+    char name[16];
+
+    s_last_argv.assign(argv, argv + argc);
+    usleep(s_slow_provider_ms * 1000);
+    for (int i = kInterfaceNum - 1; i >= 0; i--)
+    {
+        snprintf(name, sizeof(name), "if-%05d", i);
+        NNCli_AddArgCandidate(a_candidates, name);
+        NNCli_AddArgCandidate(a_candidates, name);
+    }
+}
+
+void CompleteColors(int argc, char **argv, NNCli_ArgCandidates_t *a_candidates)
+{
+    for (const char *color : {"red", "green", "blue"})
+    {
+        NNCli_AddArgCandidate(a_candidates, color);
+    }
+}
+
+void AddCompletion(void *a_ctx, const char *a_candidate, size_t a_len)
+{
+    static_cast<std::vector<std::string> *>(a_ctx)->push_back(
+        std::string(a_candidate, a_len));
+}
+}  // namespace
+
+class NNCliArgCompleterTest : public ::testing::Test
+{
+   protected:
+    void SetUp() override
+    {
+        s_slow_provider_ms = 0;
+        NNCli_ArgCompleterInit(&m_completer, 1000, 10000);
+    }
+
+    void TearDown() override { NNCli_ArgCompleterDestroy(&m_completer); }
+
+    NNCli_Err_t Lookup(NNCli_CompleteArgsFunc_t a_func, const char *a_head,
+                       const char *a_prefix, std::vector<std::string> *out)
+    {
+        out->clear();
+        return NNCli_ArgCompleterLookup(&m_completer, a_func, a_head,
+                                        a_prefix, 4, AddCompletion, out);
+    }
+
+    NNCli_ArgCompleter_t m_completer;
+};
+
+TEST_F(NNCliArgCompleterTest, CandidatesAreNarrowedWithoutFetchingAgain)
+{
+    std::vector<std::string> completions;
+
+    // Too many candidates. Their common prefix is completed.
+    ASSERT_EQ(Lookup(CompleteInterfaces, "ifconfig up ", "", &completions),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(completions, std::vector<std::string>{"if-"});
+    EXPECT_EQ(s_last_argv,
+              (std::vector<std::string>{"ifconfig", "up", ""}));
+
+    ASSERT_EQ(Lookup(CompleteInterfaces, "ifconfig up ", "if-1234",
+                     &completions),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(completions, (std::vector<std::string>{"if-12340", "if-12341",
+                                                     "if-12342", "if-12343"}));
+    ASSERT_EQ(Lookup(CompleteInterfaces, "ifconfig up ", "if-12345",
+                     &completions),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(completions, std::vector<std::string>{"if-12345"});
+
+    // Going back to a shorter argument uses the same candidates.
+    ASSERT_EQ(Lookup(CompleteInterfaces, "ifconfig up ", "if-9999",
+                     &completions),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(completions.size(), 4);
+    ASSERT_EQ(Lookup(CompleteInterfaces, "ifconfig up ", "x", &completions),
+              NN_CLI__SUCCESS);
+    EXPECT_TRUE(completions.empty());
+    EXPECT_EQ(m_completer.m_fetch_num, 1);
+}
+
+TEST_F(NNCliArgCompleterTest, OtherQueriesAreFetched)
+{
+    std::vector<std::string> completions;
+
+    ASSERT_EQ(Lookup(CompleteColors, "paint ", "", &completions),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(completions,
+              (std::vector<std::string>{"blue", "green", "red"}));
+
+    // The preceding words are a part of the query.
+    ASSERT_EQ(Lookup(CompleteColors, "paint red ", "g", &completions),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(completions, std::vector<std::string>{"green"});
+    EXPECT_EQ(m_completer.m_fetch_num, 2);
+
+    // The candidates fetched for "g" do not cover "b".
+    ASSERT_EQ(Lookup(CompleteColors, "paint red ", "b", &completions),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(completions, std::vector<std::string>{"blue"});
+    EXPECT_EQ(m_completer.m_fetch_num, 3);
+}
+
+TEST_F(NNCliArgCompleterTest, SlowProviderRunsInBackground)
+{
+    std::vector<std::string> completions;
+    NNCli_ArgCompleterDestroy(&m_completer);
+    NNCli_ArgCompleterInit(&m_completer, 20, 10000);
+    s_slow_provider_ms = 300;
+
+    ASSERT_EQ(Lookup(CompleteInterfaces, "ifconfig ", "if-0000", &completions),
+              NN_CLI__IN_PROGRESS);
+    EXPECT_TRUE(completions.empty());
+    // The next keystrokes wait for the same fetch.
+    ASSERT_EQ(Lookup(CompleteInterfaces, "ifconfig ", "if-00001",
+                     &completions),
+              NN_CLI__IN_PROGRESS);
+
+    for (int i = 0; i < 100; i++)
+    {
+        if (Lookup(CompleteInterfaces, "ifconfig ", "if-00001",
+                   &completions) == NN_CLI__SUCCESS)
+        {
+            break;
+        }
+    }
+    EXPECT_EQ(completions, std::vector<std::string>{"if-00001"});
+    EXPECT_EQ(m_completer.m_fetch_num, 1);
+}
+
+TEST_F(NNCliArgCompleterTest, CandidatesExpire)
+{
+    std::vector<std::string> completions;
+    NNCli_ArgCompleterDestroy(&m_completer);
+    NNCli_ArgCompleterInit(&m_completer, 1000, 50);
+
+    ASSERT_EQ(Lookup(CompleteColors, "paint ", "", &completions),
+              NN_CLI__SUCCESS);
+    usleep(100 * 1000);
+    ASSERT_EQ(Lookup(CompleteColors, "paint ", "r", &completions),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(completions, std::vector<std::string>{"red"});
+    EXPECT_EQ(m_completer.m_fetch_num, 2);
+}
@@ -0,0 +1,129 @@
+#include "nn_cli_history_index.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include <string>
+
+namespace
+{
+uint64_t GetMonotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+}  // namespace
+
+class NNCliHistoryIndexTest : public ::testing::Test
+{
+   protected:
+    void SetUp() override { NNCli_HistoryIndexInit(&m_index, 4); }
+    void TearDown() override { NNCli_HistoryIndexDestroy(&m_index); }
+
+    std::string Suggest(const char *a_prefix)
+    {
+        const char *line = NNCli_HistoryIndexSuggest(&m_index, a_prefix);
+        return (line != nullptr) ? line : "(none)";
+    }
+
+    NNCli_HistoryIndex_t m_index;
+};
+
+TEST_F(NNCliHistoryIndexTest, SuggestsMostRecent)
+{
+    EXPECT_EQ(Suggest("s"), "(none)");
+    NNCli_HistoryIndexAdd(&m_index, "status");
+    NNCli_HistoryIndexAdd(&m_index, "start 1");
+    NNCli_HistoryIndexAdd(&m_index, "stop");
+
+    EXPECT_EQ(Suggest("st"), "stop");
+    EXPECT_EQ(Suggest("sta"), "start 1");
+    EXPECT_EQ(Suggest("statu"), "status");
+    // Only longer entries are suggested, and nothing for an empty line.
+    EXPECT_EQ(Suggest("stop"), "(none)");
+    EXPECT_EQ(Suggest("x"), "(none)");
+    EXPECT_EQ(Suggest(""), "(none)");
+
+    // Adding an entry again makes it the most recent.
+    NNCli_HistoryIndexAdd(&m_index, "status");
+    EXPECT_EQ(Suggest("st"), "status");
+    EXPECT_EQ(NNCli_HistoryIndexGetNum(&m_index), 3u);
+}
+
+TEST_F(NNCliHistoryIndexTest, DropsOldest)
+{
+    const char *lines[] = {"a1", "a2", "a3", "a4", "a5", "a2"};
+    for (const char *line : lines)
+    {
+        NNCli_HistoryIndexAdd(&m_index, line);
+        EXPECT_EQ(Suggest("a"), line);
+    }
+    EXPECT_EQ(NNCli_HistoryIndexGetNum(&m_index), 4u);
+    EXPECT_EQ(Suggest("a1"), "(none)");
+
+    // Many lines without lookups, e.g. from a history file, are merged at
+    // once.
+    for (int i = 0; i < 20; i++)
+    {
+        std::string line = "b" + std::to_string(i % 7) + "x";
+        NNCli_HistoryIndexAdd(&m_index, line.c_str());
+    }
+    EXPECT_EQ(NNCli_HistoryIndexGetNum(&m_index), 4u);
+    EXPECT_EQ(Suggest("b"), "b5x");
+    EXPECT_EQ(Suggest("b2"), "b2x");
+    EXPECT_EQ(Suggest("b1"), "(none)");
+    EXPECT_EQ(Suggest("a"), "(none)");
+}
+
+TEST_F(NNCliHistoryIndexTest, NotInitialized)
+{
+    NNCli_HistoryIndexDestroy(&m_index);
+    EXPECT_EQ(NNCli_HistoryIndexAdd(&m_index, "help"), NN_CLI__NOT_READY);
+    EXPECT_EQ(Suggest("h"), "(none)");
+}
+
+// Looks up a history of 100k entries as a line is typed. A one-character
+// prefix which matches every entry is the slowest case.
+TEST_F(NNCliHistoryIndexTest, Suggest_100kEntries)
+{
+    const int kEntryNum = 100000;
+    const char *prefixes[] = {"c", "command 1", "command 12345", "x"};
+    char line[64];
+
+    NNCli_HistoryIndexDestroy(&m_index);
+    NNCli_HistoryIndexInit(&m_index, kEntryNum);
+    uint64_t start_ns = GetMonotonicNs();
+    for (int i = 0; i < kEntryNum; i++)
+    {
+        snprintf(line, sizeof(line), "command %d --flag",
+                 (i * 7919) % kEntryNum);
+        ASSERT_EQ(NNCli_HistoryIndexAdd(&m_index, line), NN_CLI__SUCCESS);
+    }
+    EXPECT_EQ(NNCli_HistoryIndexGetNum(&m_index), (size_t)kEntryNum);
+    printf("Indexed %d entries in %.1f ms\n", kEntryNum,
+           (GetMonotonicNs() - start_ns) / 1e6);
+
+    // A command run adds one entry before the next keystroke.
+    start_ns = GetMonotonicNs();
+    NNCli_HistoryIndexAdd(&m_index, "command 5 --new");
+    EXPECT_EQ(Suggest("command 5"), "command 5 --new");
+    printf("Added one entry in %.1f us\n", (GetMonotonicNs() - start_ns) / 1e3);
+
+    for (const char *prefix : prefixes)
+    {
+        const int kLookupNum = 100;
+        start_ns = GetMonotonicNs();
+        for (int i = 0; i < kLookupNum; i++)
+        {
+            NNCli_HistoryIndexSuggest(&m_index, prefix);
+        }
+        uint64_t ns = (GetMonotonicNs() - start_ns) / kLookupNum;
+        printf("\"%s\": %.1f us per lookup\n", prefix, ns / 1e3);
+        EXPECT_LT(ns, 1000000u);
+    }
+    EXPECT_EQ(Suggest("c"), "command 5 --new");
+    EXPECT_EQ(Suggest("command 12345"), "command 12345 --flag");
+}
@@ -0,0 +1,269 @@
+#include "nn_cli_history.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check_config.h"
+
+namespace
+{
+void AddEntry(void *a_ctx, const char *a_line)
+{
+    static_cast<std::vector<std::string> *>(a_ctx)->push_back(a_line);
+}
+
+// Appends as another process which does not lock the file would.
+void AppendRaw(const std::string &a_filename, const std::string &a_data)
+{
+    std::ofstream file(a_filename, std::ios::app | std::ios::binary);
+    file << a_data;
+}
+
+std::string ReadFile(const std::string &a_filename)
+{
+    std::ifstream file(a_filename, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+}  // namespace
+
+class NNCliHistoryTest : public ::testing::Test
+{
+   protected:
+    void SetUp() override
+    {
+        char filename[] = "/tmp/nncli_shared_history_XXXXXX";
+        int fd = mkstemp(filename);
+        ASSERT_GE(fd, 0);
+        close(fd);
+        m_filename = filename;
+    }
+
+    void TearDown() override { unlink(m_filename.c_str()); }
+
+    void Open(NNCli_SharedHistory_t *a_history,
+              std::vector<std::string> *a_entries, size_t a_max_num = 0)
+    {
+        ASSERT_EQ(NNCli_SharedHistoryOpen(a_history, m_filename.c_str(),
+                                          a_max_num, AddEntry, a_entries),
+                  NN_CLI__SUCCESS);
+    }
+
+    // Appends `entry-00\n` and so on.
+    void AppendEntries(const std::string &a_prefix, int a_begin, int a_end)
+    {
+        std::string data;
+        for (int i = a_begin; i < a_end; i++)
+        {
+            data += a_prefix + (i < 10 ? "0" : "") + std::to_string(i) + "\n";
+        }
+        AppendRaw(m_filename, data);
+    }
+
+    std::string m_filename;
+};
+
+TEST_F(NNCliHistoryTest, OpenLoadsEntries)
+{
+    AppendRaw(m_filename, "first\nsecond\n");
+
+    NNCli_SharedHistory_t history;
+    std::vector<std::string> entries;
+    Open(&history, &entries);
+    EXPECT_EQ(entries, (std::vector<std::string>{"first", "second"}));
+    NNCli_SharedHistoryClose(&history);
+}
+
+TEST_F(NNCliHistoryTest, EntriesOfOtherSessionsAreMerged)
+{
+    NNCli_SharedHistory_t history_a;
+    NNCli_SharedHistory_t history_b;
+    std::vector<std::string> entries_a;
+    std::vector<std::string> entries_b;
+    Open(&history_a, &entries_a);
+    Open(&history_b, &entries_b);
+
+    ASSERT_EQ(NNCli_SharedHistoryAppend(&history_a, "from-a"),
+              NN_CLI__SUCCESS);
+    // The entry of A is merged before the one of B is appended.
+    ASSERT_EQ(NNCli_SharedHistoryAppend(&history_b, "from-b"),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(entries_b, std::vector<std::string>{"from-a"});
+
+    NNCli_SharedHistoryMerge(&history_a);
+    EXPECT_EQ(entries_a, std::vector<std::string>{"from-b"});
+    NNCli_SharedHistoryMerge(&history_a);
+    EXPECT_EQ(entries_a.size(), 1);
+
+    EXPECT_EQ(ReadFile(m_filename), "from-a\nfrom-b\n");
+    NNCli_SharedHistoryClose(&history_a);
+    NNCli_SharedHistoryClose(&history_b);
+}
+
+TEST_F(NNCliHistoryTest, OnlyTheTailIsRead)
+{
+    AppendRaw(m_filename, "old\n");
+    NNCli_SharedHistory_t history;
+    std::vector<std::string> entries;
+    Open(&history, &entries);
+    entries.clear();
+
+    // An entry is taken in when its newline has been written.
+    AppendRaw(m_filename, "par");
+    NNCli_SharedHistoryMerge(&history);
+    EXPECT_TRUE(entries.empty());
+    AppendRaw(m_filename, "tial\n");
+    NNCli_SharedHistoryMerge(&history);
+    EXPECT_EQ(entries, std::vector<std::string>{"partial"});
+
+    // Someone rewrites the file. Only the entries appended after that are
+    // read.
+    ASSERT_EQ(truncate(m_filename.c_str(), 0), 0);
+    NNCli_SharedHistoryMerge(&history);
+    AppendRaw(m_filename, "new\n");
+    NNCli_SharedHistoryMerge(&history);
+    EXPECT_EQ(entries, (std::vector<std::string>{"partial", "new"}));
+    NNCli_SharedHistoryClose(&history);
+}
+
+TEST_F(NNCliHistoryTest, TooLongEntryIsSkipped)
+{
+    NNCli_SharedHistory_t history;
+    std::vector<std::string> entries;
+    Open(&history, &entries);
+
+    AppendRaw(m_filename, std::string(5000, 'x') + "\nok\n");
+    NNCli_SharedHistoryMerge(&history);
+    EXPECT_EQ(entries, std::vector<std::string>{"ok"});
+
+    EXPECT_EQ(NNCli_SharedHistoryAppend(&history, "two\nlines"),
+              NN_CLI__INVALID_ARGS);
+    NNCli_SharedHistoryClose(&history);
+}
+
+TEST_F(NNCliHistoryTest, OpenCompactsLongFile)
+{
+    NNCli_SharedHistory_t history;
+    std::vector<std::string> entries;
+
+    // Up to NN_CLI__SHARED_HISTORY_COMPACT_FACTOR times the entries are kept.
+    AppendEntries("entry-", 0, 5 * NN_CLI__SHARED_HISTORY_COMPACT_FACTOR);
+    std::string content = ReadFile(m_filename);
+    Open(&history, &entries, 5);
+    NNCli_SharedHistoryClose(&history);
+    EXPECT_EQ(ReadFile(m_filename), content);
+
+    // All the entries are read, and then only the last ones are kept.
+    AppendEntries("entry-", 5 * NN_CLI__SHARED_HISTORY_COMPACT_FACTOR, 50);
+    AppendRaw(m_filename, "partial");
+    entries.clear();
+    Open(&history, &entries, 5);
+    EXPECT_EQ(entries.size(), 50u);
+    EXPECT_EQ(ReadFile(m_filename),
+              "entry-45\nentry-46\nentry-47\nentry-48\nentry-49\npartial");
+
+    // The offset has been moved with the entries.
+    AppendRaw(m_filename, "\n");
+    ASSERT_EQ(NNCli_SharedHistoryAppend(&history, "own"), NN_CLI__SUCCESS);
+    EXPECT_EQ(entries.back(), "partial");
+    EXPECT_EQ(ReadFile(m_filename),
+              "entry-45\nentry-46\nentry-47\nentry-48\nentry-49\npartial\n"
+              "own\n");
+    NNCli_SharedHistoryClose(&history);
+}
+
+TEST_F(NNCliHistoryTest, OtherSessionsSurviveCompaction)
+{
+    NNCli_SharedHistory_t history_a;
+    NNCli_SharedHistory_t history_b;
+    std::vector<std::string> entries_a;
+    std::vector<std::string> entries_b;
+
+    AppendEntries("entry-", 0, 50);
+    Open(&history_a, &entries_a);
+    Open(&history_b, &entries_b, 5);
+    entries_a.clear();
+
+    // A has read past the new end. When the file has grown past it again, A
+    // does not take a part of an entry.
+    AppendEntries("appended-", 0, 60);
+    NNCli_SharedHistoryMerge(&history_a);
+    ASSERT_FALSE(entries_a.empty());
+    for (const std::string &entry : entries_a)
+    {
+        EXPECT_EQ(entry.size(), 11u) << entry;
+        EXPECT_EQ(entry.rfind("appended-", 0), 0u) << entry;
+    }
+    EXPECT_EQ(entries_a.back(), "appended-59");
+    NNCli_SharedHistoryClose(&history_a);
+    NNCli_SharedHistoryClose(&history_b);
+}
+
+TEST_F(NNCliHistoryTest, ConcurrentAppendsDoNotCollide)
+{
+    const int process_num = 4;
+    const int entry_num = 200;
+
+    for (int p = 0; p < process_num; p++)
+    {
+        pid_t pid = fork();
+        ASSERT_GE(pid, 0);
+        if (pid == 0)
+        {
+            NNCli_SharedHistory_t history;
+            std::vector<std::string> entries;
+            if (NNCli_SharedHistoryOpen(&history, m_filename.c_str(), 0,
+                                        AddEntry, &entries) != NN_CLI__SUCCESS)
+            {
+                _exit(1);
+            }
+            for (int i = 0; i < entry_num; i++)
+            {
+                std::string entry = "process-" + std::to_string(p) +
+                                    "-entry-" + std::to_string(i);
+                if (NNCli_SharedHistoryAppend(&history, entry.c_str()) !=
+                    NN_CLI__SUCCESS)
+                {
+                    _exit(1);
+                }
+            }
+            NNCli_SharedHistoryClose(&history);
+            _exit(0);
+        }
+    }
+    for (int p = 0; p < process_num; p++)
+    {
+        int status;
+        wait(&status);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    NNCli_SharedHistory_t history;
+    std::vector<std::string> entries;
+    Open(&history, &entries);
+    ASSERT_EQ(entries.size(), process_num * entry_num);
+
+    // The entries of each process are whole and in order.
+    std::vector<int> next(process_num, 0);
+    for (const std::string &entry : entries)
+    {
+        int p;
+        int i;
+        ASSERT_EQ(sscanf(entry.c_str(), "process-%d-entry-%d", &p, &i), 2)
+            << entry;
+        ASSERT_TRUE(p >= 0 && p < process_num);
+        EXPECT_EQ(i, next[p]++);
+    }
+    NNCli_SharedHistoryClose(&history);
+}
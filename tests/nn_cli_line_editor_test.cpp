@@ -0,0 +1,218 @@
+#include "nn_cli_line_editor.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+void AppendEcho(void *a_ctx, const char *a_data, size_t a_len)
+{
+    static_cast<std::string *>(a_ctx)->append(a_data, a_len);
+}
+
+// Suggests the rest of "history" for its prefixes.
+const char *HintHistory(void *a_ctx, const char *a_line)
+{
+    static const char kLine[] = "history";
+    size_t len = strlen(a_line);
+    return (strncmp(kLine, a_line, len) == 0) ? &kLine[len] : nullptr;
+}
+
+uint64_t GetMonotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+}  // namespace
+
+class NNCliLineEditorTest : public ::testing::Test
+{
+   protected:
+    void SetUp() override
+    {
+        NNCli_LineEditorInit(&m_editor, m_buf, sizeof(m_buf), "> ", AppendEcho,
+                             &m_echo);
+        NNCli_LineEditorStart(&m_editor);
+    }
+
+    std::vector<NNCli_LineEditorEvent_t> Feed(const std::string &a_keys)
+    {
+        std::vector<NNCli_LineEditorEvent_t> events;
+        for (char c : a_keys)
+        {
+            NNCli_LineEditorEvent_t event = NNCli_LineEditorFeed(&m_editor, c);
+            if (event != NN_CLI__LINE_EDITOR_EVENT_NONE)
+            {
+                events.push_back(event);
+            }
+        }
+        return events;
+    }
+
+    std::string Line() { return NNCli_LineEditorGetLine(&m_editor); }
+
+    NNCli_LineEditor_t m_editor;
+    char m_buf[16];
+    std::string m_echo;
+};
+
+TEST_F(NNCliLineEditorTest, TypeAndEnter)
+{
+    EXPECT_EQ(m_echo, "> ");
+    EXPECT_TRUE(Feed("help").empty());
+    EXPECT_EQ(m_echo, "> help");
+
+    EXPECT_EQ(Feed("\r\n"), std::vector<NNCli_LineEditorEvent_t>{
+                                NN_CLI__LINE_EDITOR_EVENT_LINE});
+    EXPECT_EQ(Line(), "help");
+    EXPECT_EQ(m_echo, "> help\r\n");
+}
+
+TEST_F(NNCliLineEditorTest, EditInTheMiddle)
+{
+    // Left arrow twice, then Backspace and Delete.
+    Feed("abcde\x1b[D\x1b[D\x7f\x1b[3~");
+    EXPECT_EQ(Line(), "abe");
+
+    // Home, Ctrl-F, Ctrl-K
+    Feed("\x1bOH\x06\x0b");
+    EXPECT_EQ(Line(), "a");
+
+    Feed(" bc  de\x17");
+    EXPECT_EQ(Line(), "a bc  ");
+    Feed("\x01x\x05y");
+    EXPECT_EQ(Line(), "xa bc  y");
+    Feed("\x15");
+    EXPECT_EQ(Line(), "");
+}
+
+TEST_F(NNCliLineEditorTest, InterruptAndEof)
+{
+    EXPECT_EQ(Feed("abc\x03"), std::vector<NNCli_LineEditorEvent_t>{
+                                   NN_CLI__LINE_EDITOR_EVENT_INTERRUPT});
+    EXPECT_EQ(Line(), "");
+
+    // Ctrl-D deletes a character unless the line is empty.
+    Feed("ab\x1b[D\x04");
+    EXPECT_EQ(Line(), "a");
+    EXPECT_TRUE(Feed("\x1b[D\x04").empty());
+    EXPECT_EQ(Feed("\x04"), std::vector<NNCli_LineEditorEvent_t>{
+                                NN_CLI__LINE_EDITOR_EVENT_EOF});
+}
+
+TEST_F(NNCliLineEditorTest, BufferFull)
+{
+    Feed(std::string(20, 'a'));
+    EXPECT_EQ(Line(), std::string(sizeof(m_buf) - 1, 'a'));
+}
+
+TEST_F(NNCliLineEditorTest, GrowableBuffer)
+{
+    NNCli_LineEditorInit(&m_editor, nullptr, 0, "> ", AppendEcho, &m_echo);
+    NNCli_LineEditorStart(&m_editor);
+    EXPECT_EQ(Line(), "");
+
+    std::string line;
+    for (int i = 0; i < 1000; i++)
+    {
+        line += std::to_string(i % 10);
+    }
+    Feed(line);
+    EXPECT_EQ(Line(), line);
+
+    // Edit at both ends of the gap after the buffer has grown.
+    Feed("\x01" "ab\x1b[C\x7f\x05\x7fz\x01\x1b[C\x1b[C\x0b");
+    EXPECT_EQ(Line(), "ab");
+    NNCli_LineEditorDestroy(&m_editor);
+}
+
+TEST_F(NNCliLineEditorTest, LongLineIsScrolled)
+{
+    NNCli_LineEditorSetColumns(&m_editor, 8);
+    // 5 columns are visible after "> " and before the last column.
+    Feed("abcde");
+    EXPECT_EQ(m_echo, "> abcde");
+
+    m_echo.clear();
+    Feed("f");
+    EXPECT_EQ(m_echo, "\r> bcdef\x1b[0K\r\x1b[7C");
+
+    m_echo.clear();
+    Feed("\x01");
+    EXPECT_EQ(m_echo, "\r> abcde\x1b[0K\r\x1b[2C");
+    EXPECT_EQ(Line(), "abcdef");
+}
+
+TEST_F(NNCliLineEditorTest, HintIsShownAndAccepted)
+{
+    NNCli_LineEditorSetHint(&m_editor, HintHistory, nullptr);
+    m_echo.clear();
+    Feed("h");
+    EXPECT_EQ(m_echo, "h\x1b[0K\x1b[90mistory\x1b[0m\x1b[6D");
+
+    // The hint goes when the line no longer matches.
+    Feed("ix");
+    m_echo.clear();
+    Feed("\x7f");
+    EXPECT_EQ(m_echo, "\r> hi\x1b[0K\x1b[90mstory\x1b[0m\r\x1b[4C");
+
+    // Not shown while the cursor is not at the end.
+    m_echo.clear();
+    Feed("\x1b[D");
+    EXPECT_EQ(m_echo, "\r> hi\x1b[0K\r\x1b[3C");
+
+    // The right arrow moves the cursor, then accepts the hint.
+    Feed("\x1b[C\x1b[C");
+    EXPECT_EQ(Line(), "history");
+
+    Feed("\x7f\x7f\x06");
+    EXPECT_EQ(Line(), "history");
+    m_echo.clear();
+    Feed("\x7f\r");
+    EXPECT_EQ(m_echo,
+              "\r> histor\x1b[0K\x1b[90my\x1b[0m\r\x1b[8C\x1b[0K\r\n");
+    EXPECT_EQ(Line(), "histor");
+}
+
+// Edits in the middle of a 100 KB line. Each keystroke is O(1) in the buffer
+// and redraws only the visible part of the line.
+TEST_F(NNCliLineEditorTest, EditInsideLongLine)
+{
+    const size_t kLineLen = 100 * 1024;
+    const int kEditNum = 10000;
+    NNCli_LineEditorInit(&m_editor, nullptr, 0, "> ", AppendEcho, &m_echo);
+    NNCli_LineEditorSetColumns(&m_editor, 80);
+    NNCli_LineEditorStart(&m_editor);
+    Feed(std::string(kLineLen, 'a'));
+
+    // Ctrl-A, then to the middle of the line.
+    Feed("\x01");
+    for (size_t i = 0; i < kLineLen / 2; i++)
+    {
+        NNCli_LineEditorFeed(&m_editor, 6);
+    }
+
+    m_echo.clear();
+    uint64_t start_ns = GetMonotonicNs();
+    for (int i = 0; i < kEditNum; i++)
+    {
+        NNCli_LineEditorFeed(&m_editor, 'b');
+        NNCli_LineEditorFeed(&m_editor, 'c');
+        NNCli_LineEditorFeed(&m_editor, 0x7f);
+    }
+    uint64_t elapsed_ns = GetMonotonicNs() - start_ns;
+    printf("%d keystrokes inside a %zu byte line: %.1f ns per keystroke\n",
+           kEditNum * 3, kLineLen, (double)elapsed_ns / (kEditNum * 3));
+
+    EXPECT_LT(m_echo.size(), (size_t)kEditNum * 3 * 100);
+    std::string line = Line();
+    ASSERT_EQ(line.size(), kLineLen + kEditNum);
+    EXPECT_EQ(line.substr(kLineLen / 2, 3), "bbb");
+    NNCli_LineEditorDestroy(&m_editor);
+}
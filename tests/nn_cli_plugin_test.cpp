@@ -0,0 +1,194 @@
+#include "nn_cli_plugin.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+namespace
+{
+NNCli_Err_t Proxy(int argc, char **argv) { return NN_CLI__SUCCESS; }
+
+void CompleteProxy(int argc, char **argv, NNCli_ArgCandidates_t *a_candidates)
+{
+}
+
+uint64_t GetMonotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// The resident set size in KB.
+long GetRssKb()
+{
+    long size = 0;
+    long resident = 0;
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (file != nullptr)
+    {
+        if (fscanf(file, "%ld %ld", &size, &resident) != 2)
+        {
+            resident = 0;
+        }
+        fclose(file);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+const char kCommands[] =
+    "command echo|TestPlugin_EchoCmd|Print the words|WORDS\n"
+    "command paint|TestPlugin_EchoCmd|Paint||TestPlugin_CompleteColor\n";
+}  // namespace
+
+class NNCliPluginTest : public ::testing::Test
+{
+   protected:
+    void SetUp() override
+    {
+        NNCli_PluginTableInit(&m_table);
+        char filename[] = "/tmp/nncli_test_manifest_XXXXXX";
+        int fd = mkstemp(filename);
+        ASSERT_NE(fd, -1);
+        close(fd);
+        m_manifest = filename;
+    }
+
+    void TearDown() override
+    {
+        NNCli_PluginTableClear(&m_table);
+        remove(m_manifest.c_str());
+    }
+
+    NNCli_Err_t Load(const std::string &a_content)
+    {
+        std::ofstream(m_manifest) << a_content;
+        return LoadManifest();
+    }
+
+    NNCli_Err_t LoadManifest()
+    {
+        return NNCli_PluginTableLoad(&m_table, m_manifest.c_str(), Proxy,
+                                     CompleteProxy);
+    }
+
+    NNCli_PluginTable_t m_table;
+    std::string m_manifest;
+};
+
+TEST_F(NNCliPluginTest, LoadedOnFirstUse)
+{
+    ASSERT_EQ(Load(std::string("# Test\n\nplugin ") + NN_CLI_TEST_PLUGIN_PATH +
+                   "\n" + kCommands),
+              NN_CLI__SUCCESS);
+    ASSERT_EQ(m_table.m_command_num, 2u);
+
+    NNCli_PluginCommand_t *echo = NNCli_PluginFind(&m_table, "echo");
+    ASSERT_NE(echo, nullptr);
+    EXPECT_EQ(echo->m_command.m_func, Proxy);
+    EXPECT_STREQ(echo->m_command.m_help_msg, "Print the words");
+    EXPECT_STREQ(echo->m_command.m_options, "WORDS");
+    EXPECT_EQ(echo->m_command.m_complete_args, nullptr);
+    NNCli_PluginCommand_t *paint = NNCli_PluginFind(&m_table, "paint");
+    ASSERT_NE(paint, nullptr);
+    EXPECT_EQ(paint->m_command.m_options, nullptr);
+    EXPECT_EQ(paint->m_command.m_complete_args, CompleteProxy);
+    EXPECT_EQ(NNCli_PluginFind(&m_table, "no-such-command"), nullptr);
+    EXPECT_EQ(m_table.m_plugins[0]->m_handle, nullptr);
+
+    ASSERT_EQ(NNCli_PluginResolve(&m_table, echo), NN_CLI__SUCCESS);
+    EXPECT_NE(m_table.m_plugins[0]->m_handle, nullptr);
+    char arg0[] = "echo";
+    char arg1[] = "hi";
+    char *argv[] = {arg0, arg1};
+    EXPECT_EQ(echo->m_func(2, argv), NN_CLI__SUCCESS);
+    EXPECT_EQ(echo->m_func(1, argv), NN_CLI__INVALID_ARGS);
+
+    ASSERT_EQ(NNCli_PluginResolve(&m_table, paint), NN_CLI__SUCCESS);
+    EXPECT_NE(paint->m_complete_args, nullptr);
+}
+
+TEST_F(NNCliPluginTest, RelativeToManifest)
+{
+    // The manifest is put next to the plugin.
+    std::string path = NN_CLI_TEST_PLUGIN_PATH;
+    size_t slash = path.rfind('/');
+    remove(m_manifest.c_str());
+    m_manifest = path.substr(0, slash) + "/nncli_test_plugins.manifest";
+    ASSERT_EQ(Load("plugin " + path.substr(slash + 1) + "\n" + kCommands),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(NNCli_PluginResolve(&m_table, NNCli_PluginFind(&m_table, "echo")),
+              NN_CLI__SUCCESS);
+}
+
+TEST_F(NNCliPluginTest, InvalidManifest)
+{
+    EXPECT_EQ(NNCli_PluginTableLoad(&m_table, "/nonexistent/manifest", Proxy,
+                                    CompleteProxy),
+              NN_CLI__INVALID_ARGS);
+
+    ASSERT_EQ(Load("command orphan|Sym|Before any plugin\n"
+                   "plugin /nonexistent/plugin.so\n"
+                   "command no-help|Sym\n"
+                   "command two words|Sym|Help\n"
+                   "unknown line\n"
+                   "command missing|Sym|Help\n"),
+              NN_CLI__SUCCESS);
+    ASSERT_EQ(m_table.m_command_num, 1u);
+
+    // The plugin is tried again each time.
+    NNCli_PluginCommand_t *missing = NNCli_PluginFind(&m_table, "missing");
+    ASSERT_NE(missing, nullptr);
+    EXPECT_EQ(NNCli_PluginResolve(&m_table, missing),
+              NN_CLI__EXTERNAL_LIB_ERROR);
+    EXPECT_EQ(NNCli_PluginResolve(&m_table, missing),
+              NN_CLI__EXTERNAL_LIB_ERROR);
+    EXPECT_EQ(missing->m_func, nullptr);
+}
+
+TEST_F(NNCliPluginTest, MissingSymbol)
+{
+    ASSERT_EQ(Load(std::string("plugin ") + NN_CLI_TEST_PLUGIN_PATH +
+                   "\ncommand gone|NoSuchSymbol|Help\n"
+                   "command half|TestPlugin_EchoCmd|Help||NoSuchSymbol\n"),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(NNCli_PluginResolve(&m_table, NNCli_PluginFind(&m_table, "gone")),
+              NN_CLI__EXTERNAL_LIB_ERROR);
+    NNCli_PluginCommand_t *half = NNCli_PluginFind(&m_table, "half");
+    EXPECT_EQ(NNCli_PluginResolve(&m_table, half), NN_CLI__EXTERNAL_LIB_ERROR);
+    EXPECT_EQ(half->m_func, nullptr);
+}
+
+// Compares what the start-up pays for the plugin when it is loaded lazily,
+// i.e. the manifest only, with what loading it at start-up adds.
+TEST_F(NNCliPluginTest, StartupCost)
+{
+    std::ofstream(m_manifest) << "plugin " NN_CLI_TEST_PLUGIN_PATH "\n"
+                              << kCommands;
+    long rss_kb = GetRssKb();
+    uint64_t start_ns = GetMonotonicNs();
+    ASSERT_EQ(LoadManifest(), NN_CLI__SUCCESS);
+    uint64_t lazy_ns = GetMonotonicNs() - start_ns;
+    long lazy_kb = GetRssKb() - rss_kb;
+    EXPECT_EQ(m_table.m_plugins[0]->m_handle, nullptr);
+
+    rss_kb = GetRssKb();
+    start_ns = GetMonotonicNs();
+    for (size_t i = 0; i < m_table.m_command_num; i++)
+    {
+        ASSERT_EQ(NNCli_PluginResolve(&m_table, m_table.m_commands[i]),
+                  NN_CLI__SUCCESS);
+    }
+    uint64_t load_ns = GetMonotonicNs() - start_ns;
+    long load_kb = GetRssKb() - rss_kb;
+
+    printf("Manifest: %.1f us, %ld KB resident\n", lazy_ns / 1e3, lazy_kb);
+    printf("Loading the plugin adds: %.1f us, %ld KB resident\n",
+           load_ns / 1e3, load_kb);
+}
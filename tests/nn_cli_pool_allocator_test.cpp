@@ -0,0 +1,122 @@
+#include "nn_cli_pool_allocator.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+class NNCliPoolAllocatorTest : public ::testing::Test
+{
+   protected:
+    void SetUp() override
+    {
+        NNCli_Pool_t pools[] = {
+            {m_small, 16, 4},
+            {m_large, 64, 2},
+        };
+        ASSERT_EQ(NNCli_PoolAllocatorInit(&m_pools, pools, 2, &m_allocator),
+                  NN_CLI__SUCCESS);
+    }
+
+    void *Malloc(size_t a_size)
+    {
+        return m_allocator.m_malloc(m_allocator.m_ctx, a_size);
+    }
+    void *Realloc(void *a_ptr, size_t a_size)
+    {
+        return m_allocator.m_realloc(m_allocator.m_ctx, a_ptr, a_size);
+    }
+    void Free(void *a_ptr) { m_allocator.m_free(m_allocator.m_ctx, a_ptr); }
+
+    NNCli_PoolUsage_t Usage(size_t a_index)
+    {
+        NNCli_PoolUsage_t usage;
+        EXPECT_EQ(NNCli_PoolAllocatorGetUsage(&m_pools, a_index, &usage),
+                  NN_CLI__SUCCESS);
+        return usage;
+    }
+
+    NN_CLI__POOL_BUF(m_small, 16, 4);
+    NN_CLI__POOL_BUF(m_large, 64, 2);
+    NNCli_PoolAllocator_t m_pools;
+    NNCli_Allocator_t m_allocator;
+};
+
+TEST_F(NNCliPoolAllocatorTest, SmallestBlockFirst)
+{
+    void *small[4];
+    for (void *&block : small)
+    {
+        block = Malloc(10);
+        ASSERT_NE(block, nullptr);
+        EXPECT_GE((char *)block, (char *)m_small);
+        EXPECT_LT((char *)block, (char *)m_small + sizeof(m_small));
+    }
+
+    // The full pool spills over to the larger one.
+    void *spilled = Malloc(16);
+    EXPECT_GE((char *)spilled, (char *)m_large);
+    EXPECT_NE(Malloc(64), nullptr);
+    EXPECT_EQ(Malloc(1), nullptr);
+    EXPECT_EQ(Malloc(65), nullptr);
+
+    for (void *block : small)
+    {
+        Free(block);
+    }
+    NNCli_PoolUsage_t usage = Usage(0);
+    EXPECT_EQ(usage.m_used_num, 0u);
+    EXPECT_EQ(usage.m_peak_num, 4u);
+    EXPECT_EQ(usage.m_largest_size, 16u);
+    EXPECT_EQ(usage.m_failed_num, 1u);
+
+    usage = Usage(1);
+    EXPECT_EQ(usage.m_used_num, 2u);
+    EXPECT_EQ(usage.m_peak_num, 2u);
+    EXPECT_EQ(usage.m_largest_size, 65u);
+    EXPECT_EQ(usage.m_failed_num, 1u);
+
+    NNCli_PoolUsage_t out_of_range;
+    EXPECT_EQ(NNCli_PoolAllocatorGetUsage(&m_pools, 2, &out_of_range),
+              NN_CLI__INVALID_ARGS);
+}
+
+TEST_F(NNCliPoolAllocatorTest, ReallocMovesToLargerBlock)
+{
+    char *block = (char *)Realloc(nullptr, 8);
+    ASSERT_NE(block, nullptr);
+    strcpy(block, "abcdefg");
+    EXPECT_EQ(Realloc(block, 16), block);
+
+    char *moved = (char *)Realloc(block, 40);
+    ASSERT_GE(moved, (char *)m_large);
+    EXPECT_STREQ(moved, "abcdefg");
+    EXPECT_EQ(Usage(0).m_used_num, 0u);
+
+    // There is no larger block, so the block is kept.
+    EXPECT_EQ(Realloc(moved, 100), nullptr);
+    EXPECT_STREQ(moved, "abcdefg");
+    Free(moved);
+    Free(nullptr);
+    EXPECT_EQ(Usage(1).m_used_num, 0u);
+}
+
+TEST_F(NNCliPoolAllocatorTest, InvalidPools)
+{
+    NNCli_PoolAllocator_t pools;
+    NNCli_Allocator_t allocator;
+    NNCli_Pool_t unsorted[] = {
+        {m_large, 64, 2},
+        {m_small, 16, 4},
+    };
+    EXPECT_EQ(NNCli_PoolAllocatorInit(&pools, unsorted, 2, &allocator),
+              NN_CLI__INVALID_ARGS);
+
+    NNCli_Pool_t misaligned = {(char *)m_small + 1, 16, 3};
+    EXPECT_EQ(NNCli_PoolAllocatorInit(&pools, &misaligned, 1, &allocator),
+              NN_CLI__INVALID_ARGS);
+    NNCli_Pool_t odd_size = {m_small, 24, 2};
+    EXPECT_EQ(NNCli_PoolAllocatorInit(&pools, &odd_size, 1, &allocator),
+              NN_CLI__INVALID_ARGS);
+    EXPECT_EQ(NNCli_PoolAllocatorInit(&pools, unsorted, 0, &allocator),
+              NN_CLI__INVALID_ARGS);
+}
@@ -0,0 +1,124 @@
+#include "nn_cli_rpc.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+// NULL frames are recorded as "<dropped>".
+void AddFrame(void *a_ctx, const char *a_frame, size_t a_len)
+{
+    static_cast<std::vector<std::string> *>(a_ctx)->push_back(
+        a_frame != nullptr ? std::string(a_frame, a_len) : "<dropped>");
+}
+
+std::string FormatResponse(const char *a_id, NNCli_Err_t a_status,
+                           const std::string &a_output)
+{
+    size_t len = NNCli_RpcFormatResponse(a_id, a_status, a_output.data(),
+                                         a_output.size(), nullptr, 0);
+    std::string response(len + 1, '\0');
+    NNCli_RpcFormatResponse(a_id, a_status, a_output.data(), a_output.size(),
+                            &response[0], response.size());
+    response.resize(len);
+    return response;
+}
+}  // namespace
+
+TEST(NNCliRpcTest, FramesAreSplitAtNewlines)
+{
+    NNCli_RpcReader_t reader;
+    std::vector<std::string> frames;
+    NNCli_RpcReaderInit(&reader);
+
+    // Pipelined requests come in arbitrary chunks.
+    EXPECT_EQ(NNCli_RpcReaderFeed(&reader, "{\"a\"}\n{\"b", 9, AddFrame,
+                                  &frames),
+              1);
+    EXPECT_EQ(NNCli_RpcReaderFeed(&reader, "\"}\n\n{\"c\"}", 9, AddFrame,
+                                  &frames),
+              2);
+    EXPECT_EQ(NNCli_RpcReaderFinish(&reader, AddFrame, &frames), 1);
+    EXPECT_EQ(NNCli_RpcReaderFinish(&reader, AddFrame, &frames), 0);
+    EXPECT_EQ(frames,
+              (std::vector<std::string>{"{\"a\"}", "{\"b\"}", "", "{\"c\"}"}));
+}
+
+TEST(NNCliRpcTest, TooLongFrameIsDropped)
+{
+    NNCli_RpcReader_t reader;
+    std::vector<std::string> frames;
+    std::string long_frame(NN_CLI__RPC_FRAME_MAX_LEN + 1, 'x');
+    NNCli_RpcReaderInit(&reader);
+
+    NNCli_RpcReaderFeed(&reader, long_frame.data(), long_frame.size(),
+                        AddFrame, &frames);
+    NNCli_RpcReaderFeed(&reader, "x\n{}\n", 5, AddFrame, &frames);
+    EXPECT_EQ(frames, (std::vector<std::string>{"<dropped>", "{}"}));
+}
+
+TEST(NNCliRpcTest, RequestIsParsed)
+{
+    NNCli_RpcRequest_t request;
+    std::string frame = R"( {"id": "a-1", "opts": {"x": [1, "}"]},)"
+                        R"( "line": "echo \"hi\"\t\u00e9\ud83d\ude00"} )";
+
+    ASSERT_EQ(NNCli_RpcParseRequest(frame.data(), frame.size(), &request),
+              NN_CLI__SUCCESS);
+    EXPECT_STREQ(request.m_id, "\"a-1\"");
+    EXPECT_STREQ(request.m_line, "echo \"hi\"\t\xc3\xa9\xf0\x9f\x98\x80");
+
+    frame = R"({"line":"help","id":[1, 2]})";
+    ASSERT_EQ(NNCli_RpcParseRequest(frame.data(), frame.size(), &request),
+              NN_CLI__SUCCESS);
+    EXPECT_STREQ(request.m_id, "[1, 2]");
+    EXPECT_STREQ(request.m_line, "help");
+}
+
+TEST(NNCliRpcTest, InvalidRequestKeepsId)
+{
+    NNCli_RpcRequest_t request;
+
+    for (std::string frame : {R"({"id": 7})", R"({"id": 7, "line": 1})",
+                              R"({"id": 7, "line": "a" "b"})",
+                              R"({"id": 7, "line": "\q"})"})
+    {
+        EXPECT_EQ(NNCli_RpcParseRequest(frame.data(), frame.size(), &request),
+                  NN_CLI__INVALID_ARGS)
+            << frame;
+        EXPECT_STREQ(request.m_id, "7") << frame;
+    }
+
+    for (std::string frame : {"", "[]", "{}", "{\"line\": \"a\"", "x"})
+    {
+        EXPECT_EQ(NNCli_RpcParseRequest(frame.data(), frame.size(), &request),
+                  NN_CLI__INVALID_ARGS)
+            << frame;
+        EXPECT_STREQ(request.m_id, "null") << frame;
+    }
+
+    std::string line(NN_CLI__LINE_MAX_LEN, 'a');
+    std::string frame = "{\"line\": \"" + line + "\"}";
+    EXPECT_EQ(NNCli_RpcParseRequest(frame.data(), frame.size(), &request),
+              NN_CLI__INVALID_ARGS);
+}
+
+TEST(NNCliRpcTest, OutputIsEscaped)
+{
+    EXPECT_EQ(FormatResponse("1", NN_CLI__SUCCESS,
+                             std::string("a \"b\" \\c\n\t\x01\xc3\xa9", 13)),
+              "{\"id\":1,\"status\":0,\"output\":"
+              "\"a \\\"b\\\" \\\\c\\n\\t\\u0001\xc3\xa9\"}\n");
+    EXPECT_EQ(FormatResponse("\"x\"", NN_CLI__INVALID_ARGS, ""),
+              "{\"id\":\"x\",\"status\":" +
+                  std::to_string(NN_CLI__INVALID_ARGS) + ",\"output\":\"\"}\n");
+
+    // Cut like snprintf().
+    char buf[8];
+    EXPECT_EQ(NNCli_RpcFormatResponse("1", NN_CLI__SUCCESS, "", 0, buf,
+                                      sizeof(buf)),
+              FormatResponse("1", NN_CLI__SUCCESS, "").size());
+    EXPECT_STREQ(buf, "{\"id\":1");
+}
@@ -2,6 +2,26 @@
 
 #include <gtest/gtest.h>
 
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The probes with three arguments as `probe:name:res`, instead of USDT
+// probes. Only command_end has three.
+static std::vector<std::string> s_command_ends;
+#define NNCli_Trace0(name) ((void)0)
+#define NNCli_Trace1(name, a1) ((void)0)
+#define NNCli_Trace2(name, a1, a2) ((void)0)
+#define NNCli_Trace3(name, a1, a2, a3) \
+    s_command_ends.push_back(std::string(#name) + ":" + (a2) + ":" + \
+                             std::to_string(a3))
+
 #include "nn_cli.c"
 #include "nn_cli_config.h"
 namespace
@@ -46,8 +66,370 @@ void GenerateDummyHistoryFile(char *filename)
     }
     close(fd);
 }
+
+int s_printed_lines = 0;
+
+// Prints "line 0", "line 1", ... until the given number of lines or until the
+// output is closed.
+NNCli_Err_t PrintLinesCmdFunc(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    int lines = atoi(argv[1]);
+    for (s_printed_lines = 0; s_printed_lines < lines; s_printed_lines++)
+    {
+        if (NNCli_IsOutputClosed())
+        {
+            break;
+        }
+        printf("line %d\n", s_printed_lines);
+    }
+    return NN_CLI__SUCCESS;
+}
+
+// Input and output of scripted sessions, kept in memory.
+struct MemoryIo
+{
+    std::string m_input;
+    size_t m_read_pos;
+    std::string m_output;
+    bool m_is_input_closed;
+};
+
+MemoryIo s_memory_io;
+
+ssize_t ReadFromMemory(void *a_ctx, char *a_buf, size_t a_len)
+{
+    MemoryIo *io = static_cast<MemoryIo *>(a_ctx);
+    size_t len = std::min(a_len, io->m_input.size() - io->m_read_pos);
+    if (len == 0)
+    {
+        if (io->m_is_input_closed)
+        {
+            return 0;
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+
+    memcpy(a_buf, &io->m_input[io->m_read_pos], len);
+    io->m_read_pos += len;
+    return len;
+}
+
+ssize_t WriteToMemory(void *a_ctx, const char *a_data, size_t a_len)
+{
+    static_cast<MemoryIo *>(a_ctx)->m_output.append(a_data, a_len);
+    return a_len;
+}
+
+NNCli_Io_t s_memory_backend = {
+    .m_read = ReadFromMemory,
+    .m_write = WriteToMemory,
+    .m_ctx = &s_memory_io,
+    .m_echo = false,
+};
+
+// Scripted sessions run in memory unless `a_io` is NULL.
+void InitWithPrintLinesCmd(const NNCli_Io_t *a_io = &s_memory_backend,
+                           const char *a_record_filename = nullptr,
+                           bool a_share_history = false,
+                           const char *a_alias_filename = nullptr,
+                           bool a_rpc = false,
+                           const char *a_plugin_manifest_filename = nullptr)
+{
+    static const NNCli_Command_t cmd = {
+        .m_func = PrintLinesCmdFunc,
+        .m_name = "print-lines",
+        .m_options = "lines",
+        .m_help_msg = "Print the given number of lines",
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&cmd), NN_CLI__SUCCESS);
+
+    char filename[] = "/tmp/nncli_test_history_XXXXXX";
+    GenerateDummyHistoryFile(filename);
+    const NNCli_Option_t option = {
+        .m_enable_multi_line = false,
+        .m_show_key_codes = false,
+        .m_async =
+            {
+                .m_enabled = false,
+                .m_timeout = {.tv_sec = 0, .tv_usec = 0},
+            },
+        .m_history_filename = filename,
+        .m_record_filename = a_record_filename,
+        .m_io = a_io,
+        .m_share_history = a_share_history,
+        .m_alias_filename = a_alias_filename,
+        .m_rpc = a_rpc,
+        .m_plugin_manifest_filename = a_plugin_manifest_filename,
+    };
+    ASSERT_EQ(NNCli_Init(&option), NN_CLI__SUCCESS);
+}
+
+std::string ReadRecordedInput(const char *a_filename)
+{
+    NNCli_RecordReader_t reader;
+    char chunk[NN_CLI__RECORD_CHUNK_MAX_LEN];
+    size_t len;
+    uint64_t time_us;
+    std::string input;
+
+    EXPECT_EQ(NNCli_RecordReaderOpen(&reader, a_filename), NN_CLI__SUCCESS);
+    while (NNCli_RecordReaderNext(&reader, &time_us, chunk, &len) ==
+           NN_CLI__SUCCESS)
+    {
+        input.append(chunk, len);
+    }
+    NNCli_RecordReaderClose(&reader);
+    return input;
+}
+
+int s_counter_query_num = 0;
+
+NNCli_Err_t CounterQueryCmdFunc(int argc, char **argv)
+{
+    s_counter_query_num++;
+    printf("counter %s: %d\n", argc == 2 ? argv[1] : "all",
+           s_counter_query_num);
+    return NN_CLI__SUCCESS;
+}
+
+// Returns when the command is cancelled.
+NNCli_Err_t WaitForCancelCmdFunc(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "interrupt") == 0)
+    {
+        raise(SIGINT);
+    }
+    while (!NNCli_IsCancelled())
+    {
+        usleep(1000);
+    }
+    printf("stopped\n");
+    return NN_CLI__SUCCESS;
+}
+
+// Blocks in a system call until it is cancelled.
+NNCli_Err_t BlockedCmdFunc(int argc, char **argv)
+{
+    printf("blocked\n");
+    while (!NNCli_IsCancelled())
+    {
+        pause();
+    }
+    return NN_CLI__SUCCESS;
+}
+
+void RegisterCancellableCmds(void)
+{
+    static const NNCli_Command_t wait_cmd = {
+        .m_func = WaitForCancelCmdFunc,
+        .m_name = "wait",
+        .m_options = "[interrupt]",
+        .m_help_msg = "Wait until cancelled",
+        .m_flags = NN_CLI__COMMAND_FLAG_NONE,
+        .m_cache_ttl_ms = 0,
+        .m_timeout_ms = 30,
+    };
+    static const NNCli_Command_t blocked_cmd = {
+        .m_func = BlockedCmdFunc,
+        .m_name = "blocked",
+        .m_options = NULL,
+        .m_help_msg = "Block until cancelled",
+        // The output of a cancelled command is not cached.
+        .m_flags = NN_CLI__COMMAND_FLAG_CACHEABLE,
+        .m_cache_ttl_ms = 1000,
+        .m_timeout_ms = 20,
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&wait_cmd), NN_CLI__SUCCESS);
+    ASSERT_EQ(NNCli_RegisterCommand(&blocked_cmd), NN_CLI__SUCCESS);
+}
+
+struct CountdownState
+{
+    bool m_is_started;
+    int m_remaining;
+};
+
+// Prints one tick in each slice.
+NNCli_Err_t CountdownCmdFunc(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+
+    CountdownState *state =
+        (CountdownState *)NNCli_GetResumeState(sizeof(CountdownState));
+    if (!state->m_is_started)
+    {
+        state->m_remaining = atoi(argv[1]);
+        state->m_is_started = true;
+    }
+    if (state->m_remaining == 0)
+    {
+        printf("done\n");
+        return NN_CLI__SUCCESS;
+    }
+    printf("tick %d\n", state->m_remaining--);
+    return NN_CLI__IN_PROGRESS;
+}
+
+struct LongRunState
+{
+    uint64_t m_start_ms;
+};
+
+// Keeps the CPU busy for 10 seconds, yielding at the end of each slice.
+NNCli_Err_t LongRunCmdFunc(int argc, char **argv)
+{
+    LongRunState *state =
+        (LongRunState *)NNCli_GetResumeState(sizeof(LongRunState));
+    if (state->m_start_ms == 0)
+    {
+        state->m_start_ms = GetMonotonicMs();
+    }
+
+    while (!NNCli_ShouldYield())
+    {
+    }
+    if (NNCli_IsCancelled())
+    {
+        printf("stopped\n");
+        return NN_CLI__SUCCESS;
+    }
+    if (GetMonotonicMs() - state->m_start_ms < 10000)
+    {
+        return NN_CLI__IN_PROGRESS;
+    }
+    printf("finished\n");
+    return NN_CLI__SUCCESS;
+}
+
+void RegisterResumableCmds(void)
+{
+    static const NNCli_Command_t countdown_cmd = {
+        .m_func = CountdownCmdFunc,
+        .m_name = "countdown",
+        .m_options = "<num>",
+        .m_help_msg = "Count down one by one",
+    };
+    static const NNCli_Command_t long_run_cmd = {
+        .m_func = LongRunCmdFunc,
+        .m_name = "long-run",
+        .m_options = NULL,
+        .m_help_msg = "Run for 10 seconds",
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&countdown_cmd), NN_CLI__SUCCESS);
+    ASSERT_EQ(NNCli_RegisterCommand(&long_run_cmd), NN_CLI__SUCCESS);
+}
+
+// Prints the number, and fails for the odd ones. The smaller numbers take
+// longer, so they finish after the larger ones when run in parallel.
+NNCli_Err_t EvenCmdFunc(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        return NN_CLI__INVALID_ARGS;
+    }
+    int num = atoi(argv[1]);
+    usleep((10 - num % 10) * 1000);
+    printf("%s %d\n", argv[0], num);
+    return (num % 2 == 0) ? NN_CLI__SUCCESS : NN_CLI__INVALID_ARGS;
+}
+
+void RegisterForeachCmds(void)
+{
+    static const NNCli_Command_t even_cmd = {
+        .m_func = EvenCmdFunc,
+        .m_name = "even",
+        .m_options = "<num>",
+        .m_help_msg = "Fail for an odd number",
+        .m_flags = NN_CLI__COMMAND_FLAG_THREAD_SAFE,
+    };
+    static const NNCli_Command_t even_in_order_cmd = {
+        .m_func = EvenCmdFunc,
+        .m_name = "even-in-order",
+        .m_options = "<num>",
+        .m_help_msg = "Fail for an odd number",
+    };
+    static const NNCli_Command_t even_cached_cmd = {
+        .m_func = EvenCmdFunc,
+        .m_name = "even-cached",
+        .m_options = "<num>",
+        .m_help_msg = "Fail for an odd number",
+        .m_flags = NN_CLI__COMMAND_FLAG_THREAD_SAFE |
+                   NN_CLI__COMMAND_FLAG_CACHEABLE,
+        .m_cache_ttl_ms = 60000,
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&even_cmd), NN_CLI__SUCCESS);
+    ASSERT_EQ(NNCli_RegisterCommand(&even_in_order_cmd), NN_CLI__SUCCESS);
+    ASSERT_EQ(NNCli_RegisterCommand(&even_cached_cmd), NN_CLI__SUCCESS);
+}
+
+// Counts the allocations passed on to the C library.
+struct CountingAllocator
+{
+    std::atomic<int> m_alloc_num{0};
+    std::atomic<int> m_free_num{0};
+};
+
+void *CountMalloc(void *a_ctx, size_t a_size)
+{
+    static_cast<CountingAllocator *>(a_ctx)->m_alloc_num++;
+    return malloc(a_size);
+}
+
+void *CountRealloc(void *a_ctx, void *a_ptr, size_t a_size)
+{
+    static_cast<CountingAllocator *>(a_ctx)->m_alloc_num++;
+    return realloc(a_ptr, a_size);
+}
+
+void CountFree(void *a_ctx, void *a_ptr)
+{
+    static_cast<CountingAllocator *>(a_ctx)->m_free_num += (a_ptr != nullptr);
+    free(a_ptr);
+}
+
+// Runs the input in the memory session started by InitWithPrintLinesCmd().
+std::string RunAndCaptureOutput(const char *input)
+{
+    s_memory_io.m_input += input;
+    s_memory_io.m_output.clear();
+
+    NNCli_Err_t res;
+    do
+    {
+        res = NNCli_Run();
+    } while (res == NN_CLI__SUCCESS &&
+             s_memory_io.m_read_pos < s_memory_io.m_input.size());
+    EXPECT_EQ(res, NN_CLI__SUCCESS);
+    return s_memory_io.m_output;
+}
 }  // namespace
 
+static NNCli_Err_t StaticCmdFunc(int argc, char **argv)
+{
+    printf("%s %d\n", argv[0], argc);
+    return NN_CLI__SUCCESS;
+}
+
+NNCLI_COMMAND(test_static_alpha,
+              .m_func = StaticCmdFunc,
+              .m_name = "static-alpha",
+              .m_options = NULL,
+              .m_help_msg = "Static test command");
+NNCLI_COMMAND(test_static_beta,
+              .m_func = StaticCmdFunc,
+              .m_name = "static-beta",
+              .m_options = "arg",
+              .m_help_msg = "Static test command");
+
 class NNCliTest : public ::testing::Test
 {
    protected:
@@ -56,11 +438,49 @@ class NNCliTest : public ::testing::Test
         s_async = {0};
         s_command_list = {0};
         s_is_initialized = false;
+        NNCli_InvalidateCache(nullptr);
+        s_cache_stats = {0};
+        NNCli_Free(s_help_listing.m_buf);
+        s_help_listing = {0};
+        s_help_listing_width = 0;
+        memset(s_jobs, 0, sizeof(s_jobs));
+        memset(&s_timer_wheel, 0, sizeof(s_timer_wheel));
+        NNCli_LineEditorDestroy(&s_line_editor);
+        s_is_line_editor_started = false;
+        s_cancel_reason = CANCEL_REASON_NONE;
+        s_is_latency_traced = false;
+        NNCli_ResetLatencyHistograms();
+        NNCli_Free(s_suspended.m_run.m_state);
+        memset(&s_suspended, 0, sizeof(s_suspended));
+        memset(&s_io, 0, sizeof(s_io));
+        s_is_rpc = false;
+        ReleaseForeach();
+        NNCli_RpcReaderInit(&s_rpc_reader);
+        s_memory_io = MemoryIo();
+        s_memory_backend.m_echo = false;
+        if (s_is_history_shared)
+        {
+            NNCli_SharedHistoryClose(&s_shared_history);
+            s_is_history_shared = false;
+        }
+        NNCli_HistoryIndexDestroy(&s_history_index);
+        if (s_has_plugins)
+        {
+            NNCli_PluginTableClear(&s_plugins);
+            s_has_plugins = false;
+        }
+        NNCli_AliasTableClear(&s_aliases);
+        NNCli_ArgCompleterDestroy(&s_arg_completer);
+        NNCli_Free(s_alias_filename);
+        s_alias_filename = nullptr;
         if (s_history_filename != nullptr)
         {
-            free(s_history_filename);
+            NNCli_Free(s_history_filename);
             s_history_filename = nullptr;
         }
+        s_is_terminal_size_known = false;
+        s_is_terminal_size_stale = true;
+        NNCli_AllocSet(nullptr);
     }
 };
 
@@ -238,7 +658,7 @@ TEST_F(NNCliTest, Init_CallTwice)
     };
 
     ASSERT_EQ(NNCli_Init(&option), NN_CLI__SUCCESS);
-    free(s_history_filename);
+    NNCli_Free(s_history_filename);
     s_history_filename = nullptr;
 
     ASSERT_EQ(NNCli_Init(&option), NN_CLI__IN_PROGRESS);
@@ -305,7 +725,7 @@ TEST_F(NNCliTest, Run_WordLimitPerCommand)
     std::string cmd_option;
 
     // Subtract 1 as "test-cmd" is already included
-    for (size_t i = 0; i < MAX_NUM_OF_WORDS_PER_COMMAND - 1; i++)
+    for (size_t i = 0; i < NN_CLI__MAX_WORDS_PER_COMMAND - 1; i++)
     {
         cmd_option += " arg" + std::to_string(i + 2);
     }
@@ -314,9 +734,11 @@ TEST_F(NNCliTest, Run_WordLimitPerCommand)
     DummyKeyboardInput(upper_limit_cmd.c_str());
     ASSERT_EQ(NNCli_Run(), NN_CLI__SUCCESS);
 
+    // Like the other failures of commands, this does not end the session.
     std::string exceeding_upper_limit_cmd = "test-cmd" + cmd_option + " arg\n";
     DummyKeyboardInput(exceeding_upper_limit_cmd.c_str());
-    ASSERT_EQ(NNCli_Run(), NN_CLI__EXCEED_CAPACITY);
+    ASSERT_EQ(NNCli_Run(), NN_CLI__SUCCESS);
+    EXPECT_EQ(s_command_res, NN_CLI__EXCEED_CAPACITY);
 }
 
 TEST_F(NNCliTest, Run_CommandLengthUpperLimit)
@@ -346,7 +768,7 @@ TEST_F(NNCliTest, Run_CommandLengthUpperLimit)
     std::string cmd_base = "test-cmd ";
 
     std::string string_for_upper_limit;
-    for (size_t i = 0; i < COMMAND_STRING_MAX_LEN - cmd_base.size() - 1; i++)
+    for (size_t i = 0; i < NN_CLI__LINE_MAX_LEN - cmd_base.size() - 1; i++)
     {
         string_for_upper_limit += "x";
     }
@@ -360,4 +782,1248 @@ TEST_F(NNCliTest, Run_CommandLengthUpperLimit)
     ASSERT_EQ(NNCli_Run(), NN_CLI__EXCEED_CAPACITY);
 }
 
+TEST_F(NNCliTest, Run_LongHeadlessLineIsRejected)
+{
+    InitWithPrintLinesCmd();
+
+    // The line can be typed, but is not run. It is read in several chunks.
+    s_memory_io.m_input += "print-lines 1 " +
+                           std::string(NN_CLI__LINE_MAX_LEN, 'x') + "\n";
+    while (s_memory_io.m_read_pos < s_memory_io.m_input.size())
+    {
+        ASSERT_NE(NNCli_Run(), NN_CLI__PROCESS_COMPLETED);
+    }
+    EXPECT_EQ(s_memory_io.m_output.find("line 0"), std::string::npos);
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 1\n"), "line 0\n");
+}
+
+TEST_F(NNCliTest, Run_PipelineStopsCommandEarly)
+{
+    InitWithPrintLinesCmd();
+
+    std::string output =
+        RunAndCaptureOutput("print-lines 100000 | grep 7 | head 3\n");
+    EXPECT_EQ(output, "line 7\nline 17\nline 27\n");
+    // `head` has closed the output, so the command stopped early.
+    EXPECT_LT(s_printed_lines, 100);
+}
+
+TEST_F(NNCliTest, Run_PipelineCount)
+{
+    InitWithPrintLinesCmd();
+
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 20 | grep -v 1 | count\n"),
+              "9\n");
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 20|count|head 1\n"), "20\n");
+}
+
+TEST_F(NNCliTest, Run_CommandSequence)
+{
+    InitWithPrintLinesCmd();
+
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 1 ; print-lines 2 | head 1\n"),
+              "line 0\nline 0\n");
+}
+
+TEST_F(NNCliTest, Run_PipelineInvalidFilter)
+{
+    InitWithPrintLinesCmd();
+
+    // The command is not called if the pipeline is invalid.
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 3 | sort\n"), "");
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 3 | head x\n"), "");
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 3 | | count\n"), "");
+}
+
+TEST_F(NNCliTest, RegisterCommand_CacheableWithoutTtl)
+{
+    const NNCli_Command_t cmd = {
+        .m_func = TestCmdFunc,
+        .m_name = "test-cmd",
+        .m_options = nullptr,
+        .m_help_msg = "test help msg",
+        .m_flags = NN_CLI__COMMAND_FLAG_CACHEABLE,
+        .m_cache_ttl_ms = 0,
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&cmd), NN_CLI__INVALID_ARGS);
+}
+
+TEST_F(NNCliTest, Run_CacheableCommand)
+{
+    const NNCli_Command_t cmd = {
+        .m_func = CounterQueryCmdFunc,
+        .m_name = "counter",
+        .m_options = "[name]",
+        .m_help_msg = "Show counters",
+        .m_flags = NN_CLI__COMMAND_FLAG_CACHEABLE,
+        .m_cache_ttl_ms = 60 * 1000,
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&cmd), NN_CLI__SUCCESS);
+    InitWithPrintLinesCmd();
+    s_counter_query_num = 0;
+
+    // The output of the first call is replayed within the TTL.
+    EXPECT_EQ(RunAndCaptureOutput("counter\n"), "counter all: 1\n");
+    EXPECT_EQ(RunAndCaptureOutput("counter\n"), "counter all: 1\n");
+    EXPECT_EQ(RunAndCaptureOutput("counter | grep all\n"), "counter all: 1\n");
+    // Different arguments are cached separately.
+    EXPECT_EQ(RunAndCaptureOutput("counter rx\n"), "counter rx: 2\n");
+    EXPECT_EQ(s_counter_query_num, 2);
+
+    NNCli_CacheStats_t stats;
+    ASSERT_EQ(NNCli_GetCacheStats(&stats), NN_CLI__SUCCESS);
+    EXPECT_EQ(stats.m_hits, 2u);
+    EXPECT_EQ(stats.m_misses, 2u);
+
+    NNCli_InvalidateCache("counter");
+    EXPECT_EQ(RunAndCaptureOutput("counter\n"), "counter all: 3\n");
+    EXPECT_EQ(RunAndCaptureOutput("cache clear\n"), "");
+    EXPECT_EQ(RunAndCaptureOutput("counter\n"), "counter all: 4\n");
+}
+
+TEST_F(NNCliTest, Run_CacheEviction)
+{
+    const NNCli_Command_t cmd = {
+        .m_func = CounterQueryCmdFunc,
+        .m_name = "counter",
+        .m_options = "[name]",
+        .m_help_msg = "Show counters",
+        .m_flags = NN_CLI__COMMAND_FLAG_CACHEABLE,
+        .m_cache_ttl_ms = 60 * 1000,
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&cmd), NN_CLI__SUCCESS);
+    InitWithPrintLinesCmd();
+
+    for (int i = 0; i < NN_CLI__CACHE_ENTRY_NUM + 1; i++)
+    {
+        std::string line = "counter c" + std::to_string(i) + "\n";
+        RunAndCaptureOutput(line.c_str());
+    }
+
+    NNCli_CacheStats_t stats;
+    ASSERT_EQ(NNCli_GetCacheStats(&stats), NN_CLI__SUCCESS);
+    EXPECT_EQ(stats.m_evictions, 1u);
+    EXPECT_EQ(stats.m_misses, (uint32_t)NN_CLI__CACHE_ENTRY_NUM + 1);
+}
+
+TEST_F(NNCliTest, ScheduleCommand_BeforeInit)
+{
+    ASSERT_EQ(NNCli_ScheduleCommand("help", 1000, nullptr), NN_CLI__NOT_READY);
+}
+
+TEST_F(NNCliTest, ScheduleCommand_RunFromRun)
+{
+    InitWithPrintLinesCmd();
+
+    int job_id;
+    ASSERT_EQ(NNCli_ScheduleCommand("print-lines 1", 50, &job_id),
+              NN_CLI__SUCCESS);
+
+    // The input wait is shortened to the next due time.
+    struct timeval timeout = {.tv_sec = 10, .tv_usec = 0};
+    LimitTimeoutToNextJob(&timeout);
+    EXPECT_EQ(timeout.tv_sec, 0);
+    EXPECT_LE(timeout.tv_usec, 50 * 1000);
+
+    // Runs which have been missed are not run at once.
+    usleep(120 * 1000);
+    EXPECT_EQ(RunAndCaptureOutput("\n"), "line 0\n");
+    EXPECT_EQ(RunAndCaptureOutput("\n"), "");
+
+    ASSERT_EQ(NNCli_CancelScheduledCommand(job_id), NN_CLI__SUCCESS);
+    ASSERT_EQ(NNCli_CancelScheduledCommand(job_id), NN_CLI__INVALID_ARGS);
+    usleep(60 * 1000);
+    EXPECT_EQ(RunAndCaptureOutput("\n"), "");
+}
+
+TEST_F(NNCliTest, ScheduleCommand_SyncModeWarns)
+{
+    InitWithPrintLinesCmd(nullptr);
+
+    testing::internal::CaptureStdout();
+    ASSERT_EQ(NNCli_ScheduleCommand("print-lines 1", 50, nullptr),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(),
+              "[NNCli][WARN]Scheduled commands only run between lines in the "
+              "sync mode\n");
+}
+
+TEST_F(NNCliTest, Run_WatchCommand)
+{
+    InitWithPrintLinesCmd();
+
+    EXPECT_EQ(RunAndCaptureOutput("watch -n 0.5 print-lines 2\n"),
+              "[1] every 0.5s: print-lines 2\n");
+    EXPECT_EQ(RunAndCaptureOutput("watch print-lines 3\n"),
+              "[2] every 2.0s: print-lines 3\n");
+    EXPECT_EQ(RunAndCaptureOutput("watch\n"),
+              "[1] every 0.5s: print-lines 2\n"
+              "[2] every 2.0s: print-lines 3\n");
+
+    RunAndCaptureOutput("watch -c 1\n");
+    EXPECT_EQ(RunAndCaptureOutput("watch | count\n"), "1\n");
+}
+
+TEST_F(NNCliTest, Run_WatchCommand_InvalidInterval)
+{
+    InitWithPrintLinesCmd();
+
+    for (const char *interval : {"nan", "inf", "1e10", "0.0001", "-1"})
+    {
+        std::string line = std::string("watch -n ") + interval + " ls\n";
+        RunAndCaptureOutput(line.c_str());
+    }
+    EXPECT_EQ(RunAndCaptureOutput("watch | count\n"), "0\n");
+}
+
+TEST_F(NNCliTest, StaticCommand_Lookup)
+{
+    ASSERT_TRUE(HasStaticCommandTable());
+    EXPECT_EQ(GetStaticCommandNum(), 2);
+    EXPECT_EQ(GetSectionCommandNum(), 2);
+    EXPECT_EQ(FindCommand("static-alpha"),
+              &nn_cli_static_command_test_static_alpha);
+    EXPECT_EQ(FindCommand("static-beta"),
+              &nn_cli_static_command_test_static_beta);
+    EXPECT_EQ(FindCommand("static-gamma"), nullptr);
+    EXPECT_EQ(FindCommand(""), nullptr);
+}
+
+TEST_F(NNCliTest, StaticCommand_PreventDuplicate)
+{
+    NNCli_Command_t command = {
+        .m_func = TestCmdFunc,
+        .m_name = "static-alpha",
+        .m_options = NULL,
+        .m_help_msg = "Duplicate of a static command",
+    };
+
+    ASSERT_EQ(NNCli_RegisterCommand(&command), NN_CLI__DUPLICATE);
+}
+
+TEST_F(NNCliTest, StaticCommand_Run)
+{
+    InitWithPrintLinesCmd();
+
+    EXPECT_EQ(RunAndCaptureOutput("static-beta x\n"), "static-beta 2\n");
+    EXPECT_EQ(RunAndCaptureOutput("help | grep static | count\n"), "2\n");
+}
+
+TEST_F(NNCliTest, FeedInput_BeforeInit)
+{
+    ASSERT_EQ(NNCli_FeedInput("help\r", 5), NN_CLI__NOT_READY);
+}
+
+TEST_F(NNCliTest, FeedInput_Success)
+{
+    InitWithPrintLinesCmd(nullptr);
+
+    testing::internal::CaptureStdout();
+    // Typed with a typo which is fixed by Backspace.
+    ASSERT_EQ(NNCli_FeedInput("print-lines 3\x7f"
+                              "2\r",
+                              16),
+              NN_CLI__SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(output,
+              "> print-lines 3\r> print-lines \x1b[0K\r\x1b[14C2\r\n"
+              "line 0\nline 1\n> ");
+
+    testing::internal::CaptureStdout();
+    EXPECT_EQ(NNCli_FeedInput("\x04", 1), NN_CLI__PROCESS_COMPLETED);
+    testing::internal::GetCapturedStdout();
+}
+
+TEST_F(NNCliTest, Replay_Success)
+{
+    InitWithPrintLinesCmd(nullptr);
+
+    char filename[] = "/tmp/nncli_test_recording_XXXXXX";
+    GenerateDummyHistoryFile(filename);
+    NNCli_RecordWriter_t writer;
+    ASSERT_EQ(NNCli_RecordWriterOpen(&writer, filename), NN_CLI__SUCCESS);
+    const char *keys[] = {"p", "r", "i", "n", "t", "-", "l", "i", "n", "e",
+                          "s", " ", "2", "\r", "\r", "\x1b[D", "\x04"};
+    uint64_t time_us = 0;
+    for (const char *key : keys)
+    {
+        time_us += 1000;
+        ASSERT_EQ(NNCli_RecordWriterWrite(&writer, time_us, key, strlen(key)),
+                  NN_CLI__SUCCESS);
+    }
+    NNCli_RecordWriterClose(&writer);
+
+    NNCli_ReplayOption_t option = {.m_realtime = true, .m_report = nullptr};
+    NNCli_ReplayStats_t stats;
+    uint64_t start_ms = GetMonotonicMs();
+    testing::internal::CaptureStdout();
+    ASSERT_EQ(NNCli_Replay(filename, &option, &stats), NN_CLI__SUCCESS);
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_GE(GetMonotonicMs() - start_ms, 17);
+    EXPECT_NE(output.find("line 0\nline 1\n"), std::string::npos);
+    EXPECT_EQ(stats.m_keystroke_num, 17);
+    // The empty line is not a command.
+    EXPECT_EQ(stats.m_command_num, 1);
+    EXPECT_GE(stats.m_keystroke_max_ns, stats.m_keystroke_total_ns / 17);
+}
+
+TEST_F(NNCliTest, Replay_InvalidFile)
+{
+    InitWithPrintLinesCmd();
+
+    char filename[] = "/tmp/nncli_test_recording_XXXXXX";
+    GenerateDummyHistoryFile(filename);
+    NNCli_ReplayOption_t option = {.m_realtime = false, .m_report = nullptr};
+    EXPECT_EQ(NNCli_Replay(filename, &option, nullptr), NN_CLI__INVALID_ARGS);
+}
+
+TEST_F(NNCliTest, Run_RecordInput)
+{
+    char filename[] = "/tmp/nncli_test_recording_XXXXXX";
+    GenerateDummyHistoryFile(filename);
+
+    // stdin is not a terminal, so it is relayed through a pipe.
+    DummyKeyboardInput("print-lines 1\n");
+    InitWithPrintLinesCmd(nullptr, filename);
+    testing::internal::CaptureStdout();
+    EXPECT_EQ(NNCli_Run(), NN_CLI__SUCCESS);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "line 0\n");
+    NNCli_RecorderStop();
+
+    EXPECT_EQ(ReadRecordedInput(filename), "print-lines 1\n");
+}
+
+TEST_F(NNCliTest, Run_SharedHistory)
+{
+    InitWithPrintLinesCmd(&s_memory_backend, nullptr, true);
+    struct stat before;
+    ASSERT_EQ(stat(s_history_filename, &before), 0);
+
+    // Another session appends an entry while this one waits for input.
+    {
+        std::ofstream file(s_history_filename, std::ios::app);
+        file << "from-other\n";
+    }
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 1\n"), "line 0\n");
+
+    std::ifstream file(s_history_filename);
+    std::stringstream content;
+    content << file.rdbuf();
+    EXPECT_EQ(content.str(), "from-other\nprint-lines 1\n");
+
+    // The file is appended to, not replaced.
+    struct stat after;
+    ASSERT_EQ(stat(s_history_filename, &after), 0);
+    EXPECT_EQ(before.st_ino, after.st_ino);
+}
+
+TEST_F(NNCliTest, Run_Aliases)
+{
+    InitWithPrintLinesCmd();
+
+    // The definition takes the whole line including `|`.
+    EXPECT_EQ(RunAndCaptureOutput("alias pl = print-lines $1 | grep 1\n"), "");
+    EXPECT_EQ(RunAndCaptureOutput("pl 12\n"), "line 1\nline 10\nline 11\n");
+    EXPECT_EQ(RunAndCaptureOutput("alias pl ; pl 2 | head 0\n"),
+              "pl = print-lines $1 | grep 1\n");
+
+    // An alias is not changed in the middle of a line.
+    RunAndCaptureOutput("print-lines 1 ; alias -d pl\n");
+    EXPECT_NE(NNCli_AliasFind(&s_aliases, "pl"), nullptr);
+    EXPECT_EQ(RunAndCaptureOutput("alias -d pl\n"), "");
+    EXPECT_EQ(RunAndCaptureOutput("alias\n"), "");
+
+    // Nor by a line nested in a command, while the alias is being run.
+    RunAndCaptureOutput("alias y = time alias -d y ; print-lines 1\n");
+    EXPECT_NE(RunAndCaptureOutput("y\n").find("line 0\n"), std::string::npos);
+    EXPECT_NE(NNCli_AliasFind(&s_aliases, "y"), nullptr);
+    EXPECT_EQ(s_command_res, NN_CLI__NOT_READY);
+}
+
+TEST_F(NNCliTest, Run_AliasErrorsAreCommandFailures)
+{
+    InitWithPrintLinesCmd();
+    RunAndCaptureOutput("alias pl = print-lines $1\n");
+
+    // The session goes on, while the line has failed.
+    char out[256];
+    for (const char *line : {"alias -d nosuch", "alias x =", "pl"})
+    {
+        RunAndCaptureOutput((std::string(line) + "\n").c_str());
+        EXPECT_EQ(NNCli_Execute(line, out, sizeof(out)), NN_CLI__INVALID_ARGS)
+            << line;
+    }
+
+    std::string stages = "print-lines 1";
+    for (int i = 0; i < NN_CLI__MAX_PIPELINE_STAGES; i++)
+    {
+        stages += " | count";
+    }
+    RunAndCaptureOutput((stages + "\n").c_str());
+    EXPECT_EQ(NNCli_Execute(stages.c_str(), out, sizeof(out)),
+              NN_CLI__EXCEED_CAPACITY);
+    std::string words = "print-lines";
+    for (int i = 0; i < NN_CLI__MAX_WORDS_PER_COMMAND; i++)
+    {
+        words += " 1";
+    }
+    RunAndCaptureOutput((words + "\n").c_str());
+    EXPECT_EQ(NNCli_Execute(words.c_str(), out, sizeof(out)),
+              NN_CLI__EXCEED_CAPACITY);
+}
+
+TEST_F(NNCliTest, Run_AliasesArePersisted)
+{
+    char filename[] = "/tmp/nncli_test_aliases_XXXXXX";
+    GenerateDummyHistoryFile(filename);
+    {
+        std::ofstream file(filename);
+        file << "pl = print-lines $1\nbroken\n";
+    }
+
+    InitWithPrintLinesCmd(&s_memory_backend, nullptr, false, filename);
+    EXPECT_EQ(RunAndCaptureOutput("pl 2\n"), "line 0\nline 1\n");
+    EXPECT_EQ(RunAndCaptureOutput("alias p1 = print-lines 1\n"), "");
+
+    std::ifstream file(filename);
+    std::stringstream content;
+    content << file.rdbuf();
+    EXPECT_EQ(content.str(), "pl = print-lines $1\np1 = print-lines 1\n");
+
+    // Aliases are completed with the commands.
+    linenoiseCompletions completions = {0, NULL};
+    CompleteCommandName("p", &completions);
+    std::vector<std::string> names;
+    for (size_t i = 0; i < completions.len; i++)
+    {
+        names.push_back(completions.cvec[i]);
+        NNCli_Free(completions.cvec[i]);
+    }
+    NNCli_Free(completions.cvec);
+    EXPECT_EQ(names,
+              (std::vector<std::string>{"print-lines", "pl", "p1"}));
+    unlink(filename);
+}
+
+static void CompleteColorArgs(int argc, char **argv,
+                              NNCli_ArgCandidates_t *a_candidates)
+{
+    if (argc == 2)
+    {
+        NNCli_AddArgCandidate(a_candidates, "red");
+        NNCli_AddArgCandidate(a_candidates, "green");
+    }
+}
+
+TEST_F(NNCliTest, Completion_Arguments)
+{
+    static const NNCli_Command_t cmd = {
+        .m_func = TestCmdFunc,
+        .m_name = "paint",
+        .m_options = "color",
+        .m_help_msg = "Paint with the color",
+        .m_complete_args = CompleteColorArgs,
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&cmd), NN_CLI__SUCCESS);
+    InitWithPrintLinesCmd();
+
+    auto complete = [](const char *a_line)
+    {
+        linenoiseCompletions completions = {0, NULL};
+        std::vector<std::string> lines;
+        completion(a_line, &completions);
+        for (size_t i = 0; i < completions.len; i++)
+        {
+            lines.push_back(completions.cvec[i]);
+            NNCli_Free(completions.cvec[i]);
+        }
+        NNCli_Free(completions.cvec);
+        return lines;
+    };
+
+    EXPECT_EQ(complete("paint "),
+              (std::vector<std::string>{"paint green", "paint red"}));
+    EXPECT_EQ(complete("help ; paint  r"),
+              std::vector<std::string>{"help ; paint  red"});
+    // The words after the argument are not completed, nor are commands
+    // without `m_complete_args` and filters.
+    EXPECT_EQ(complete("paint red "),
+              std::vector<std::string>{"paint red "});
+    EXPECT_EQ(complete("print-lines 1"),
+              std::vector<std::string>{"print-lines 1"});
+    EXPECT_EQ(complete("paint | grep r"),
+              std::vector<std::string>{"paint | grep r"});
+    EXPECT_EQ(complete("pai"), std::vector<std::string>{"paint"});
+}
+
+TEST_F(NNCliTest, Run_Plugins)
+{
+    char manifest[] = "/tmp/nncli_test_plugins_XXXXXX";
+    int fd = mkstemp(manifest);
+    ASSERT_NE(fd, -1);
+    close(fd);
+    std::ofstream(manifest)
+        << "plugin " NN_CLI_TEST_PLUGIN_PATH "\n"
+        << "command plugin-echo|TestPlugin_EchoCmd|Print the words|WORDS\n"
+        << "command plugin-paint|TestPlugin_EchoCmd|Paint|COLOR|"
+           "TestPlugin_CompleteColor\n";
+    InitWithPrintLinesCmd(&s_memory_backend, nullptr, false, nullptr, false,
+                          manifest);
+
+    // Listed without loading the plugin.
+    EXPECT_EQ(RunAndCaptureOutput("help ^plugin-e\n"),
+              "plugin-echo: Print the words\n");
+    std::string output = RunAndCaptureOutput("plugins\n");
+    EXPECT_NE(output.find(": not loaded\n  plugin-echo\n  plugin-paint\n"),
+              std::string::npos);
+
+    EXPECT_EQ(RunAndCaptureOutput("plugin-echo a b\n"), "a b\n");
+    EXPECT_NE(RunAndCaptureOutput("plugins\n").find(": loaded\n"),
+              std::string::npos);
+
+    linenoiseCompletions completions = {0, NULL};
+    completion("plugin-paint g", &completions);
+    ASSERT_EQ(completions.len, 1u);
+    EXPECT_STREQ(completions.cvec[0], "plugin-paint green");
+    NNCli_Free(completions.cvec[0]);
+    NNCli_Free(completions.cvec);
+    remove(manifest);
+}
+
+TEST_F(NNCliTest, Run_Help)
+{
+    InitWithPrintLinesCmd();
+    setenv("COLUMNS", "40", 1);
+
+    // Help messages are wrapped at the terminal width.
+    EXPECT_EQ(RunAndCaptureOutput("help ^print\n"),
+              "print-lines: Print the given number of\n"
+              "             lines\n");
+    EXPECT_EQ(RunAndCaptureOutput("help -lin\n"),
+              RunAndCaptureOutput("help ^print\n"));
+    EXPECT_EQ(RunAndCaptureOutput("help print-lines\n"),
+              "print-lines: Print the given number of\n"
+              "             lines\n"
+              "  usage: print-lines lines\n");
+    EXPECT_EQ(RunAndCaptureOutput("help no-such-word\n"),
+              "No command matches no-such-word\n");
+
+    // The listing is rendered again when a command is registered.
+    std::string listing = RunAndCaptureOutput("help\n");
+    EXPECT_NE(listing.find("     help: Show registered commands\n"),
+              std::string::npos);
+    EXPECT_GT(s_help_listing.m_len, 0);
+    EXPECT_EQ(RunAndCaptureOutput("help\n"), listing);
+    const NNCli_Command_t cmd = {
+        .m_func = TestCmdFunc,
+        .m_name = "test-cmd",
+        .m_options = NULL,
+        .m_help_msg = "test help msg",
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&cmd), NN_CLI__SUCCESS);
+    EXPECT_EQ(s_help_listing.m_len, 0);
+    EXPECT_NE(RunAndCaptureOutput("help\n").find("test-cmd: test help msg\n"),
+              std::string::npos);
+    unsetenv("COLUMNS");
+}
+
+TEST_F(NNCliTest, SetTerminalSize)
+{
+    s_memory_backend.m_echo = true;
+    InitWithPrintLinesCmd();
+    setenv("COLUMNS", "100", 1);
+    RunAndCaptureOutput("\r");
+    EXPECT_EQ(s_line_editor.m_columns, 100u);
+
+    // The size is cached until SIGWINCH.
+    setenv("COLUMNS", "40", 1);
+    RunAndCaptureOutput("\r");
+    EXPECT_EQ(s_line_editor.m_columns, 100u);
+    OnTerminalResize(SIGWINCH, nullptr, nullptr);
+    RunAndCaptureOutput("\r");
+    EXPECT_EQ(s_line_editor.m_columns, 40u);
+    unsetenv("COLUMNS");
+
+    EXPECT_EQ(NNCli_SetTerminalSize(0, 24), NN_CLI__INVALID_ARGS);
+    EXPECT_EQ(NNCli_SetTerminalSize(80, -1), NN_CLI__INVALID_ARGS);
+    ASSERT_EQ(NNCli_SetTerminalSize(60, 24), NN_CLI__SUCCESS);
+    RunAndCaptureOutput("\r");
+    EXPECT_EQ(s_line_editor.m_columns, 60u);
+
+    // A resize which cannot be measured keeps the given size.
+    OnTerminalResize(SIGWINCH, nullptr, nullptr);
+    int columns;
+    int rows;
+    ASSERT_EQ(NNCli_GetTerminalSize(&columns, &rows), NN_CLI__SUCCESS);
+    EXPECT_EQ(columns, 60);
+    EXPECT_EQ(rows, 24);
+}
+
+static volatile sig_atomic_t s_app_sigwinch_signo;
+
+static void AppSigwinchHandler(int a_signal, siginfo_t *a_info, void *)
+{
+    s_app_sigwinch_signo = (a_info != nullptr) ? a_info->si_signo : -1;
+}
+
+TEST_F(NNCliTest, TerminalResize_CallsSigInfoHandler)
+{
+    struct sigaction app_action;
+    struct sigaction saved_action;
+    struct sigaction prev_sigwinch_action = s_prev_sigwinch_action;
+    bool was_resize_watched = s_is_resize_watched;
+
+    memset(&app_action, 0, sizeof(app_action));
+    app_action.sa_sigaction = AppSigwinchHandler;
+    app_action.sa_flags = SA_SIGINFO;
+    sigemptyset(&app_action.sa_mask);
+    ASSERT_EQ(sigaction(SIGWINCH, &app_action, &saved_action), 0);
+    s_is_resize_watched = false;
+    WatchTerminalResize();
+
+    // The handler of the application gets its siginfo_t.
+    s_app_sigwinch_signo = 0;
+    s_is_terminal_size_stale = false;
+    raise(SIGWINCH);
+    EXPECT_TRUE(s_is_terminal_size_stale);
+    EXPECT_EQ(s_app_sigwinch_signo, SIGWINCH);
+
+    sigaction(SIGWINCH, &saved_action, nullptr);
+    s_prev_sigwinch_action = prev_sigwinch_action;
+    s_is_resize_watched = was_resize_watched;
+}
+
+TEST_F(NNCliTest, Init_InvalidIo)
+{
+    char filename[] = "/tmp/nncli_test_history_XXXXXX";
+    GenerateDummyHistoryFile(filename);
+    NNCli_Io_t io = s_memory_backend;
+    io.m_read = nullptr;
+    NNCli_Option_t option = {0};
+    option.m_history_filename = filename;
+    option.m_io = &io;
+
+    EXPECT_EQ(NNCli_Init(&option), NN_CLI__INVALID_ARGS);
+}
+
+TEST_F(NNCliTest, Run_MemoryIo)
+{
+    s_memory_backend.m_echo = true;
+    InitWithPrintLinesCmd();
+
+    // Nothing has been typed yet.
+    EXPECT_EQ(NNCli_Run(), NN_CLI__IN_PROGRESS);
+    s_memory_io.m_input = "print-l";
+    EXPECT_EQ(NNCli_Run(), NN_CLI__IN_PROGRESS);
+    s_memory_io.m_input += "ines 1\r";
+    EXPECT_EQ(NNCli_Run(), NN_CLI__SUCCESS);
+    EXPECT_EQ(s_memory_io.m_output, "> print-lines 1\r\nline 0\n> ");
+
+    s_memory_io.m_is_input_closed = true;
+    EXPECT_EQ(NNCli_Run(), NN_CLI__PROCESS_COMPLETED);
+}
+
+TEST_F(NNCliTest, Run_HistorySuggestion)
+{
+    s_memory_backend.m_echo = true;
+    InitWithPrintLinesCmd();
+    RunAndCaptureOutput("print-lines 2\r");
+    RunAndCaptureOutput("print-lines 1\r");
+
+    int color;
+    int bold;
+    EXPECT_STREQ(hints("print", &color, &bold), "-lines 1");
+    EXPECT_EQ(color, 90);
+
+    // The right arrow accepts the suggestion.
+    s_memory_io.m_input += "print-lines 2";
+    EXPECT_EQ(NNCli_Run(), NN_CLI__IN_PROGRESS);
+    s_memory_io.m_output.clear();
+    s_memory_io.m_input += "\x7f";
+    EXPECT_EQ(NNCli_Run(), NN_CLI__IN_PROGRESS);
+    EXPECT_NE(s_memory_io.m_output.find("\x1b[90m1\x1b[0m"),
+              std::string::npos);
+    std::string output = RunAndCaptureOutput("\x1b[C\r");
+    EXPECT_EQ(output.find("\r> print-lines 1\x1b[0K"), 0u);
+    EXPECT_NE(output.find("\r\nline 0\n> "), std::string::npos);
+
+    // Tab takes the suggestion in linenoise when nothing else completes, also
+    // in the first word, e.g. of a command which is not registered any more.
+    RunAndCaptureOutput("gone-cmd 1\r");
+    const std::vector<std::pair<std::string, std::string>> kTabs = {
+        {"print-lines ", "print-lines 1"},
+        {"gon", "gone-cmd 1"},
+        {"pri", "print-lines"},
+        {"x", "x"},
+    };
+    for (const auto &tab : kTabs)
+    {
+        linenoiseCompletions completions = {0, NULL};
+        completion(tab.first.c_str(), &completions);
+        ASSERT_EQ(completions.len, 1u) << tab.first;
+        EXPECT_STREQ(completions.cvec[0], tab.second.c_str()) << tab.first;
+        NNCli_Free(completions.cvec[0]);
+        NNCli_Free(completions.cvec);
+    }
+}
+
+TEST_F(NNCliTest, Run_Foreach)
+{
+    RegisterForeachCmds();
+    InitWithPrintLinesCmd();
+
+    // The outputs are in the order of the items, though the workers finish
+    // in the reverse order.
+    EXPECT_EQ(RunAndCaptureOutput("foreach {1,2,3,4,5,6,7,8} even\n"),
+              "even 1\neven 2\neven 3\neven 4\neven 5\neven 6\neven 7\n"
+              "even 8\nforeach: 4 succeeded, 4 failed\nfailed: 1 3 5 7\n");
+
+    // `{}` is replaced with the item, and the output can be filtered.
+    EXPECT_EQ(RunAndCaptureOutput(
+                  "foreach {2,4} even-in-order 1{} | grep even\n"),
+              "even-in-order 12\neven-in-order 14\n");
+    EXPECT_EQ(RunAndCaptureOutput("foreach {1,2} print-lines\n"),
+              "line 0\nline 0\nline 1\nforeach: 2 succeeded, 0 failed\n");
+
+    // A cacheable command still uses the cache.
+    EXPECT_EQ(RunAndCaptureOutput("foreach {2,2} even-cached\n"),
+              "even-cached 2\neven-cached 2\nforeach: 2 succeeded, 0 failed\n");
+    EXPECT_EQ(s_cache_stats.m_hits, 1u);
+}
+
+TEST_F(NNCliTest, Run_ForeachItemsFromFile)
+{
+    RegisterForeachCmds();
+    InitWithPrintLinesCmd();
+
+    char filename[] = "/tmp/nncli_test_items_XXXXXX";
+    GenerateDummyHistoryFile(filename);
+    FILE *fp = fopen(filename, "w");
+    ASSERT_NE(fp, nullptr);
+    fputs("2\r\n\n3\n", fp);
+    fclose(fp);
+
+    EXPECT_EQ(RunAndCaptureOutput(
+                  (std::string("foreach @") + filename + " even\n").c_str()),
+              "even 2\neven 3\nforeach: 1 succeeded, 1 failed\nfailed: 3\n");
+    unlink(filename);
+}
+
+TEST_F(NNCliTest, Run_ForeachInvalidArgs)
+{
+    RegisterForeachCmds();
+    InitWithPrintLinesCmd();
+
+    EXPECT_NE(RunAndCaptureOutput("foreach 1,2 even\n").find("incorrect"),
+              std::string::npos);
+    EXPECT_NE(RunAndCaptureOutput("foreach {1} foreach {2} even\n")
+                  .find("incorrect"),
+              std::string::npos);
+    // Nor through another command. All the items of the outer one are run.
+    std::string output =
+        RunAndCaptureOutput("foreach {2,4,6} time foreach {8} even\n");
+    size_t nested_num = 0;
+    for (size_t pos = 0; (pos = output.find("cannot be nested", pos)) !=
+                         std::string::npos;
+         pos++)
+    {
+        nested_num++;
+    }
+    EXPECT_EQ(nested_num, 3u);
+    EXPECT_EQ(output.find("even 8"), std::string::npos);
+    EXPECT_NE(output.find("foreach: 3 succeeded, 0 failed\n"),
+              std::string::npos);
+    EXPECT_EQ(RunAndCaptureOutput("foreach {1} nothing\n").substr(0, 27),
+              "Command not found: nothing\n");
+}
+
+TEST_F(NNCliTest, Execute_BeforeInit)
+{
+    char out[16];
+    EXPECT_EQ(NNCli_Execute("help", out, sizeof(out)), NN_CLI__NOT_READY);
+}
+
+TEST_F(NNCliTest, Execute_CapturesOutput)
+{
+    RegisterResumableCmds();
+    InitWithPrintLinesCmd();
+
+    char out[128];
+    EXPECT_EQ(NNCli_Execute("print-lines 3 | count", out, sizeof(out)),
+              NN_CLI__SUCCESS);
+    EXPECT_STREQ(out, "3\n");
+
+    // A command which yields runs to the end.
+    EXPECT_EQ(NNCli_Execute("countdown 2", out, sizeof(out)),
+              NN_CLI__SUCCESS);
+    EXPECT_STREQ(out, "tick 2\ntick 1\ndone\n");
+    EXPECT_FALSE(s_suspended.m_is_pending);
+
+    char small[8];
+    EXPECT_EQ(NNCli_Execute("print-lines 3", small, sizeof(small)),
+              NN_CLI__EXCEED_CAPACITY);
+    EXPECT_STREQ(small, "line 0\n");
+    EXPECT_EQ(NNCli_Execute("", small, sizeof(small)), NN_CLI__SUCCESS);
+    EXPECT_STREQ(small, "");
+
+    // The result of a failed command is returned, and so is the one of the
+    // first failure in a sequence.
+    EXPECT_EQ(NNCli_Execute("countdown", out, sizeof(out)),
+              NN_CLI__INVALID_ARGS);
+    EXPECT_EQ(NNCli_Execute("no-such-cmd ; countdown ; print-lines 1", out,
+                            sizeof(out)),
+              NN_CLI__NOT_FOUND);
+    EXPECT_STREQ(out, "[NNCli][WARN]Command args are incorrect. countdown | "
+                      "Count down one by one\nline 0\n");
+    EXPECT_EQ(NNCli_Execute("time countdown", out, sizeof(out)),
+              NN_CLI__INVALID_ARGS);
+
+    // Nothing has been written to the session.
+    EXPECT_EQ(s_memory_io.m_output, "");
+}
+
+// Prints the result of `countdown` run by NNCli_Execute().
+static NNCli_Err_t ExecuteCountdownCmdFunc(int argc, char **argv)
+{
+    char out[128];
+    printf("%d\n", NNCli_Execute("countdown", out, sizeof(out)));
+    return NN_CLI__SUCCESS;
+}
+
+TEST_F(NNCliTest, Execute_InCommand)
+{
+    const NNCli_Command_t cmd = {
+        .m_func = ExecuteCountdownCmdFunc,
+        .m_name = "execute-countdown",
+        .m_options = NULL,
+        .m_help_msg = "Run countdown with NNCli_Execute()",
+    };
+    ASSERT_EQ(NNCli_RegisterCommand(&cmd), NN_CLI__SUCCESS);
+    RegisterResumableCmds();
+    InitWithPrintLinesCmd();
+
+    // The result is of the nested line, not of the outer one which has
+    // failed before, while the outer line still fails.
+    char out[256];
+    EXPECT_EQ(NNCli_Execute("no-such-cmd ; execute-countdown", out,
+                            sizeof(out)),
+              NN_CLI__NOT_FOUND);
+    EXPECT_STREQ(out, "2\n");
+}
+
+TEST_F(NNCliTest, Execute_FromAnotherThread)
+{
+    InitWithPrintLinesCmd();
+
+    char out[64];
+    NNCli_Err_t res = NN_CLI__SUCCESS;
+    std::thread thread(
+        [&]() { res = NNCli_Execute("print-lines 1", out, sizeof(out)); });
+    thread.join();
+    EXPECT_EQ(res, NN_CLI__NOT_READY);
+}
+
+TEST_F(NNCliTest, ExecuteStream_History)
+{
+    InitWithPrintLinesCmd();
+    std::string output;
+    auto append = [](void *a_ctx, const char *a_data, size_t a_len) {
+        static_cast<std::string *>(a_ctx)->append(a_data, a_len);
+    };
+
+    EXPECT_EQ(NNCli_ExecuteStream("print-lines 1", append, &output,
+                                  NN_CLI__EXECUTE_FLAG_NONE),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(output, "line 0\n");
+    std::ifstream file(s_history_filename);
+    std::string history((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    EXPECT_EQ(history, "");
+
+    EXPECT_EQ(NNCli_ExecuteStream("print-lines 2", nullptr, nullptr,
+                                  NN_CLI__EXECUTE_FLAG_ADD_HISTORY),
+              NN_CLI__SUCCESS);
+    file.close();
+    file.open(s_history_filename);
+    history.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+    EXPECT_NE(history.find("print-lines 2\n"), std::string::npos);
+}
+
+TEST_F(NNCliTest, Trace_CommandEnd)
+{
+    RegisterResumableCmds();
+    InitWithPrintLinesCmd();
+    char out[256];
+
+    // The probe of a line has the first failure of its commands, and the
+    // lines run by `time` have their own probes.
+    s_command_ends.clear();
+    NNCli_Execute("print-lines 1", out, sizeof(out));
+    NNCli_Execute("no-such-cmd ; countdown", out, sizeof(out));
+    NNCli_Execute("time countdown", out, sizeof(out));
+    EXPECT_EQ(s_command_ends,
+              std::vector<std::string>({"command_end:print-lines:0",
+                                        "command_end:no-such-cmd:10",
+                                        "command_end:countdown:2",
+                                        "command_end:time:2"}));
+}
+
+// Calls a command through NNCli_Execute() as fast as possible.
+TEST_F(NNCliTest, Execute_Throughput)
+{
+    const int kCallNum = 100000;
+    InitWithPrintLinesCmd();
+
+    char out[64];
+    uint64_t start_ns = GetMonotonicNs();
+    for (int i = 0; i < kCallNum; i++)
+    {
+        ASSERT_EQ(NNCli_Execute("static-beta x", out, sizeof(out)),
+                  NN_CLI__SUCCESS);
+    }
+    uint64_t elapsed_ns = GetMonotonicNs() - start_ns;
+    printf("%d calls of NNCli_Execute(): %.0f commands per second\n",
+           kCallNum, kCallNum * 1e9 / elapsed_ns);
+    EXPECT_STREQ(out, "static-beta 2\n");
+}
+
+TEST_F(NNCliTest, Run_Time)
+{
+    InitWithPrintLinesCmd();
+
+    std::string output = RunAndCaptureOutput("time print-lines 2\n");
+    EXPECT_EQ(output.substr(0, 14), "line 0\nline 1\n");
+    EXPECT_EQ(output.substr(14, 5), "real ");
+    EXPECT_NE(output.find(" allocations\n"), std::string::npos);
+
+    // The output buffers of `foreach` are counted.
+    output = RunAndCaptureOutput("time foreach {1} print-lines | grep real\n");
+    unsigned long alloc_num = 0;
+    ASSERT_EQ(
+        sscanf(output.c_str(), "real %*f ms, cpu %*f ms, %lu", &alloc_num), 1);
+    EXPECT_GT(alloc_num, 0u);
+}
+
+TEST_F(NNCliTest, Run_Repeat)
+{
+    InitWithPrintLinesCmd();
+
+    // Aliases are expanded in each run.
+    RunAndCaptureOutput("alias p3 = print-lines 3\n");
+    std::string output = RunAndCaptureOutput("repeat 5 p3\n");
+    EXPECT_EQ(output.substr(0, 12), "5 runs: min ");
+    EXPECT_EQ(output.find("line"), std::string::npos);
+    EXPECT_EQ(s_printed_lines, 3);
+
+    EXPECT_NE(RunAndCaptureOutput("repeat 0 p3\n").find("incorrect"),
+              std::string::npos);
+    EXPECT_NE(RunAndCaptureOutput("repeat 2x p3\n").find("incorrect"),
+              std::string::npos);
+    EXPECT_NE(RunAndCaptureOutput("repeat 2\n").find("incorrect"),
+              std::string::npos);
+}
+
+TEST_F(NNCliTest, SetAllocator_Success)
+{
+    CountingAllocator counter;
+    NNCli_Allocator_t allocator = {CountMalloc, CountRealloc, CountFree,
+                                   &counter};
+    ASSERT_EQ(NNCli_SetAllocator(&allocator), NN_CLI__SUCCESS);
+    InitWithPrintLinesCmd();
+    int init_alloc_num = counter.m_alloc_num;
+    EXPECT_GT(init_alloc_num, 0);
+
+    // The output buffers of nn_cli and the history entries of linenoise.
+    EXPECT_EQ(RunAndCaptureOutput("foreach {1,2} print-lines | count\n"),
+              "4\n");
+    EXPECT_GT(counter.m_alloc_num, init_alloc_num);
+    EXPECT_GT(counter.m_free_num, 0);
+
+    // Blocks could be freed with another allocator after this.
+    EXPECT_EQ(NNCli_SetAllocator(nullptr), NN_CLI__NOT_READY);
+    NN_CLI__POOL_BUF(buf, 64, 1);
+    NNCli_Pool_t pool = {buf, 64, 1};
+    EXPECT_EQ(NNCli_UsePools(&pool, 1), NN_CLI__NOT_READY);
+    NNCli_PoolUsage_t usage;
+    EXPECT_EQ(NNCli_GetPoolUsage(0, &usage), NN_CLI__INVALID_ARGS);
+}
+
+TEST_F(NNCliTest, SetAllocator_Invalid)
+{
+    NNCli_Allocator_t allocator = {CountMalloc, nullptr, CountFree, nullptr};
+    EXPECT_EQ(NNCli_SetAllocator(&allocator), NN_CLI__INVALID_ARGS);
+}
+
+TEST_F(NNCliTest, Run_RpcPipelining)
+{
+    RegisterResumableCmds();
+    InitWithPrintLinesCmd(&s_memory_backend, nullptr, false, nullptr, true);
+
+    // The requests are sent at once and answered in order. Commands which
+    // yield run to the end, because the responses carry all the output.
+    s_memory_io.m_input =
+        "{\"id\": 1, \"line\": \"print-lines 2 | count\"}\n"
+        "\n"
+        "{\"id\": \"b\", \"line\": \"countdown 2\"}\n"
+        "{\"id\": 3, \"line\": \"countdown\"}\n"
+        "{\"id\": 4, \"line\": print-lines}\n"
+        "{\"id\": 6, \"line\": \"no-such-cmd ; print-lines 1\"}\n"
+        "{\"id\": 5, \"line\": \"print-l";
+    EXPECT_EQ(NNCli_Run(), NN_CLI__SUCCESS);
+    EXPECT_EQ(s_memory_io.m_output,
+              "{\"id\":1,\"status\":0,\"output\":\"2\\n\"}\n"
+              "{\"id\":\"b\",\"status\":0,"
+              "\"output\":\"tick 2\\ntick 1\\ndone\\n\"}\n"
+              "{\"id\":3,\"status\":2,\"output\":\"[NNCli][WARN]Command "
+              "args are incorrect. countdown | Count down one by one\\n\"}\n"
+              "{\"id\":4,\"status\":2,\"output\":\"\"}\n"
+              "{\"id\":6,\"status\":10,\"output\":\"line 0\\n\"}\n");
+    EXPECT_FALSE(s_suspended.m_is_pending);
+
+    // The last request has no newline before the end of the input.
+    s_memory_io.m_output.clear();
+    s_memory_io.m_input += "ines 1\"}";
+    EXPECT_EQ(NNCli_Run(), NN_CLI__IN_PROGRESS);
+    EXPECT_EQ(s_memory_io.m_output, "");
+    s_memory_io.m_is_input_closed = true;
+    EXPECT_EQ(NNCli_Run(), NN_CLI__PROCESS_COMPLETED);
+    EXPECT_EQ(s_memory_io.m_output,
+              "{\"id\":5,\"status\":0,\"output\":\"line 0\\n\"}\n");
+}
+
+TEST_F(NNCliTest, Init_RpcWithRecording)
+{
+    char filename[] = "/tmp/nncli_test_history_XXXXXX";
+    GenerateDummyHistoryFile(filename);
+    NNCli_Option_t option = {0};
+    option.m_history_filename = filename;
+    option.m_record_filename = "/tmp/nncli_test_rpc_record";
+    option.m_rpc = true;
+
+    EXPECT_EQ(NNCli_Init(&option), NN_CLI__INVALID_ARGS);
+}
+
+TEST_F(NNCliTest, Run_ThousandsOfMemorySessions)
+{
+    InitWithPrintLinesCmd();
+
+    for (int i = 0; i < 5000; i++)
+    {
+        std::string line = "print-lines " + std::to_string(i % 3) +
+                           " ; static-alpha | count\n";
+        std::string expected;
+        for (int j = 0; j < i % 3; j++)
+        {
+            expected += "line " + std::to_string(j) + "\n";
+        }
+        ASSERT_EQ(RunAndCaptureOutput(line.c_str()), expected + "1\n");
+    }
+}
+
+TEST_F(NNCliTest, Run_CommandTimeout)
+{
+    RegisterCancellableCmds();
+    InitWithPrintLinesCmd();
+
+    uint64_t start_ms = GetMonotonicMs();
+    EXPECT_EQ(RunAndCaptureOutput("wait\n"),
+              "stopped\n[NNCli][WARN]wait has been timed out\n");
+    EXPECT_GE(GetMonotonicMs() - start_ms, 30);
+    EXPECT_EQ(s_running_command, nullptr);
+}
+
+TEST_F(NNCliTest, Run_CommandTimeoutKeepsAppTimer)
+{
+    RegisterCancellableCmds();
+    InitWithPrintLinesCmd();
+
+    struct itimerval app_timer;
+    memset(&app_timer, 0, sizeof(app_timer));
+    app_timer.it_value.tv_sec = 10;
+    app_timer.it_interval.tv_sec = 5;
+    ASSERT_EQ(setitimer(ITIMER_REAL, &app_timer, nullptr), 0);
+
+    EXPECT_EQ(RunAndCaptureOutput("wait\n"),
+              "stopped\n[NNCli][WARN]wait has been timed out\n");
+
+    // The timer goes on with the time it has left.
+    struct itimerval timer;
+    ASSERT_EQ(getitimer(ITIMER_REAL, &timer), 0);
+    EXPECT_EQ(timer.it_value.tv_sec, 9);
+    EXPECT_EQ(timer.it_interval.tv_sec, 5);
+
+    memset(&app_timer, 0, sizeof(app_timer));
+    setitimer(ITIMER_REAL, &app_timer, nullptr);
+}
+
+TEST_F(NNCliTest, Run_InterruptCommand)
+{
+    RegisterCancellableCmds();
+    InitWithPrintLinesCmd();
+
+    uint64_t start_ms = GetMonotonicMs();
+    EXPECT_EQ(RunAndCaptureOutput("wait interrupt\n"),
+              "stopped\n[NNCli][WARN]wait has been interrupted\n");
+    EXPECT_LT(GetMonotonicMs() - start_ms, 30);
+}
+
+TEST_F(NNCliTest, Run_BlockedCommandTimesOut)
+{
+    RegisterCancellableCmds();
+    InitWithPrintLinesCmd();
+
+    // The deadline interrupts the blocking call, and the command returns to
+    // the prompt. It is run again rather than replayed from the cache.
+    for (int i = 0; i < 2; i++)
+    {
+        uint64_t start_ms = GetMonotonicMs();
+        EXPECT_EQ(RunAndCaptureOutput("blocked | count\n"),
+                  "1\n[NNCli][WARN]blocked has been timed out\n");
+        EXPECT_GE(GetMonotonicMs() - start_ms, 20);
+    }
+
+    // The console is still usable.
+    EXPECT_EQ(s_capture_top, nullptr);
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 1\n"), "line 0\n");
+}
+
+TEST_F(NNCliTest, Run_ResumableCommand)
+{
+    RegisterResumableCmds();
+    InitWithPrintLinesCmd();
+
+    // The rest of the line waits for the command, but the next line does not.
+    EXPECT_EQ(RunAndCaptureOutput("countdown 2 ; print-lines 1\n"),
+              "tick 2\n");
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 2 | count\n"), "tick 1\n2\n");
+    EXPECT_TRUE(s_suspended.m_is_pending);
+
+    s_memory_io.m_output.clear();
+    EXPECT_EQ(NNCli_Run(), NN_CLI__IN_PROGRESS);
+    EXPECT_EQ(s_memory_io.m_output, "done\nline 0\n");
+    EXPECT_FALSE(s_suspended.m_is_pending);
+    EXPECT_EQ(s_suspended.m_run.m_state, nullptr);
+}
+
+TEST_F(NNCliTest, Run_ResumableCommandInPipeline)
+{
+    RegisterResumableCmds();
+    InitWithPrintLinesCmd();
+
+    EXPECT_EQ(RunAndCaptureOutput("countdown 3 | grep -v 2 | count\n"), "");
+    while (s_suspended.m_is_pending)
+    {
+        EXPECT_EQ(NNCli_Run(), NN_CLI__IN_PROGRESS);
+    }
+    EXPECT_EQ(s_memory_io.m_output, "3\n");
+}
+
+TEST_F(NNCliTest, FeedInput_ResumableCommandRunsToEnd)
+{
+    RegisterResumableCmds();
+    InitWithPrintLinesCmd(nullptr);
+
+    // Without a loop to resume it, the command is called until it finishes.
+    testing::internal::CaptureStdout();
+    ASSERT_EQ(NNCli_FeedInput("countdown 2\r", 12), NN_CLI__SUCCESS);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(),
+              "> countdown 2\r\ntick 2\ntick 1\ndone\n> ");
+    EXPECT_FALSE(s_suspended.m_is_pending);
+}
+
+TEST_F(NNCliTest, Run_InputIsResponsiveDuringLongCommand)
+{
+    RegisterResumableCmds();
+    InitWithPrintLinesCmd();
+
+    uint64_t start_ms = GetMonotonicMs();
+    EXPECT_EQ(RunAndCaptureOutput("long-run\n"), "");
+    for (int i = 0; i < 20; i++)
+    {
+        uint64_t line_start_ms = GetMonotonicMs();
+        EXPECT_EQ(RunAndCaptureOutput("print-lines 1\n"), "line 0\n");
+        EXPECT_LT(GetMonotonicMs() - line_start_ms,
+                  NN_CLI__COMMAND_SLICE_MS + 50);
+    }
+    EXPECT_TRUE(s_suspended.m_is_pending);
+    EXPECT_LT(GetMonotonicMs() - start_ms, 10000);
+
+    // Ctrl-C at the prompt cancels the command in the background.
+    s_memory_io.m_input += "\x03";
+    EXPECT_EQ(NNCli_Run(), NN_CLI__IN_PROGRESS);
+    s_memory_io.m_output.clear();
+    EXPECT_EQ(NNCli_Run(), NN_CLI__IN_PROGRESS);
+    EXPECT_EQ(s_memory_io.m_output,
+              "stopped\n[NNCli][WARN]long-run has been interrupted\n");
+    EXPECT_FALSE(s_suspended.m_is_pending);
+}
+
+TEST_F(NNCliTest, LatencyTracing_Keystrokes)
+{
+    InitWithPrintLinesCmd();
+    NNCli_LatencyHistogram_t histogram;
+
+    // Nothing is measured until it is turned on.
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 1\n"), "line 0\n");
+    ASSERT_EQ(NNCli_GetLatencyHistogram(NN_CLI__LATENCY_KEYSTROKE, &histogram),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(histogram.m_count, 0);
+
+    EXPECT_EQ(RunAndCaptureOutput("latency on\n"), "");
+    EXPECT_EQ(RunAndCaptureOutput("print-lines 1\n"), "line 0\n");
+    ASSERT_EQ(NNCli_GetLatencyHistogram(NN_CLI__LATENCY_KEYSTROKE, &histogram),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(histogram.m_count, 1);
+    EXPECT_GT(histogram.m_total_ns, 0);
+    EXPECT_EQ(histogram.m_max_ns, histogram.m_total_ns);
+
+    uint32_t bucket_total = 0;
+    for (uint32_t count : histogram.m_buckets)
+    {
+        bucket_total += count;
+    }
+    EXPECT_EQ(bucket_total, histogram.m_count);
+
+    NNCli_ResetLatencyHistograms();
+    ASSERT_EQ(NNCli_GetLatencyHistogram(NN_CLI__LATENCY_KEYSTROKE, &histogram),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(histogram.m_count, 0);
+}
+
+TEST_F(NNCliTest, LatencyTracing_Callbacks)
+{
+    InitWithPrintLinesCmd();
+    NNCli_SetLatencyTracing(true);
+
+    linenoiseCompletions completions = {0, NULL};
+    int color;
+    int bold;
+    completion("print", &completions);
+    hints("print-lines", &color, &bold);
+    hints("print-lines", &color, &bold);
+    for (size_t i = 0; i < completions.len; i++)
+    {
+        NNCli_Free(completions.cvec[i]);
+    }
+    NNCli_Free(completions.cvec);
+
+    NNCli_LatencyHistogram_t histogram;
+    ASSERT_EQ(NNCli_GetLatencyHistogram(NN_CLI__LATENCY_COMPLETION, &histogram),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(histogram.m_count, 1);
+    ASSERT_EQ(NNCli_GetLatencyHistogram(NN_CLI__LATENCY_HINTS, &histogram),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(histogram.m_count, 2);
+
+    std::string output = RunAndCaptureOutput("latency\n");
+    EXPECT_NE(output.find("Latency tracing is on\n"), std::string::npos);
+    EXPECT_NE(output.find("hints: 2 samples"), std::string::npos);
+    EXPECT_NE(output.find("wakeup: no samples\n"), std::string::npos);
+
+    EXPECT_EQ(NNCli_GetLatencyHistogram(NN_CLI__LATENCY_KIND_NUM, &histogram),
+              NN_CLI__INVALID_ARGS);
+}
+
 }  // namespace testing
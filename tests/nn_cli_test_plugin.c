@@ -0,0 +1,24 @@
+// A plugin for the tests, loaded with dlopen() through a manifest.
+
+#include <stdio.h>
+
+#include "nn_cli.h"
+
+NNCli_Err_t TestPlugin_EchoCmd(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        printf("%s%s", argv[i], (i + 1 < argc) ? " " : "\n");
+    }
+    return (argc > 1) ? NN_CLI__SUCCESS : NN_CLI__INVALID_ARGS;
+}
+
+void TestPlugin_CompleteColor(int argc, char **argv,
+                              NNCli_ArgCandidates_t *a_candidates)
+{
+    if (argc == 2)
+    {
+        NNCli_AddArgCandidate(a_candidates, "red");
+        NNCli_AddArgCandidate(a_candidates, "green");
+    }
+}
@@ -0,0 +1,145 @@
+#include "nn_cli_timer_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace
+{
+struct FiredTimer
+{
+    int m_id;
+    uint64_t m_tick;
+};
+
+std::vector<FiredTimer> s_fired;
+NNCli_TimerWheel_t *s_wheel;
+
+struct TestTimer
+{
+    NNCli_Timer_t m_timer;
+    int m_id;
+    uint64_t m_interval;  // Added again with this interval if not 0
+};
+
+void OnExpired(NNCli_Timer_t *a_timer, void *a_ctx)
+{
+    TestTimer *timer = static_cast<TestTimer *>(a_ctx);
+    s_fired.push_back({timer->m_id, s_wheel->m_current_tick});
+    if (timer->m_interval != 0)
+    {
+        NNCli_TimerWheelAdd(s_wheel, a_timer,
+                            a_timer->m_expire_tick + timer->m_interval);
+    }
+}
+}  // namespace
+
+class NNCliTimerWheelTest : public ::testing::Test
+{
+   protected:
+    void SetUp() override
+    {
+        s_fired.clear();
+        NNCli_TimerWheelInit(&m_wheel, 1000);
+        s_wheel = &m_wheel;
+    }
+
+    void AddTimer(TestTimer *a_timer, int a_id, uint64_t a_expire_tick,
+                  uint64_t a_interval = 0)
+    {
+        a_timer->m_id = a_id;
+        a_timer->m_interval = a_interval;
+        NNCli_TimerInit(&a_timer->m_timer, OnExpired, a_timer);
+        NNCli_TimerWheelAdd(&m_wheel, &a_timer->m_timer, a_expire_tick);
+    }
+
+    NNCli_TimerWheel_t m_wheel;
+};
+
+namespace testing
+{
+TEST_F(NNCliTimerWheelTest, FireInOrderAcrossLevels)
+{
+    // Spread over all levels, including one beyond the range of the wheel.
+    const uint64_t expires[] = {1000 + (1ULL << 25), 1000 + 300000, 1000 + 5000,
+                                1000 + 70, 1000 + 3};
+    TestTimer timers[5];
+    for (int i = 0; i < 5; i++)
+    {
+        AddTimer(&timers[i], i, expires[i]);
+    }
+
+    for (int i = 4; i >= 0; i--)
+    {
+        uint64_t next;
+        ASSERT_TRUE(NNCli_TimerWheelGetNextExpiry(&m_wheel, &next));
+        EXPECT_EQ(next, expires[i]);
+
+        // Nothing fires until the tick just before the expiry.
+        EXPECT_EQ(NNCli_TimerWheelAdvance(&m_wheel, next - 1), 0u);
+        EXPECT_EQ(NNCli_TimerWheelAdvance(&m_wheel, next), 1u);
+        ASSERT_EQ(s_fired.size(), (size_t)(5 - i));
+        EXPECT_EQ(s_fired.back().m_id, i);
+        EXPECT_EQ(s_fired.back().m_tick, expires[i]);
+    }
+
+    uint64_t next;
+    EXPECT_FALSE(NNCli_TimerWheelGetNextExpiry(&m_wheel, &next));
+}
+
+TEST_F(NNCliTimerWheelTest, SameDeadlineFiresAtOnce)
+{
+    TestTimer timers[3];
+    for (int i = 0; i < 3; i++)
+    {
+        AddTimer(&timers[i], i, 1100);
+    }
+
+    EXPECT_EQ(NNCli_TimerWheelAdvance(&m_wheel, 2000), 3u);
+    for (const FiredTimer &fired : s_fired)
+    {
+        EXPECT_EQ(fired.m_tick, 1100u);
+    }
+}
+
+TEST_F(NNCliTimerWheelTest, Periodic)
+{
+    TestTimer timer;
+    AddTimer(&timer, 0, 1010, 10);
+
+    EXPECT_EQ(NNCli_TimerWheelAdvance(&m_wheel, 1100), 10u);
+    EXPECT_EQ(s_fired.back().m_tick, 1100u);
+    EXPECT_TRUE(NNCli_TimerIsPending(&timer.m_timer));
+
+    uint64_t next;
+    ASSERT_TRUE(NNCli_TimerWheelGetNextExpiry(&m_wheel, &next));
+    EXPECT_EQ(next, 1110u);
+}
+
+TEST_F(NNCliTimerWheelTest, Remove)
+{
+    TestTimer timers[2];
+    AddTimer(&timers[0], 0, 1005);
+    AddTimer(&timers[1], 1, 1005);
+
+    NNCli_TimerWheelRemove(&m_wheel, &timers[0].m_timer);
+    EXPECT_FALSE(NNCli_TimerIsPending(&timers[0].m_timer));
+    // Removing twice does nothing.
+    NNCli_TimerWheelRemove(&m_wheel, &timers[0].m_timer);
+
+    EXPECT_EQ(NNCli_TimerWheelAdvance(&m_wheel, 1010), 1u);
+    EXPECT_EQ(s_fired[0].m_id, 1);
+}
+
+TEST_F(NNCliTimerWheelTest, AlreadyExpired)
+{
+    TestTimer timer;
+    AddTimer(&timer, 0, 10);
+
+    uint64_t next;
+    ASSERT_TRUE(NNCli_TimerWheelGetNextExpiry(&m_wheel, &next));
+    EXPECT_EQ(next, 1001u);
+    EXPECT_EQ(NNCli_TimerWheelAdvance(&m_wheel, 1001), 1u);
+}
+
+}  // namespace testing
@@ -0,0 +1,84 @@
+#include "nn_cli_worker_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <vector>
+
+namespace
+{
+struct Jobs
+{
+    std::vector<int> m_results;
+    std::atomic<int> m_run_num{0};
+    useconds_t m_sleep_us = 0;
+};
+
+void RunJob(void *a_ctx, size_t a_index)
+{
+    Jobs *jobs = static_cast<Jobs *>(a_ctx);
+    // The later jobs finish first.
+    usleep(jobs->m_sleep_us * (jobs->m_results.size() - a_index));
+    jobs->m_results[a_index] = (int)a_index * 2;
+    jobs->m_run_num++;
+}
+}  // namespace
+
+TEST(NNCliWorkerPoolTest, WaitInOrder)
+{
+    Jobs jobs;
+    jobs.m_results.assign(20, -1);
+    jobs.m_sleep_us = 200;
+    NNCli_WorkerPool_t pool;
+
+    ASSERT_EQ(NNCli_WorkerPoolStart(&pool, 4, jobs.m_results.size(), RunJob,
+                                    &jobs),
+              NN_CLI__SUCCESS);
+    for (size_t i = 0; i < jobs.m_results.size(); i++)
+    {
+        NNCli_Err_t res;
+        while ((res = NNCli_WorkerPoolWait(&pool, i, 10)) ==
+               NN_CLI__IN_PROGRESS)
+        {
+        }
+        ASSERT_EQ(res, NN_CLI__SUCCESS);
+        EXPECT_EQ(jobs.m_results[i], (int)i * 2);
+    }
+    NNCli_WorkerPoolDestroy(&pool);
+    EXPECT_EQ(jobs.m_run_num, 20);
+}
+
+TEST(NNCliWorkerPoolTest, WaitTimesOut)
+{
+    Jobs jobs;
+    jobs.m_results.assign(1, -1);
+    jobs.m_sleep_us = 200 * 1000;
+    NNCli_WorkerPool_t pool;
+
+    ASSERT_EQ(NNCli_WorkerPoolStart(&pool, 2, 1, RunJob, &jobs),
+              NN_CLI__SUCCESS);
+    EXPECT_EQ(NNCli_WorkerPoolWait(&pool, 0, 1), NN_CLI__IN_PROGRESS);
+    EXPECT_EQ(pool.m_thread_num, 1u);
+    EXPECT_EQ(NNCli_WorkerPoolWait(&pool, 0, 1000), NN_CLI__SUCCESS);
+    NNCli_WorkerPoolDestroy(&pool);
+    EXPECT_EQ(jobs.m_results[0], 0);
+}
+
+TEST(NNCliWorkerPoolTest, StopSkipsTheRest)
+{
+    Jobs jobs;
+    jobs.m_results.assign(100, -1);
+    jobs.m_sleep_us = 100;
+    NNCli_WorkerPool_t pool;
+
+    ASSERT_EQ(NNCli_WorkerPoolStart(&pool, 2, jobs.m_results.size(), RunJob,
+                                    &jobs),
+              NN_CLI__SUCCESS);
+    NNCli_WorkerPoolStop(&pool);
+    EXPECT_EQ(NNCli_WorkerPoolWait(&pool, 99, 1000), NN_CLI__CANCELLED);
+    NNCli_WorkerPoolDestroy(&pool);
+    EXPECT_LT(jobs.m_run_num, 100);
+    EXPECT_EQ(jobs.m_results[99], -1);
+}
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""Generates the table of commands registered with NNCLI_COMMAND().
+
+The commands are sorted by name and looked up by a perfect hash (hash and
+displace), so nn_cli does not have to register or sort them at startup.
+Duplicate names are reported as errors here instead of at runtime.
+"""
+
+import argparse
+import re
+import sys
+from typing import Dict, List, NamedTuple
+
+MASK32 = 0xFFFFFFFF
+MAX_DISPLACEMENT = 0xFFFF
+
+
+class Command(NamedTuple):
+    ident: str
+    name: str
+    location: str
+
+
+def hash32(data: bytes, seed: int) -> int:
+    """Must be the same as HashBytes() in nn_cli.c."""
+    h = (2166136261 ^ seed) & MASK32
+    for byte in data:
+        h ^= byte
+        h = (h * 16777619) & MASK32
+    h ^= h >> 16
+    h = (h * 0x7FEB352D) & MASK32
+    h ^= h >> 15
+    h = (h * 0x846CA68B) & MASK32
+    h ^= h >> 16
+    return h
+
+
+def strip_comments(text: str) -> str:
+    """Blanks out comments but keeps newlines for line numbers."""
+    def blank(match: re.Match) -> str:
+        s = match.group(0)
+        if s.startswith("/"):
+            return re.sub(r"[^\n]", " ", s)
+        return s
+
+    pattern = r'//[^\n]*|/\*.*?\*/|"(?:\\.|[^"\\])*"'
+    return re.sub(pattern, blank, text, flags=re.DOTALL)
+
+
+def find_commands(path: str) -> List[Command]:
+    with open(path, encoding="utf-8") as f:
+        text = strip_comments(f.read())
+
+    commands = []
+    for match in re.finditer(r"\bNNCLI_COMMAND\s*\(\s*(\w+)\s*,", text):
+        line_start = text.rfind("\n", 0, match.start()) + 1
+        if re.match(r"\s*#\s*define\b", text[line_start:match.start()]):
+            continue
+        line = text.count("\n", 0, match.start()) + 1
+        location = f"{path}:{line}"
+        body = text[match.end():]
+        end = body.find(");")
+        name = re.search(r'\.m_name\s*=\s*"((?:\\.|[^"\\])*)"', body[:end])
+        if end < 0 or name is None:
+            raise ValueError(f"{location}: .m_name must be a string literal")
+        commands.append(Command(match.group(1), name.group(1), location))
+
+    return commands
+
+
+def build_perfect_hash(names: List[bytes]):
+    bucket_num = max(1, (len(names) + 3) // 4)
+    slot_num = 1
+    while slot_num < len(names) + len(names) // 4:
+        slot_num *= 2
+
+    buckets: List[List[int]] = [[] for _ in range(bucket_num)]
+    for i, name in enumerate(names):
+        buckets[hash32(name, 0) % bucket_num].append(i)
+
+    slots = [0] * slot_num
+    displacements = [0] * bucket_num
+    # Larger buckets are harder to place, so they are placed first.
+    for bucket in sorted(range(bucket_num), key=lambda b: -len(buckets[b])):
+        members = buckets[bucket]
+        if not members:
+            continue
+        for displacement in range(1, MAX_DISPLACEMENT + 1):
+            positions = [hash32(names[i], displacement) & (slot_num - 1)
+                         for i in members]
+            if (len(set(positions)) == len(positions)
+                    and all(slots[p] == 0 for p in positions)):
+                for i, p in zip(members, positions):
+                    slots[p] = i + 1
+                displacements[bucket] = displacement
+                break
+        else:
+            raise ValueError("Failed to build the perfect hash")
+
+    return displacements, slots
+
+
+def format_array(values: List[int]) -> str:
+    lines = []
+    for i in range(0, len(values), 12):
+        lines.append("    " + ", ".join(str(v) for v in values[i:i + 12]) + ",")
+    return "\n".join(lines)
+
+
+def generate(commands: List[Command]) -> str:
+    commands = sorted(commands, key=lambda c: c.name.encode())
+    names = [c.name.encode() for c in commands]
+    displacements, slots = build_perfect_hash(names)
+
+    out = ["// Generated by nn_cli_gen_commands.py. Do not edit.",
+           '#include "nn_cli.h"', ""]
+    for c in commands:
+        out.append(f"extern const NNCli_Command_t nn_cli_static_command_{c.ident};")
+    out += ["", "static const NNCli_Command_t *const s_commands[] = {"]
+    for c in commands:
+        out.append(f"    &nn_cli_static_command_{c.ident},  // {c.name}")
+    if not commands:
+        out.append("    0,")
+    out += ["};", "",
+            "static const uint16_t s_displacements[] = {",
+            format_array(displacements), "};", "",
+            "static const uint16_t s_slots[] = {",
+            format_array(slots), "};", "",
+            "const NNCli_StaticCommandTable_t nn_cli_static_command_table = {",
+            "    .m_commands = s_commands,",
+            f"    .m_command_num = {len(commands)},",
+            "    .m_displacements = s_displacements,",
+            f"    .m_bucket_num = {len(displacements)},",
+            "    .m_slots = s_slots,",
+            f"    .m_slot_num = {len(slots)},",
+            "};", ""]
+    return "\n".join(out)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--output", required=True)
+    parser.add_argument("sources", nargs="*")
+    args = parser.parse_args()
+
+    commands: List[Command] = []
+    try:
+        for source in args.sources:
+            commands += find_commands(source)
+    except ValueError as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    errors = []
+    by_name: Dict[str, Command] = {}
+    by_ident: Dict[str, Command] = {}
+    for c in commands:
+        if c.name in by_name:
+            errors.append(f"{c.location}: '{c.name}' command is already "
+                          f"registered at {by_name[c.name].location}")
+        if c.ident in by_ident:
+            errors.append(f"{c.location}: '{c.ident}' is already used at "
+                          f"{by_ident[c.ident].location}")
+        by_name.setdefault(c.name, c)
+        by_ident.setdefault(c.ident, c)
+    if errors:
+        for e in errors:
+            print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    text = generate(commands)
+    try:
+        with open(args.output, encoding="utf-8") as f:
+            if f.read() == text:
+                return 0
+    except FileNotFoundError:
+        pass
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""Reports the RAM and flash used by each symbol from a GNU ld map file.
+
+The map file is written with `-Wl,-Map=FILE`. Objects built with
+-ffunction-sections and -fdata-sections have one input section per symbol,
+so their sizes are exact. Other input sections are split at the global
+symbols the map lists in them.
+"""
+
+import argparse
+import re
+import sys
+from collections import defaultdict
+from typing import Dict, List, NamedTuple, Optional
+
+# Output sections which are reported, and where they are placed.
+KINDS = {
+    ".text": "flash",
+    ".rodata": "flash",
+    ".data": "flash+RAM",
+    ".bss": "RAM",
+}
+
+INPUT_SECTION = re.compile(r"^ (\.[\w.$]+)(?:\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)"
+                           r"\s+(.+))?$")
+WRAPPED_INPUT_SECTION = re.compile(
+    r"^\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(.+)$")
+SYMBOL = re.compile(r"^\s+(0x[0-9a-f]+)\s+([A-Za-z_][\w.$]*)$")
+
+
+class Symbol(NamedTuple):
+    kind: str
+    name: str
+    size: int
+    obj: str
+
+
+class InputSection(NamedTuple):
+    kind: str
+    name: str
+    address: int
+    size: int
+    obj: str
+
+
+def kind_of(section: str) -> Optional[str]:
+    """`.bss.s_cache` and `.text.unlikely` are counted as `.bss` and `.text`."""
+    for kind in KINDS:
+        if section == kind or section.startswith(kind + "."):
+            return kind
+    return None
+
+
+def parse_map(path: str) -> List[Symbol]:
+    with open(path, encoding="utf-8", errors="replace") as f:
+        lines = f.read().splitlines()
+
+    # The memory map follows the list of discarded sections.
+    try:
+        start = lines.index("Linker script and memory map")
+    except ValueError:
+        raise ValueError(f"{path}: not a GNU ld map file")
+
+    symbols: List[Symbol] = []
+    section: Optional[InputSection] = None
+    section_symbols: List[tuple] = []
+    pending_name: Optional[str] = None
+
+    def flush() -> None:
+        if section is not None and section.size > 0:
+            symbols.extend(split_section(section, section_symbols))
+
+    for line in lines[start + 1:]:
+        if pending_name is not None:
+            # A long section name is followed by its address on the next line.
+            match = WRAPPED_INPUT_SECTION.match(line)
+            name, pending_name = pending_name, None
+            if match:
+                flush()
+                section = new_section(name, match.group(1), match.group(2),
+                                      match.group(3))
+                section_symbols = []
+                continue
+
+        match = INPUT_SECTION.match(line)
+        if match:
+            if match.group(2) is None:
+                pending_name = match.group(1)
+                continue
+            flush()
+            section = new_section(match.group(1), match.group(2),
+                                  match.group(3), match.group(4))
+            section_symbols = []
+            continue
+
+        match = SYMBOL.match(line)
+        if match and section is not None:
+            section_symbols.append((int(match.group(1), 16), match.group(2)))
+            continue
+
+        if line and not line[0].isspace():
+            # An output section or another part of the map.
+            flush()
+            section = None
+            section_symbols = []
+    flush()
+    return symbols
+
+
+def new_section(name: str, address: str, size: str,
+                obj: str) -> Optional[InputSection]:
+    kind = kind_of(name)
+    if kind is None:
+        return None
+    return InputSection(kind, name, int(address, 16), int(size, 16),
+                        obj.strip())
+
+
+def split_section(section: InputSection,
+                  section_symbols: List[tuple]) -> List[Symbol]:
+    # Constants with relocations are in `.data.rel.ro.NAME`.
+    suffix = re.sub(r"^rel(\.ro)?(\.local)?\.?", "",
+                    section.name[len(section.kind) + 1:])
+    if suffix and not suffix.startswith(("unlikely", "startup", "hot")):
+        return [Symbol(section.kind, suffix, section.size, section.obj)]
+
+    end = section.address + section.size
+    inside = sorted(s for s in section_symbols
+                    if section.address <= s[0] < end)
+    if not inside:
+        return [Symbol(section.kind, f"({section.name})", section.size,
+                       section.obj)]
+
+    result = []
+    if inside[0][0] > section.address:
+        result.append(Symbol(section.kind, f"({section.name})",
+                             inside[0][0] - section.address, section.obj))
+    for i, (address, name) in enumerate(inside):
+        next_address = inside[i + 1][0] if i + 1 < len(inside) else end
+        result.append(Symbol(section.kind, name, next_address - address,
+                             section.obj))
+    return result
+
+
+def print_report(symbols: List[Symbol], top: int) -> None:
+    totals: Dict[str, int] = defaultdict(int)
+    for symbol in symbols:
+        totals[symbol.kind] += symbol.size
+
+    for kind in KINDS:
+        of_kind = sorted((s for s in symbols if s.kind == kind),
+                         key=lambda s: (-s.size, s.name))
+        if not of_kind:
+            continue
+        print(f"{kind} ({KINDS[kind]}): {totals[kind]} bytes")
+        shown = of_kind if top <= 0 else of_kind[:top]
+        for symbol in shown:
+            obj = re.sub(r"^.*/", "", symbol.obj)
+            print(f"  {symbol.size:8d}  {symbol.name:<40s} {obj}")
+        if len(shown) < len(of_kind):
+            rest = sum(s.size for s in of_kind[len(shown):])
+            print(f"  {rest:8d}  ({len(of_kind) - len(shown)} more)")
+        print()
+
+    ram = totals[".data"] + totals[".bss"]
+    flash = totals[".text"] + totals[".rodata"] + totals[".data"]
+    print(f"RAM: {ram} bytes, flash: {flash} bytes")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--filter", default="",
+                        help="only objects whose path contains this")
+    parser.add_argument("--top", type=int, default=0,
+                        help="symbols shown per section, 0 for all")
+    parser.add_argument("map_file")
+    args = parser.parse_args()
+
+    try:
+        symbols = parse_map(args.map_file)
+    except (OSError, ValueError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+
+    print_report([s for s in symbols if args.filter in s.obj], args.top)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())